@@ -548,6 +548,10 @@ CCrystalTextView::~CCrystalTextView ()
   RxFree (m_rxnode);
   m_rxnode = nullptr;
 
+  for (auto& cache : m_markerRegexCache)
+    RxFree (cache.second.rxnode);
+  m_markerRegexCache.clear ();
+
   free(m_pszMatched); // Allocated by _tcsdup()
   m_pszMatched = nullptr;
 
@@ -1991,7 +1995,17 @@ CCrystalTextView::GetMarkerTextBlocks(int nLineIndex) const
       int nLineLength = GetLineLength(nLineIndex);
       if (pszChars != nullptr)
         {
-          RxNode *node = nullptr;
+          //  Reuse the expression compiled for previous lines of this marker
+          MarkerRegex& cache = m_markerRegexCache[marker.first];
+          if (cache.rxnode != nullptr &&
+              (cache.sFindWhat != marker.second.sFindWhat || cache.dwFlags != marker.second.dwFlags))
+            {
+              RxFree (cache.rxnode);
+              cache.rxnode = nullptr;
+            }
+          cache.sFindWhat = marker.second.sFindWhat;
+          cache.dwFlags = marker.second.dwFlags;
+          RxNode *&node = cache.rxnode;
           for (const TCHAR *p = pszChars; p < pszChars + nLineLength; )
             {
               RxMatchRes matches;
@@ -2013,7 +2027,6 @@ CCrystalTextView::GetMarkerTextBlocks(int nLineIndex) const
               ++nBlocks;
               p = pszChars + nPos + (nMatchLen == 0 ? 1 : nMatchLen);
             }
-          RxFree (node);
           blocks.resize(nBlocks);
           allblocks = MergeTextBlocks(allblocks, blocks);
         }
@@ -5497,13 +5510,22 @@ PrepareDragData ()
 static const TCHAR *memstr(const TCHAR *str1, size_t str1len, const TCHAR *str2, size_t str2len)
 {
   ASSERT(str1 && str2 && str2len > 0);
-  for (const TCHAR *p = str1; p < str1 + str1len; ++p)
+  if (str1len < str2len)
+    return nullptr;
+  //  Let the CRT's vectorized character scan skip to the candidates for the
+  //  first character and only verify the rest of the pattern there.
+  const TCHAR *pLast = str1 + (str1len - str2len) + 1;
+  for (const TCHAR *p = str1; p < pLast; ++p)
     {
-      if (*p == *str2)
-        {
-          if (memcmp(p, str2, str2len * sizeof(TCHAR)) == 0)
-            return p;
-        }
+#ifdef _UNICODE
+      p = wmemchr(p, *str2, pLast - p);
+#else
+      p = static_cast<const TCHAR *>(memchr(p, *str2, pLast - p));
+#endif
+      if (p == nullptr)
+        return nullptr;
+      if (memcmp(p + 1, str2 + 1, (str2len - 1) * sizeof(TCHAR)) == 0)
+        return p;
     }
   return nullptr;
 }
@@ -5513,22 +5535,35 @@ inline TCHAR mytoupper(TCHAR ch)
     return static_cast<TCHAR>(reinterpret_cast<uintptr_t>(CharUpper(reinterpret_cast<LPTSTR>(ch))));
 }
 
+inline TCHAR mytolower(TCHAR ch)
+{
+    return static_cast<TCHAR>(reinterpret_cast<uintptr_t>(CharLower(reinterpret_cast<LPTSTR>(ch))));
+}
+
 static const TCHAR *memistr(const TCHAR *str1, size_t str1len, const TCHAR *str2, size_t str2len)
 {
   ASSERT(str1 && str2 && str2len > 0);
-  for (const TCHAR *p = str1; p < str1 + str1len; ++p)
-    {
-      if (mytoupper(*p) == mytoupper(*str2))
+  if (str1len < str2len)
+    return nullptr;
+  //  Case-fold the first character of the pattern once, so that ASCII
+  //  characters can be rejected without calling CharUpper() for each of them.
+  const TCHAR chFirstUpper = mytoupper(*str2);
+  const TCHAR chFirstLower = mytolower(chFirstUpper);
+  const TCHAR *pLast = str1 + (str1len - str2len) + 1;
+  for (const TCHAR *p = str1; p < pLast; ++p)
+    {
+      const TCHAR ch = *p;
+      if (ch != chFirstUpper && ch != chFirstLower && ch != *str2 &&
+          (static_cast<unsigned>(ch) < 0x80 || mytoupper(ch) != chFirstUpper))
+        continue;
+      size_t i;
+      for (i = 1; i < str2len; ++i)
         {
-          size_t i;
-          for (i = 0; i < str2len; ++i)
-            {
-              if (mytoupper(p[i]) != mytoupper(str2[i]))
-                break;
-            }
-          if (i == str2len)
-            return p;
+          if (p[i] != str2[i] && mytoupper(p[i]) != mytoupper(str2[i]))
+            break;
         }
+      if (i == str2len)
+        return p;
     }
   return nullptr;
 }
@@ -5540,12 +5575,12 @@ FindStringHelper (LPCTSTR pszLineBegin, size_t nLineLength, LPCTSTR pszFindWhere
     {
       ptrdiff_t pos = -1;
 
-      if (rxnode)
-        RxFree (rxnode);
-      rxnode = nullptr;
       if (pszFindWhat[0] == '^' && pszLineBegin != pszFindWhere)
         return pos;
-      rxnode = RxCompile (pszFindWhat, (dwFlags & FIND_MATCH_CASE) != 0 ? RX_CASE : 0);
+      //  The compiled expression is kept in rxnode and reused by subsequent
+      //  calls; callers reset it to nullptr when the pattern changes.
+      if (rxnode == nullptr)
+        rxnode = RxCompile (pszFindWhat, (dwFlags & FIND_MATCH_CASE) != 0 ? RX_CASE : 0);
       if (rxnode && RxExec (rxnode, pszLineBegin, nLineLength, pszFindWhere, rxmatch))
         {
           pos = rxmatch->Open[0];
@@ -5706,6 +5741,9 @@ FindTextInBlock (LPCTSTR pszText, const CPoint & ptStartPosition,
 
   CString what = pszText;
   int nEolns;
+  //  The expression is compiled on first use and reused for every line
+  RxFree (m_rxnode);
+  m_rxnode = nullptr;
   if (dwFlags & FIND_REGEXP)
     {
       nEolns = HowManyStr (what, _T("\\n"));
@@ -5813,6 +5851,8 @@ FindTextInBlock (LPCTSTR pszText, const CPoint & ptStartPosition,
             {
               int nLineLength;
               CString line;
+              LPCTSTR pszLine;
+              int nFullLength;
               if (dwFlags & FIND_REGEXP)
                 {
                   int nLines = m_pTextBuffer->GetLineCount ();
@@ -5831,6 +5871,8 @@ FindTextInBlock (LPCTSTR pszText, const CPoint & ptStartPosition,
                         }
                     }
                   nLineLength = line.GetLength ();
+                  pszLine = line;
+                  nFullLength = nLineLength;
                 }
               else
                 {
@@ -5842,16 +5884,19 @@ FindTextInBlock (LPCTSTR pszText, const CPoint & ptStartPosition,
                       continue;
                     }
 
-                  line.SetString(GetLineChars(ptCurrentPos.y), GetLineLength(ptCurrentPos.y));
+                  //  Plain text is searched in place, without copying the line
+                  pszLine = GetLineChars (ptCurrentPos.y);
+                  nFullLength = GetLineLength (ptCurrentPos.y);
                 }
 
               //  Perform search in the line
-              size_t nPos = ::FindStringHelper (line, line.GetLength (), static_cast<LPCTSTR>(line) + ptCurrentPos.x, what, dwFlags, m_nLastFindWhatLen, m_rxnode, &m_rxmatch);
+              size_t nPos = ::FindStringHelper (pszLine, nFullLength, pszLine + ptCurrentPos.x, what, dwFlags, m_nLastFindWhatLen, m_rxnode, &m_rxmatch);
               if (nPos != -1)
                 {
                   if (m_pszMatched != nullptr)
                     free(m_pszMatched);
-                  m_pszMatched = _tcsdup (line);
+                  //  Only regular expression replacement needs the matched line
+                  m_pszMatched = (dwFlags & FIND_REGEXP) ? _tcsdup (line) : nullptr;
                   if (nEolns)
                     {
                       CString item = line.Left (static_cast<LONG>(nPos));
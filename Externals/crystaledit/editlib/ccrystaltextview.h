@@ -32,6 +32,7 @@
 #pragma once
 
 #include <vector>
+#include <map>
 #include "crystalparser.h"
 #include "parsers/crystallineparser.h"
 #include "renderers/ccrystalrenderer.h"
@@ -758,6 +759,15 @@ public :
     RxNode *m_rxnode;
     RxMatchRes m_rxmatch;
     LPTSTR m_pszMatched;
+
+    /** @brief Compiled marker expression, kept until the marker changes. */
+    struct MarkerRegex
+      {
+        CString sFindWhat;
+        DWORD dwFlags = 0;
+        RxNode *rxnode = nullptr;
+      };
+    mutable std::map<CString, MarkerRegex> m_markerRegexCache;
     static LOGFONT m_LogFont;
     static RENDERING_MODE s_nRenderingModeDefault;
     RENDERING_MODE m_nRenderingMode;
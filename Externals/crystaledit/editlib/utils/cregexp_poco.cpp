@@ -34,6 +34,21 @@ struct _RxNode {
 	std::unique_ptr<RegularExpression> regexp;
 };
 
+#ifdef UNICODE
+// Number of UTF-16 code units needed for the UTF-8 sequence [p, p + len).
+// Counting lead bytes avoids converting the match back to UTF-16.
+static ptrdiff_t Utf16len_of_utf8(const char *p, size_t len) {
+	ptrdiff_t n = 0;
+	for (size_t i = 0; i < len; i++)
+	{
+		unsigned char c = static_cast<unsigned char>(p[i]);
+		if ((c & 0xC0) != 0x80)
+			n += (c >= 0xF0) ? 2 : 1;
+	}
+	return n;
+}
+#endif
+
 RxNode *RxCompile(LPCTSTR Regexp, unsigned int RxOpt) {
     RxNode *n = nullptr;
     if (Regexp == nullptr) return nullptr;
@@ -101,13 +116,10 @@ int RxExec(RxNode *Regexp, LPCTSTR Data, size_t Len, LPCTSTR Start, RxMatchRes *
 		for (i = 0; i < result; i++)
 		{
 #ifdef UNICODE
-			std::wstring utf16str;
-            if (ovector[i].offset != -1)
+            if (ovector[i].offset != std::string::npos)
             {
-                UnicodeConverter::toUTF16(std::string(compString.c_str(), ovector[i].offset), utf16str);
-                Match->Open[i] = utf16str.length();
-                UnicodeConverter::toUTF16(std::string(compString.c_str() + ovector[i].offset, ovector[i].length), utf16str);
-                Match->Close[i] = Match->Open[i] + utf16str.length();
+                Match->Open[i] = Utf16len_of_utf8(compString.c_str(), ovector[i].offset);
+                Match->Close[i] = Match->Open[i] + Utf16len_of_utf8(compString.c_str() + ovector[i].offset, ovector[i].length);
             }
             else
             {
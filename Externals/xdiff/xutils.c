@@ -22,6 +22,7 @@
 
 #include <limits.h>
 #include <assert.h>
+#include <stdint.h>
 #include "xinclude.h"
 
 
@@ -377,20 +378,64 @@ static unsigned long xdl_hash_record_with_whitespace(char const **data,
 	return ha;
 }
 
+#define XDL_ONES64 0x0101010101010101ULL
+#define XDL_HAS_ZERO_BYTE(v) (((v) - XDL_ONES64) & ~(v) & (XDL_ONES64 * 0x80))
+#define XDL_HAS_EOL_BYTE(v) \
+	(XDL_HAS_ZERO_BYTE((v) ^ (XDL_ONES64 * '\n')) | XDL_HAS_ZERO_BYTE((v) ^ (XDL_ONES64 * '\r')))
+
+/*
+ * Return the first '\n' or '\r' in [ptr, top), or top if there is none.
+ * Eight bytes are tested at a time.
+ */
+static char const *xdl_find_eol_byte(char const *ptr, char const *top) {
+	uint64_t w;
+
+	for (; top - ptr >= 8; ptr += 8) {
+		memcpy(&w, ptr, 8);
+		if (XDL_HAS_EOL_BYTE(w))
+			break;
+	}
+	for (; ptr < top && *ptr != '\n' && *ptr != '\r'; ptr++);
+	return ptr;
+}
+
+/*
+ * Hash [ptr, top) eight bytes at a time. Only used when lines are matched
+ * verbatim, so that equal lines still get equal hashes; the equivalence
+ * classes are decided by xdl_recmatch() as before.
+ */
+static unsigned long xdl_hash_bytes(char const *ptr, char const *top) {
+	uint64_t ha = 5381 ^ ((uint64_t) (top - ptr) * 0x9E3779B97F4A7C15ULL);
+	uint64_t w;
+
+	for (; top - ptr >= 8; ptr += 8) {
+		memcpy(&w, ptr, 8);
+		ha = (ha ^ w) * 0x9E3779B97F4A7C15ULL;
+		ha ^= ha >> 29;
+	}
+	if (ptr < top) {
+		w = 0;
+		memcpy(&w, ptr, top - ptr);
+		ha = (ha ^ w) * 0x9E3779B97F4A7C15ULL;
+		ha ^= ha >> 29;
+	}
+	return (unsigned long) (ha ^ (ha >> 32));
+}
+
 unsigned long xdl_hash_record(char const **data, char const *top, long flags) {
-	unsigned long ha = 5381;
 	char const *ptr = *data;
+	char const *eol;
 
 	if (flags & XDF_INEXACT_MATCH)
 		return xdl_hash_record_with_whitespace(data, top, flags);
 
-	for (; ptr < top && !is_eol(ptr, top); ptr++) {
-		ha += (ha << 5);
-		ha ^= hash_a_byte(*ptr, flags);
-	}
-	*data = ptr < top ? ptr + 1: ptr;
+	/* a CR is part of the line if it is followed by LF (see is_eol()) */
+	eol = xdl_find_eol_byte(ptr, top);
+	if (eol < top - 1 && eol[0] == '\r' && eol[1] == '\n')
+		eol++;
+	*data = eol < top ? eol + 1: eol;
 
-	return ha;
+	return xdl_hash_bytes(ptr, eol);
 }
 
 unsigned int xdl_hashbits(unsigned int size) {
@@ -7,13 +7,17 @@
 #include "pch.h"
 #include "ExConverter.h"
 #include <windows.h>
+#ifdef _WIN32
 #include <mlang.h>
+#endif
 #include <memory>
 #include <list>
 #define POCO_NO_UNWINDOWS 1
 #include <Poco/Mutex.h>
 #include "unicoder.h"
 
+#ifdef _WIN32
+
 #if !defined(__IMultiLanguage2_INTERFACE_DEFINED__) && !defined(__GNUC__)
 #error "IMultiLanguage2 is not defined in mlang.h. Please install latest Platform SDK."
 #endif
@@ -312,3 +316,16 @@ IExconverter *Exconverter::getInstance()
 	return m_pexconv;
 }
 
+#else
+
+/**
+ * @brief There is no MLang outside Windows: the codepages iconv knows are
+ * converted by unicoder, the others are not supported.
+ */
+IExconverter *Exconverter::getInstance()
+{
+	return nullptr;
+}
+
+#endif
+
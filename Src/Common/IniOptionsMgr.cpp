@@ -347,7 +347,7 @@ int CIniOptionsMgr::RemoveOption(const String& name)
 			if (key.find(strPath) == 0 && key.length() > strPath.length() && key[strPath.length()] == '/')
 			{
 				m_iniFileKeyValues.erase(key);
-				it = m_optionsMap.erase(it);
+				it = EraseOption(it);
 			}
 			else
 				++it;
@@ -30,6 +30,8 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "OptionsMgr.h"
 #include <algorithm>
 #include <cassert>
+#include <mutex>
+#include <unordered_map>
 #include <Windows.h>
 
 constexpr int MAX_PATH_FULL = 32767;
@@ -368,11 +370,64 @@ int COptionsMgr::AddOption(const String& name, const varprop::VariantValue& defa
 	COption tmpOption;
 	int retVal = tmpOption.Init(name, defaultValue);
 	if (retVal == COption::OPT_OK)
-		m_optionsMap.insert_or_assign(name, tmpOption);
+	{
+		auto it = m_optionsMap.insert_or_assign(name, tmpOption).first;
+		const size_t index = static_cast<size_t>(GetHandle(name));
+		if (index >= m_handleOptions.size())
+			m_handleOptions.resize(index + 1);
+		m_handleOptions[index] = &it->second;
+		++m_nChangeCount;
+	}
 
 	return retVal;
 }
 
+/**
+ * @brief Return handle for option name.
+ * The handle is meant to be resolved once (e.g. into a static variable) by
+ * code that reads an option often, so that the reads can skip the lookup by
+ * name. An option does not need to be added before its handle is taken.
+ * @param [in] name Option's name.
+ * @return Handle of the name.
+ */
+OptionHandle COptionsMgr::GetHandle(const String& name)
+{
+	static std::mutex mutex;
+	static std::unordered_map<String, int> handles;
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = handles.find(name);
+	if (it == handles.end())
+		it = handles.emplace(name, static_cast<int>(handles.size())).first;
+	return static_cast<OptionHandle>(it->second);
+}
+
+/**
+ * @brief Get option value by handle.
+ * @param [in] handle Handle of the option to get, see GetHandle().
+ * @return Option's value as variant type.
+ */
+const varprop::VariantValue& COptionsMgr::Get(OptionHandle handle) const
+{
+	const size_t index = static_cast<size_t>(handle);
+	if (index < m_handleOptions.size() && m_handleOptions[index] != nullptr)
+		return m_handleOptions[index]->Get();
+	return m_emptyValue;
+}
+
+/**
+ * @brief Remove option from the map, keeping the handles valid.
+ * @param [in] it Option to remove.
+ * @return Iterator following the removed option.
+ */
+OptionsMap::iterator COptionsMgr::EraseOption(OptionsMap::iterator it)
+{
+	const size_t index = static_cast<size_t>(GetHandle(it->first));
+	if (index < m_handleOptions.size())
+		m_handleOptions[index] = nullptr;
+	++m_nChangeCount;
+	return m_optionsMap.erase(it);
+}
+
 int COptionsMgr::InitOption(const String& name, int defaultValue, int minValue, int maxValue, bool serializable)
 {
 	int retVal = InitOption(name, defaultValue, serializable);
@@ -443,7 +498,10 @@ int COptionsMgr::Set(const String& name, const varprop::VariantValue& value)
 		COption tmpOption = found->second;
 		retVal = tmpOption.Set(value, true);
 		if (retVal == COption::OPT_OK)
+		{
 			m_optionsMap.insert_or_assign(name, tmpOption);
+			++m_nChangeCount;
+		}
 	}
 	else
 	{
@@ -517,13 +575,9 @@ int COptionsMgr::RemoveOption(const String& name)
 {
 	int retVal = COption::OPT_OK;
 
-	OptionsMap::const_iterator found = m_optionsMap.find(name);
+	OptionsMap::iterator found = m_optionsMap.find(name);
 	if (found != m_optionsMap.end())
-	{
-		size_t nr_removed = m_optionsMap.erase(name);
-		if (nr_removed == 0)
-			retVal = COption::OPT_NOTFOUND;
-	}
+		EraseOption(found);
 	else
 		retVal = COption::OPT_NOTFOUND;
 
@@ -544,6 +598,7 @@ int COptionsMgr::Reset(const String& name)
 		COption tmpOption = found->second;
 		tmpOption.Reset();
 		m_optionsMap.insert_or_assign(name, tmpOption);
+		++m_nChangeCount;
 	}
 	else
 	{
@@ -655,6 +710,7 @@ String COptionsMgr::ExpandShortName(const String& shortname) const
  */
 int COptionsMgr::ExportOptions(const String& filename, const bool bHexColor /*= false*/) const
 {
+#ifdef _WIN32
 	int retVal = COption::OPT_OK;
 	OptionsMap::const_iterator optIter = m_optionsMap.begin();
 	while (optIter != m_optionsMap.end() && retVal == COption::OPT_OK)
@@ -688,6 +744,10 @@ int COptionsMgr::ExportOptions(const String& filename, const bool bHexColor /*=
 		++optIter;
 	}
 	return retVal;
+#else
+	// The INI files are written with the profile API of Windows
+	return COption::OPT_ERR;
+#endif
 }
 
 /**
@@ -704,6 +764,7 @@ int COptionsMgr::ExportOptions(const String& filename, const bool bHexColor /*=
  */
 int COptionsMgr::ImportOptions(const String& filename)
 {
+#ifdef _WIN32
 	int retVal = COption::OPT_OK;
 	const int BufSize = 20480; // This should be enough for a long time..
 	TCHAR buf[BufSize] = {0};
@@ -750,6 +811,10 @@ int COptionsMgr::ImportOptions(const String& filename)
 			pKey++;
 	}
 	return retVal;
+#else
+	// The INI files are read with the profile API of Windows
+	return COption::OPT_NOTFOUND;
+#endif
 }
 
 String COptionsMgr::EscapeValue(const String& text)
@@ -93,6 +93,13 @@ inline const varprop::VariantValue& COption::GetDefault() const
 
 typedef std::map<String, COption> OptionsMap;
 
+/**
+ * @brief Handle of an option name.
+ * Names are interned process-wide, so the same name always gives the same
+ * handle regardless of which options manager it is used with.
+ */
+enum class OptionHandle : int {};
+
 /**
  * @brief Class to store list of options.
  * This class holds a list of all options (known to application). Options
@@ -110,6 +117,13 @@ public:
 	const String& GetString(const String& name) const;
 	int GetInt(const String& name) const;
 	bool GetBool(const String& name) const;
+	static OptionHandle GetHandle(const String& name);
+	const varprop::VariantValue& Get(OptionHandle handle) const;
+	const String& GetString(OptionHandle handle) const { return Get(handle).GetString(); }
+	int GetInt(OptionHandle handle) const { return Get(handle).GetInt(); }
+	bool GetBool(OptionHandle handle) const { return Get(handle).GetBool(); }
+	/** @brief Return counter incremented whenever any option value changes. */
+	unsigned GetChangeCount() const { return m_nChangeCount; }
 	int Set(const String& name, const varprop::VariantValue& value);
 	int Set(const String& name, const String& value);
 	int Set(const String& name, const TCHAR *value);
@@ -157,8 +171,12 @@ protected:
 	static String UnescapeValue(const String& text);
 	static std::pair<String, String> SplitName(const String& strName);
 
+	OptionsMap::iterator EraseOption(OptionsMap::iterator it);
+
 	OptionsMap m_optionsMap; /**< Map where options are stored. */
 
 private:
 	static varprop::VariantValue m_emptyValue;
+	std::vector<const COption *> m_handleOptions; /**< Options indexed by handle, `nullptr` if not added. */
+	unsigned m_nChangeCount = 0;
 };
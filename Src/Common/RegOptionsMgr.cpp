@@ -479,7 +479,7 @@ int CRegOptionsMgr::RemoveOption(const String& name)
 		{
 			const String& key = it->first;
 			if (key.find(strPath) == 0 && key.length() > strPath.length() && key[strPath.length()] == '/')
-				it = m_optionsMap.erase(it);
+				it = EraseOption(it);
 			else 
 				++it;
 		}
@@ -101,6 +101,7 @@ bool UniLocalFile::DoGetFileStatus()
 	try
 	{
 		m_filesize = TFile(m_filepath).getSize();
+#ifdef _WIN32
 		if (m_filesize == 0)
 		{
 			// if m_filesize equals zero, the file size is really zero or the file is a symbolic link.
@@ -113,6 +114,7 @@ bool UniLocalFile::DoGetFileStatus()
 			if (GetLastError() == 0)
 				m_filesize = ((int64_t)dwFileSizeHigh << 32) + dwFileSizeLow;
 		}
+#endif
 		m_statusFetched = 1;
 
 		return true;
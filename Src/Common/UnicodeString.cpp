@@ -17,7 +17,9 @@
 #include <cerrno>
 #include <vector>
 
+#ifdef _WIN32
 extern "C" int __stdcall StrCmpLogicalW(const wchar_t* psz1, const wchar_t* psz2);
+#endif
 
 namespace strutils
 {
@@ -191,7 +193,11 @@ int compare_nocase(const String &str1, const String &str2)
  */
 int compare_logical(const String& str1, const String& str2)
 {
+#ifdef _WIN32
 	return StrCmpLogicalW(str1.c_str(), str2.c_str());
+#else
+	return strverscmp(makelower(str1).c_str(), makelower(str2).c_str());
+#endif
 }
 
 /**
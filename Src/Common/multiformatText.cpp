@@ -42,6 +42,8 @@ using Poco::Buffer;
 
 ////////////////////////////////////////////////////////////////////////////////
 
+#ifdef _WIN32
+
 static void *GetVariantArrayData(VARIANT& array, unsigned& size)
 {
 	char * parrayData;
@@ -540,6 +542,8 @@ VARIANT * storageForPlugins::GetDataBufferAnsi()
 	}
 }
 
+#endif
+
 template<typename T, bool flipbytes>
 inline const T *findNextLine(const T *pstart, const T *pend)
 {
@@ -572,83 +576,185 @@ static const char *findNextLine(ucr::UNICODESET unicoding, const char *pstart, c
 	}
 }
 
-bool AnyCodepageToUTF8(int codepage, const String& filepath, const String& filepathDst, int & nFileChanged, bool bWriteBOM)
+/**
+ * @brief Convert UTF-16LE text to UTF-8.
+ * Runs of four ASCII characters are converted a 64-bit word at a time,
+ * which is the common case for source and resource files.
+ * Unpaired surrogates are replaced with U+FFFD.
+ * @return Number of bytes written to @p dst (at most 3 * srcbytes / 2)
+ */
+static size_t UCS2LEToUTF8(const unsigned char *src, size_t srcbytes, char *dst)
+{
+	const unsigned char *p = src;
+	const unsigned char *const end = src + (srcbytes & ~static_cast<size_t>(1));
+	char *q = dst;
+	while (p < end)
+	{
+		uint64_t w;
+		while (end - p >= 8 && (memcpy(&w, p, 8), (w & 0xFF80FF80FF80FF80ULL) == 0))
+		{
+			q[0] = static_cast<char>(p[0]);
+			q[1] = static_cast<char>(p[2]);
+			q[2] = static_cast<char>(p[4]);
+			q[3] = static_cast<char>(p[6]);
+			q += 4;
+			p += 8;
+		}
+		if (p >= end)
+			break;
+		unsigned u = p[0] | (p[1] << 8);
+		p += 2;
+		if (u < 0x80)
+		{
+			*q++ = static_cast<char>(u);
+		}
+		else if (u < 0x800)
+		{
+			*q++ = static_cast<char>(0xC0 | (u >> 6));
+			*q++ = static_cast<char>(0x80 | (u & 0x3F));
+		}
+		else
+		{
+			if (u >= 0xD800 && u < 0xDC00 && end - p >= 2)
+			{
+				unsigned u2 = p[0] | (p[1] << 8);
+				if (u2 >= 0xDC00 && u2 < 0xE000)
+				{
+					p += 2;
+					unsigned c = 0x10000 + ((u - 0xD800) << 10) + (u2 - 0xDC00);
+					*q++ = static_cast<char>(0xF0 | (c >> 18));
+					*q++ = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+					*q++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+					*q++ = static_cast<char>(0x80 | (c & 0x3F));
+					continue;
+				}
+			}
+			if (u >= 0xD800 && u < 0xE000)
+				u = 0xFFFD;
+			*q++ = static_cast<char>(0xE0 | (u >> 12));
+			*q++ = static_cast<char>(0x80 | ((u >> 6) & 0x3F));
+			*q++ = static_cast<char>(0x80 | (u & 0x3F));
+		}
+	}
+	return q - dst;
+}
+
+/**
+ * @brief Convert file contents to UTF-8, line-aligned chunk by chunk.
+ * @param [in] write Called with each converted chunk.
+ * @return `false` if file can't be opened; throws if conversion fails
+ */
+template <class Writer>
+static bool ConvertFileToUTF8(int codepage, const String& filepath, bool bWriteBOM, Writer&& write)
 {
 	UniMemFile ufile;
 	if (!ufile.OpenReadOnly(filepath))
-		return true;
+		return false;
 	ufile.ReadBom();
 	ucr::UNICODESET unicoding = ufile.GetUnicoding();
 	// Finished with examing file contents
 	ufile.Close();
 
+	// Init filedataIn struct and open file as memory mapped (input)
 	TFile fileIn(filepath);
-	try
+	SharedMemory shmIn(fileIn, SharedMemory::AM_READ);
+
+	IExconverter *pexconv = Exconverter::getInstance();
+
+	char * pszBuf = shmIn.begin();
+	size_t nBufSize = shmIn.end() - shmIn.begin();
+	size_t nSizeOldBOM = 0;
+	switch (unicoding)
 	{
-		// Init filedataIn struct and open file as memory mapped (input)
-		SharedMemory shmIn(fileIn, SharedMemory::AM_READ);
+	case ucr::UTF8:
+		nSizeOldBOM = 3;
+		break;
+	case ucr::UCS2LE:
+	case ucr::UCS2BE:
+		nSizeOldBOM = 2;
+		break;
+	}
 
-		IExconverter *pexconv = Exconverter::getInstance();
+	const size_t minbufsize = 128 * 1024;
 
-		char * pszBuf = shmIn.begin();
-		size_t nBufSize = shmIn.end() - shmIn.begin();
-		size_t nSizeOldBOM = 0;
-		switch (unicoding)
-		{
-		case ucr::UTF8:
-			nSizeOldBOM = 3;
-			break;
-		case ucr::UCS2LE:
-		case ucr::UCS2BE:
-			nSizeOldBOM = 2;
+	Buffer<char> obuf(minbufsize);
+	int64_t pos = nSizeOldBOM;
+
+	// write BOM
+	if (bWriteBOM)
+	{
+		char bom[4];
+		write(bom, ucr::writeBom(bom, ucr::UTF8));
+	}
+
+	// write data
+	for (;;)
+	{
+		size_t srcbytes = findNextLine(unicoding, pszBuf + pos + minbufsize, pszBuf + nBufSize) - (pszBuf + pos);
+		if (srcbytes == 0)
 			break;
+		if (srcbytes * 3 > obuf.size())
+			obuf.resize(srcbytes * 3 * 2, false);
+		size_t destbytes = obuf.size();
+		if (codepage == ucr::CP_UCS2LE)
+		{
+			destbytes = UCS2LEToUTF8((const unsigned char *)pszBuf+pos, srcbytes, obuf.begin());
 		}
+		else if (pexconv != nullptr)
+		{
+			size_t srcbytes2 = srcbytes;
+			if (!pexconv->convert(codepage, ucr::CP_UTF_8, (const unsigned char *)pszBuf+pos, &srcbytes2, (unsigned char *)obuf.begin(), &destbytes))
+				throw "failed to convert file contents to utf-8";
+		}
+		else
+		{
+			bool lossy = false;
+			destbytes = ucr::CrossConvert((const char *)pszBuf+pos, static_cast<unsigned>(srcbytes), obuf.begin(), static_cast<unsigned>(destbytes), codepage, ucr::CP_UTF_8, &lossy);
+		}
+		write(obuf.begin(), destbytes);
+		pos += srcbytes;
+	}
+	return true;
+}
 
-		const size_t minbufsize = 128 * 1024;
-
+bool AnyCodepageToUTF8(int codepage, const String& filepath, const String& filepathDst, int & nFileChanged, bool bWriteBOM)
+{
+	try
+	{
 		// create the destination file
 		FileOutputStream fout(ucr::toUTF8(filepathDst), std::ios::out|std::ios::binary|std::ios::trunc);
-		Buffer<char> obuf(minbufsize);
-		int64_t pos = nSizeOldBOM;
+		if (!ConvertFileToUTF8(codepage, filepath, bWriteBOM,
+				[&fout](const char *data, size_t size) { fout.write(data, size); }))
+			return true;
 
-		// write BOM
-		if (bWriteBOM)
+		nFileChanged ++;
+		return true;
+	}
+	catch (...)
+	{
+		try
 		{
-			char bom[4];
-			fout.write(bom, ucr::writeBom(bom, ucr::UTF8));
+			if (TFile(filepath).getSize() == 0)
+				return true;
 		}
-
-		// write data
-		for (;;)
+		catch (...)
 		{
-			size_t srcbytes = findNextLine(unicoding, pszBuf + pos + minbufsize, pszBuf + nBufSize) - (pszBuf + pos);
-			if (srcbytes == 0)
-				break;
-			if (srcbytes * 3 > obuf.size())
-				obuf.resize(srcbytes * 3 * 2, false);
-			size_t destbytes = obuf.size();
-			if (pexconv != nullptr)
-			{
-				size_t srcbytes2 = srcbytes;
-				if (!pexconv->convert(codepage, ucr::CP_UTF_8, (const unsigned char *)pszBuf+pos, &srcbytes2, (unsigned char *)obuf.begin(), &destbytes))
-					throw "failed to convert file contents to utf-8";
-			}
-			else
-			{
-				bool lossy = false;
-				destbytes = ucr::CrossConvert((const char *)pszBuf+pos, static_cast<unsigned>(srcbytes), obuf.begin(), static_cast<unsigned>(destbytes), codepage, ucr::CP_UTF_8, &lossy);
-			}
-			fout.write(obuf.begin(), destbytes);
-			pos += srcbytes;
 		}
+		return false;
+	}
+}
 
-		nFileChanged ++;
-		return true;
+bool AnyCodepageToUTF8(int codepage, const String& filepath, std::string& text, bool bWriteBOM)
+{
+	text.clear();
+	try
+	{
+		auto write = [&text](const char *data, size_t size) { text.append(data, size); };
+		return ConvertFileToUTF8(codepage, filepath, bWriteBOM, write);
 	}
 	catch (...)
 	{
-		if (fileIn.getSize() == 0)
-			return true;
+		text.clear();
 		return false;
 	}
 }
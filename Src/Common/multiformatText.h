@@ -10,6 +10,9 @@
 #include "UnicodeString.h"
 #include "unicoder.h"
 #include "FileTextEncoding.h"
+
+#ifdef _WIN32
+
 #include <windows.h>
 #include <oleauto.h>
 
@@ -144,8 +147,12 @@ private:
 	String m_tempFileExtensionDst;
 };
 
+#endif
+
 
 // other conversion functions
 
 /// Convert file to UTF-8 (for diffutils)
 bool AnyCodepageToUTF8(int codepage, const String& filepath, const String& filepathDst, int & nFileChanged, bool bWriteBOM);
+/// Convert file to UTF-8 in memory (for diffutils); `false` if file can't be opened or converted
+bool AnyCodepageToUTF8(int codepage, const String& filepath, std::string& text, bool bWriteBOM);
@@ -692,6 +692,7 @@ int CrossConvert(const char* src, unsigned srclen, char* dest, unsigned destsize
 	int wlen = srclen * 2 + 6;
 	auto wbuff = std::make_unique<wchar_t[]>(wlen);
 	int n;
+#ifdef _WIN32
 	if (cpin == CP_UCS2LE)
 	{
 		if (srclen == -1)
@@ -707,6 +708,7 @@ int CrossConvert(const char* src, unsigned srclen, char* dest, unsigned destsize
 		n = srclen / sizeof(wchar_t);
 	}
 	else
+#endif
 	{
 		n = MultiByteToWideChar(cpin, flags, (const char*)src, srclen, wbuff.get(), wlen - 1);
 		if (!n)
@@ -735,6 +737,7 @@ int CrossConvert(const char* src, unsigned srclen, char* dest, unsigned destsize
 		flags = 0;
 		pdefaulted = nullptr;
 	}
+#ifdef _WIN32
 	if (cpout == CP_UCS2LE)
 	{
 		memcpy(dest, wbuff.get(), n * sizeof(wchar_t));
@@ -750,6 +753,7 @@ int CrossConvert(const char* src, unsigned srclen, char* dest, unsigned destsize
 		dest[n + 1] = 0;
 	}
 	else
+#endif
 	{
 		n = WideCharToMultiByte(cpout, flags, wbuff.get(), n, dest, destsize - 1, nullptr, pdefaulted);
 		if (!n)
@@ -956,7 +960,7 @@ bool convert(UNICODESET unicoding1, int codepage1, const unsigned char * src, si
 	{
 		// simple byte copy
 		dest->resize(srcbytes + 2);
-		CopyMemory(dest->ptr, src, srcbytes);
+		memcpy(dest->ptr, src, srcbytes);
 		dest->ptr[srcbytes] = 0;
 		dest->ptr[srcbytes+1] = 0;
 		dest->size = srcbytes;
@@ -996,10 +1000,19 @@ bool convert(UNICODESET unicoding1, int codepage1, const unsigned char * src, si
 		if (destcp == CP_ACP || IsValidCodePage(destcp))
 		{
 			DWORD flags = 0;
-			int bytes = WideCharToMultiByte(destcp, flags, (LPCWSTR)src, static_cast<int>(srcbytes/2), 0, 0, nullptr, nullptr);
+			LPCWSTR wsrc = (LPCWSTR)src;
+			int wchars = static_cast<int>(srcbytes/2);
+#ifndef _WIN32
+			// wchar_t is UTF-32 here, so widen the UCS-2LE bytes first
+			std::wstring wstr(wchars, 0);
+			if (wchars > 0)
+				wchars = MultiByteToWideChar(CP_UCS2LE, flags, (LPCSTR)src, static_cast<int>(srcbytes), &wstr[0], wchars);
+			wsrc = wstr.c_str();
+#endif
+			int bytes = WideCharToMultiByte(destcp, flags, wsrc, wchars, 0, 0, nullptr, nullptr);
 			dest->resize(bytes + 2);
 			int losses = 0;
-			bytes = WideCharToMultiByte(destcp, flags, (LPCWSTR)src, static_cast<int>(srcbytes/2), (char *)dest->ptr, static_cast<int>(dest->capacity), nullptr, nullptr);
+			bytes = WideCharToMultiByte(destcp, flags, wsrc, wchars, (char *)dest->ptr, static_cast<int>(dest->capacity), nullptr, nullptr);
 			dest->ptr[bytes] = 0;
 			dest->ptr[bytes+1] = 0;
 			dest->size = bytes;
@@ -1030,9 +1043,22 @@ bool convert(UNICODESET unicoding1, int codepage1, const unsigned char * src, si
 		if (srccp == CP_ACP || IsValidCodePage(srccp))
 		{
 			DWORD flags = 0;
+#ifdef _WIN32
 			int wchars = MultiByteToWideChar(srccp, flags, (LPCSTR)src, static_cast<int>(srcbytes), 0, 0);
 			dest->resize((wchars + 1) *2);
 			wchars = MultiByteToWideChar(srccp, flags, (LPCSTR)src, static_cast<int>(srcbytes), (LPWSTR)dest->ptr, static_cast<int>(dest->capacity/2));
+#else
+			// wchar_t is UTF-32 here, so narrow the wide chars to UCS-2LE bytes
+			int wlen = MultiByteToWideChar(srccp, flags, (LPCSTR)src, static_cast<int>(srcbytes), 0, 0);
+			std::wstring wstr(wlen, 0);
+			if (wlen > 0)
+				wlen = MultiByteToWideChar(srccp, flags, (LPCSTR)src, static_cast<int>(srcbytes), &wstr[0], wlen);
+			int bytes = wlen > 0 ? WideCharToMultiByte(CP_UCS2LE, flags, wstr.c_str(), wlen, 0, 0, nullptr, nullptr) : 0;
+			dest->resize(bytes + 2);
+			if (bytes > 0)
+				bytes = WideCharToMultiByte(CP_UCS2LE, flags, wstr.c_str(), wlen, (char *)dest->ptr, bytes, nullptr, nullptr);
+			int wchars = bytes / 2;
+#endif
 			dest->ptr[wchars * 2] = 0;
 			dest->ptr[wchars * 2 + 1] = 0;
 			dest->size = wchars * 2;
@@ -1258,12 +1284,16 @@ static int NormalizeCodepage(int cp)
 {
 	if (cp == CP_THREAD_ACP) // should only happen on Win2000+
 	{
+#ifdef _WIN32
 		TCHAR buff[32];
 		if (GetLocaleInfo(GetThreadLocale(), LOCALE_IDEFAULTANSICODEPAGE, buff, sizeof(buff) / sizeof(buff[0])))
 			cp = _ttol(buff);
 		else
 			// a valid codepage is better than no codepage
 			cp = GetACP();
+#else
+		cp = GetACP();
+#endif
 	}
 	if (cp == CP_ACP) cp = GetACP();
 	if (cp == CP_OEMCP) cp = GetOEMCP();
@@ -31,7 +31,12 @@ void BinaryCompare::SetAbortable(const IAbortable * piAbortable)
 	m_piAbortable = const_cast<IAbortable*>(piAbortable);
 }
 
-static int compare_files(const String& file1, const String& file2, IAbortable *piAbortable)
+/**
+ * @brief Compare the contents of two files, byte-by-byte.
+ * @param [in] piAbortable Checked between blocks, may be nullptr.
+ * @return DIFFCODE::SAME, DIFFCODE::DIFF, DIFFCODE::CMPERR or DIFFCODE::CMPABORT
+ */
+int BinaryCompare::CompareFileContents(const String& file1, const String& file2, const IAbortable *piAbortable)
 {
 	const size_t bufsize = 1024 * 256;
 	int code;
@@ -90,12 +95,12 @@ int BinaryCompare::CompareFiles(const PathContext& files, const DIFFITEM &di) co
 	{
 	case 2:
 		return di.diffFileInfo[0].size != di.diffFileInfo[1].size ? 
-			DIFFCODE::DIFF : compare_files(files[0], files[1], m_piAbortable);
+			DIFFCODE::DIFF : CompareFileContents(files[0], files[1], m_piAbortable);
 	case 3:
 		unsigned code10 = (di.diffFileInfo[1].size != di.diffFileInfo[0].size) ?
-			DIFFCODE::DIFF : compare_files(files[1], files[0], m_piAbortable);
+			DIFFCODE::DIFF : CompareFileContents(files[1], files[0], m_piAbortable);
 		unsigned code12 = (di.diffFileInfo[1].size != di.diffFileInfo[2].size) ?
-			DIFFCODE::DIFF : compare_files(files[1], files[2], m_piAbortable);
+			DIFFCODE::DIFF : CompareFileContents(files[1], files[2], m_piAbortable);
 		unsigned code02 = DIFFCODE::SAME;
 		if (code10 == DIFFCODE::SAME && code12 == DIFFCODE::SAME)
 			return DIFFCODE::SAME;
@@ -106,7 +111,7 @@ int BinaryCompare::CompareFiles(const PathContext& files, const DIFFITEM &di) co
 		else if (code10 == DIFFCODE::DIFF && code12 == DIFFCODE::DIFF)
 		{
 			code02 = di.diffFileInfo[0].size != di.diffFileInfo[2].size ?
-				DIFFCODE::DIFF : compare_files(files[0], files[2], m_piAbortable);
+				DIFFCODE::DIFF : CompareFileContents(files[0], files[2], m_piAbortable);
 			if (code02 == DIFFCODE::SAME)
 				return DIFFCODE::DIFF | DIFFCODE::DIFF2NDONLY;
 		}
@@ -5,6 +5,8 @@
  */
 #pragma once
 
+#include "UnicodeString.h"
+
 class DIFFITEM;
 class PathContext;
 class IAbortable;
@@ -23,6 +25,7 @@ public:
 	~BinaryCompare();
 	void SetAbortable(const IAbortable * piAbortable);
 	int CompareFiles(const PathContext& files, const DIFFITEM &di) const;
+	static int CompareFileContents(const String& file1, const String& file2, const IAbortable *piAbortable);
 private:
 	IAbortable * m_piAbortable;
 };
@@ -6,10 +6,13 @@
 
 #include "pch.h"
 #include "ImageCompare.h"
+#include "BinaryCompare.h"
 #include "DiffItem.h"
 #include "PathContext.h"
+#ifdef _WIN32
 #include "WinIMergeLib.h"
 #include <Windows.h>
+#endif
 
 namespace CompareEngines
 {
@@ -17,8 +20,10 @@ namespace CompareEngines
 ImageCompare::ImageCompare()
 	: m_colorDistanceThreshold(0.0)
 	, m_pImgMergeWindow(nullptr)
+	, m_piAbortable(nullptr)
 	, m_hModule(nullptr)
 {
+#ifdef _WIN32
 	m_hModule = LoadLibraryW(L"WinIMerge\\WinIMergeLib.dll");
 	if (m_hModule == nullptr)
 		return;
@@ -27,10 +32,12 @@ ImageCompare::ImageCompare()
 	if (pfnWinIMerge_CreateWindowless == nullptr)
 		return;
 	m_pImgMergeWindow = pfnWinIMerge_CreateWindowless();
+#endif
 }
 
 ImageCompare::~ImageCompare()
 {
+#ifdef _WIN32
 	if (m_pImgMergeWindow)
 	{
 		bool(*pfnWinIMerge_DestroyWindow)(IImgMergeWindow *) =
@@ -40,10 +47,32 @@ ImageCompare::~ImageCompare()
 	}
 	if (m_hModule)
 		FreeLibrary(m_hModule);
+#endif
 }
 
-int ImageCompare::compare_files(const String& file1, const String& file2) const
+/**
+ * @brief Compare two of the files of @p di.
+ * Byte-identical files are the same image, so they are not decoded.
+ * @return DIFFCODE::SAME, DIFFCODE::DIFF, DIFFCODE::CMPERR or DIFFCODE::CMPABORT
+ */
+int ImageCompare::compare_files(const PathContext& files, const DIFFITEM &di, int index1, int index2) const
+{
+	if (di.diffFileInfo[index1].size == di.diffFileInfo[index2].size)
+	{
+		int code = BinaryCompare::CompareFileContents(files[index1], files[index2], m_piAbortable);
+		if (code == DIFFCODE::SAME || code == DIFFCODE::CMPABORT)
+			return code;
+	}
+	return compare_images(files[index1], files[index2]);
+}
+
+/**
+ * @brief Compare two image files with WinIMergeLib.
+ * Images can only be decoded on Windows; elsewhere this is a compare error.
+ */
+int ImageCompare::compare_images(const String& file1, const String& file2) const
 {
+#ifdef _WIN32
 	if (!m_pImgMergeWindow)
 		return DIFFCODE::CMPERR;
 	int code = DIFFCODE::CMPERR;
@@ -68,6 +97,9 @@ int ImageCompare::compare_files(const String& file1, const String& file2) const
 		m_pImgMergeWindow->CloseImages();
 	}
 	return code;
+#else
+	return DIFFCODE::CMPERR;
+#endif
 }
 
 /**
@@ -81,12 +113,12 @@ int ImageCompare::CompareFiles(const PathContext& files, const DIFFITEM &di) con
 	{
 	case 2:
 		return (!di.diffcode.exists(0) || !di.diffcode.exists(1)) ?
-			DIFFCODE::DIFF : compare_files(files[0], files[1]);
+			DIFFCODE::DIFF : compare_files(files, di, 0, 1);
 	case 3:
 		unsigned code10 = (!di.diffcode.exists(1) || !di.diffcode.exists(0)) ?
-			DIFFCODE::DIFF : compare_files(files[1], files[0]);
+			DIFFCODE::DIFF : compare_files(files, di, 1, 0);
 		unsigned code12 = (!di.diffcode.exists(1) || !di.diffcode.exists(2)) ?
-			DIFFCODE::DIFF : compare_files(files[1], files[2]);
+			DIFFCODE::DIFF : compare_files(files, di, 1, 2);
 		unsigned code02 = DIFFCODE::SAME;
 		if (code10 == DIFFCODE::SAME && code12 == DIFFCODE::SAME)
 			return DIFFCODE::SAME;
@@ -97,7 +129,7 @@ int ImageCompare::CompareFiles(const PathContext& files, const DIFFITEM &di) con
 		else if (code10 == DIFFCODE::DIFF && code12 == DIFFCODE::DIFF)
 		{
 			code02 = (!di.diffcode.exists(0) || !di.diffcode.exists(2)) ?
-				DIFFCODE::DIFF : compare_files(files[0], files[2]);
+				DIFFCODE::DIFF : compare_files(files, di, 0, 2);
 			if (code02 == DIFFCODE::SAME)
 				return DIFFCODE::DIFF | DIFFCODE::DIFF2NDONLY;
 		}
@@ -11,6 +11,7 @@
 
 class DIFFITEM;
 class PathContext;
+class IAbortable;
 struct IImgMergeWindow;
 
 namespace CompareEngines
@@ -19,6 +20,8 @@ namespace CompareEngines
 /**
  * @brief A image compare class.
  * This compare method compares files by their image contents.
+ * Files of the same size are first compared byte-by-byte, and files with
+ * identical contents are not decoded at all.
  */
 class ImageCompare
 {
@@ -29,9 +32,12 @@ public:
 
     double GetColorDistanceThreshold() const { return m_colorDistanceThreshold; }
     void SetColorDistanceThreshold(double colorDistanceThreshold) { m_colorDistanceThreshold = colorDistanceThreshold; };
+    void SetAbortable(const IAbortable * piAbortable) { m_piAbortable = piAbortable; }
 private:
-    int compare_files(const String& file1, const String& file2) const;
+    int compare_files(const PathContext& files, const DIFFITEM &di, int index1, int index2) const;
+    int compare_images(const String& file1, const String& file2) const;
     mutable IImgMergeWindow *m_pImgMergeWindow;
+    const IAbortable * m_piAbortable;
     double m_colorDistanceThreshold;
     HMODULE m_hModule;
 };
@@ -17,6 +17,11 @@
 CompareStats::CompareStats(int nDirs)
 : m_nTotalItems(0)
 , m_nComparedItems(0)
+, m_nTranscodedBytes(0)
+, m_nTempBytesAvoided(0)
+, m_nPrefetchQueueDepth(0)
+, m_nPrefetchDepth(0)
+, m_nCompareQueueDepth(0)
 , m_state(STATE_IDLE)
 , m_bCompareDone(false)
 , m_nDirs(nDirs)
@@ -45,6 +50,21 @@ void CompareStats::AddItem(int code)
 	assert(m_nComparedItems <= m_nTotalItems);
 }
 
+/**
+ * @brief Remove a compared item from the stats, when items are merged.
+ * @param [in] code Resultcode of the removed item.
+ */
+void CompareStats::RemoveItem(int code)
+{
+	if (code != -1)
+	{
+		RESULT res = GetResultFromCode(code);
+		m_counts[static_cast<int>(res)] -= 1;
+	}
+	--m_nComparedItems;
+	--m_nTotalItems;
+}
+
 /**
 * @brief Return item taking most time among current items.
 */
@@ -80,6 +100,11 @@ void CompareStats::Reset()
 	SetCompareState(STATE_IDLE);
 	m_nTotalItems = 0;
 	m_nComparedItems = 0;
+	m_nTranscodedBytes = 0;
+	m_nTempBytesAvoided = 0;
+	m_nPrefetchQueueDepth = 0;
+	m_nPrefetchDepth = 0;
+	m_nCompareQueueDepth = 0;
 	m_bCompareDone = false;
 }
 
@@ -8,6 +8,7 @@
 #include <atomic>
 #include <vector>
 #include <array>
+#include <cstdint>
 
 class DIFFITEM;
 
@@ -80,7 +81,13 @@ public:
 		rThreadState.m_nHitCount = 0;
 		rThreadState.m_pDiffItem = di;
 	}
+	void ClearCurDiffItems()
+	{
+		for (auto& rThreadState : m_rgThreadState)
+			rThreadState.m_pDiffItem = nullptr;
+	}
 	void AddItem(int code);
+	void RemoveItem(int code);
 	void IncreaseTotalItems(int count = 1);
 	int GetCount(CompareStats::RESULT result) const;
 	int GetTotalItems() const;
@@ -93,11 +100,24 @@ public:
 	CompareStats::RESULT GetResultFromCode(unsigned diffcode) const;
 	void Swap(int idx1, int idx2);
 	int GetCompareDirs() const { return m_nDirs; }
+	void AddTranscodedBytes(int64_t nBytes, int64_t nTempBytesAvoided);
+	int64_t GetTranscodedBytes() const { return m_nTranscodedBytes; }
+	int64_t GetTempBytesAvoided() const { return m_nTempBytesAvoided; }
+	void SetPrefetchQueueDepth(int nQueued, int nReading);
+	void SetCompareQueueDepth(int nQueued) { m_nCompareQueueDepth = nQueued; }
+	int GetPrefetchQueueDepth() const { return m_nPrefetchQueueDepth; }
+	int GetPrefetchDepth() const { return m_nPrefetchDepth; }
+	int GetCompareQueueDepth() const { return m_nCompareQueueDepth; }
 
 private:
 	std::array<std::atomic_int, RESULT_COUNT> m_counts; /**< Table storing result counts */
 	std::atomic_int m_nTotalItems; /**< Total items found to compare */
 	std::atomic_int m_nComparedItems; /**< Compared items so far */
+	std::atomic<int64_t> m_nTranscodedBytes; /**< Bytes of files converted to UTF-8 for diffing */
+	std::atomic<int64_t> m_nTempBytesAvoided; /**< UTF-8 bytes kept in memory instead of temp files */
+	std::atomic_int m_nPrefetchQueueDepth; /**< Items waiting to be read ahead */
+	std::atomic_int m_nPrefetchDepth; /**< Files allowed to be read ahead at once */
+	std::atomic_int m_nCompareQueueDepth; /**< Items waiting for a compare thread */
 	CMP_STATE m_state; /**< State for compare (idle, collect, compare,..) */
 	bool m_bCompareDone; /**< Have we finished last compare? */
 	int m_nDirs; /**< number of directories to compare */
@@ -139,6 +159,30 @@ inline int CompareStats::GetTotalItems() const
 	return m_nTotalItems;
 }
 
+/**
+ * @brief Count files converted to UTF-8 for diffutils.
+ * @param [in] nBytes Size of converted files.
+ * @param [in] nTempBytesAvoided Size of converted text kept in memory
+ *  instead of written to temp files.
+ */
+inline void CompareStats::AddTranscodedBytes(int64_t nBytes, int64_t nTempBytesAvoided)
+{
+	m_nTranscodedBytes += nBytes;
+	m_nTempBytesAvoided += nTempBytesAvoided;
+}
+
+/**
+ * @brief Update the state of the stage reading files ahead of compare threads.
+ * @param [in] nQueued Items waiting to be read ahead.
+ * @param [in] nReading Files currently allowed to be read ahead at once,
+ *  0 if files are not read ahead.
+ */
+inline void CompareStats::SetPrefetchQueueDepth(int nQueued, int nReading)
+{
+	m_nPrefetchQueueDepth = nQueued;
+	m_nPrefetchDepth = nReading;
+}
+
 /**
  * @brief Return current comparestate.
  */
@@ -12,11 +12,18 @@
 
 #include "pch.h"
 #include "ConflictFileParser.h"
+#include <cstdio>
+#include <memory>
+#include <string_view>
+#include <Poco/Exception.h>
+#include <Poco/SharedMemory.h>
 #include "UnicodeString.h"
 #include "UniFile.h"
 #include "FileTextEncoding.h"
 #include "codepage_detect.h"
+#include "TFile.h"
 
+using Poco::SharedMemory;
 
 // Note: keep these strings in "wrong" order so we can resolve this file :)
 /** @brief String separating Mine and Theirs blocks. */
@@ -28,49 +35,157 @@ static const TCHAR MineBegin[] = _T("<<<<<<< ");
 /** @brief String starting Base block (and conflict). */
 static const TCHAR BaseBegin[] = _T("||||||| ");
 
-namespace ConflictFileParser
+namespace
+{
+
+/** @brief The markers above, as bytes of 8-bit and UTF-8 files. */
+constexpr std::string_view SeparatorBytes = "=======";
+constexpr std::string_view TheirsEndBytes = ">>>>>>> ";
+constexpr std::string_view MineBeginBytes = "<<<<<<< ";
+constexpr std::string_view BaseBeginBytes = "||||||| ";
+
+/** @brief BOM of UTF-8 files, it is not part of the first line. */
+constexpr std::string_view Utf8Bom = "\xEF\xBB\xBF";
+
+/** @brief Every marker has a run of this many equal chars. */
+constexpr size_t MarkerRunLength = 7;
+
+/** @brief Revisions a part of the conflict file goes to. */
+enum : unsigned
+{
+	WorkingCopy = 1,
+	NewRevision = 2,
+	BaseRevision = 4,
+	AllRevisions = WorkingCopy | NewRevision | BaseRevision,
+};
+
+inline bool IsMarkerChar(char ch)
+{
+	return ch == '<' || ch == '=' || ch == '>' || ch == '|';
+}
+
+inline bool IsEolChar(char ch)
+{
+	return ch == '\n' || ch == '\r';
+}
+
+/** @brief Size of the UTF-8 BOM at the beginning of the text, 0 if none. */
+inline size_t GetBomLength(const char *pchText, size_t cbText)
 {
+	return std::string_view(pchText, cbText).substr(0, Utf8Bom.length()) == Utf8Bom ? Utf8Bom.length() : 0;
+}
 
 /**
- * @brief Check if the file is a conflict file.
- * This function checks if the conflict file marker is found from given file.
- * This is faster than trying to parse a file that is not conflict file.
- * @param [in] conflictFileName Full path to file to check.
- * @return true if given file is a conflict file, false otherwise.
+ * @brief Find a run of MarkerRunLength equal marker chars.
+ * Every such run covers one of the bytes MarkerRunLength apart, so only
+ * those are looked at until one of them is a marker char.
+ * @return Offset of a byte of the run, @p cbText if there is none.
  */
-bool IsConflictFile(const String& conflictFileName)
+size_t FindMarkerRun(const char *pchText, size_t cbText, size_t pos)
 {
-	UniMemFile conflictFile;
-	bool startFound = false;
+	for (size_t i = pos + MarkerRunLength - 1; i < cbText; i += MarkerRunLength)
+	{
+		const char ch = pchText[i];
+		if (!IsMarkerChar(ch))
+			continue;
+		size_t begin = i;
+		while (begin > pos && pchText[begin - 1] == ch)
+			--begin;
+		size_t end = i + 1;
+		while (end < cbText && end - begin < MarkerRunLength && pchText[end] == ch)
+			++end;
+		if (end - begin >= MarkerRunLength)
+			return i;
+	}
+	return cbText;
+}
 
-	// open input file
-	bool success = conflictFile.OpenReadOnly(conflictFileName);
-	if (!success)
-		return false;
+/**
+ * @brief Collects the slices of the three revisions, joining adjacent ones.
+ */
+class RevisionSlices
+{
+public:
+	RevisionSlices(ConflictFileParser::Slices& workingCopy, ConflictFileParser::Slices& newRevision, ConflictFileParser::Slices& baseRevision)
+		: m_slices{ &workingCopy, &newRevision, &baseRevision }
+	{
+	}
 
-	// Search for a conflict marker
-	bool linesToRead = true;
-	while (linesToRead && !startFound)
+	void Add(unsigned revisions, size_t offset, size_t length)
 	{
-		String line;
-		bool lossy;
-		String eol;
-		linesToRead = conflictFile.ReadString(line, eol, &lossy);
+		if (length == 0)
+			return;
+		for (int i = 0; i < 3; ++i)
+		{
+			if ((revisions & (1u << i)) == 0)
+				continue;
+			ConflictFileParser::Slices& slices = *m_slices[i];
+			if (!slices.empty() && slices.back().offset + slices.back().length == offset)
+				slices.back().length += length;
+			else
+				slices.push_back({ offset, length });
+		}
+	}
+
+private:
+	ConflictFileParser::Slices *m_slices[3];
+};
 
-		std::string::size_type pos;
-		pos = line.find(MineBegin);
-		if (pos == 0)
-			startFound = true;
+/**
+ * @brief Read-only view of a whole file.
+ */
+class FileView
+{
+public:
+	explicit FileView(const String& path)
+	{
+		try
+		{
+			TFile file(path);
+			if (file.getSize() > 0)
+				m_pMapping.reset(new SharedMemory(file, SharedMemory::AM_READ));
+			m_bOpen = true;
+		}
+		catch (Poco::Exception&)
+		{
+		}
 	}
-	conflictFile.Close();
+	bool IsOpen() const { return m_bOpen; }
+	const char *GetData() const { return m_pMapping ? m_pMapping->begin() : nullptr; }
+	size_t GetSize() const { return m_pMapping ? m_pMapping->end() - m_pMapping->begin() : 0; }
+
+private:
+	std::unique_ptr<SharedMemory> m_pMapping;
+	bool m_bOpen = false;
+};
+
+/**
+ * @brief Write the slices of one revision to a file.
+ */
+bool WriteSlices(const String& fileName, const FileView& view, const ConflictFileParser::Slices& slices)
+{
+	FILE *fp = nullptr;
+	if (_tfopen_s(&fp, fileName.c_str(), _T("wb")) != 0)
+		return false;
+	bool bWritten = true;
+	for (const auto& slice : slices)
+	{
+		if (fwrite(view.GetData() + slice.offset, 1, slice.length, fp) != slice.length)
+		{
+			bWritten = false;
+			break;
+		}
+	}
+	if (fclose(fp) != 0)
+		bWritten = false;
+	return bWritten;
+}
 
-	return startFound;
 }
 
 /**
- * @brief Parse a conflict file to separate files.
- * This function parses a conflict file to two different files which can be
- * opened into WinMerge's file compare.
+ * @brief Parse a conflict file to separate files one line at a time.
+ * Used for UTF-16 and UTF-32 files, whose markers are not single bytes.
  * @param [in] conflictFileName Full path to conflict file.
  * @param [in] workingCopyFileName Full path for user's modified file in
  *  working copy/working folder.
@@ -79,7 +194,7 @@ bool IsConflictFile(const String& conflictFileName)
  * @param [out] bNestedConflicts returned as true if nested conflicts found.
  * @return true if conflict file was successfully parsed, false otherwise.
  */
-bool ParseConflictFile(const String& conflictFileName,
+static bool ParseConflictFileByLines(const String& conflictFileName,
 		const String& workingCopyFileName, const String& newRevisionFileName, const String& baseRevisionFileName,
 		int iGuessEncodingType, bool &bNestedConflicts, bool &b3way)
 {
@@ -328,4 +443,234 @@ bool ParseConflictFile(const String& conflictFileName,
 	return bResult;
 }
 
+namespace ConflictFileParser
+{
+
+/**
+ * @brief Check if the file is a conflict file.
+ * This function checks if the conflict file marker is found from given file.
+ * This is faster than trying to parse a file that is not conflict file.
+ * @param [in] conflictFileName Full path to file to check.
+ * @return true if given file is a conflict file, false otherwise.
+ */
+bool IsConflictFile(const String& conflictFileName)
+{
+	FileView view(conflictFileName);
+	const char *pchText = view.GetData();
+	const size_t cbText = view.GetSize();
+	const size_t textBegin = GetBomLength(pchText, cbText);
+
+	// Search for a conflict marker at the beginning of a line
+	for (size_t pos = FindMarkerRun(pchText, cbText, textBegin); pos < cbText; pos = FindMarkerRun(pchText, cbText, pos + 1))
+	{
+		size_t begin = pos;
+		while (begin > textBegin && pchText[begin - 1] == '<')
+			--begin;
+		if ((begin == textBegin || IsEolChar(pchText[begin - 1])) &&
+			std::string_view(pchText + begin, cbText - begin).substr(0, MineBeginBytes.length()) == MineBeginBytes)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Split the text of a conflict file into three revisions.
+ * The text is scanned once. Lines without a run of marker chars go to the
+ * revisions of the current section as they are, so all of them up to the
+ * next possible marker are added at once. The revisions are slices of
+ * @p pchText, lines keep their EOL bytes. A UTF-8 BOM goes to all revisions.
+ * @param [in] pchText Text of an 8-bit or UTF-8 conflict file.
+ * @param [in] cbText Size of the text in bytes.
+ * @param [out] workingCopy Slices of user's modified file.
+ * @param [out] newRevision Slices of the revision control file.
+ * @param [out] baseRevision Slices of the base revision.
+ * @param [out] bNestedConflicts returned as true if nested conflicts found.
+ * @param [out] b3way returned as true if the conflicts have base sections.
+ * @return true if a conflict was found, false otherwise.
+ */
+bool SplitConflictText(const char *pchText, size_t cbText,
+		Slices& workingCopy, Slices& newRevision, Slices& baseRevision,
+		bool &bNestedConflicts, bool &b3way)
+{
+	// Revisions the lines of each state go to
+	static const unsigned StateRevisions[] = {
+		AllRevisions, WorkingCopy, NewRevision, WorkingCopy, NewRevision, BaseRevision
+	};
+	RevisionSlices revisions(workingCopy, newRevision, baseRevision);
+	int state = 0;
+	int iNestingLevel = 0;
+	bool bResult = false;
+	bNestedConflicts = false;
+	b3way = false;
+
+	size_t pos = GetBomLength(pchText, cbText);
+	revisions.Add(AllRevisions, 0, pos);
+	while (pos < cbText)
+	{
+		// Lines before the line of the next marker run have no markers
+		const size_t run = FindMarkerRun(pchText, cbText, pos);
+		size_t lineBegin = run;
+		while (lineBegin > pos && !IsEolChar(pchText[lineBegin - 1]))
+			--lineBegin;
+		revisions.Add(StateRevisions[state], pos, lineBegin - pos);
+		pos = lineBegin;
+		if (pos >= cbText)
+			break;
+
+		size_t eolBegin = run;
+		while (eolBegin < cbText && !IsEolChar(pchText[eolBegin]))
+			++eolBegin;
+		size_t eolEnd = eolBegin;
+		if (eolEnd < cbText)
+		{
+			if (pchText[eolEnd++] == '\r' && eolEnd < cbText && pchText[eolEnd] == '\n')
+				++eolEnd;
+		}
+		const std::string_view line(pchText + pos, eolBegin - pos);
+		const size_t eolLength = eolEnd - eolBegin;
+		const unsigned lineRevisions = StateRevisions[state];
+		// Writes the text before a marker and the EOL, like the whole line
+		auto addPrefix = [&](unsigned revision, size_t length)
+		{
+			if (length > 0)
+			{
+				revisions.Add(revision, pos, length);
+				revisions.Add(revision, eolBegin, eolLength);
+			}
+		};
+
+		size_t found;
+		switch (state)
+		{
+			// in common section
+		case 0:
+			// search beginning of conflict section
+			if (line.substr(0, MineBeginBytes.length()) == MineBeginBytes)
+			{
+				// working copy section starts
+				state = 1;
+				bResult = true;
+			}
+			else
+				revisions.Add(lineRevisions, pos, eolEnd - pos);
+			break;
+
+			// in working copy section
+		case 1:
+			if (line.substr(0, MineBeginBytes.length()) == MineBeginBytes)
+			{
+				// nested conflict section starts
+				state = 3;
+				bNestedConflicts = true;
+				revisions.Add(lineRevisions, pos, eolEnd - pos);
+			}
+			else if ((found = line.find(BaseBeginBytes)) != std::string_view::npos)
+			{
+				addPrefix(BaseRevision, found);
+				// base revision section
+				state = 5;
+				b3way = true;
+			}
+			else if ((found = line.find(SeparatorBytes)) != std::string_view::npos && found == line.length() - SeparatorBytes.length())
+			{
+				addPrefix(WorkingCopy, found);
+				//  new revision section
+				state = 2;
+			}
+			else
+				revisions.Add(lineRevisions, pos, eolEnd - pos);
+			break;
+
+			// in new revision section
+		case 2:
+			if (line.substr(0, MineBeginBytes.length()) == MineBeginBytes)
+			{
+				// nested conflict section starts
+				state = 4;
+				revisions.Add(lineRevisions, pos, eolEnd - pos);
+			}
+			else if ((found = line.find(TheirsEndBytes)) != std::string_view::npos)
+			{
+				addPrefix(NewRevision, found);
+				//  common section
+				state = 0;
+			}
+			else
+				revisions.Add(lineRevisions, pos, eolEnd - pos);
+			break;
+
+			// in nested section in working copy or new revision section
+		case 3:
+		case 4:
+			if (line.substr(0, MineBeginBytes.length()) == MineBeginBytes)
+				iNestingLevel++;
+			else if (line.find(TheirsEndBytes) != std::string_view::npos)
+			{
+				if (iNestingLevel == 0)
+					state = (state == 3) ? 1 : 2;
+				else
+					iNestingLevel--;
+			}
+			revisions.Add(lineRevisions, pos, eolEnd - pos);
+			break;
+
+			// in base revision section
+		case 5:
+			if ((found = line.find(SeparatorBytes)) != std::string_view::npos && found == line.length() - SeparatorBytes.length())
+			{
+				addPrefix(BaseRevision, found);
+				//  new revision section
+				state = 2;
+			}
+			else
+				revisions.Add(lineRevisions, pos, eolEnd - pos);
+			break;
+		}
+		pos = eolEnd;
+	}
+	return bResult;
+}
+
+/**
+ * @brief Parse a conflict file to separate files.
+ * This function parses a conflict file to two different files which can be
+ * opened into WinMerge's file compare. 8-bit and UTF-8 files are mapped and
+ * split by SplitConflictText(), and the revisions are written from the
+ * mapped file as they are.
+ * @param [in] conflictFileName Full path to conflict file.
+ * @param [in] workingCopyFileName Full path for user's modified file in
+ *  working copy/working folder.
+ * @param [in] newRevisionFileName Full path for revision control file.
+ * @param [in] baseRevisionFileName Full path for base revision file.
+ * @param [in] iGuessEncodingType Try to guess codepage (not just unicode encoding)
+ * @param [out] bNestedConflicts returned as true if nested conflicts found.
+ * @param [out] b3way returned as true if the conflicts have base sections.
+ * @return true if conflict file was successfully parsed, false otherwise.
+ */
+bool ParseConflictFile(const String& conflictFileName,
+		const String& workingCopyFileName, const String& newRevisionFileName, const String& baseRevisionFileName,
+		int iGuessEncodingType, bool &bNestedConflicts, bool &b3way)
+{
+	FileTextEncoding encoding = codepage_detect::Guess(conflictFileName, iGuessEncodingType);
+	if (encoding.m_unicoding != ucr::NONE && encoding.m_unicoding != ucr::UTF8)
+		return ParseConflictFileByLines(conflictFileName, workingCopyFileName, newRevisionFileName, baseRevisionFileName,
+			iGuessEncodingType, bNestedConflicts, b3way);
+
+	bNestedConflicts = false;
+	b3way = false;
+	FileView view(conflictFileName);
+	if (!view.IsOpen())
+		return false;
+
+	Slices slices[3];
+	bool bResult = SplitConflictText(view.GetData(), view.GetSize(), slices[0], slices[1], slices[2], bNestedConflicts, b3way);
+	if (!WriteSlices(workingCopyFileName, view, slices[0]))
+		bResult = false;
+	if (!WriteSlices(newRevisionFileName, view, slices[1]))
+		bResult = false;
+	if (!WriteSlices(baseRevisionFileName, view, slices[2]))
+		bResult = false;
+	return bResult;
+}
+
 }
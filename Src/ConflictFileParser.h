@@ -11,12 +11,27 @@
 
 #pragma once
 
+#include <vector>
 #include "UnicodeString.h"
 
 namespace ConflictFileParser
 {
+/** @brief Part of a conflict file, in bytes. */
+struct Slice
+{
+	size_t offset;
+	size_t length;
+};
+
+/** @brief Parts of a conflict file making up one revision, in order. */
+using Slices = std::vector<Slice>;
+
 bool IsConflictFile(const String& conflictFileName);
 
+bool SplitConflictText(const char *pchText, size_t cbText,
+		Slices& workingCopy, Slices& newRevision, Slices& baseRevision,
+		bool &bNestedConflicts, bool &b3way);
+
 bool ParseConflictFile(const String& conflictFileName,
 		const String& workingCopyFileName, const String& newRevisionFileName, const String& baseRevisionFileName,
 		int iGuessEncodingType, bool &nestedConflicts, bool &b3way);
@@ -14,10 +14,13 @@
 #include "DiffContext.h"
 #include <Poco/ScopedLock.h>
 #include "CompareOptions.h"
+#ifdef _WIN32
 #include "VersionInfo.h"
+#endif
 #include "paths.h"
 #include "codepage_detect.h"
 #include "DiffItemList.h"
+#include "DiffSnapshot.h"
 #include "IAbortable.h"
 #include "DiffWrapper.h"
 #include "DebugNew.h"
@@ -51,11 +54,15 @@ CDiffContext::CDiffContext(const PathContext & paths, int compareMethod)
 , m_bPluginsEnabled(false)
 , m_bRecursive(false)
 , m_bWalkUniques(true)
+, m_bDetectMovedItems(false)
+, m_nMovedSimilarity(0)
 , m_bIgnoreReparsePoints(false)
 , m_bIgnoreCodepage(false)
 , m_iGuessEncodingType(0)
 , m_nQuickCompareLimit(0)
 , m_nBinaryCompareLimit(0)
+, m_nTranscodeInMemoryLimit(0)
+, m_nStreamingDiffMemoryLimit(0)
 , m_bEnableImageCompare(false)
 , m_pImgfileFilter(nullptr)
 , m_dColorDistanceThreshold(0.0)
@@ -150,12 +157,14 @@ void CDiffContext::UpdateVersion(DIFFITEM &di, int nIndex) const
 	spath = di.getFilepath(nIndex, GetNormalizedPath(nIndex));
 	spath = paths::ConcatPath(spath, di.diffFileInfo[nIndex].filename);
 	
+#ifdef _WIN32
 	// Get version info if it exists
 	CVersionInfo ver(spath.c_str());
 	unsigned verMS = 0;
 	unsigned verLS = 0;
 	if (ver.GetFixedFileVersion(verMS, verLS))
 		dfi.version.SetFileVersion(verMS, verLS);
+#endif
 }
 
 /**
@@ -304,7 +313,7 @@ void CDiffContext::CreateDuplicateValueMap()
 				{
 					if (pValues->IsHashValue(j) )
 					{
-						std::vector<uint8_t> value = pValues->GetHashValue(j);
+						HashDigest value = pValues->GetHashValue(j);
 						if (!value.empty())
 						{
 							auto it = m_duplicateValues[j].find(value);
@@ -339,3 +348,39 @@ void CDiffContext::CreateDuplicateValueMap()
 		}
 	}
 }
+
+/**
+ * @brief Save the items of this compare to a snapshot file.
+ * @param [in] filename Snapshot file to write.
+ * @return true if the file was written.
+ */
+bool CDiffContext::SaveSnapshot(const String& filename) const
+{
+	return SaveDiffSnapshot(filename, *this, GetNormalizedPaths(), m_nCompMethod);
+}
+
+/**
+ * @brief Replace the items of this compare with the items of a snapshot file.
+ * The snapshot must be of as many folders and of the same compare method.
+ * Its items are relative to the compared folders, so a snapshot saved for
+ * other folders shows their results for the folders of this compare.
+ * @param [in] filename Snapshot file to read.
+ * @param [in] bRevalidate Mark the items changed since the snapshot was
+ * saved for rescan (see DirScan_UpdateMarkedItems()).
+ * @param [out] bCompleteRescan Set if the compared folders changed, so that
+ * only a full compare finds all the changes.
+ * @return true if the items were loaded.
+ */
+bool CDiffContext::LoadSnapshot(const String& filename, bool bRevalidate, bool& bCompleteRescan)
+{
+	bCompleteRescan = false;
+	DiffSnapshotInfo info;
+	if (!ReadDiffSnapshotInfo(filename, info) ||
+		info.nDirs != GetCompareDirs() || info.nCompareMethod != m_nCompMethod)
+		return false;
+	if (!LoadDiffSnapshot(filename, *this, info))
+		return false;
+	if (bRevalidate)
+		bCompleteRescan = !MarkChangedSnapshotItems(*this, GetNormalizedPaths(), info);
+	return true;
+}
@@ -8,6 +8,8 @@
 #define POCO_NO_UNWINDOWS 1
 #include <Poco/Mutex.h>
 #include <memory>
+#include <map>
+#include <unordered_map>
 #include "PathContext.h"
 #include "DiffItemList.h"
 #include "FilterList.h"
@@ -27,9 +29,15 @@ struct DIFFOPTIONS;
 class IPluginInfos
 {
 public:
+	typedef std::map<String, std::pair<PackingInfo *, PrediffingInfo *>> PluginInfoTable;
+
 	virtual void FetchPluginInfos(const String& filteredFilenames, 
                                       PackingInfo ** infoUnpacker, 
                                       PrediffingInfo ** infoPrediffer) = 0;
+	virtual void GetPluginInfos(PluginInfoTable& infos) = 0;
+	virtual void SetPluginInfos(const String& filteredFilenames,
+                                    const PackingInfo& infoUnpacker,
+                                    const PrediffingInfo& infoPrediffer) = 0;
 };
 
 /** Information on the number of duplicate hash values */
@@ -165,6 +173,9 @@ public:
 	static String GetFilteredFilenames(const PathContext& paths) { return strutils::join(paths.begin(), paths.end(), _T("|")); }
 	void CreateDuplicateValueMap();
 
+	bool SaveSnapshot(const String& filename) const;
+	bool LoadSnapshot(const String& filename, bool bRevalidate, bool& bCompleteRescan);
+
 	IDiffFilter * m_piFilterGlobal; /**< Interface for file filtering. */
 	IDiffFilter * m_pImgfileFilter; /**< Interface for image file filtering */
 	IPluginInfos * m_piPluginInfos;
@@ -191,6 +202,19 @@ public:
 
 	int m_nBinaryCompareLimit;
 
+	/**
+	 * Threshold size for converting files to UTF-8 in memory.
+	 * Files needing conversion for diffutils compare that are bigger (in
+	 * bytes) than this value are converted to temp files instead.
+	 */
+	int m_nTranscodeInMemoryLimit;
+
+	/**
+	 * Memory budget (in bytes) for comparing files above the quick compare
+	 * limit with StreamingDiff instead of quick compare. 0 disables it.
+	 */
+	int m_nStreamingDiffMemoryLimit;
+
 	/**
 	 * Walk into unique folders and add contents.
 	 * This enables/disables walking into unique folders. If we don't walk into
@@ -201,6 +225,8 @@ public:
 	 * This value is true by default.
 	 */
 	bool m_bWalkUniques;
+	bool m_bDetectMovedItems; /**< Pair unique files which were moved or renamed? */
+	int m_nMovedSimilarity; /**< Minimum percentage of common lines of moved and edited text files */
 	bool m_bIgnoreReparsePoints;
 	bool m_bIgnoreCodepage;
 	bool m_bEnableImageCompare;
@@ -211,7 +237,7 @@ public:
 	std::unique_ptr<FilterList> m_pFilterList; /**< Filter list for line filters */
 	std::shared_ptr<SubstitutionList> m_pSubstitutionList; /// list for Substitution Filters
 	std::unique_ptr<PropertySystem> m_pPropertySystem; /**< pointer to Property System */
-	std::vector<std::map<std::vector<uint8_t>, DuplicateInfo>> m_duplicateValues; /**< Number of duplicate hash values */
+	std::vector<std::unordered_map<HashDigest, DuplicateInfo, HashDigest::Hasher>> m_duplicateValues; /**< Number of duplicate hash values */
 	std::vector<String> m_vCurrentlyHiddenItems; /**< The list of currently hidden items */
 
 private:
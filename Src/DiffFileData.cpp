@@ -9,12 +9,14 @@
 #include "pch.h"
 #include "DiffFileData.h"
 #include <io.h>
+#include <cstring>
 #include <memory>
 #include "DiffItem.h"
 #include "FileLocation.h"
 #include "diff.h"
 #include "TFile.h"
 #include "FileTransform.h"
+#include "multiformatText.h"
 #include "unicoder.h"
 #include "DebugNew.h"
 
@@ -36,12 +38,18 @@ DiffFileData::~DiffFileData()
 	delete [] m_inf;
 }
 
-/** @brief Open file descriptors in the inf structure (return false if failure) */
-bool DiffFileData::OpenFiles(const String& szFilepath1, const String& szFilepath2)
+/**
+ * @brief Open file descriptors in the inf structure (return false if failure)
+ * @param [in] pTranscoded1, pTranscoded2 Text of files already converted to
+ *  UTF-8 by Filepath_Transform(), diffed instead of file contents (or `nullptr`)
+ */
+bool DiffFileData::OpenFiles(const String& szFilepath1, const String& szFilepath2,
+	const std::string *pTranscoded1 /*= nullptr*/, const std::string *pTranscoded2 /*= nullptr*/)
 {
 	m_FileLocation[0].setPath(szFilepath1);
 	m_FileLocation[1].setPath(szFilepath2);
-	bool b = DoOpenFiles();
+	const std::string *pTranscoded[2] = { pTranscoded1, pTranscoded2 };
+	bool b = DoOpenFiles(pTranscoded);
 	if (!b)
 		Reset();
 	return b;
@@ -56,7 +64,7 @@ void DiffFileData::SetDisplayFilepaths(const String& szTrueFilepath1, const Stri
 
 
 /** @brief Open file descriptors in the inf structure (return false if failure) */
-bool DiffFileData::DoOpenFiles()
+bool DiffFileData::DoOpenFiles(const std::string *pTranscoded[2])
 {
 	Reset();
 
@@ -92,6 +100,22 @@ bool DiffFileData::DoOpenFiles()
 		{
 			m_inf[1].desc = m_inf[0].desc;
 		}
+
+		// Hand text converted in memory to diffutils instead of the file
+		// contents. Leave room for appended newline and sentinel word
+		// (`unsigned` in diffutils' io.c).
+		if (pTranscoded[i] != nullptr && (i == 0 || m_inf[1].desc != m_inf[0].desc))
+		{
+			const size_t size = pTranscoded[i]->size();
+			m_inf[i].bufsize = size + sizeof(unsigned) + 1;
+			m_inf[i].buffer = static_cast<char *>(malloc(m_inf[i].bufsize));
+			if (m_inf[i].buffer == nullptr)
+				return false;
+			memcpy(m_inf[i].buffer, pTranscoded[i]->data(), size);
+			m_inf[i].buffered_chars = size;
+			m_inf[i].stat.st_size = size;
+			m_inf[i].preloaded = 1;
+		}
 	}
 
 	m_used = true;
@@ -108,6 +132,14 @@ void DiffFileData::Reset()
 		cleanup_file_buffers(m_inf);
 		m_used = false;
 	}
+	else
+	{
+		for (int i = 0; i < 2; ++i)
+		{
+			if (m_inf[i].preloaded)
+				free(m_inf[i].buffer);
+		}
+	}
 	// clean up any open file handles, and zero stuff out
 	// open file handles might be leftover from a failure in DiffFileData::OpenFiles
 	for (int i = 0; i < 2; ++i)
@@ -128,14 +160,26 @@ void DiffFileData::Reset()
 	}
 }
 
+/**
+ * @brief Return whether file has to be converted to UTF-8 for diffutils.
+ */
+bool DiffFileData::NeedsUTF8Transform(bool bForceUTF8, const FileTextEncoding & encoding)
+{
+	return (encoding.m_unicoding && encoding.m_unicoding != ucr::UTF8) || bForceUTF8;
+}
+
 /**
  * @brief Invoke appropriate plugins for prediffing
  * return false if anything fails
  * caller has to DeleteFile filepathTransformed, if it differs from filepath
+ * @param [out] pTranscoded If not `nullptr`, files up to @p nMaxTranscodedSize
+ *  bytes are converted to UTF-8 into this string instead of a temp file; the
+ *  string stays empty if a temp file was used.
  */
 bool DiffFileData::Filepath_Transform(bool bForceUTF8,
 	const FileTextEncoding & encoding, const String & filepath, String & filepathTransformed,
-	const String& filteredFilenames, PrediffingInfo& infoPrediffer)
+	const String& filteredFilenames, PrediffingInfo& infoPrediffer,
+	std::string *pTranscoded /*= nullptr*/, int64_t nMaxTranscodedSize /*= 0*/)
 {
 	// third step : prediff (plugins)
 	bool bMayOverwrite =  // temp variable set each time it is used
@@ -148,9 +192,23 @@ bool DiffFileData::Filepath_Transform(bool bForceUTF8,
 	if (!infoPrediffer.Prediffing(filepathTransformed, filteredFilenames, bMayOverwrite, { filepath }))
 		return false;
 
-	if ((encoding.m_unicoding && encoding.m_unicoding != ucr::UTF8) || bForceUTF8)
+	if (NeedsUTF8Transform(bForceUTF8, encoding))
 	{
 		// fourth step : prepare for diffing
+		// Convert small enough files in memory. Text with NULs goes through
+		// the temp file so that diffutils sees the same bytes as before.
+		if (pTranscoded != nullptr)
+		{
+			int64_t nSize = -1;
+			try { nSize = TFile(filepathTransformed).getSize(); } catch (...) {}
+			if (nSize >= 0 && nSize <= nMaxTranscodedSize &&
+				::AnyCodepageToUTF8(encoding.m_codepage, filepathTransformed, *pTranscoded, false))
+			{
+				if (!pTranscoded->empty() && memchr(pTranscoded->data(), '\0', pTranscoded->size()) == nullptr)
+					return true;
+			}
+			pTranscoded->clear();
+		}
 		// may overwrite if we've already copied to temp file
 		bool bMayOverwrite1 = 0 != strutils::compare_nocase(filepathTransformed, filepath);
 		if (!FileTransform::AnyCodepageToUTF8(encoding.m_codepage, filepathTransformed, bMayOverwrite1))
@@ -7,6 +7,7 @@
  */
 #pragma once
 
+#include <string>
 #include "FileLocation.h"
 #include "FileTextStats.h"
 
@@ -28,13 +29,16 @@ struct DiffFileData
 	DiffFileData(const DiffFileData& other) = delete;
 	~DiffFileData();
 
-	bool OpenFiles(const String& szFilepath1, const String& szFilepath2);
+	bool OpenFiles(const String& szFilepath1, const String& szFilepath2,
+		const std::string *pTranscoded1 = nullptr, const std::string *pTranscoded2 = nullptr);
 	void Reset();
 	void Close() { Reset(); }
 	void SetDisplayFilepaths(const String& szTrueFilepath1, const String& szTrueFilepath2);
 
+	static bool NeedsUTF8Transform(bool bForceUTF8, const FileTextEncoding & encoding);
 	bool Filepath_Transform(bool bForceUTF8, const FileTextEncoding & encoding, const String & filepath, String & filepathTransformed,
-		const String& filteredFilenames, PrediffingInfo& infoPrediffer);
+		const String& filteredFilenames, PrediffingInfo& infoPrediffer,
+		std::string *pTranscoded = nullptr, int64_t nMaxTranscodedSize = 0);
 
 // Data (public)
 	file_data * m_inf;
@@ -45,5 +49,5 @@ struct DiffFileData
 	String m_sDisplayFilepath[2];
 
 private:
-	bool DoOpenFiles();
+	bool DoOpenFiles(const std::string *pTranscoded[2]);
 };
@@ -11,10 +11,13 @@
 
 DIFFITEM DIFFITEM::emptyitem;
 
-/** @brief DIFFITEM's destructor */
+/**
+ * @brief DIFFITEM's destructor.
+ * Items are allocated from and released to the DiffItemList that owns them,
+ * which destroys the `children` first.
+ */
 DIFFITEM::~DIFFITEM()
 {
-	RemoveChildren();
 	assert(children == nullptr);
 }
 
@@ -86,20 +89,6 @@ std::vector<const DIFFITEM*> DIFFITEM::GetAncestors() const
 	return ancestors;
 }
 
-/** @brief Remove and delete all children DIFFITEM entries */
-void DIFFITEM::RemoveChildren()
-{
-	DIFFITEM *pRem = children;
-	while (pRem != nullptr)
-	{
-		assert(pRem->parent == this);
-		DIFFITEM *pNext = pRem->Flink;
-		delete pRem;
-		pRem = pNext;
-	}
-	children = nullptr;
-}
-
 /** @brief Swap two items in `diffFileInfo[]`.  Used when swapping GUI panes. */
 void DIFFITEM::Swap(int idx1, int idx2)
 {
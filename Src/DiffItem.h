@@ -55,6 +55,7 @@ struct DIFFCODE
 		FILTERFLAGS=0x20000U, INCLUDED=0x00000U, SKIPPED=0x20000U,
 		SCANFLAGS=0x100000U, NEEDSCAN=0x100000U,
 		THREEWAYFLAGS=0x200000U, THREEWAY=0x200000U,
+		MOVEDFLAGS=0x400000U, MOVED=0x400000U,
 		SIDEFLAGS=0x70000000U, FIRST=0x10000000U, SECOND=0x20000000U, THIRD=0x40000000U, BOTH=0x30000000U, ALL=0x70000000U,
 	};
 
@@ -156,6 +157,8 @@ public:
 	bool isImage() const { return (diffcode & DIFFCODE::IMAGE) != 0; }
 	// rescan
 	bool isScanNeeded() const { return ((diffcode & DIFFCODE::SCANFLAGS) == DIFFCODE::NEEDSCAN); }
+	// left only and right only files paired by their contents
+	bool isMoved() const { return (diffcode & DIFFCODE::MOVED) != 0; }
 
 	void swap(int idx1, int idx2);
 };
@@ -261,11 +264,11 @@ private:							// Don't allow direct external manipulation of link values
 										 with the first (oldest) item (pointed to by `this->parent->children`)
 										 pointing to the last (newest) item. This is for easy insertion. */
 	void AppendSibling(DIFFITEM *p);
+	friend class DiffItemList;		// Owns the storage; releases items and their `children`
 
 public:
 	void DelinkFromSiblings();
 	void AddChildToParent(DIFFITEM *p);
-	void RemoveChildren();
 	int GetDepth() const;
 	bool IsAncestor(const DIFFITEM *pdi) const;
 	std::vector<const DIFFITEM*> GetAncestors() const;
@@ -274,9 +277,9 @@ public:
 	inline DIFFITEM *GetParentLink() const { return parent; }
 
 	/** @brief Return whether the current DIFFITEM has children */
-	inline bool DIFFITEM::HasChildren() const { return (children != nullptr); }
+	inline bool HasChildren() const { return (children != nullptr); }
 	/** @brief Return whether the current DIFFITEM has children */
-	inline bool DIFFITEM::HasParent() const { return (parent != nullptr); }
+	inline bool HasParent() const { return (parent != nullptr); }
 
 //**** The `emptyitem` and its access procedures
 private:
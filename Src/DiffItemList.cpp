@@ -7,11 +7,12 @@
 #include "pch.h"
 #include "DiffItemList.h"
 #include <cassert>
+#include <new>
 
 /**
  * @brief Constructor
  */
-DiffItemList::DiffItemList() : m_pRoot(nullptr)
+DiffItemList::DiffItemList() : m_pRoot(nullptr), m_nSlabUsed(SlabItemCount)
 {
 }
 
@@ -30,7 +31,7 @@ DiffItemList::~DiffItemList()
  */
 DIFFITEM *DiffItemList::AddNewDiff(DIFFITEM *par)
 {
-	DIFFITEM *p = new DIFFITEM;
+	DIFFITEM *p = AllocDiffItem();
 	if (par == nullptr)
 	{
 		// if there is no `parent`, this item becomes a child of `m_pRoot`
@@ -44,18 +45,103 @@ DIFFITEM *DiffItemList::AddNewDiff(DIFFITEM *par)
 }
 
 /**
- * @brief Empty structured DIFFITEM tree
+ * @brief Remove diffitem and all its children from structured DIFFITEM tree.
+ * @param [in] diffpos Position of item to remove; invalid after the call.
+ */
+void DiffItemList::RemoveDiff(DIFFITEM *diffpos)
+{
+	assert(diffpos != nullptr && diffpos != m_pRoot);
+	diffpos->DelinkFromSiblings();
+	FreeDiffItem(diffpos);
+}
+
+/**
+ * @brief Remove all children of diffitem from structured DIFFITEM tree.
+ * @param [in] diffpos Position of parent item.
+ */
+void DiffItemList::RemoveChildren(DIFFITEM *diffpos)
+{
+	assert(diffpos != nullptr);
+	DIFFITEM *p = diffpos->children;
+	diffpos->children = nullptr;
+	while (p != nullptr)
+	{
+		assert(p->parent == diffpos);
+		DIFFITEM *pNext = p->Flink;
+		FreeDiffItem(p);
+		p = pNext;
+	}
+}
+
+/**
+ * @brief Empty structured DIFFITEM tree.
+ * Items are only destructed here; their storage is released with the slabs,
+ * not one item at a time.
  */
 void DiffItemList::RemoveAll()
 {
-	delete m_pRoot;
+	if (m_pRoot != nullptr)
+		DestroyDiffItem(m_pRoot);
 	m_pRoot = nullptr;
+	m_freeItems.clear();
+	m_slabs.clear();
+	m_nSlabUsed = SlabItemCount;
 }
 
 void DiffItemList::InitDiffItemList()
 {
 	assert(m_pRoot == nullptr);
-	m_pRoot = new DIFFITEM;
+	m_pRoot = AllocDiffItem();
+}
+
+/**
+ * @brief Construct new diffitem, in a reused slot if there is one.
+ */
+DIFFITEM *DiffItemList::AllocDiffItem()
+{
+	DiffItemStorage *pStorage;
+	if (!m_freeItems.empty())
+	{
+		pStorage = m_freeItems.back();
+		m_freeItems.pop_back();
+	}
+	else
+	{
+		if (m_nSlabUsed == SlabItemCount)
+		{
+			m_slabs.emplace_back(new DiffItemStorage[SlabItemCount]);
+			m_nSlabUsed = 0;
+		}
+		pStorage = &m_slabs.back()[m_nSlabUsed++];
+	}
+	return new (pStorage) DIFFITEM;
+}
+
+/**
+ * @brief Destruct diffitem and its children and put their slots to free list.
+ * @param [in] p Item to free, already delinked from its siblings.
+ */
+void DiffItemList::FreeDiffItem(DIFFITEM *p)
+{
+	RemoveChildren(p);
+	p->~DIFFITEM();
+	m_freeItems.push_back(reinterpret_cast<DiffItemStorage *>(p));
+}
+
+/**
+ * @brief Destruct diffitem and its children without freeing their slots.
+ */
+void DiffItemList::DestroyDiffItem(DIFFITEM *p)
+{
+	DIFFITEM *pChild = p->children;
+	p->children = nullptr;
+	while (pChild != nullptr)
+	{
+		DIFFITEM *pNext = pChild->Flink;
+		DestroyDiffItem(pChild);
+		pChild = pNext;
+	}
+	p->~DIFFITEM();
 }
 
 void DiffItemList::ClearAllAdditionalProperties()
@@ -5,6 +5,8 @@
  */
 #pragma once
 
+#include <memory>
+#include <vector>
 #include "DiffItem.h"
 
 /**
@@ -13,6 +15,13 @@
  * we have a linked list of DIFFITEMs. But there is a structure that follows
  * the actual folder structure. Each DIFFITEM can have a parent folder and
  * another list of child items. Parent DIFFITEM is always a folder item.
+ *
+ * The DIFFITEMs are allocated from slabs owned by the list, so building a
+ * tree of millions of items does not cost one heap allocation per item, and
+ * RemoveAll() releases the whole tree slab by slab. Items removed one at a
+ * time (e.g. on rescan) go to a free list and are reused by AddNewDiff().
+ * Items must therefore be removed with RemoveDiff()/RemoveChildren(), never
+ * with `delete`.
  */
 class DiffItemList
 {
@@ -21,6 +30,8 @@ public:
 	~DiffItemList();
 	// add & remove differences
 	DIFFITEM *AddNewDiff(DIFFITEM *parent);
+	void RemoveDiff(DIFFITEM *diffpos);
+	void RemoveChildren(DIFFITEM *diffpos);
 	void RemoveAll();
 	void InitDiffItemList();
 	void ClearAllAdditionalProperties();
@@ -44,6 +55,22 @@ public:
 
 protected:
 	DIFFITEM* m_pRoot; /**< Root of list of diffitems; initially `nullptr`. */
+
+private:
+	/** @brief Uninitialized storage for one DIFFITEM. */
+	struct alignas(DIFFITEM) DiffItemStorage
+	{
+		unsigned char data[sizeof(DIFFITEM)];
+	};
+	static constexpr size_t SlabItemCount = 1024; /**< Number of items in one slab */
+
+	DIFFITEM *AllocDiffItem();
+	void FreeDiffItem(DIFFITEM *p);
+	static void DestroyDiffItem(DIFFITEM *p);
+
+	std::vector<std::unique_ptr<DiffItemStorage[]>> m_slabs; /**< Storage of all items */
+	size_t m_nSlabUsed; /**< Number of used slots in the last slab */
+	std::vector<DiffItemStorage *> m_freeItems; /**< Slots of removed items, reused first */
 };
 
 /**
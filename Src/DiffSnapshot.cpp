@@ -0,0 +1,522 @@
+/**
+ * @file  DiffSnapshot.cpp
+ *
+ * @brief Saves and loads the results of a folder compare.
+ *
+ * A snapshot file holds the DIFFITEM tree in a form read by mapping the file
+ * instead of parsing it:
+ * - a header with the compared folders and the offsets of the other parts,
+ * - fixed-size item records in tree order (a folder is followed by its
+ *   subtree), with the record index of the parent and of the end of the
+ *   subtree, so a subtree can be skipped or read without its siblings,
+ * - a table of the distinct names and paths, stored once in UTF-8 and
+ *   referenced by index from the records.
+ *
+ * Additional properties (hashes etc.) are not saved, they are calculated
+ * again when their columns are shown.
+ */
+#include "pch.h"
+#include "DiffSnapshot.h"
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <Poco/Exception.h>
+#include <Poco/SharedMemory.h>
+#include "DiffItemList.h"
+#include "PathContext.h"
+#include "TFile.h"
+#include "paths.h"
+#include "unicoder.h"
+
+using Poco::SharedMemory;
+
+namespace
+{
+
+/** @brief First bytes of a snapshot file. */
+constexpr char Magic[8] = { 'W', 'M', 'S', 'N', 'A', 'P', '\r', '\n' };
+/** @brief Version of the layout, increased whenever the layout changes. */
+constexpr uint32_t FormatVersion = 1;
+/** @brief Parent record index of top level items. */
+constexpr uint32_t NoParent = UINT32_MAX;
+
+struct Header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize;
+	uint32_t nDirs;
+	int32_t nCompareMethod;
+	uint32_t recordSize;
+	uint32_t itemCount;
+	uint32_t stringCount;
+	uint32_t reserved;
+	uint32_t rootPaths[4]; /**< String indexes of the compared folders */
+	int64_t rootTimes[3]; /**< Modification times of the compared folders */
+	uint64_t recordsOffset;
+	uint64_t stringOffsetsOffset; /**< stringCount + 1 offsets into the string data */
+	uint64_t stringDataOffset;
+	uint64_t stringDataSize;
+};
+
+/** @brief Item part of a record, followed by one SideRecord per compared folder. */
+struct ItemRecord
+{
+	uint32_t diffcode;
+	int32_t nsdiffs;
+	int32_t nidiffs;
+	uint32_t customFlags;
+	uint32_t parent; /**< Record index of the parent folder, or NoParent */
+	uint32_t subtreeEnd; /**< Record index following the last item of the subtree */
+};
+
+struct SideRecord
+{
+	uint64_t size;
+	int64_t mtime;
+	int64_t ctime;
+	uint64_t version;
+	uint32_t filename; /**< String index */
+	uint32_t path; /**< String index */
+	uint32_t attributes;
+	int32_t codepage;
+	int32_t ncrs;
+	int32_t nlfs;
+	int32_t ncrlfs;
+	int32_t nzeros;
+	uint8_t unicoding;
+	uint8_t bom;
+	uint8_t reserved[6];
+};
+
+static_assert(sizeof(Header) == 112, "snapshot header layout");
+static_assert(sizeof(ItemRecord) == 24, "snapshot record layout");
+static_assert(sizeof(SideRecord) == 72, "snapshot record layout");
+
+/** @brief Size of the records of a snapshot of nDirs folders. */
+constexpr size_t GetRecordSize(int nDirs)
+{
+	return sizeof(ItemRecord) + nDirs * sizeof(SideRecord);
+}
+
+/** @brief An item in tree order, when saving. */
+struct TreeEntry
+{
+	const DIFFITEM *pdi;
+	uint32_t parent;
+	uint32_t subtreeEnd;
+};
+
+void CollectItems(const DiffItemList& list, const DIFFITEM *parent, uint32_t parentIndex, std::vector<TreeEntry>& entries)
+{
+	for (const DIFFITEM *pdi = list.GetFirstChildDiffPosition(parent); pdi != nullptr; pdi = pdi->GetFwdSiblingLink())
+	{
+		uint32_t index = static_cast<uint32_t>(entries.size());
+		entries.push_back({ pdi, parentIndex, 0 });
+		if (pdi->HasChildren())
+			CollectItems(list, pdi, index, entries);
+		entries[index].subtreeEnd = static_cast<uint32_t>(entries.size());
+	}
+}
+
+/**
+ * @brief Distinct strings of a snapshot.
+ * Names and paths of the items are flyweights, so equal strings share one
+ * object and are found by its address without hashing the string.
+ */
+class StringTable
+{
+public:
+	StringTable() : m_offsets{ 0 } {}
+
+	uint32_t Add(const String& str)
+	{
+		auto it = m_indexes.find(&str);
+		if (it != m_indexes.end())
+			return it->second;
+		uint32_t index = Append(str);
+		m_indexes.emplace(&str, index);
+		return index;
+	}
+
+	uint32_t Append(const String& str)
+	{
+		m_data += ucr::toUTF8(str);
+		m_offsets.push_back(static_cast<uint32_t>(m_data.size()));
+		return static_cast<uint32_t>(m_offsets.size() - 2);
+	}
+
+	uint32_t GetCount() const { return static_cast<uint32_t>(m_offsets.size() - 1); }
+	const std::vector<uint32_t>& GetOffsets() const { return m_offsets; }
+	const std::string& GetData() const { return m_data; }
+
+private:
+	std::unordered_map<const String *, uint32_t> m_indexes;
+	std::vector<uint32_t> m_offsets;
+	std::string m_data;
+};
+
+SideRecord MakeSideRecord(const DiffFileInfo& fi, StringTable& strings)
+{
+	SideRecord side{};
+	side.size = fi.size;
+	side.mtime = fi.mtime.epochMicroseconds();
+	side.ctime = fi.ctime.epochMicroseconds();
+	side.version = fi.version.GetFileVersionQWORD();
+	side.filename = strings.Add(fi.filename.get());
+	side.path = strings.Add(fi.path.get());
+	side.attributes = fi.flags.attributes;
+	side.codepage = fi.encoding.m_codepage;
+	side.ncrs = fi.m_textStats.ncrs;
+	side.nlfs = fi.m_textStats.nlfs;
+	side.ncrlfs = fi.m_textStats.ncrlfs;
+	side.nzeros = fi.m_textStats.nzeros;
+	side.unicoding = static_cast<uint8_t>(fi.encoding.m_unicoding);
+	side.bom = fi.encoding.m_bom ? 1 : 0;
+	return side;
+}
+
+void ReadSideRecord(const SideRecord& side, const std::vector<boost::flyweight<String>>& strings, DiffFileInfo& fi)
+{
+	fi.size = side.size;
+	fi.mtime = Poco::Timestamp(side.mtime);
+	fi.ctime = Poco::Timestamp(side.ctime);
+	fi.version.SetFileVersion(static_cast<unsigned>(side.version >> 32), static_cast<unsigned>(side.version));
+	fi.filename = strings[side.filename];
+	fi.path = strings[side.path];
+	fi.flags.attributes = side.attributes;
+	fi.encoding.m_codepage = side.codepage;
+	fi.encoding.m_unicoding = static_cast<ucr::UNICODESET>(side.unicoding);
+	fi.encoding.m_bom = side.bom != 0;
+	fi.m_textStats.ncrs = side.ncrs;
+	fi.m_textStats.nlfs = side.nlfs;
+	fi.m_textStats.ncrlfs = side.ncrlfs;
+	fi.m_textStats.nzeros = side.nzeros;
+}
+
+/**
+ * @brief Read-only mapping of a snapshot file, checked to be consistent.
+ */
+class SnapshotView
+{
+public:
+	explicit SnapshotView(const String& filename)
+	{
+		try
+		{
+			TFile file(filename);
+			if (file.getSize() < sizeof(Header))
+				return;
+			m_pMapping.reset(new SharedMemory(file, SharedMemory::AM_READ));
+		}
+		catch (Poco::Exception&)
+		{
+			return;
+		}
+		m_bValid = Validate();
+	}
+
+	bool IsValid() const { return m_bValid; }
+	const Header& GetHeader() const { return *reinterpret_cast<const Header *>(GetData()); }
+
+	const ItemRecord& GetItem(uint32_t index) const
+	{
+		return *reinterpret_cast<const ItemRecord *>(GetData() + GetHeader().recordsOffset + index * static_cast<uint64_t>(GetHeader().recordSize));
+	}
+
+	const SideRecord& GetSide(uint32_t index, int nIndex) const
+	{
+		return reinterpret_cast<const SideRecord *>(&GetItem(index) + 1)[nIndex];
+	}
+
+	String GetString(uint32_t index) const
+	{
+		const Header& header = GetHeader();
+		const uint32_t *offsets = reinterpret_cast<const uint32_t *>(GetData() + header.stringOffsetsOffset);
+		const char *data = GetData() + header.stringDataOffset;
+		return ucr::toTString(std::string(data + offsets[index], offsets[index + 1] - offsets[index]));
+	}
+
+	void GetInfo(DiffSnapshotInfo& info) const
+	{
+		const Header& header = GetHeader();
+		info.nDirs = static_cast<int>(header.nDirs);
+		info.nCompareMethod = header.nCompareMethod;
+		info.paths.clear();
+		info.rootTimes.clear();
+		for (uint32_t i = 0; i < header.nDirs; ++i)
+		{
+			info.paths.push_back(GetString(header.rootPaths[i]));
+			info.rootTimes.push_back(header.rootTimes[i]);
+		}
+	}
+
+private:
+	const char *GetData() const { return m_pMapping->begin(); }
+	uint64_t GetSize() const { return m_pMapping->end() - m_pMapping->begin(); }
+
+	bool Validate() const
+	{
+		const Header& header = GetHeader();
+		const uint64_t size = GetSize();
+		if (memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != FormatVersion ||
+			header.headerSize != sizeof(Header) || header.nDirs < 2 || header.nDirs > 3 ||
+			header.recordSize != GetRecordSize(header.nDirs))
+			return false;
+		if (header.recordsOffset % alignof(SideRecord) != 0 || header.recordsOffset > size ||
+			(size - header.recordsOffset) / header.recordSize < header.itemCount)
+			return false;
+		if (header.stringOffsetsOffset % alignof(uint32_t) != 0 || header.stringOffsetsOffset > size ||
+			(size - header.stringOffsetsOffset) / sizeof(uint32_t) <= header.stringCount)
+			return false;
+		if (header.stringDataOffset > size || size - header.stringDataOffset < header.stringDataSize)
+			return false;
+		const uint32_t *offsets = reinterpret_cast<const uint32_t *>(GetData() + header.stringOffsetsOffset);
+		if (offsets[0] != 0 || offsets[header.stringCount] != header.stringDataSize)
+			return false;
+		for (uint32_t i = 0; i < header.stringCount; ++i)
+		{
+			if (offsets[i] > offsets[i + 1])
+				return false;
+		}
+		for (uint32_t i = 0; i < header.nDirs; ++i)
+		{
+			if (header.rootPaths[i] >= header.stringCount)
+				return false;
+		}
+		for (uint32_t i = 0; i < header.itemCount; ++i)
+		{
+			// Records are in tree order, a parent comes before its children
+			const ItemRecord& item = GetItem(i);
+			if (item.parent != NoParent && (item.parent >= i || !DIFFCODE(GetItem(item.parent).diffcode).isDirectory()))
+				return false;
+			for (uint32_t nIndex = 0; nIndex < header.nDirs; ++nIndex)
+			{
+				const SideRecord& side = GetSide(i, nIndex);
+				if (side.filename >= header.stringCount || side.path >= header.stringCount)
+					return false;
+			}
+		}
+		return true;
+	}
+
+	std::unique_ptr<SharedMemory> m_pMapping;
+	bool m_bValid = false;
+};
+
+/**
+ * @brief Mark an item for rescan.
+ * Like the items of changed paths of a watched compare, side flags are kept
+ * and DirScan_UpdateMarkedItems() sets them again.
+ */
+void MarkItem(DIFFITEM& di)
+{
+	di.diffcode.diffcode &= ~(DIFFCODE::TEXTFLAGS | DIFFCODE::COMPAREFLAGS);
+	di.diffcode.diffcode |= DIFFCODE::NEEDSCAN;
+}
+
+/**
+ * @brief Return whether a side of an item is not as it was when saved.
+ * Folders are changed when their modification time is, which happens when
+ * items are added, removed or renamed in them, files when their size or
+ * modification time is.
+ */
+bool IsSideChanged(const DIFFITEM& di, int nIndex, const String& root, const String& relativePath)
+{
+	DirItem current;
+	bool bExists = current.Update(paths::ConcatPath(root, relativePath));
+	if (bExists != di.diffcode.exists(nIndex))
+		return true;
+	if (!bExists)
+		return false;
+	const DiffFileInfo& fi = di.diffFileInfo[nIndex];
+	if (current.IsDirectory() != di.diffcode.isDirectory() || current.mtime != fi.mtime)
+		return true;
+	return !di.diffcode.isDirectory() && current.size != fi.size;
+}
+
+bool IsItemChanged(const DIFFITEM& di, const PathContext& paths)
+{
+	// Missing sides are looked for at the path of an existing side
+	String relativePath = di.getItemRelativePath();
+	for (int nIndex = 0; nIndex < paths.GetSize(); ++nIndex)
+	{
+		if (IsSideChanged(di, nIndex, paths.GetPath(nIndex),
+				di.diffcode.exists(nIndex) ? di.diffFileInfo[nIndex].GetFile() : relativePath))
+			return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Mark the changed items below a folder item.
+ * The subtree of a changed folder is not checked, it is scanned again.
+ */
+void MarkChangedChildren(DiffItemList& list, DIFFITEM *parent, const PathContext& paths)
+{
+	for (DIFFITEM *pdi = list.GetFirstChildDiffPosition(parent); pdi != nullptr; pdi = pdi->GetFwdSiblingLink())
+	{
+		if (IsItemChanged(*pdi, paths))
+			MarkItem(*pdi);
+		else if (pdi->HasChildren())
+			MarkChangedChildren(list, pdi, paths);
+	}
+}
+
+}
+
+/**
+ * @brief Save the items of a folder compare to a snapshot file.
+ * @param [in] filename Snapshot file to write.
+ * @param [in] list Items to save.
+ * @param [in] paths Compared folders.
+ * @param [in] nCompareMethod Compare method of the results.
+ * @return true if the file was written.
+ */
+bool SaveDiffSnapshot(const String& filename, const DiffItemList& list, const PathContext& paths, int nCompareMethod)
+{
+	const int nDirs = paths.GetSize();
+	if (nDirs < 2 || nDirs > 3)
+		return false;
+
+	std::vector<TreeEntry> entries;
+	CollectItems(list, nullptr, NoParent, entries);
+
+	Header header{};
+	memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = FormatVersion;
+	header.headerSize = sizeof(Header);
+	header.nDirs = nDirs;
+	header.nCompareMethod = nCompareMethod;
+	header.recordSize = static_cast<uint32_t>(GetRecordSize(nDirs));
+	header.itemCount = static_cast<uint32_t>(entries.size());
+	header.recordsOffset = sizeof(Header);
+
+	StringTable strings;
+	for (int nIndex = 0; nIndex < nDirs; ++nIndex)
+	{
+		String root = paths.GetPath(nIndex);
+		DirItem rootItem;
+		rootItem.Update(root);
+		header.rootPaths[nIndex] = strings.Append(root);
+		header.rootTimes[nIndex] = rootItem.mtime.epochMicroseconds();
+	}
+
+	FILE *fp = nullptr;
+	if (_tfopen_s(&fp, filename.c_str(), _T("wb")) != 0)
+		return false;
+	bool bOK = fwrite(&header, sizeof(header), 1, fp) == 1;
+	std::vector<char> record(header.recordSize);
+	for (const auto& entry : entries)
+	{
+		if (!bOK)
+			break;
+		const DIFFITEM& di = *entry.pdi;
+		ItemRecord item{};
+		item.diffcode = di.diffcode.diffcode;
+		item.nsdiffs = di.nsdiffs;
+		item.nidiffs = di.nidiffs;
+		item.customFlags = di.customFlags;
+		item.parent = entry.parent;
+		item.subtreeEnd = entry.subtreeEnd;
+		memcpy(record.data(), &item, sizeof(item));
+		for (int nIndex = 0; nIndex < nDirs; ++nIndex)
+		{
+			SideRecord side = MakeSideRecord(di.diffFileInfo[nIndex], strings);
+			memcpy(record.data() + sizeof(item) + nIndex * sizeof(side), &side, sizeof(side));
+		}
+		bOK = fwrite(record.data(), record.size(), 1, fp) == 1;
+	}
+
+	header.stringCount = strings.GetCount();
+	header.stringOffsetsOffset = header.recordsOffset + static_cast<uint64_t>(header.itemCount) * header.recordSize;
+	header.stringDataOffset = header.stringOffsetsOffset + strings.GetOffsets().size() * sizeof(uint32_t);
+	header.stringDataSize = strings.GetData().size();
+	if (bOK)
+		bOK = fwrite(strings.GetOffsets().data(), sizeof(uint32_t), strings.GetOffsets().size(), fp) == strings.GetOffsets().size();
+	if (bOK && !strings.GetData().empty())
+		bOK = fwrite(strings.GetData().data(), strings.GetData().size(), 1, fp) == 1;
+	if (bOK)
+		bOK = fseek(fp, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, fp) == 1;
+	if (fclose(fp) != 0)
+		bOK = false;
+	if (!bOK)
+		_tremove(filename.c_str());
+	return bOK;
+}
+
+/**
+ * @brief Read the compared folders and compare method of a snapshot file.
+ * @return true if the file is a valid snapshot.
+ */
+bool ReadDiffSnapshotInfo(const String& filename, DiffSnapshotInfo& info)
+{
+	SnapshotView view(filename);
+	if (!view.IsValid())
+		return false;
+	view.GetInfo(info);
+	return true;
+}
+
+/**
+ * @brief Replace the items of a list with the items of a snapshot file.
+ * @param [in] filename Snapshot file to read.
+ * @param [in,out] list List getting the items, unchanged if the file is not
+ * a valid snapshot.
+ * @param [out] info Folder compare described by the snapshot.
+ * @return true if the items were loaded.
+ */
+bool LoadDiffSnapshot(const String& filename, DiffItemList& list, DiffSnapshotInfo& info)
+{
+	SnapshotView view(filename);
+	if (!view.IsValid())
+		return false;
+	view.GetInfo(info);
+
+	const Header& header = view.GetHeader();
+	std::vector<boost::flyweight<String>> strings;
+	strings.reserve(header.stringCount);
+	for (uint32_t i = 0; i < header.stringCount; ++i)
+		strings.emplace_back(view.GetString(i));
+
+	list.RemoveAll();
+	list.InitDiffItemList();
+	std::vector<DIFFITEM *> items(header.itemCount);
+	for (uint32_t i = 0; i < header.itemCount; ++i)
+	{
+		const ItemRecord& item = view.GetItem(i);
+		DIFFITEM *pdi = list.AddNewDiff(item.parent != NoParent ? items[item.parent] : nullptr);
+		pdi->diffcode.diffcode = item.diffcode;
+		pdi->nsdiffs = item.nsdiffs;
+		pdi->nidiffs = item.nidiffs;
+		pdi->customFlags = item.customFlags;
+		for (uint32_t nIndex = 0; nIndex < header.nDirs; ++nIndex)
+			ReadSideRecord(view.GetSide(i, nIndex), strings, pdi->diffFileInfo[nIndex]);
+		items[i] = pdi;
+	}
+	return true;
+}
+
+/**
+ * @brief Mark the loaded items changed since the snapshot was saved for rescan.
+ * Items of changed files, and of folders whose items changed, are marked
+ * so that DirScan_UpdateMarkedItems() compares them again. Files added
+ * directly in the compared folders have no item to mark.
+ * @param [in] paths Compared folders.
+ * @param [in] info Folder compare described by the snapshot.
+ * @return false if the compared folders themselves changed, so that only a
+ * full compare finds all the changes.
+ */
+bool MarkChangedSnapshotItems(DiffItemList& list, const PathContext& paths, const DiffSnapshotInfo& info)
+{
+	bool bRootsUnchanged = paths.GetSize() == info.nDirs;
+	for (int nIndex = 0; bRootsUnchanged && nIndex < info.nDirs; ++nIndex)
+	{
+		DirItem root;
+		bRootsUnchanged = root.Update(paths.GetPath(nIndex)) &&
+			root.mtime.epochMicroseconds() == info.rootTimes[nIndex];
+	}
+	MarkChangedChildren(list, nullptr, paths);
+	return bRootsUnchanged;
+}
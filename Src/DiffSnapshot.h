@@ -0,0 +1,29 @@
+/**
+ * @file  DiffSnapshot.h
+ *
+ * @brief Declaration of the functions saving and loading folder compare results.
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "UnicodeString.h"
+
+class DiffItemList;
+class PathContext;
+
+/**
+ * @brief Folder compare described by a snapshot file.
+ */
+struct DiffSnapshotInfo
+{
+	int nDirs = 0; /**< Number of compared folders */
+	int nCompareMethod = 0; /**< Compare method of the results */
+	std::vector<String> paths; /**< Compared folders when saved */
+	std::vector<int64_t> rootTimes; /**< Modification times of the compared folders, in microseconds */
+};
+
+bool SaveDiffSnapshot(const String& filename, const DiffItemList& list, const PathContext& paths, int nCompareMethod);
+bool ReadDiffSnapshotInfo(const String& filename, DiffSnapshotInfo& info);
+bool LoadDiffSnapshot(const String& filename, DiffItemList& list, DiffSnapshotInfo& info);
+bool MarkChangedSnapshotItems(DiffItemList& list, const PathContext& paths, const DiffSnapshotInfo& info);
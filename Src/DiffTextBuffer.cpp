@@ -21,6 +21,7 @@
 #include "FileTextEncoding.h"
 #include "codepage_detect.h"
 #include "TFile.h"
+#include "PerfTrace.h"
 
 using Poco::Exception;
 
@@ -226,6 +227,8 @@ int CDiffTextBuffer::LoadFromFile(LPCTSTR pszFileNameInit,
 {
 	ASSERT(!m_bInit);
 	ASSERT(m_aLines.size() == 0);
+	const String sTraceFile = perftrace::IsEnabled() ? String(pszFileNameInit) : String();
+	PERFTRACE_SCOPE("CDiffTextBuffer::LoadFromFile", sTraceFile);
 
 	// Unpacking the file here, save the result in a temporary file
 	m_strTempFileName = pszFileNameInit;
@@ -14,7 +14,9 @@
 #include "UnicodeString.h"
 #include "CompareStats.h"
 #include "IAbortable.h"
+#ifdef _WIN32
 #include "Plugins.h"
+#endif
 #include "DebugNew.h"
 
 using Poco::Thread;
@@ -84,7 +86,7 @@ unsigned CDiffThread::CompareDirectories()
 	m_pDiffParm->nCollectThreadState = THREAD_COMPARING;
 
 	delete m_pDiffParm->pSemaphore;
-	m_pDiffParm->pSemaphore = new Semaphore(0, LONG_MAX);
+	m_pDiffParm->pSemaphore = new Semaphore(0, INT_MAX);
 
 	m_pDiffParm->context->m_pCompareStats->SetCompareState(CompareStats::STATE_START);
 
@@ -132,7 +134,9 @@ static void DiffThreadCollect(void *pParam)
 static void DiffThreadCompare(void *pParam)
 {
 	DiffFuncStruct *myStruct = static_cast<DiffFuncStruct *>(pParam);
+#ifdef _WIN32
 	CAssureScriptsForThread scriptsForRescan;
+#endif
 
 	// Stash abortable interface into context
 	myStruct->context->SetAbortable(myStruct->m_pAbortgate);
@@ -49,6 +49,8 @@
 #include "MergeApp.h"
 #include "SubstitutionList.h"
 #include "codepage_detect.h"
+#include "StreamingDiff.h"
+#include "PerfTrace.h"
 
 using Poco::Debugger;
 using Poco::format;
@@ -72,6 +74,9 @@ CDiffWrapper::CDiffWrapper()
 , m_bUseDiffList(false)
 , m_bAddCmdLine(true)
 , m_bAppendFiles(false)
+, m_pPatchStream(nullptr)
+, m_nStreamingDiffMemoryLimit(0)
+, m_nThreads(1)
 , m_nDiffs(0)
 , m_infoPrediffer(nullptr)
 , m_pDiffList(nullptr)
@@ -107,10 +112,24 @@ void CDiffWrapper::SetCreatePatchFile(const String &filename)
 	{
 		m_bCreatePatchFile = true;
 		m_sPatchFile = filename;
+#ifdef _WIN32
 		strutils::replace(m_sPatchFile, _T("/"), _T("\\"));
+#endif
 	}
 }
 
+/**
+ * @brief Write patches to an open stream instead of the patch file.
+ * The stream is not closed by CDiffWrapper. Patch file creation must still
+ * be enabled with SetCreatePatchFile().
+ * @param [in] pPatchStream Stream to write to, `nullptr` to write to the
+ * patch file again.
+ */
+void CDiffWrapper::SetPatchStream(FILE *pPatchStream)
+{
+	m_pPatchStream = pPatchStream;
+}
+
 /**
  * @brief Enables/disabled DiffList creation ands sets DiffList.
  * This function enables or disables DiffList creation. When
@@ -364,6 +383,7 @@ void RemoveBlankLines(std::string &str)
 void CDiffWrapper::PostFilter(PostFilterContext& ctxt, int LineNumberLeft, int QtyLinesLeft, int LineNumberRight,
 	int QtyLinesRight, OP_TYPE &Op, const file_data *file_data_ary) const
 {
+	PERFTRACE_SCOPE("CDiffWrapper::PostFilter");
 	if (Op == OP_TRIVIAL)
 		return;
 
@@ -467,6 +487,7 @@ void CDiffWrapper::SetPaths(const PathContext &tFiles,
  */
 bool CDiffWrapper::RunFileDiff()
 {
+	PERFTRACE_SCOPE("CDiffWrapper::RunFileDiff", m_files[0]);
 	PathContext aFiles = m_files;
 	int file;
 	for (file = 0; file < m_files.GetSize(); file++)
@@ -521,6 +542,20 @@ bool CDiffWrapper::RunFileDiff()
 			return false;
 		}
 
+		// Files too big to load are diffed while the patch is written
+		if (UseStreamingDiff(diffdata))
+		{
+			StreamingDiff streamingDiff(make_xdl_flags(m_options), m_nStreamingDiffMemoryLimit);
+			WritePatchFile(nullptr, diffdata.m_inf, &streamingDiff);
+			m_status.Identical = (streamingDiff.GetDiffCount() == 0 && streamingDiff.GetTrivialDiffCount() == 0) ?
+				IDENTLEVEL::ALL : IDENTLEVEL::NONE;
+			m_status.bBinaries = false;
+			m_status.bMissingNL[0] = streamingDiff.IsMissingNewline(0);
+			m_status.bMissingNL[1] = streamingDiff.IsMissingNewline(1);
+			diffdata.Close();
+			return true;
+		}
+
 		// Compare the files, if no error was found.
 		// Last param (bin_file) is `nullptr` since we don't
 		// (yet) need info about binary sides.
@@ -844,6 +879,45 @@ void CDiffWrapper::SetAppendFiles(bool bAppendFiles)
 	m_bAppendFiles = bAppendFiles;
 }
 
+/**
+ * @brief Set the memory limit for creating patches of big files.
+ * @param [in] nMemoryLimit Patches of file pairs bigger than this (in bytes)
+ * are written while reading the files, 0 disables it.
+ */
+void CDiffWrapper::SetStreamingDiffMemoryLimit(int nMemoryLimit)
+{
+	m_nStreamingDiffMemoryLimit = nMemoryLimit;
+}
+
+/**
+ * @brief Set the number of threads comparing one big file pair.
+ * @param [in] nThreads Threads the xdiff algorithms may use, 1 (default)
+ * compares in the calling thread. Only set it where a single file pair is
+ * compared at a time, not for wrappers used by several worker threads.
+ */
+void CDiffWrapper::SetThreadCount(int nThreads)
+{
+	m_nThreads = nThreads;
+}
+
+/**
+ * @brief Check if the patch of opened files is created with StreamingDiff.
+ * Only normal and unified patches of text files too big for the memory
+ * limit qualify; ignore options are handled by xdiff flags.
+ */
+bool CDiffWrapper::UseStreamingDiff(const DiffFileData & diffdata) const
+{
+	if (!m_bCreatePatchFile || m_bUseDiffList || m_nStreamingDiffMemoryLimit <= 0)
+		return false;
+	if (output_style != OUTPUT_NORMAL && output_style != OUTPUT_UNIFIED)
+		return false;
+	const file_data *inf = diffdata.m_inf;
+	if (inf[0].desc == inf[1].desc ||
+		inf[0].stat.st_size + inf[1].stat.st_size <= m_nStreamingDiffMemoryLimit)
+		return false;
+	return !StreamingDiff::LooksBinary(inf[0].desc) && !StreamingDiff::LooksBinary(inf[1].desc);
+}
+
 /**
  * @brief Compare two files using diffutils.
  *
@@ -871,7 +945,7 @@ bool CDiffWrapper::Diff2Files(struct change ** diffs, DiffFileData *diffData,
 		if (m_options.m_diffAlgorithm != DIFF_ALGORITHM_DEFAULT)
 		{
 			unsigned xdl_flags = make_xdl_flags(m_options);
-			*diffs = diff_2_files_xdiff(diffData->m_inf, (m_pMovedLines[0] != nullptr), xdl_flags);
+			*diffs = diff_2_files_xdiff(diffData->m_inf, (m_pMovedLines[0] != nullptr), xdl_flags, m_nThreads);
 			files[0] = diffData->m_inf[0];
 			files[1] = diffData->m_inf[1];
 		}
@@ -1308,8 +1382,10 @@ void CDiffWrapper::WritePatchFileTerminator(enum output_style tOutput_style)
  * delimiters from \ to / since we want to keep compatibility with patch-tools.
  * @param [in] script list of changes.
  * @param [in] inf file_data table containing filenames
+ * @param [in] pStreamingDiff If not `nullptr`, @p script is not used and the
+ * changes are found while the patch is written.
  */
-void CDiffWrapper::WritePatchFile(struct change * script, file_data * inf)
+void CDiffWrapper::WritePatchFile(struct change * script, file_data * inf, StreamingDiff * pStreamingDiff /*= nullptr*/)
 {
 	file_data inf_patch[2] = { inf[0], inf[1] };
 
@@ -1350,7 +1426,9 @@ void CDiffWrapper::WritePatchFile(struct change * script, file_data * inf)
 	}
 
 	outfile = nullptr;
-	if (!m_sPatchFile.empty())
+	if (m_pPatchStream != nullptr)
+		outfile = m_pPatchStream;
+	else if (!m_sPatchFile.empty())
 	{
 		const TCHAR *mode = (m_bAppendFiles ? _T("a+") : _T("w+"));
 		if (_tfopen_s(&outfile, m_sPatchFile.c_str(), mode) != 0)
@@ -1386,7 +1464,10 @@ void CDiffWrapper::WritePatchFile(struct change * script, file_data * inf)
 	switch (output_style)
 	{
 	case OUTPUT_NORMAL:
-		print_normal_script(script);
+		if (pStreamingDiff != nullptr)
+			WriteStreamingPatch(*pStreamingDiff, inf, false);
+		else
+			print_normal_script(script);
 		break;
 	case OUTPUT_CONTEXT:
 		print_context_header(inf_patch, 0);
@@ -1394,7 +1475,10 @@ void CDiffWrapper::WritePatchFile(struct change * script, file_data * inf)
 		break;
 	case OUTPUT_UNIFIED:
 		print_context_header(inf_patch, 1);
-		print_context_script(script, 1);
+		if (pStreamingDiff != nullptr)
+			WriteStreamingPatch(*pStreamingDiff, inf, true);
+		else
+			print_context_script(script, 1);
 		break;
 #if 0
 	case OUTPUT_ED:
@@ -1419,13 +1503,29 @@ void CDiffWrapper::WritePatchFile(struct change * script, file_data * inf)
 		print_html_diff_terminator();
 	}
 	
-	fclose(outfile);
+	if (m_pPatchStream == nullptr)
+		fclose(outfile);
+	else if (ferror(outfile))
+		m_status.bPatchFileFailed = true;
 	outfile = nullptr;
 
 	free((void *)inf_patch[0].name);
 	free((void *)inf_patch[1].name);
 }
 
+/**
+ * @brief Write the patch body while diffing the opened files.
+ * @param [in] streamingDiff Diff engine to use.
+ * @param [in] inf file_data table containing the file descriptors
+ * @param [in] bUnified Write unified instead of normal output.
+ */
+void CDiffWrapper::WriteStreamingPatch(StreamingDiff & streamingDiff, const file_data * inf, bool bUnified)
+{
+	auto pWriter = StreamingDiff::CreatePatchWriter(outfile, bUnified, context, m_nStreamingDiffMemoryLimit);
+	if (streamingDiff.Compare(inf[0].desc, inf[1].desc, pWriter.get()) == StreamingDiff::Result::Error)
+		m_status.bPatchFileFailed = true;
+}
+
 /**
  * @brief Set line filters, given as one string.
  * @param [in] filterStr Filters.
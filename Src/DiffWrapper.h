@@ -25,6 +25,7 @@ struct file_data;
 class MovedLines;
 class FilterList;
 class SubstitutionList;
+class StreamingDiff;
 namespace CrystalLineParser { struct TextDefinition; };
 
 /** @enum COMPARE_TYPE
@@ -161,6 +162,7 @@ public:
 	CDiffWrapper();
 	~CDiffWrapper();
 	void SetCreatePatchFile(const String &filename);
+	void SetPatchStream(FILE *pPatchStream);
 	void SetCreateDiffList(DiffList *diffList);
 	void GetOptions(DIFFOPTIONS *options) const;
 	void SetOptions(const DIFFOPTIONS *options);
@@ -171,6 +173,8 @@ public:
 	void SetDetectMovedBlocks(bool bDetectMovedBlocks);
 	bool GetDetectMovedBlocks() const { return (m_pMovedLines[0] != nullptr); }
 	void SetAppendFiles(bool bAppendFiles);
+	void SetStreamingDiffMemoryLimit(int nMemoryLimit);
+	void SetThreadCount(int nThreads);
 	void SetPaths(const PathContext &files, bool tempPaths);
 	void SetAlternativePaths(const PathContext &altPaths);
 	bool RunFileDiff();
@@ -197,7 +201,9 @@ protected:
 	bool Diff2Files(struct change ** diffs, DiffFileData *diffData,
 		int * bin_status, int * bin_file) const;
 	void LoadWinMergeDiffsFromDiffUtilsScript(struct change * script, const file_data * inf);
-	void WritePatchFile(struct change * script, file_data * inf);
+	void WritePatchFile(struct change * script, file_data * inf, StreamingDiff * pStreamingDiff = nullptr);
+	void WriteStreamingPatch(StreamingDiff & streamingDiff, const file_data * inf, bool bUnified);
+	bool UseStreamingDiff(const DiffFileData & diffdata) const;
 public:
 	void LoadWinMergeDiffsFromDiffUtilsScript3(
 		struct change * script10, struct change * script12,
@@ -216,6 +222,7 @@ private:
 	PathContext m_originalFile; /**< file's original (NON-TEMP) path. */
 
 	String m_sPatchFile; /**< Full path to created patch file. */
+	FILE *m_pPatchStream; /**< Open stream patches are written to instead of m_sPatchFile, or `nullptr` */
 	bool m_bPathsAreTemp; /**< Are compared paths temporary? */
 	/// prediffer info are stored only for MergeDoc
 	std::unique_ptr<PrediffingInfo> m_infoPrediffer;
@@ -225,6 +232,8 @@ private:
 	bool m_bCreatePatchFile; /**< Do we create a patch file? */
 	bool m_bAddCmdLine; /**< Do we add commandline to patch file? */
 	bool m_bAppendFiles; /**< Do we append to existing patch file? */
+	int m_nStreamingDiffMemoryLimit; /**< Patch files bigger than this are written while streaming, 0 = never */
+	int m_nThreads; /**< Threads comparing one file pair with xdiff */
 	int m_nDiffs; /**< Difference count */
 	DiffList *m_pDiffList; /**< Pointer to external DiffList */
 	std::unique_ptr<MovedLines> m_pMovedLines[3];
@@ -10,12 +10,14 @@
 #include <cassert>
 #include <sstream>
 #include <algorithm>
+#include <memory>
 #include <Poco/Base64Encoder.h>
+#include <Poco/Runnable.h>
+#include <Poco/ThreadPool.h>
 #include "locality.h"
 #include "DirCmpReport.h"
 #include "paths.h"
 #include "unicoder.h"
-#include "markdown.h"
 #include "CompareStats.h"
 #include "DiffItem.h"
 #include "DiffThread.h"
@@ -59,6 +61,31 @@ static String EndEl(const String& elName)
 	return strutils::format(_T("</%s>"), elName);
 }
 
+/**
+ * @brief Is @p pdi a compared item and not a listview-only row?
+ */
+static bool IsReportItem(const DIFFITEM *pdi)
+{
+	return reinterpret_cast<uintptr_t>(pdi) != -1;
+}
+
+namespace
+{
+
+/**
+ * @brief Formats a range of report rows on a thread pool thread.
+ */
+class RowChunkTask : public Poco::Runnable
+{
+public:
+	explicit RowChunkTask(std::function<void()> task) : m_task(std::move(task)) {}
+	void run() override { m_task(); }
+private:
+	std::function<void()> m_task;
+};
+
+}
+
 /**
  * @brief Constructor.
  */
@@ -70,8 +97,9 @@ DirCmpReport::DirCmpReport(const std::vector<String> & colRegKeys)
 , m_sSeparator(_T(","))
 , m_pFileCmpReport(nullptr)
 , m_bIncludeFileCmpReport(false)
-, m_bOutputUTF8(false)
+, m_nFailedFileCmpReports(0)
 , m_myStruct(nullptr)
+, m_nThreads(1)
 , m_bCopyToClipboard(false)
 , m_nReportType(REPORT_TYPE_COMMALIST)
 {
@@ -163,6 +191,7 @@ bool DirCmpReport::GenerateReport(String &errStr)
 	assert(m_pList != nullptr);
 	assert(m_pFile == nullptr);
 	bool bRet = false;
+	m_nFailedFileCmpReports = 0;
 	try
 	{
 		if (m_bCopyToClipboard)
@@ -177,7 +206,7 @@ bool DirCmpReport::GenerateReport(String &errStr)
 			m_bIncludeFileCmpReport = false;
 			GenerateReport(m_nReportType);
 			HGLOBAL hMem = file.Detach();
-			SetClipboardData(CF_UNICODETEXT, ConvertToUTF16ForClipboard(hMem, m_bOutputUTF8 ? CP_UTF8 : CP_THREAD_ACP));
+			SetClipboardData(CF_UNICODETEXT, ConvertToUTF16ForClipboard(hMem, m_buffer.IsUTF8() ? CP_UTF8 : CP_THREAD_ACP));
 			GlobalFree(hMem);
 			// If report type is HTML, render CF_HTML format as well
 			if (m_nReportType == REPORT_TYPE_SIMPLEHTML)
@@ -200,6 +229,7 @@ bool DirCmpReport::GenerateReport(String &errStr)
 				file.Write(start, sizeof start - 1);
 				GenerateHTMLHeaderBodyPortion();
 				GenerateXmlHtmlContent(false);
+				Flush();
 				file.Write(end, sizeof end); // include terminating zero
 				DWORD size = GetLength32(file);
 				// Rewrite CF_HTML header with valid offsets
@@ -227,6 +257,9 @@ bool DirCmpReport::GenerateReport(String &errStr)
 				CFile::modeWrite|CFile::modeCreate|CFile::shareDenyWrite);
 			m_pFile = &file;
 			GenerateReport(m_nReportType);
+			if (m_nFailedFileCmpReports > 0)
+				errStr = strutils::format_string1(_("%1 file compare reports could not be written."),
+					strutils::to_str(m_nFailedFileCmpReports));
 		}
 		bRet = true;
 	}
@@ -245,57 +278,58 @@ bool DirCmpReport::GenerateReport(String &errStr)
  */
 void DirCmpReport::GenerateReport(REPORT_TYPE nReportType)
 {
+	m_buffer.Clear();
 	switch (nReportType)
 	{
 	case REPORT_TYPE_SIMPLEHTML:
-		m_bOutputUTF8 = true;
+		m_buffer.SetUTF8(true);
 		GenerateHTMLHeader();
 		GenerateXmlHtmlContent(false);
 		GenerateHTMLFooter();
 		break;
 	case REPORT_TYPE_SIMPLEXML:
-		m_bOutputUTF8 = true;
+		m_buffer.SetUTF8(true);
 		GenerateXmlHeader();
 		GenerateXmlHtmlContent(true);
 		GenerateXmlFooter();
 		break;
 	case REPORT_TYPE_COMMALIST:
-		m_bOutputUTF8 = false;
+		m_buffer.SetUTF8(false);
 		m_sSeparator = _T(",");
 		GenerateHeader();
 		GenerateContent();
 		break;
 	case REPORT_TYPE_TABLIST:
-		m_bOutputUTF8 = false;
+		m_buffer.SetUTF8(false);
 		m_sSeparator = _T("\t");
 		GenerateHeader();
 		GenerateContent();
 		break;
 	}
+	Flush();
 }
 
 /**
  * @brief Write text to report file.
- * @param [in] pszText Text to write to report file.
+ * The text is buffered, Flush() writes it to the file.
+ * @param [in] sText Text to write to report file.
  */
 void DirCmpReport::WriteString(const String& sText)
 {
-	std::string sOctets(m_bOutputUTF8 ? ucr::toUTF8(sText) : ucr::toThreadCP(sText));
-	const char *pchOctets = sOctets.c_str();
-	void *pvOctets = const_cast<char *>(pchOctets);
-	size_t cchAhead = sOctets.length();
-	while (const char *pchAhead = (const char *)memchr(pchOctets, '\n', cchAhead))
-	{
-		size_t cchLine = pchAhead - pchOctets;
-		m_pFile->Write(pchOctets, static_cast<unsigned>(cchLine));
-		static const char eol[] = { '\r', '\n' };
-		m_pFile->Write(eol, sizeof eol);
-		++cchLine;
-		pchOctets += cchLine;
-		cchAhead -= cchLine;
-	}
-	m_pFile->Write(pchOctets, static_cast<unsigned>(cchAhead));
+	m_buffer.Append(sText);
+	if (m_buffer.IsFull())
+		Flush();
+}
 
+/**
+ * @brief Write text to report file.
+ * @param [in] pszText Text to write to report file.
+ */
+void DirCmpReport::WriteString(const TCHAR *pszText)
+{
+	m_buffer.Append(pszText);
+	if (m_buffer.IsFull())
+		Flush();
 }
 
 /**
@@ -304,7 +338,116 @@ void DirCmpReport::WriteString(const String& sText)
  */
 void DirCmpReport::WriteStringEntityAware(const String& sText)
 {
-	WriteString(ucr::toTString(CMarkdown::Entities(ucr::toUTF8(sText))));
+	m_buffer.AppendEntities(sText);
+	if (m_buffer.IsFull())
+		Flush();
+}
+
+/**
+ * @brief Write buffered text to report file.
+ */
+void DirCmpReport::Flush()
+{
+	if (m_buffer.GetSize() > 0)
+		m_pFile->Write(m_buffer.GetData(), static_cast<unsigned>(m_buffer.GetSize()));
+	m_buffer.Clear();
+}
+
+/**
+ * @brief Return text of a report cell.
+ * @param [in] pdi Item of the row, as stored in the listview.
+ */
+String DirCmpReport::GetItemText(int row, const DIFFITEM *pdi, int col) const
+{
+	if (m_columnTextFunc && IsReportItem(pdi))
+		return m_columnTextFunc(*pdi, col);
+	return m_pList->GetItemText(row, col);
+}
+
+/**
+ * @brief Is the user aborting the report?
+ */
+bool DirCmpReport::ShouldAbort() const
+{
+	return m_myStruct && m_myStruct->context->GetAbortable()->ShouldAbort();
+}
+
+/**
+ * @brief Format all listview rows and write them to the report.
+ * Rows are formatted in chunks of RowsPerChunk rows on m_nThreads threads
+ * when @p bParallel is set, the chunks are written in listview order.
+ * @param [in] formatRow Formats one row, is called for special rows too.
+ * @param [in] bParallel Can @p formatRow run on other threads?
+ */
+void DirCmpReport::GenerateRows(const RowFormatter& formatRow, bool bParallel)
+{
+	const int nRows = m_pList->GetRowCount();
+	std::vector<const DIFFITEM *> items(nRows);
+	for (int currRow = 0; currRow < nRows; currRow++)
+		items[currRow] = reinterpret_cast<const DIFFITEM *>(m_pList->GetItemData(currRow));
+
+	CompareStats *pCompareStats = m_myStruct ? m_myStruct->context->m_pCompareStats : nullptr;
+
+	// Querying cells from the listview is serialized by the UI thread, so
+	// only rows formatted from DIFFITEMs are worth spreading over threads.
+	const int nThreads = (bParallel && m_columnTextFunc) ? m_nThreads : 1;
+	if (nThreads <= 1 || nRows <= RowsPerChunk)
+	{
+		for (int currRow = 0; currRow < nRows; currRow++)
+		{
+			if (ShouldAbort())
+				break;
+			const DIFFITEM *pdi = items[currRow];
+			if (pCompareStats && IsReportItem(pdi))
+				pCompareStats->BeginCompare(pdi, 0);
+			formatRow(m_buffer, currRow, pdi);
+			if (pCompareStats && IsReportItem(pdi))
+				pCompareStats->AddItem(-1);
+			if (m_buffer.IsFull())
+				Flush();
+		}
+		return;
+	}
+
+	Poco::ThreadPool threadPool(nThreads, nThreads);
+	std::vector<ReportBuffer> chunks(nThreads, ReportBuffer(m_buffer.IsUTF8()));
+	std::vector<std::unique_ptr<RowChunkTask>> tasks;
+	for (int batchBegin = 0; batchBegin < nRows && !ShouldAbort(); batchBegin += RowsPerChunk * nThreads)
+	{
+		tasks.clear();
+		for (int i = 0; i < nThreads; ++i)
+		{
+			const int chunkBegin = batchBegin + i * RowsPerChunk;
+			if (chunkBegin >= nRows)
+				break;
+			const int chunkEnd = (std::min)(chunkBegin + RowsPerChunk, nRows);
+			ReportBuffer& chunk = chunks[i];
+			chunk.Clear();
+			tasks.push_back(std::make_unique<RowChunkTask>([&formatRow, &items, &chunk, chunkBegin, chunkEnd]()
+				{
+					for (int currRow = chunkBegin; currRow < chunkEnd; currRow++)
+						formatRow(chunk, currRow, items[currRow]);
+				}));
+			threadPool.start(*tasks.back());
+		}
+		threadPool.joinAll();
+		for (int i = 0; i < static_cast<int>(tasks.size()); ++i)
+		{
+			m_buffer.Append(chunks[i]);
+			const int chunkBegin = batchBegin + i * RowsPerChunk;
+			const int chunkEnd = (std::min)(chunkBegin + RowsPerChunk, nRows);
+			for (int currRow = chunkBegin; pCompareStats && currRow < chunkEnd; currRow++)
+			{
+				if (IsReportItem(items[currRow]))
+				{
+					pCompareStats->BeginCompare(items[currRow], 0);
+					pCompareStats->AddItem(-1);
+				}
+			}
+			if (m_buffer.IsFull())
+				Flush();
+		}
+	}
 }
 
 /**
@@ -326,42 +469,40 @@ void DirCmpReport::GenerateHeader()
 }
 
 /**
- * @brief Generate report content (compared items).
+ * @brief Format one row of a comma or tab separated report.
  */
-void DirCmpReport::GenerateContent()
+void DirCmpReport::FormatListRow(ReportBuffer& buffer, int currRow, const DIFFITEM *pdi) const
 {
-	int nRows = m_pList->GetRowCount();
-
-	// Report:Detail. All currently displayed columns will be added
-	for (int currRow = 0; currRow < nRows; currRow++)
+	buffer.Append(_T("\n"));
+	if (!IsReportItem(pdi))
+		return;
+	for (int currCol = 0; currCol < m_nColumns; currCol++)
 	{
-		if (m_myStruct && m_myStruct->context->GetAbortable()->ShouldAbort())
-			break;
-		WriteString(_T("\n"));
-		DIFFITEM* pdi = reinterpret_cast<DIFFITEM*>(m_pList->GetItemData(currRow));
-		if (reinterpret_cast<uintptr_t>(pdi) == -1)
-			continue;
-		if (m_myStruct)
-			m_myStruct->context->m_pCompareStats->BeginCompare(pdi, 0);
-		for (int currCol = 0; currCol < m_nColumns; currCol++)
-		{
-			String value = m_pList->GetItemText(currRow, currCol);
-			if (value.find(m_sSeparator) != String::npos) {
-				WriteString(_T("\""));
-				WriteString(value);
-				WriteString(_T("\""));
-			}
-			else
-				WriteString(value);
-
-			// Add col-separator, but not after last column
-			if (currCol < m_nColumns - 1)
-				WriteString(m_sSeparator);
+		String value = GetItemText(currRow, pdi, currCol);
+		if (value.find(m_sSeparator) != String::npos) {
+			buffer.Append(_T("\""));
+			buffer.Append(value);
+			buffer.Append(_T("\""));
 		}
-		if (m_myStruct)
-			m_myStruct->context->m_pCompareStats->AddItem(-1);
+		else
+			buffer.Append(value);
+
+		// Add col-separator, but not after last column
+		if (currCol < m_nColumns - 1)
+			buffer.Append(m_sSeparator);
 	}
+}
 
+/**
+ * @brief Generate report content (compared items).
+ */
+void DirCmpReport::GenerateContent()
+{
+	// Report:Detail. All currently displayed columns will be added
+	GenerateRows([this](ReportBuffer& buffer, int currRow, const DIFFITEM *pdi)
+		{
+			FormatListRow(buffer, currRow, pdi);
+		}, true);
 }
 
 /**
@@ -481,87 +622,96 @@ void DirCmpReport::GenerateXmlHeader()
 	WriteString(EndEl(rowEl) + _T("\n"));
 }
 
+/**
+ * @brief Format one row of a simple xml report.
+ */
+void DirCmpReport::FormatXmlRow(ReportBuffer& buffer, int currRow, const DIFFITEM *pdi) const
+{
+	if (!IsReportItem(pdi))
+		return;
+	buffer.Append(_T("<filediff>"));
+	for (int currCol = 0; currCol < m_nColumns; currCol++)
+	{
+		const String& colEl = m_colRegKeys[currCol];
+		buffer.Append(_T("<"));
+		buffer.Append(colEl);
+		buffer.Append(_T(">"));
+		buffer.AppendEntities(GetItemText(currRow, pdi, currCol));
+		buffer.Append(_T("</"));
+		buffer.Append(colEl);
+		buffer.Append(_T(">"));
+	}
+	buffer.Append(_T("</filediff>\n"));
+}
+
 /**
  * @brief Generate simple html or xml report content.
  */
 void DirCmpReport::GenerateXmlHtmlContent(bool xml)
 {
+	// Report:Detail. All currently displayed columns will be added
+	if (xml)
+	{
+		GenerateRows([this](ReportBuffer& buffer, int currRow, const DIFFITEM *pdi)
+			{
+				FormatXmlRow(buffer, currRow, pdi);
+			}, true);
+		return;
+	}
+
 	String sFileName, sParentDir;
 	paths::SplitFilename((const TCHAR *)m_pFile->GetFilePath(), &sParentDir, &sFileName, nullptr);
 	String sRelDestDir = sFileName.substr(0, sFileName.find_last_of(_T('.'))) + _T(".files");
 	String sDestDir = paths::ConcatPath(sParentDir, sRelDestDir);
-	if (!xml && m_bIncludeFileCmpReport && m_pFileCmpReport != nullptr)
+	if (m_bIncludeFileCmpReport && m_pFileCmpReport != nullptr)
 		paths::CreateIfNeeded(sDestDir);
 
-	int nRows = m_pList->GetRowCount();
-
-	// Report:Detail. All currently displayed columns will be added
-	for (int currRow = 0; currRow < nRows; currRow++)
-	{
-		if (m_myStruct && m_myStruct->context->GetAbortable()->ShouldAbort())
-			break;
-		DIFFITEM* pdi = reinterpret_cast<DIFFITEM*>(m_pList->GetItemData(currRow));
-		if (reinterpret_cast<uintptr_t>(pdi) == -1)
-			continue;
-		String sLinkPath;
-		if (m_myStruct)
-			m_myStruct->context->m_pCompareStats->BeginCompare(pdi, 0);
-		if (!xml && m_bIncludeFileCmpReport && m_pFileCmpReport != nullptr)
-			(*m_pFileCmpReport.get())(REPORT_TYPE_SIMPLEHTML, m_pList.get(), currRow, sDestDir, sLinkPath);
-
-		String rowEl = _T("tr");
-		if (xml)
-		{
-			rowEl = _T("filediff");
-			WriteString(BeginEl(rowEl));
-		}
-		else
+	// Row colors, icons and file compare reports come from the UI thread,
+	// so html rows are formatted one at a time.
+	GenerateRows([&](ReportBuffer& buffer, int currRow, const DIFFITEM *pdi)
 		{
+			if (!IsReportItem(pdi))
+				return;
+			String sLinkPath;
+			if (m_bIncludeFileCmpReport && m_pFileCmpReport != nullptr)
+				(*m_pFileCmpReport.get())(REPORT_TYPE_SIMPLEHTML, m_pList.get(), currRow, sDestDir, sLinkPath);
+
+			const String rowEl = _T("tr");
 			COLORREF backcolor = m_pList->GetBackColor(currRow);
 			COLORREF textcolor = m_pList->GetTextColor(currRow);
 			String attr = strutils::format(_T("style='%sbackground-color: #%02x%02x%02x'"),
 				textcolor == 0 ? _T("") : strutils::format(_T("color: #%02x%02x%02x; "),
 						GetRValue(textcolor), GetGValue(textcolor), GetBValue(textcolor)).c_str(),
 				GetRValue(backcolor), GetGValue(backcolor), GetBValue(backcolor));
-			WriteString(BeginEl(rowEl, attr));
-		}
-		for (int currCol = 0; currCol < m_nColumns; currCol++)
-		{
-			String colEl = _T("td");
-			if (xml)
-			{
-				colEl = m_colRegKeys[currCol];
-				WriteString(BeginEl(colEl));
-			}
-			else
+			buffer.Append(BeginEl(rowEl, attr));
+			for (int currCol = 0; currCol < m_nColumns; currCol++)
 			{
+				const String colEl = _T("td");
 				if (currCol == 0)
-					WriteString(BeginEl(colEl, strutils::format(_T("class=\"icon%d indent%d\""), m_pList->GetIconIndex(currRow), m_pList->GetIndent(currRow))));
+					buffer.Append(BeginEl(colEl, strutils::format(_T("class=\"icon%d indent%d\""), m_pList->GetIconIndex(currRow), m_pList->GetIndent(currRow))));
 				else
-					WriteString(BeginEl(colEl));
-			}
-			if (currCol == 0 && !sLinkPath.empty())
-			{
-				WriteString(_T("<a href=\""));
-				WriteString(sRelDestDir);
-				WriteString(_T("/"));
-				WriteString(sLinkPath);
-				WriteString(_T("\">"));
-				WriteStringEntityAware(m_pList->GetItemText(currRow, currCol));
-				WriteString(_T("</a>"));
-			}
-			else
-			{
-				WriteStringEntityAware(m_pList->GetItemText(currRow, currCol));
+					buffer.Append(BeginEl(colEl));
+				if (currCol == 0 && !sLinkPath.empty())
+				{
+					buffer.Append(_T("<a href=\""));
+					buffer.Append(sRelDestDir);
+					buffer.Append(_T("/"));
+					buffer.Append(sLinkPath);
+					buffer.Append(_T("\">"));
+					buffer.AppendEntities(GetItemText(currRow, pdi, currCol));
+					buffer.Append(_T("</a>"));
+				}
+				else
+				{
+					buffer.AppendEntities(GetItemText(currRow, pdi, currCol));
+				}
+				buffer.Append(EndEl(colEl));
 			}
-			WriteString(EndEl(colEl));
-		}
-		WriteString(EndEl(rowEl) + _T("\n"));
-		if (m_myStruct)
-			m_myStruct->context->m_pCompareStats->AddItem(-1);
-	}
-	if (!xml)
-		WriteString(_T("</table>\n"));
+			buffer.Append(EndEl(rowEl) + _T("\n"));
+		}, false);
+	if (m_bIncludeFileCmpReport && m_pFileCmpReport != nullptr)
+		m_nFailedFileCmpReports += m_pFileCmpReport->Finish();
+	WriteString(_T("</table>\n"));
 }
 
 /**
@@ -7,12 +7,15 @@
 #pragma once
 
 #include <vector>
+#include <functional>
 #include "UnicodeString.h"
 #include "PathContext.h"
 #include "DirReportTypes.h"
 #include "IListCtrl.h"
+#include "ReportBuffer.h"
 
 struct DiffFuncStruct;
+class DIFFITEM;
 
 /**
  * @brief This class creates directory compare reports.
@@ -22,6 +25,12 @@ struct DiffFuncStruct;
  * re-formatting data and complex GUI for selecting what info to show in
  * reports. Downside is we only have data that is visible in GUI.
  *
+ * When a column text function is set, cell texts are formatted directly
+ * from the DIFFITEMs in listview order instead of being queried from the
+ * listview one cell at a time. Text is collected in a ReportBuffer and
+ * written in large blocks, and list and XML rows are then formatted in
+ * chunks on several threads.
+ *
  * @todo We should read DIFFITEMs from CDirDoc and format data to better
  * fit for reporting. Duplicating formatting and sorting code should be
  * avoided.
@@ -31,11 +40,21 @@ struct IFileCmpReport
 {
 	virtual ~IFileCmpReport() {}
 	virtual bool operator()(REPORT_TYPE nReportType, IListCtrl *pList, int nIndex, const String &sDestDir, String &sLinkPath) = 0;
+	/**
+	 * @brief Wait for file compare reports still being written.
+	 * @return Number of file compare reports that could not be written.
+	 */
+	virtual int Finish() { return 0; }
 };
 
 class DirCmpReport
 {
 public:
+	/** @brief Gives the text of physical column @p col of an item. */
+	using ColumnTextFunction = std::function<String(const DIFFITEM& di, int col)>;
+
+	/** @brief Rows formatted by one thread at a time. */
+	static constexpr int RowsPerChunk = 1024;
 
 	explicit DirCmpReport(const std::vector<String>& colRegKeys);
 	void SetList(IListCtrl *pList);
@@ -51,12 +70,16 @@ public:
 	void SetIncludeFileCmpReport(bool bIncludeFileCmpReport) { m_bIncludeFileCmpReport = bIncludeFileCmpReport; }
 	bool GetIncludeFileCmpReport() const { return m_bIncludeFileCmpReport; }
 	void SetDiffFuncStruct(DiffFuncStruct* myStruct) { m_myStruct = myStruct; }
+	void SetColumnTextFunction(ColumnTextFunction func) { m_columnTextFunc = func; }
+	void SetThreadCount(int nThreads) { m_nThreads = nThreads; }
 	bool GenerateReport(String &errStr);
 
 protected:
 	void GenerateReport(REPORT_TYPE nReportType);
 	void WriteString(const String&);
+	void WriteString(const TCHAR *pszText);
 	void WriteStringEntityAware(const String& sText);
+	void Flush();
 	void GenerateHeader();
 	void GenerateContent();
 	void GenerateHTMLHeader();
@@ -66,6 +89,15 @@ protected:
 	void GenerateHTMLFooter();
 	void GenerateXmlFooter();
 
+private:
+	using RowFormatter = std::function<void(ReportBuffer& buffer, int row, const DIFFITEM *pdi)>;
+
+	String GetItemText(int row, const DIFFITEM *pdi, int col) const;
+	void FormatListRow(ReportBuffer& buffer, int row, const DIFFITEM *pdi) const;
+	void FormatXmlRow(ReportBuffer& buffer, int row, const DIFFITEM *pdi) const;
+	void GenerateRows(const RowFormatter& formatRow, bool bParallel);
+	bool ShouldAbort() const;
+
 private:
 	std::unique_ptr<IListCtrl> m_pList; /**< Pointer to UI-list */
 	PathContext m_rootPaths; /**< Root paths, printed to report */
@@ -77,8 +109,11 @@ private:
 	std::vector<String> m_colRegKeys; /**< Key names for currently displayed columns */
 	std::unique_ptr<IFileCmpReport> m_pFileCmpReport;
 	bool m_bIncludeFileCmpReport; /**< Do we include file compare report in folder compare report? */
-	bool m_bOutputUTF8;
+	int m_nFailedFileCmpReports; /**< File compare reports that could not be written */
 	REPORT_TYPE m_nReportType; /**< Report type integer */
 	bool m_bCopyToClipboard; /**< Do we copy report to clipboard? */
 	DiffFuncStruct* m_myStruct;
+	ColumnTextFunction m_columnTextFunc; /**< Formats cells from DIFFITEMs, if set */
+	int m_nThreads; /**< Threads formatting list and XML rows */
+	ReportBuffer m_buffer; /**< Report text not yet written to m_pFile */
 };
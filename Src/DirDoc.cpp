@@ -41,6 +41,7 @@
 #include "DiffWrapper.h"
 #include "FolderCmp.h"
 #include "DirViewColItems.h"
+#include "DirWatcher.h"
 #include <Poco/Semaphore.h>
 
 #ifdef _DEBUG
@@ -241,8 +242,12 @@ void CDirDoc::InitDiffContext(CDiffContext *pCtxt)
 	pCtxt->m_bStopAfterFirstDiff = GetOptionsMgr()->GetBool(OPT_CMP_STOP_AFTER_FIRST);
 	pCtxt->m_nQuickCompareLimit = GetOptionsMgr()->GetInt(OPT_CMP_QUICK_LIMIT);
 	pCtxt->m_nBinaryCompareLimit = GetOptionsMgr()->GetInt(OPT_CMP_BINARY_LIMIT);
+	pCtxt->m_nTranscodeInMemoryLimit = GetOptionsMgr()->GetInt(OPT_CMP_TRANSCODE_IN_MEMORY_LIMIT);
+	pCtxt->m_nStreamingDiffMemoryLimit = GetOptionsMgr()->GetInt(OPT_CMP_STREAMING_DIFF_MEMORY_LIMIT);
 	pCtxt->m_bPluginsEnabled = GetOptionsMgr()->GetBool(OPT_PLUGINS_ENABLED);
 	pCtxt->m_bWalkUniques = GetOptionsMgr()->GetBool(OPT_CMP_WALK_UNIQUE_DIRS);
+	pCtxt->m_bDetectMovedItems = GetOptionsMgr()->GetBool(OPT_CMP_DETECT_MOVED);
+	pCtxt->m_nMovedSimilarity = GetOptionsMgr()->GetInt(OPT_CMP_DETECT_MOVED_SIMILARITY);
 	pCtxt->m_bIgnoreReparsePoints = GetOptionsMgr()->GetBool(OPT_CMP_IGNORE_REPARSE_POINTS);
 	pCtxt->m_bIgnoreCodepage = GetOptionsMgr()->GetBool(OPT_CMP_IGNORE_CODEPAGE);
 	pCtxt->m_bEnableImageCompare = GetOptionsMgr()->GetBool(OPT_CMP_ENABLE_IMGCMP_IN_DIRCMP);
@@ -301,6 +306,11 @@ void CDirDoc::Rescan()
 	// Don't clear if only scanning selected items
 	if (!m_bMarkedRescan && !m_bGeneratingReport)
 	{
+		// The rescan finds the changes seen until now, the changes seen
+		// while it runs are rescanned when it is ready
+		WatchFolders();
+		if (m_pDirWatcher != nullptr)
+			m_pDirWatcher->TakeChanges();
 		m_pCtxt->RemoveAll();
 		m_pCtxt->InitDiffItemList();
 	}
@@ -397,6 +407,8 @@ void CDirDoc::Rescan()
 		});
 		m_diffThread.SetCompareFunction([](DiffFuncStruct* myStruct) {
 			DirScan_CompareItems(myStruct, nullptr);
+			if (myStruct->context->m_bDetectMovedItems)
+				DirScan_DetectMovedItems(myStruct);
 		});
 		m_diffThread.SetMarkedRescan(false);
 	}
@@ -590,6 +602,54 @@ void CDirDoc::CompareReady()
 	if (m_pCmpProgressBar != nullptr)
 		m_pDirView->GetParentFrame()->ShowControlBar(m_pCmpProgressBar.get(), FALSE, FALSE);
 	m_pCmpProgressBar.reset();
+
+	// Watch compared folders, and catch up with changes seen while comparing
+	WatchFolders();
+	if (m_pDirWatcher != nullptr && m_pDirWatcher->HasChanges())
+		m_pDirView->PostMessage(MSG_WATCHED_FOLDERS_CHANGED);
+}
+
+/**
+ * @brief Start or stop watching the compared folders, as set in options.
+ * The watcher is kept as long as the compared folders and the recursion
+ * stay the same, so that it also sees the changes made while comparing.
+ */
+void CDirDoc::WatchFolders()
+{
+	if (!GetOptionsMgr()->GetBool(OPT_CMP_WATCH_FOLDERS) || m_pCtxt == nullptr)
+	{
+		m_pDirWatcher.reset();
+		return;
+	}
+	std::vector<String> folders;
+	for (int nIndex = 0; nIndex < m_nDirs; ++nIndex)
+		folders.push_back(m_pCtxt->GetPath(nIndex));
+	if (m_pDirWatcher == nullptr || !m_pDirWatcher->IsWatching(folders, m_pCtxt->m_bRecursive))
+	{
+		HWND hWnd = m_pDirView->GetSafeHwnd();
+		m_pDirWatcher.reset(new DirWatcher(folders, m_pCtxt->m_bRecursive,
+			[hWnd]() { PostMessage(hWnd, MSG_WATCHED_FOLDERS_CHANGED, 0, 0); }));
+	}
+}
+
+/**
+ * @brief Take the changes of the watched folders.
+ * Changes are left for later while a compare is running.
+ * @param [out] changedPaths Changed paths, relative to the compared folders.
+ * @param [out] bOverflow Set if some changes were lost.
+ * @return false if there are no changes to rescan now.
+ */
+bool CDirDoc::TakeWatchedChanges(std::set<String>& changedPaths, bool& bOverflow)
+{
+	if (m_pDirWatcher == nullptr || m_bGeneratingReport ||
+		m_diffThread.GetThreadState() == CDiffThread::THREAD_COMPARING)
+		return false;
+	DirWatcher::Changes changes = m_pDirWatcher->TakeChanges();
+	if (changes.empty())
+		return false;
+	changedPaths.swap(changes.paths);
+	bOverflow = changes.bOverflow;
+	return true;
 }
 
 /**
@@ -12,6 +12,7 @@
 #pragma once
 
 #include <memory>
+#include <set>
 #include "DiffThread.h"
 #include "PluginManager.h"
 #include "FileFilterHelper.h"
@@ -25,6 +26,7 @@ typedef CTypedPtrList<CPtrList, IMergeDoc *> MergeDocPtrList;
 class DirDocFilterGlobal;
 class DirDocFilterByExtension;
 class CTempPathContext;
+class DirWatcher;
 struct FileActionItem;
 struct FileLocation;
 
@@ -86,6 +88,7 @@ public:
 	bool HasDirView() const { return m_pDirView != nullptr; }
 	void RefreshOptions();
 	void CompareReady();
+	bool TakeWatchedChanges(std::set<String>& changedPaths, bool& bOverflow);
 	void UpdateChangedItem(const PathContext & paths,
 		UINT nDiffs, UINT nTrivialDiffs, bool bIdentical);
 	void UpdateResources();
@@ -130,6 +133,7 @@ protected:
 	void InitDiffContext(CDiffContext *pCtxt);
 	void LoadLineFilterList(CDiffContext *pCtxt);
 	void LoadSubstitutionFiltersList(CDiffContext* pCtxt);
+	void WatchFolders();
 
 	// Generated message map functions
 	//{{AFX_MSG(CDirDoc)
@@ -156,6 +160,7 @@ private:
 	std::unique_ptr<DirCmpReport> m_pReport;
 	FileFilterHelper m_fileHelper; /**< File filter helper */
 	std::unique_ptr<DirCompProgressBar> m_pCmpProgressBar;
+	std::unique_ptr<DirWatcher> m_pDirWatcher; /**< Watches compared folders for changes, if enabled */
 };
 
 /**
@@ -12,6 +12,7 @@
 #include "TFile.h"
 #include "DebugNew.h"
 #include <filesystem>
+#include <windows.h>
 
 /**
  * @brief Set filename and path for the item.
@@ -68,7 +69,12 @@ bool DirItem::Update(const String &sFilePath)
 			if (!file.isDirectory())
 				size = file.getSize();
 
+#ifdef _WIN32
 			flags.attributes = GetFileAttributes(file.wpath().c_str());
+#else
+			flags.attributes = (file.isDirectory() ? FILE_ATTRIBUTE_DIRECTORY : 0) |
+				(file.canWrite() ? 0 : FILE_ATTRIBUTE_READONLY);
+#endif
 
 			retVal = true;
 		}
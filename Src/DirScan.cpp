@@ -8,6 +8,10 @@
 #include "DirScan.h"
 #include <cassert>
 #include <memory>
+#include <atomic>
+#include <functional>
+#include <io.h>
+#include <fcntl.h>
 #define POCO_NO_UNWINDOWS 1
 #include <Poco/Semaphore.h>
 #include <Poco/Notification.h>
@@ -20,21 +24,27 @@
 #include <Poco/AutoPtr.h>
 #include <Poco/Stopwatch.h>
 #include <Poco/Format.h>
+#include <Poco/Timestamp.h>
 #include "DiffThread.h"
 #include "UnicodeString.h"
 #include "DiffWrapper.h"
 #include "CompareStats.h"
 #include "FolderCmp.h"
+#include "MoveDetection.h"
 #include "FileFilterHelper.h"
 #include "IAbortable.h"
 #include "DirItem.h"
 #include "DirTravel.h"
 #include "paths.h"
+#ifdef _WIN32
 #include "Plugins.h"
+#endif
 #include "MergeApp.h"
 #include "OptionsDef.h"
 #include "OptionsMgr.h"
 #include "PathContext.h"
+#include "TFile.h"
+#include "PerfTrace.h"
 #include "DebugNew.h"
 
 using Poco::NotificationQueue;
@@ -45,6 +55,9 @@ using Poco::ThreadPool;
 using Poco::Runnable;
 using Poco::Environment;
 using Poco::Stopwatch;
+using Poco::Semaphore;
+using Poco::FastMutex;
+using Poco::Timestamp;
 
 // Static functions (ie, functions only used locally)
 static void CompareDiffItem(FolderCmp &fc, DIFFITEM &di);
@@ -54,6 +67,9 @@ static DIFFITEM *AddToList(const String &sDir1, const String &sDir2, const Strin
 	unsigned code, DiffFuncStruct *myStruct, DIFFITEM *parent, int nItems = 3);
 static void UpdateDiffItem(DIFFITEM &di, bool &bExists, CDiffContext *pCtxt);
 static int CompareItems(NotificationQueue &queue, DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos);
+static int CompareRequestedItems(NotificationQueue &queue, DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos);
+static int CompareItemsOnWorkers(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos,
+	const std::function<int(NotificationQueue &, DiffFuncStruct *, DIFFITEM *)> &compareItems);
 
 class WorkNotification: public Poco::Notification
 {
@@ -78,24 +94,30 @@ private:
 class DiffWorker: public Runnable
 {
 public:
-	DiffWorker(NotificationQueue& queue, CDiffContext *pCtxt, int id):
-	  m_queue(queue), m_pCtxt(pCtxt), m_id(id) {}
+	DiffWorker(NotificationQueue& queue, CDiffContext *pCtxt, int id,
+		std::shared_ptr<const FolderCmpSnapshot> pSnapshot, Semaphore *pReadAhead = nullptr):
+	  m_queue(queue), m_pCtxt(pCtxt), m_id(id), m_pSnapshot(pSnapshot), m_pReadAhead(pReadAhead) {}
 
 	void run()
 	{
-		FolderCmp fc(m_pCtxt);
+		FolderCmp fc(m_pCtxt, m_pSnapshot);
 		// keep the scripts alive during the Rescan
 		// when we exit the thread, we delete this and release the scripts
+#ifdef _WIN32
 		CAssureScriptsForThread scriptsForRescan;
+#endif
 
 		AutoPtr<Notification> pNf(m_queue.waitDequeueNotification());
 		while (pNf.get() != nullptr)
 		{
 			WorkNotification* pWorkNf = dynamic_cast<WorkNotification*>(pNf.get());
 			if (pWorkNf != nullptr) {
+				m_pCtxt->m_pCompareStats->SetCompareQueueDepth(m_queue.size());
 				m_pCtxt->m_pCompareStats->BeginCompare(&pWorkNf->data(), m_id);
 				if (!m_pCtxt->ShouldAbort())
 					CompareDiffItem(fc, pWorkNf->data());
+				if (m_pReadAhead != nullptr)
+					m_pReadAhead->set();
 				pWorkNf->queueResult().enqueueNotification(new WorkCompletedNotification(pWorkNf->data()));
 			}
 			pNf = m_queue.waitDequeueNotification();
@@ -106,10 +128,196 @@ private:
 	NotificationQueue& m_queue;
 	CDiffContext *m_pCtxt;
 	int m_id;
+	std::shared_ptr<const FolderCmpSnapshot> m_pSnapshot; /**< Settings shared by all workers */
+	Semaphore *m_pReadAhead; /**< Released once an item read ahead is compared */
 };
 
 typedef std::shared_ptr<DiffWorker> DiffWorkerPtr;
 
+/**
+ * @brief Limits the number of files the PrefetchWorker threads read at once.
+ *
+ * The limit is tuned from the average time taken to open a file and read its
+ * first block. It grows while reads are slow and the DiffWorker threads wait
+ * for work, as on network drives, and shrinks while reads are fast. Once
+ * reads stay fast with one file read at a time, files are no longer read
+ * ahead, except one in ProbeInterval files to notice when reads slow down.
+ */
+class PrefetchDepth
+{
+public:
+	static constexpr int TuneInterval = 16; /**< Files read between two adjustments */
+	static constexpr int ProbeInterval = 64; /**< Files passed between two reads when not reading ahead */
+	static constexpr Timestamp::TimeDiff SlowRead = 2000; /**< Microseconds */
+	static constexpr Timestamp::TimeDiff FastRead = 200; /**< Microseconds */
+
+	explicit PrefetchDepth(int nMaxDepth)
+		: m_nMaxDepth(nMaxDepth)
+		, m_nDepth((nMaxDepth + 1) / 2)
+		, m_sem((nMaxDepth + 1) / 2, nMaxDepth)
+		, m_avgLatency(0)
+		, m_nSamples(0)
+		, m_nSinceTune(0)
+		, m_bBypass(false)
+		, m_nBypassed(0)
+	{
+	}
+
+	/**
+	 * @brief Wait until a file may be read ahead.
+	 * @return false if the file should not be read ahead.
+	 */
+	bool Enter()
+	{
+		if (m_bBypass && ++m_nBypassed % ProbeInterval != 0)
+			return false;
+		m_sem.wait();
+		return true;
+	}
+
+	/**
+	 * @brief Record the time taken to read a file and adjust the limit.
+	 * @param [in] latency Microseconds taken to open the file and read its first block.
+	 * @param [in] bComparersIdle Are the DiffWorker threads waiting for work?
+	 */
+	void Leave(Timestamp::TimeDiff latency, bool bComparersIdle)
+	{
+		bool bRelease = true;
+		bool bGrow = false;
+		{
+			FastMutex::ScopedLock lock(m_mutex);
+			m_avgLatency = (m_nSamples++ == 0) ? latency : (m_avgLatency * 7 + latency) / 8;
+			if (++m_nSinceTune >= TuneInterval || m_bBypass)
+			{
+				m_nSinceTune = 0;
+				if (m_avgLatency >= SlowRead)
+				{
+					m_bBypass = false;
+					if (bComparersIdle && m_nDepth < m_nMaxDepth)
+					{
+						++m_nDepth;
+						bGrow = true;
+					}
+				}
+				else if (m_avgLatency <= FastRead)
+				{
+					if (m_nDepth > 1)
+					{
+						--m_nDepth;
+						bRelease = false;
+					}
+					else
+						m_bBypass = true;
+				}
+			}
+		}
+		if (bRelease)
+			m_sem.set();
+		if (bGrow)
+			m_sem.set();
+	}
+
+	/** @brief Return the number of files read ahead at once, 0 if not reading ahead. */
+	int GetDepth() const { return m_bBypass ? 0 : m_nDepth.load(); }
+
+private:
+	const int m_nMaxDepth;
+	std::atomic_int m_nDepth;
+	Semaphore m_sem; /**< One count per file that may be read now */
+	FastMutex m_mutex;
+	Timestamp::TimeDiff m_avgLatency;
+	int m_nSamples;
+	int m_nSinceTune;
+	std::atomic_bool m_bBypass;
+	std::atomic_int m_nBypassed;
+};
+
+/**
+ * @brief Reads the files of queued items before passing the items to the
+ * DiffWorker threads.
+ *
+ * Opening and reading files blocks for a long time on slow disks and network
+ * drives. The files of an item are read here in large sequential blocks, up
+ * to PrefetchLimit bytes each, while the DiffWorker threads are comparing
+ * earlier items. The compare engines open the files themselves, so what is
+ * read ahead is the content of the system file cache; the block buffer of
+ * each thread is reused for all files. The number of items read ahead and
+ * not compared yet is bounded by the read-ahead semaphore, which the
+ * DiffWorker threads release.
+ */
+class PrefetchWorker: public Runnable
+{
+public:
+	static constexpr int PrefetchBlockSize = 256 * 1024;
+	static constexpr int64_t PrefetchLimit = 4 * 1024 * 1024;
+
+	PrefetchWorker(NotificationQueue& queue, NotificationQueue& queueCompare, PrefetchDepth& depth,
+		Semaphore& readAhead, CDiffContext *pCtxt):
+	  m_queue(queue), m_queueCompare(queueCompare), m_depth(depth), m_readAhead(readAhead), m_pCtxt(pCtxt) {}
+
+	void run()
+	{
+		std::vector<char> buffer(PrefetchBlockSize);
+		AutoPtr<Notification> pNf(m_queue.waitDequeueNotification());
+		while (pNf.get() != nullptr)
+		{
+			WorkNotification* pWorkNf = dynamic_cast<WorkNotification*>(pNf.get());
+			if (pWorkNf != nullptr) {
+				DIFFITEM& di = pWorkNf->data();
+				m_readAhead.wait();
+				if (!di.diffcode.isDirectory() && !m_pCtxt->ShouldAbort() && m_depth.Enter())
+					m_depth.Leave(PrefetchFiles(di, buffer), m_queueCompare.empty());
+				if (di.diffcode.existAll())
+					m_queueCompare.enqueueUrgentNotification(pNf);
+				else
+					m_queueCompare.enqueueNotification(pNf);
+				m_pCtxt->m_pCompareStats->SetPrefetchQueueDepth(m_queue.size(), m_depth.GetDepth());
+			}
+			pNf = m_queue.waitDequeueNotification();
+		}
+	}
+
+private:
+	/**
+	 * @brief Read the files of an item into the system file cache.
+	 * @return Longest time in microseconds taken to open a file and read its first block.
+	 */
+	Timestamp::TimeDiff PrefetchFiles(const DIFFITEM& di, std::vector<char>& buffer) const
+	{
+		PathContext files;
+		m_pCtxt->GetComparePaths(di, files);
+		Timestamp::TimeDiff latency = 0;
+		for (int i = 0; i < files.GetSize(); ++i)
+		{
+			if (!di.diffcode.exists(i) || di.diffFileInfo[i].size == 0)
+				continue;
+			Timestamp start;
+			int fd = -1;
+			if (_tsopen_s(&fd, TFile(files[i]).wpath().c_str(), O_BINARY | O_RDONLY | O_SEQUENTIAL, _SH_DENYNO, _S_IREAD) != 0)
+				continue;
+			int64_t nRead = 0;
+			int size;
+			while (nRead < PrefetchLimit && !m_pCtxt->ShouldAbort() &&
+				(size = _read(fd, buffer.data(), static_cast<unsigned>(buffer.size()))) > 0)
+			{
+				if (nRead == 0)
+					latency = (std::max)(latency, start.elapsed());
+				nRead += size;
+			}
+			_close(fd);
+		}
+		return latency;
+	}
+
+	NotificationQueue& m_queue;
+	NotificationQueue& m_queueCompare;
+	PrefetchDepth& m_depth;
+	Semaphore& m_readAhead;
+	CDiffContext *m_pCtxt;
+};
+
+typedef std::shared_ptr<PrefetchWorker> PrefetchWorkerPtr;
+
 /**
  * @brief Collect file- and folder-names to list.
  * This function walks given folders and adds found subfolders and files into
@@ -138,7 +346,7 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 		bool casesensitive, int depth, DIFFITEM *parent,
 		bool bUniques)
 {
-	static const TCHAR backslash[] = _T("\\");
+	PERFTRACE_SCOPE("DirScan_GetItems", subdir[0]);
 	int nDirs = paths.GetSize();
 	CDiffContext *pCtxt = myStruct->context;
 	String sDir[3];
@@ -151,7 +359,7 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 		for (int nIndex = 0; nIndex < paths.GetSize(); nIndex++)
 		{
 			sDir[nIndex] = paths::ConcatPath(sDir[nIndex], subdir[nIndex]);
-			subprefix[nIndex] = subdir[nIndex] + backslash;
+			subprefix[nIndex] = subdir[nIndex] + paths::PathSeparator;
 		}
 	}
 
@@ -472,6 +680,38 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
  * @return >= 0 number of diff items, -1 if compare was aborted
  */
 int DirScan_CompareItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
+{
+	return CompareItemsOnWorkers(myStruct, parentdiffpos, CompareItems);
+}
+
+/**
+ * @brief Return the number of PrefetchWorker threads reading files ahead of
+ * the DiffWorker threads, 0 if the compare method does not read files.
+ */
+static int GetPrefetchThreadCount(int compareMethod)
+{
+	if (compareMethod != CMP_CONTENT && compareMethod != CMP_QUICK_CONTENT && compareMethod != CMP_BINARY_CONTENT)
+		return 0;
+	int nprefetchers = GetOptionsMgr()->GetInt(OPT_CMP_PREFETCH_THREADS);
+	if (nprefetchers < 0)
+		return 0;
+	if (nprefetchers == 0)
+		return (std::min)(2 * static_cast<int>(Environment::processorCount()), 32);
+	return nprefetchers;
+}
+
+/**
+ * @brief Start the DiffWorker threads and compare items on them.
+ * Items are compared on several threads for content compares and on one
+ * thread for other compare methods. For compare methods reading the files,
+ * items are queued to PrefetchWorker threads first, which read the files
+ * and pass the items on to the DiffWorker threads. The compare settings are
+ * copied once into a FolderCmpSnapshot shared by all DiffWorker threads.
+ * @param compareItems [in] Walks the items and queues them for the workers
+ * @return Return value of @p compareItems
+ */
+static int CompareItemsOnWorkers(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos,
+	const std::function<int(NotificationQueue &, DiffFuncStruct *, DIFFITEM *)> &compareItems)
 {
 	const int compareMethod = myStruct->context->GetCompareMethod();
 	int nworkers = 1;
@@ -483,20 +723,44 @@ int DirScan_CompareItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
 			nworkers += Environment::processorCount();
 		nworkers = std::clamp(nworkers, 1, static_cast<int>(Environment::processorCount()));
 	}
+	const int nprefetchers = GetPrefetchThreadCount(compareMethod);
+	const int nreadahead = (std::max)(nworkers * 4, nprefetchers);
 
 	ThreadPool threadPool(nworkers, nworkers);
 	std::vector<DiffWorkerPtr> workers;
 	NotificationQueue queue;
+	Semaphore readAhead(nreadahead, nreadahead);
+	auto pSnapshot = std::make_shared<FolderCmpSnapshot>(myStruct->context);
 	myStruct->context->m_pCompareStats->SetCompareThreadCount(nworkers);
 	for (int i = 0; i < nworkers; ++i)
 	{
-		workers.emplace_back(std::make_shared<DiffWorker>(queue, myStruct->context, i));
+		workers.emplace_back(std::make_shared<DiffWorker>(queue, myStruct->context, i, pSnapshot,
+			nprefetchers > 0 ? &readAhead : nullptr));
 		threadPool.start(*workers[i]);
 	}
 
-	int res = CompareItems(queue, myStruct, parentdiffpos);
+	std::unique_ptr<ThreadPool> pPrefetchPool;
+	std::vector<PrefetchWorkerPtr> prefetchers;
+	NotificationQueue queuePrefetch;
+	PrefetchDepth depth((std::max)(nprefetchers, 1));
+	if (nprefetchers > 0)
+	{
+		pPrefetchPool.reset(new ThreadPool(nprefetchers, nprefetchers));
+		for (int i = 0; i < nprefetchers; ++i)
+		{
+			prefetchers.emplace_back(std::make_shared<PrefetchWorker>(queuePrefetch, queue, depth, readAhead, myStruct->context));
+			pPrefetchPool->start(*prefetchers[i]);
+		}
+	}
+
+	int res = compareItems(nprefetchers > 0 ? queuePrefetch : queue, myStruct, parentdiffpos);
 
 	Thread::sleep(100);
+	if (pPrefetchPool)
+	{
+		queuePrefetch.wakeUpAll();
+		pPrefetchPool->joinAll();
+	}
 	queue.wakeUpAll();
 	threadPool.joinAll();
 
@@ -597,17 +861,24 @@ static int CompareItems(NotificationQueue& queue, DiffFuncStruct *myStruct, DIFF
 /**
  * @brief Compare DiffItems in context marked for rescan.
  *
+ * Files marked for rescan are queued for the DiffWorker threads, with
+ * the same priorities as in CompareItems(), and their results are collected
+ * once all items of the folder are queued.
+ *
+ * @param queue [in] Work queue of the PrefetchWorker or DiffWorker threads
  * @param myStruct [in,out] A structure containing compare-related data.
  * @param parentdiffpos [in] Position of parent diff item 
  * @return >= 0 number of diff items, -1 if compare was aborted
  */
-static int CompareRequestedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
+static int CompareRequestedItems(NotificationQueue& queue, DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
 {
+	NotificationQueue queueResult;
 	CDiffContext *pCtxt = myStruct->context;
-	FolderCmp fc(pCtxt);
 	int res = 0;
+	int count = 0;
 	bool bCompareFailure = false;
 	bool bCompareIndeterminate = false;
+	bool bAborted = false;
 	if (parentdiffpos == nullptr)
 		myStruct->pSemaphore->wait();
 
@@ -621,7 +892,7 @@ static int CompareRequestedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffp
 	{
 		if (pCtxt->ShouldAbort())
 		{
-			res = -1;
+			bAborted = true;
 			break;
 		}
 
@@ -633,7 +904,7 @@ static int CompareRequestedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffp
 			if (pCtxt->m_bRecursive)
 			{
 				di.diffcode.diffcode &= ~(DIFFCODE::DIFF | DIFFCODE::SAME);
-				int ndiff = CompareRequestedItems(myStruct, curpos);
+				int ndiff = CompareRequestedItems(queue, myStruct, curpos);
 				if (ndiff > 0)
 				{
 					if (existsalldirs)
@@ -663,17 +934,12 @@ static int CompareRequestedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffp
 		{
 			if (di.diffcode.isScanNeeded())
 			{
-				CompareDiffItem(fc, di);
-				if (di.diffcode.isResultError())
-				{ 
-					DIFFITEM *diParent = di.GetParentLink();
-					assert(diParent != nullptr);
-					if (diParent != nullptr)
-					{
-						diParent->diffcode.diffcode |= DIFFCODE::CMPERR;
-						bCompareFailure = true;
-					}
-				}
+				if (existsalldirs)
+					queue.enqueueUrgentNotification(new WorkNotification(di, queueResult));
+				else
+					queue.enqueueNotification(new WorkNotification(di, queueResult));
+				++count;
+				continue;
 			}
 			else
 			{
@@ -687,12 +953,98 @@ static int CompareRequestedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffp
 			(!existsalldirs && !di.diffcode.isResultFiltered()))
 			res++;
 	}
+
+	while (count > 0)
+	{
+		AutoPtr<Notification> pNf(queueResult.waitDequeueNotification());
+		if (pNf.get() == nullptr)
+			break;
+		WorkCompletedNotification* pWorkCompletedNf = dynamic_cast<WorkCompletedNotification*>(pNf.get());
+		if (pWorkCompletedNf != nullptr) {
+			DIFFITEM &di = pWorkCompletedNf->data();
+			if (di.diffcode.isResultError())
+			{ 
+				DIFFITEM *diParent = di.GetParentLink();
+				assert(diParent != nullptr);
+				if (diParent != nullptr)
+				{
+					diParent->diffcode.diffcode |= DIFFCODE::CMPERR;
+					bCompareFailure = true;
+				}
+			}
+			if (di.diffcode.isResultDiff() ||
+				(!di.diffcode.existAll() && !di.diffcode.isResultFiltered()))
+				res++;
+		}
+		--count;
+	}
+	if (bAborted || pCtxt->ShouldAbort())
+		bCompareFailure = true;
+
 	return bCompareIndeterminate ? -2 : (bCompareFailure ? -1 : res);
 }
 
 int DirScan_CompareRequestedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
 {
-	return CompareRequestedItems(myStruct, parentdiffpos);
+	return CompareItemsOnWorkers(myStruct, parentdiffpos, CompareRequestedItems);
+}
+
+/**
+ * @brief Pair the unique files which were moved or renamed.
+ * Run once the items are compared. Each left only file paired with a right
+ * only file gets the right file as its right side and the right only item
+ * is removed. Identical files get their result at once, similar text files
+ * are queued for the DiffWorker threads like other items.
+ * @param myStruct [in] A structure containing compare-related data.
+ * @return Number of pairs, -1 if compare was aborted
+ */
+int DirScan_DetectMovedItems(DiffFuncStruct *myStruct)
+{
+	CDiffContext *pCtxt = myStruct->context;
+	if (pCtxt->GetCompareDirs() != 2)
+		return 0;
+	CompareStats *pStats = pCtxt->m_pCompareStats;
+	// The items shown as being compared may be removed
+	pStats->ClearCurDiffItems();
+
+	MoveDetectionOptions options;
+	options.nSimilarity = pCtxt->m_nMovedSimilarity;
+	options.nThreads = (std::min)(2 * static_cast<int>(Environment::processorCount()), 32);
+	options.piAbortable = pCtxt->GetAbortable();
+	std::vector<MovedItem> moved = FindMovedItems(*pCtxt, pCtxt->GetNormalizedPaths(), options);
+	if (pCtxt->ShouldAbort())
+		return -1;
+
+	std::vector<DIFFITEM *> similar;
+	for (const auto& item : moved)
+	{
+		pStats->RemoveItem(item.pdi[0]->diffcode.diffcode);
+		pStats->RemoveItem(item.pdi[1]->diffcode.diffcode);
+		pStats->IncreaseTotalItems();
+		DIFFITEM *pdi = PairMovedItems(*pCtxt, item);
+		if (item.bIdentical)
+			pStats->AddItem(pdi->diffcode.diffcode);
+		else
+			similar.push_back(pdi);
+	}
+	if (similar.empty())
+		return static_cast<int>(moved.size());
+
+	CompareItemsOnWorkers(myStruct, nullptr,
+		[&similar](NotificationQueue &queue, DiffFuncStruct *myStruct, DIFFITEM *)
+		{
+			NotificationQueue queueResult;
+			for (DIFFITEM *pdi : similar)
+				queue.enqueueNotification(new WorkNotification(*pdi, queueResult));
+			for (size_t count = similar.size(); count > 0; --count)
+			{
+				AutoPtr<Notification> pNf(queueResult.waitDequeueNotification());
+				if (pNf.get() == nullptr)
+					break;
+			}
+			return myStruct->context->ShouldAbort() ? -1 : 0;
+		});
+	return pCtxt->ShouldAbort() ? -1 : static_cast<int>(moved.size());
 }
 
 static int markChildrenForRescan(CDiffContext *pCtxt, DIFFITEM *parentdiffpos)
@@ -732,8 +1084,7 @@ int DirScan_UpdateMarkedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
 			UpdateDiffItem(di, bItemsExist, pCtxt);
 			if (!bItemsExist)
 			{ 
-				di.DelinkFromSiblings();	// delink from list of Siblings
-				delete &di;					// Also delete all Children items
+				pCtxt->RemoveDiff(&di);		// Delink from Siblings, also remove all Children items
 				continue;					// (... because `di` is now invalid)
 			}
 			if (!di.diffcode.isDirectory())
@@ -746,7 +1097,7 @@ int DirScan_UpdateMarkedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
 					di.diffFileInfo[i].size = 0;
 			if (di.diffcode.isScanNeeded() && !di.diffcode.isResultFiltered())
 			{
-				di.RemoveChildren();
+				pCtxt->RemoveChildren(&di);
 				di.diffcode.diffcode &= ~DIFFCODE::NEEDSCAN;
 
 				bool casesensitive = false;
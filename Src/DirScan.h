@@ -20,3 +20,4 @@ int DirScan_UpdateMarkedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
 
 int DirScan_CompareItems(DiffFuncStruct *, DIFFITEM *parentdiffpos);
 int DirScan_CompareRequestedItems(DiffFuncStruct *, DIFFITEM *parentdiffpos);
+int DirScan_DetectMovedItems(DiffFuncStruct *myStruct);
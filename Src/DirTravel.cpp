@@ -9,6 +9,7 @@
 #include "DirTravel.h"
 #include <algorithm>
 #include <Poco/DirectoryIterator.h>
+#include <Poco/Exception.h>
 #include <Poco/Timestamp.h>
 #include <windows.h>
 #include "TFile.h"
@@ -16,7 +17,9 @@
 #include "DirItem.h"
 #include "unicoder.h"
 #include "paths.h"
+#ifdef _WIN32
 #include "Win_VersionHelper.h"
+#endif
 #include "DebugNew.h"
 
 using Poco::DirectoryIterator;
@@ -50,28 +53,41 @@ void LoadAndSortFiles(const String& sDir, DirItemArray * dirs, DirItemArray * fi
 static void LoadFiles(const String& sDir, DirItemArray * dirs, DirItemArray * files)
 {
 	boost::flyweight<String> dir(sDir);
-#if 0
-	DirectoryIterator it(ucr::toUTF8(sDir));
-	DirectoryIterator end;
+#ifndef _WIN32
+	try
+	{
+		DirectoryIterator it(ucr::toUTF8(sDir));
+		DirectoryIterator end;
 
-	for (; it != end; ++it)
+		for (; it != end; ++it)
+		{
+			try
+			{
+				bool bIsDirectory = it->isDirectory();
+
+				DirItem ent;
+				ent.ctime = it->created();
+				if (ent.ctime < 0)
+					ent.ctime = 0;
+				ent.mtime = it->getLastModified();
+				if (ent.mtime < 0)
+					ent.mtime = 0;
+				ent.size = bIsDirectory ? DirItem::FILE_SIZE_NONE : it->getSize();
+				ent.path = dir;
+				ent.filename = ucr::toTString(it.name());
+				ent.flags.attributes = (bIsDirectory ? FILE_ATTRIBUTE_DIRECTORY : 0) |
+					(it->canWrite() ? 0 : FILE_ATTRIBUTE_READONLY);
+				(bIsDirectory ? dirs : files)->push_back(ent);
+			}
+			catch (Poco::FileException&)
+			{
+				// dangling symbolic link, or removed while the folder is read
+			}
+		}
+	}
+	catch (Poco::Exception&)
 	{
-		bool bIsDirectory = it->isDirectory();
-		if (bIsDirectory)
-			continue;
-
-		DirItem ent;
-		ent.ctime = it->created();
-		if (ent.ctime < 0)
-			ent.ctime = 0;
-		ent.mtime = it->getLastModified();
-		if (ent.mtime < 0)
-			ent.mtime = 0;
-		ent.size = it->getSize();
-		ent.path = dir;
-		ent.filename = ucr::toTString(it.name());
-		ent.flags.attributes = GetFileAttributes(ucr::toTString(it.name()).c_str());		
-		(bIsDirectory ? dirs : files)->push_back(ent);
+		// unreadable folder, like FindFirstFile() failing
 	}
 
 #else
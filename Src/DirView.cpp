@@ -32,6 +32,7 @@
 #include "BCMenu.h"
 #include "DirCmpReportDlg.h"
 #include "DirCmpReport.h"
+#include "FileCmpHtmlReport.h"
 #include "CompareStatisticsDlg.h"
 #include "LoadSaveCodepageDlg.h"
 #include "ConfirmFolderCopyDlg.h"
@@ -47,10 +48,15 @@
 #include "IntToIntMap.h"
 #include "PatchTool.h"
 #include "SyntaxColors.h"
+#include "OptionsDiffOptions.h"
+#include "OptionsDiffColors.h"
+#include "OptionsFont.h"
 #include "Shell.h"
 #include "DirTravel.h"
+#include "DirWatcher.h"
 #include <numeric>
 #include <functional>
+#include <Poco/Environment.h>
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -129,6 +135,7 @@ BEGIN_MESSAGE_MAP(CDirView, CListView)
 	ON_WM_KEYDOWN()
 	ON_WM_TIMER()
 	ON_MESSAGE(MSG_UI_UPDATE, OnUpdateUIMessage)
+	ON_MESSAGE(MSG_WATCHED_FOLDERS_CHANGED, OnWatchedFoldersChanged)
 	ON_COMMAND(ID_EDIT_COPY, OnEditCopy)
 	ON_COMMAND(ID_EDIT_CUT, OnEditCut)
 	ON_COMMAND(ID_EDIT_PASTE, OnEditPaste)
@@ -1124,10 +1131,7 @@ void CDirView::SortColumnsAppropriately()
 
 	bool bSortAscending = GetOptionsMgr()->GetBool(OPT_DIRVIEW_SORT_ASCENDING);
 	m_ctlSortHeader.SetSortImage(m_pColItems->ColLogToPhys(sortCol), bSortAscending);
-	//sort using static CompareFunc comparison function
-	CompareState cs(&GetDiffContext(), m_pColItems.get(), sortCol, bSortAscending, m_bTreeMode);
-	std::stable_sort(m_listViewItems.begin(), m_listViewItems.end(), [&cs](const ListViewOwnerDataItem& a, const ListViewOwnerDataItem& b)
-		{ return CompareState::CompareFunc(a.lParam, b.lParam, reinterpret_cast<LPARAM>(&cs)) < 0; });
+	SortListViewItems(0, m_listViewItems.size());
 
 	m_firstDiffItem.reset();
 	m_lastDiffItem.reset();
@@ -1135,6 +1139,35 @@ void CDirView::SortColumnsAppropriately()
 	m_pList->Invalidate();
 }
 
+/**
+ * @brief Sort a range of the list view items on the current sort column.
+ * In tree mode a range holding a complete subtree can be sorted alone, as
+ * its items are only ordered against each other.
+ * @param [in] first Index of the first item to sort.
+ * @param [in] last Index past the last item to sort.
+ */
+void CDirView::SortListViewItems(size_t first, size_t last)
+{
+	int sortCol = GetOptionsMgr()->GetInt((GetDocument()->m_nDirs < 3) ? OPT_DIRVIEW_SORT_COLUMN : OPT_DIRVIEW_SORT_COLUMN3);
+	if (sortCol < 0 || sortCol >= m_pColItems->GetColCount())
+		return;
+
+	bool bSortAscending = GetOptionsMgr()->GetBool(OPT_DIRVIEW_SORT_ASCENDING);
+	// Sort special items always first in dir view, then sort the
+	// remaining items once and apply the resulting order to the list
+	auto itFirst = std::stable_partition(m_listViewItems.begin() + first, m_listViewItems.begin() + last,
+		[](const ListViewOwnerDataItem& item) { return item.lParam == -1; });
+	auto itLast = m_listViewItems.begin() + last;
+	std::vector<const DIFFITEM *> items;
+	items.reserve(itLast - itFirst);
+	for (auto it = itFirst; it != itLast; ++it)
+		items.push_back(&GetDiffContext().GetDiffAt(reinterpret_cast<DIFFITEM *>(it->lParam)));
+	std::vector<size_t> order = m_pColItems->ColSortOrder(&GetDiffContext(), sortCol, items, bSortAscending, m_bTreeMode);
+	std::vector<ListViewOwnerDataItem> sorted(itFirst, itLast);
+	for (size_t i = 0; i < order.size(); ++i)
+		*(itFirst + i) = sorted[order[i]];
+}
+
 /// Do any last minute work as view closes
 void CDirView::OnDestroy()
 {
@@ -1215,17 +1248,38 @@ void CDirView::CollapseSubdir(int sel)
 
 	dip.customFlags &= ~ViewCustomFlags::EXPANDED;
 
-	int count = m_pList->GetItemCount();
-	for (int i = sel + 1; i < count; i++)
-	{
-		const DIFFITEM& di = GetDiffItem(i);
-		if (!di.IsAncestor(&dip))
-			break;
-		m_listViewItems.erase(m_listViewItems.begin() + i);
-		m_pList->DeleteItem(i--);
-		count--;
+	// Descendants of the folder follow it, so remove them as one range
+	int count = static_cast<int>(m_listViewItems.size());
+	int last = sel + 1;
+	while (last < count && GetDiffItem(last).IsAncestor(&dip))
+		++last;
+	const int removed = last - (sel + 1);
+	if (removed > 0)
+	{
+		// The owner data list keeps item states by index, so move the
+		// states of the items below the removed range up with them
+		std::vector<std::pair<int, UINT>> states;
+		const UINT stateMask = LVIS_SELECTED | LVIS_FOCUSED;
+		for (int i = m_pList->GetNextItem(-1, LVNI_SELECTED); i != -1; i = m_pList->GetNextItem(i, LVNI_SELECTED))
+		{
+			if (i <= sel || i >= last)
+				states.emplace_back(i <= sel ? i : i - removed, m_pList->GetItemState(i, stateMask));
+		}
+		int focused = m_pList->GetNextItem(-1, LVNI_FOCUSED);
+		m_pList->SetItemState(-1, 0, stateMask);
+
+		m_listViewItems.erase(m_listViewItems.begin() + sel + 1, m_listViewItems.begin() + last);
+		m_pList->SetItemCountEx(static_cast<int>(m_listViewItems.size()), LVSICF_NOSCROLL);
+
+		for (const auto& state : states)
+			m_pList->SetItemState(state.first, state.second, stateMask);
+		if (focused != -1)
+			m_pList->SetItemState(focused <= sel ? focused : (focused >= last ? focused - removed : sel), LVIS_FOCUSED, LVIS_FOCUSED);
 	}
 
+	m_firstDiffItem.reset();
+	m_lastDiffItem.reset();
+
 	m_pList->SetRedraw(TRUE);	// Turn updating back on
 }
 
@@ -1246,12 +1300,16 @@ void CDirView::ExpandSubdir(int sel, bool bRecursive)
 	if (bRecursive)
 		ExpandSubdirs(ctxt, dip);
 
+	// Append the children to the end of the list and rotate them into place
+	// at once instead of inserting them one by one, then sort only them
 	DIFFITEM *diffpos = ctxt.GetFirstChildDiffPosition(GetItemKey(sel));
-	UINT indext = sel + 1;
+	const size_t oldCount = m_listViewItems.size();
+	UINT indext = static_cast<UINT>(oldCount);
 	int alldiffs;
 	RedisplayChildren(diffpos, dip.GetDepth() + 1, indext, alldiffs);
+	std::rotate(m_listViewItems.begin() + sel + 1, m_listViewItems.begin() + oldCount, m_listViewItems.end());
 
-	SortColumnsAppropriately();
+	SortListViewItems(sel + 1, sel + 1 + (m_listViewItems.size() - oldCount));
 
 	m_pList->SetRedraw(TRUE);	// Turn updating back on
 	m_pList->SetItemCount(static_cast<int>(m_listViewItems.size()));
@@ -1746,12 +1804,7 @@ void CDirView::DeleteItem(int sel, bool removeDIFFITEM)
 		m_pList->DeleteItem(sel);
 	}
 	if (removeDIFFITEM)
-	{
-		if (diffpos->HasChildren())
-			diffpos->RemoveChildren();
-		diffpos->DelinkFromSiblings();
-		delete diffpos;
-	}
+		GetDiffContext().RemoveDiff(diffpos);
 
 	m_firstDiffItem.reset();
 	m_lastDiffItem.reset();
@@ -2547,6 +2600,29 @@ LRESULT CDirView::OnUpdateUIMessage(WPARAM wParam, LPARAM lParam)
 	return 0; // return value unused
 }
 
+/**
+ * @brief Rescan the items changed in the watched folders.
+ * Changed items are rescanned as with "Refresh Selected". Everything is
+ * rescanned if changes were lost or are outside of all folder items.
+ */
+LRESULT CDirView::OnWatchedFoldersChanged(WPARAM wParam, LPARAM lParam)
+{
+	UNREFERENCED_PARAMETER(wParam);
+	UNREFERENCED_PARAMETER(lParam);
+
+	CDirDoc *pDoc = GetDocument();
+	std::set<String> changedPaths;
+	bool bOverflow = false;
+	if (!pDoc->TakeWatchedChanges(changedPaths, bOverflow))
+		return 0;
+
+	m_pSavedTreeState.reset(SaveTreeState(GetDiffContext()));
+	if (!bOverflow && MarkChangedItems(GetDiffContext(), changedPaths, GetDiffContext().m_piFilterGlobal))
+		pDoc->SetMarkedRescan();
+	pDoc->Rescan();
+	return 0;
+}
+
 BOOL CDirView::OnNotify(WPARAM wParam, LPARAM lParam, LRESULT* pResult)
 {
 	NMHDR * hdr = reinterpret_cast<NMHDR *>(lParam);
@@ -2830,9 +2906,39 @@ std::vector<String> CDirView::GetCurrentColRegKeys()
 	return colKeys;
 }
 
+/**
+ * @brief Writes the file compare reports linked from a folder compare report.
+ * Items are opened in a file compare window on the UI thread, one at a time.
+ * With the FastFileCmpReport option, two-way compares of text files are
+ * written by FileCmpHtmlReport on worker threads instead. Those reports have
+ * no syntax highlighting and no word level difference highlighting.
+ */
 struct FileCmpReport: public IFileCmpReport
 {
-	explicit FileCmpReport(CDirView *pDirView) : m_pDirView(pDirView) {}
+	explicit FileCmpReport(CDirView *pDirView) : m_pDirView(pDirView), m_pDirDoc(pDirView->GetDocument())
+	{
+		// Read the settings here on the UI thread
+		DIFFOPTIONS options;
+		Options::DiffOptions::Load(GetOptionsMgr(), options);
+		m_report.SetDiffOptions(options);
+		COLORSETTINGS colors;
+		Options::DiffColors::Load(GetOptionsMgr(), colors);
+		m_report.SetColors(colors);
+		const SyntaxColors *pSyntaxColors = theApp.GetMainSyntaxColors();
+		m_report.SetTextColors(pSyntaxColors->GetColor(COLORINDEX_NORMALTEXT),
+			pSyntaxColors->GetColor(COLORINDEX_BKGND), pSyntaxColors->GetColor(COLORINDEX_SELMARGIN));
+		m_report.SetTabSize(GetOptionsMgr()->GetInt(OPT_TAB_SIZE));
+		m_report.SetGuessEncodingType(GetOptionsMgr()->GetInt(OPT_CP_DETECT));
+		LOGFONT lf = Options::Font::Load(GetOptionsMgr(), OPT_FONT_FILECMP);
+		CClientDC dc(pDirView);
+		m_report.SetFontSize(-MulDiv(lf.lfHeight, 72, dc.GetDeviceCaps(LOGPIXELSY)));
+		m_bFastReport = GetOptionsMgr()->GetBool(OPT_REPORTFILES_FASTFILECMPREPORT);
+		m_bPluginsEnabled = GetOptionsMgr()->GetBool(OPT_PLUGINS_ENABLED);
+		m_nThreads = GetOptionsMgr()->GetInt(OPT_CMP_COMPARE_THREADS);
+		if (m_nThreads <= 0)
+			m_nThreads += Poco::Environment::processorCount();
+		m_nThreads = std::clamp(m_nThreads, 1, static_cast<int>(Poco::Environment::processorCount()));
+	}
 	~FileCmpReport() override {}
 	bool operator()(REPORT_TYPE nReportType, IListCtrl *pList, int nIndex, const String &sDestDir, String &sLinkPath) override
 	{
@@ -2852,6 +2958,27 @@ struct FileCmpReport: public IFileCmpReport
 		strutils::replace(sLinkPath, _T("\\"), _T("_"));
 		sLinkPath += _T(".html");
 		String sReportPath = paths::ConcatPath(sDestDir, sLinkPath);
+
+		if (m_bFastReport && ctxt.GetCompareDirs() == 2 && di.diffcode.existAll() && di.diffcode.isText() && !m_bPluginsEnabled)
+		{
+			if (m_pPool == nullptr)
+			{
+				// The line filters of the context are set up when the report starts
+				m_report.SetFilterList(ctxt.m_pFilterList.get());
+				m_report.SetSubstitutionList(ctxt.m_pSubstitutionList);
+				m_pPool.reset(new FileCmpHtmlReportPool(m_report, m_nThreads, ctxt.GetAbortable()));
+			}
+			PathContext files = GetItemFileNames(ctxt, di);
+			PathContext titles = files;
+			if (m_pDirDoc->IsArchiveFolders())
+			{
+				for (int i = 0; i < titles.GetSize(); i++)
+					m_pDirDoc->ApplyDisplayRoot(i, titles[i]);
+			}
+			m_pPool->Add(files, titles, sReportPath);
+			return true;
+		}
+
 		bool completed = false;
 
 		m_pDirView->MoveFocus(m_pDirView->GetFirstSelectedInd(), nIndex, m_pDirView->GetSelectedCount());
@@ -2872,9 +2999,24 @@ struct FileCmpReport: public IFileCmpReport
 
 		return true;
 	}
+	int Finish() override
+	{
+		if (m_pPool == nullptr)
+			return 0;
+		m_pPool->Finish();
+		const int nFailed = m_pPool->GetFailedCount();
+		m_pPool.reset();
+		return nFailed;
+	}
 private:
 	FileCmpReport();
 	CDirView *m_pDirView;
+	CDirDoc *m_pDirDoc;
+	FileCmpHtmlReport m_report;
+	std::unique_ptr<FileCmpHtmlReportPool> m_pPool;
+	bool m_bFastReport; /**< Write two-way text reports on worker threads? */
+	bool m_bPluginsEnabled;
+	int m_nThreads;
 };
 
 LRESULT CDirView::OnGenerateFileCmpReport(WPARAM wParam, LPARAM lParam)
@@ -2926,6 +3068,18 @@ void CDirView::OnToolsGenerateReport()
 	pReport->SetColumns(m_pColItems->GetDispColCount());
 	pReport->SetFileCmpReport(new FileCmpReport(this));
 	pReport->SetList(new IListCtrlImpl(m_pList->m_hWnd, m_listViewItems));
+	// Format cells from the items on the report thread, as LVN_GETDISPINFO would
+	const CDiffContext *pCtxt = &ctxt;
+	const DirViewColItems *pColItems = m_pColItems.get();
+	pReport->SetColumnTextFunction([pCtxt, pColItems](const DIFFITEM& di, int col)
+		{
+			return pColItems->ColGetTextToDisplay(pCtxt, pColItems->ColPhysToLog(col), di);
+		});
+	// Same number of threads as folder compare
+	int nThreads = GetOptionsMgr()->GetInt(OPT_CMP_COMPARE_THREADS);
+	if (nThreads <= 0)
+		nThreads += Poco::Environment::processorCount();
+	pReport->SetThreadCount(std::clamp(nThreads, 1, static_cast<int>(Poco::Environment::processorCount())));
 	pReport->SetReportType(dlg.m_nReportType);
 	pReport->SetReportFile(dlg.m_sReportFile);
 	pReport->SetCopyToClipboard(dlg.m_bCopyToClipboard);
@@ -3490,8 +3644,7 @@ afx_msg void CDirView::OnEndLabelEdit(NMHDR* pNMHDR, LRESULT* pResult)
 							{
 								if ((pItem != &di) && (pItem->diffcode.isDirectory() == di.diffcode.isDirectory()) && (collstr(pItem->diffFileInfo[0].filename, di.diffFileInfo[0].filename, false) == 0))
 								{
-									pItem->DelinkFromSiblings();
-									delete pItem;
+									GetDiffContext().RemoveDiff(pItem);
 									break;
 								}
 							}
@@ -4379,35 +4532,6 @@ void CDirView::SetColAlignments()
 	}
 }
 
-CDirView::CompareState::CompareState(const CDiffContext *pCtxt, const DirViewColItems *pColItems, int sortCol, bool bSortAscending, bool bTreeMode)
-: pCtxt(pCtxt)
-, pColItems(pColItems)
-, sortCol(sortCol)
-, bSortAscending(bSortAscending)
-, bTreeMode(bTreeMode)
-{
-}
-
-/// Compare two specified rows during a sort operation (windows callback)
-int CALLBACK CDirView::CompareState::CompareFunc(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
-{
-	CompareState *pThis = reinterpret_cast<CompareState*>(lParamSort);
-	// Sort special items always first in dir view
-	if (lParam1 == -1)
-		return -1;
-	if (lParam2 == -1)
-		return 1;
-
-	DIFFITEM *diffposl = (DIFFITEM *)lParam1;
-	DIFFITEM *diffposr = (DIFFITEM *)lParam2;
-	const DIFFITEM &ldi = pThis->pCtxt->GetDiffAt(diffposl);
-	const DIFFITEM &rdi = pThis->pCtxt->GetDiffAt(diffposr);
-	// compare 'left' and 'right' parameters as appropriate
-	int retVal = pThis->pColItems->ColSort(pThis->pCtxt, pThis->sortCol, ldi, rdi, pThis->bTreeMode);
-	// return compare result, considering sort direction
-	return pThis->bSortAscending ? retVal : -retVal;
-}
-
 /// Add new item to list view
 void CDirView::AddNewItem(int i, DIFFITEM *diffpos, int iImage, int iIndent)
 {
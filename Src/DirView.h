@@ -146,22 +146,10 @@ private:
 public:
 	void UpdateColumnNames();
 	void SetColAlignments();
-	// class CompareState is used to pass parameters to the PFNLVCOMPARE callback function.
-	class CompareState
-	{
-	private:
-		const DirViewColItems *const pColItems;
-		const CDiffContext *const pCtxt;
-		const int sortCol;
-		const bool bSortAscending;
-		const bool bTreeMode;
-	public:
-		CompareState(const CDiffContext *pCtxt, const DirViewColItems *pColItems, int sortCol, bool bSortAscending, bool bTreeMode);
-		static int CALLBACK CompareFunc(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort);
-	} friend;
 	void UpdateDiffItemStatus(UINT nIdx);
 private:
 	void InitiateSort();
+	void SortListViewItems(size_t first, size_t last);
 	void NameColumn(const DirColInfo *col, int subitem);
 	void AddNewItem(int i, DIFFITEM *diffpos, int iImage, int iIndent);
 // End DirViewCols.cpp
@@ -279,6 +267,7 @@ protected:
 	afx_msg void OnUpdateCurdiff(CCmdUI* pCmdUI);
 	afx_msg void OnUpdateSave(CCmdUI* pCmdUI);
 	afx_msg LRESULT OnUpdateUIMessage(WPARAM wParam, LPARAM lParam);
+	afx_msg LRESULT OnWatchedFoldersChanged(WPARAM wParam, LPARAM lParam);
 	afx_msg void OnRefresh();
 	afx_msg void OnUpdateRefresh(CCmdUI* pCmdUI);
 	afx_msg void OnTimer(UINT_PTR nIDEvent);
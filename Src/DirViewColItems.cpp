@@ -8,6 +8,10 @@
 
 #include "pch.h"
 #include "DirViewColItems.h"
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <unordered_map>
 #include <Poco/Timestamp.h>
 #include <Shlwapi.h>
 #include "UnicodeString.h"
@@ -430,6 +434,11 @@ static String ColStatusGet(const CDiffContext *pCtxt, const void *p, int)
 		case DIFFCODE::DIFF3RDONLY: s += _(" (Left and middle are identical)"); break;
 		}
 	}
+	if (di.diffcode.isMoved() && di.diffcode.existAll())
+	{
+		s += strutils::format_string1(_(" (moved to %1)"),
+				paths::ConcatPath(di.diffFileInfo[1].path, di.diffFileInfo[1].filename));
+	}
 	return s;
 }
 
@@ -1825,6 +1834,161 @@ DirViewColItems::ColSort(const CDiffContext *pCtxt, int col, const DIFFITEM &ldi
 	return 0;
 }
 
+namespace
+{
+/**
+ * @brief Precomputed sort key of a string column.
+ * Folders are kept before files for the columns that sort them so.
+ */
+struct StringSortKey
+{
+	int group;
+	String text;
+};
+
+/**
+ * @brief Return the getter whose text defines the sort order of the column,
+ * or `nullptr` if the column has a sort function comparing raw values.
+ */
+ColGetFncPtrType GetSortKeyFnc(const DirColInfo *pColInfo, bool& bDirsFirst, bool& bLogical)
+{
+	bDirsFirst = false;
+	bLogical = true;
+	if (pColInfo->sortfnc == nullptr)
+		return pColInfo->getfnc;
+	if (pColInfo->sortfnc == &ColFileNameSort)
+	{
+		bDirsFirst = true;
+		return &ColFileNameGet<String>;
+	}
+	if (pColInfo->sortfnc == &ColExtSort)
+	{
+		bDirsFirst = true;
+		return &ColExtGet;
+	}
+	if (pColInfo->sortfnc == &ColPathSort)
+		return &ColPathGet;
+	if (pColInfo->sortfnc == &ColPropertyMoveSort)
+		return &ColPropertyMoveGet;
+	if (pColInfo->sortfnc == &ColNewerSort)
+	{
+		bLogical = false;
+		return &ColNewerGet;
+	}
+	return nullptr;
+}
+
+/**
+ * @brief Does the sort function only read the items, so that it can be
+ * called from several threads at once?
+ */
+bool IsSortFncThreadSafe(ColSortFncPtrType fnc)
+{
+	return fnc == &ColStatusSort || fnc == &ColTimeSort || fnc == &ColSizeSort ||
+		fnc == &ColDiffsSort || fnc == &ColBinSort || fnc == &ColAttrSort;
+}
+}
+
+/**
+ * @brief Compute the sorted order of items on specified column.
+ * Unlike sorting with ColSort(), the text of string columns is built only once
+ * per item and tree mode ancestors are resolved by index, so the comparison
+ * does not allocate and the sort can run in parallel.
+ * @param [in] pCtxt Compare context.
+ * @param [in] col Column number to sort.
+ * @param [in] items Items to sort. In tree mode the parents of all items
+ *  must be included.
+ * @param [in] bSortAscending Sort direction.
+ * @param [in] bTreeMode Are items shown as a tree?
+ * @return Indexes into @p items in sorted order.
+ */
+std::vector<size_t>
+DirViewColItems::ColSortOrder(const CDiffContext *pCtxt, int col,
+		const std::vector<const DIFFITEM *>& items, bool bSortAscending, bool bTreeMode) const
+{
+	std::vector<size_t> order(items.size());
+	std::iota(order.begin(), order.end(), 0);
+	const DirColInfo * pColInfo = GetDirColInfo(col);
+	if (pColInfo == nullptr)
+	{
+		assert(false); // fix caller, should not ask for nonexistent columns
+		return order;
+	}
+	const size_t offset = pColInfo->offset;
+	const int opt = pColInfo->opt;
+
+	// In tree mode, items are compared through their ancestors on the same level
+	const size_t npos = static_cast<size_t>(-1);
+	std::vector<size_t> parents;
+	std::vector<int> depths;
+	if (bTreeMode)
+	{
+		std::unordered_map<const DIFFITEM *, size_t> indexes(items.size());
+		for (size_t i = 0; i < items.size(); ++i)
+			indexes.emplace(items[i], i);
+		parents.resize(items.size(), npos);
+		depths.resize(items.size());
+		for (size_t i = 0; i < items.size(); ++i)
+		{
+			auto it = indexes.find(items[i]->GetParentLink());
+			if (it != indexes.end())
+				parents[i] = it->second;
+			depths[i] = items[i]->GetDepth();
+		}
+	}
+	auto resolve = [&](size_t& l, size_t& r)
+	{
+		if (!bTreeMode)
+			return;
+		int lLevel = depths[l];
+		int rLevel = depths[r];
+		for (; rLevel > lLevel && parents[r] != npos; rLevel--)
+			r = parents[r];
+		for (; lLevel > rLevel && parents[l] != npos; lLevel--)
+			l = parents[l];
+		while (l != r && parents[l] != parents[r] && parents[l] != npos && parents[r] != npos)
+		{
+			l = parents[l];
+			r = parents[r];
+		}
+	};
+
+	bool bDirsFirst, bLogical;
+	if (ColGetFncPtrType fnc = GetSortKeyFnc(pColInfo, bDirsFirst, bLogical))
+	{
+		std::vector<StringSortKey> keys(items.size());
+		for (size_t i = 0; i < items.size(); ++i)
+		{
+			keys[i].group = (bDirsFirst && !items[i]->diffcode.isDirectory()) ? 1 : 0;
+			keys[i].text = (*fnc)(pCtxt, reinterpret_cast<const char *>(items[i]) + offset, opt);
+		}
+		std::stable_sort(std::execution::par, order.begin(), order.end(), [&](size_t l, size_t r)
+			{
+				resolve(l, r);
+				const StringSortKey& lkey = keys[bSortAscending ? l : r];
+				const StringSortKey& rkey = keys[bSortAscending ? r : l];
+				if (lkey.group != rkey.group)
+					return lkey.group < rkey.group;
+				return (bLogical ? strutils::compare_logical(lkey.text, rkey.text) : lkey.text.compare(rkey.text)) < 0;
+			});
+		return order;
+	}
+
+	ColSortFncPtrType fnc = pColInfo->sortfnc;
+	auto less = [&](size_t l, size_t r)
+	{
+		resolve(l, r);
+		int retVal = (*fnc)(pCtxt, reinterpret_cast<const char *>(items[l]) + offset,
+			reinterpret_cast<const char *>(items[r]) + offset, opt);
+		return (bSortAscending ? retVal : -retVal) < 0;
+	};
+	if (IsSortFncThreadSafe(fnc))
+		std::stable_sort(std::execution::par, order.begin(), order.end(), less);
+	else
+		std::stable_sort(order.begin(), order.end(), less);
+	return order;
+}
+
 void DirViewColItems::SetColumnOrdering(const int colorder[])
 {
 	m_dispcols = 0;
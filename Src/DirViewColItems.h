@@ -70,6 +70,7 @@ public:
 	int GetDispColCount() const { return m_dispcols; }
 	String ColGetTextToDisplay(const CDiffContext *pCtxt, int col, const DIFFITEM &di) const;
 	int ColSort(const CDiffContext *pCtxt, int col, const DIFFITEM &ldi, const DIFFITEM &rdi, bool bTreeMode) const;
+	std::vector<size_t> ColSortOrder(const CDiffContext *pCtxt, int col, const std::vector<const DIFFITEM *>& items, bool bSortAscending, bool bTreeMode) const;
 
 	int ColPhysToLog(int i) const { return m_invcolorder[i]; }
 	int ColLogToPhys(int i) const { return m_colorder[i]; } /**< -1 if not displayed */
@@ -0,0 +1,447 @@
+/**
+ * @file  DirWatcher.cpp
+ *
+ * @brief Implementation of DirWatcher.
+ */
+#include "pch.h"
+#include "DirWatcher.h"
+#include <algorithm>
+#include <Windows.h>
+#include <Poco/DirectoryIterator.h>
+#include <Poco/Exception.h>
+#include "DiffItemList.h"
+#include "FileFilterHelper.h"
+#include "paths.h"
+#include "unicoder.h"
+
+namespace
+{
+
+/** @brief Size of the buffer receiving the changes of one folder. */
+constexpr DWORD NotifyBufferSize = 64 * 1024;
+
+/** @brief Milliseconds after the first pending change it is reported at the latest. */
+constexpr DWORD MaxDelay = 3000;
+
+/** @brief More changed paths than this are reported as an overflow. */
+constexpr size_t MaxChangedPaths = 10000;
+
+/**
+ * @brief Find the child of @p parent with name @p name on any side.
+ */
+DIFFITEM *FindChild(DiffItemList& list, const DIFFITEM *parent, const String& name)
+{
+	for (DIFFITEM *pdi = list.GetFirstChildDiffPosition(parent); pdi != nullptr; pdi = pdi->GetFwdSiblingLink())
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			if (pdi->diffcode.exists(i) && strutils::compare_nocase(pdi->diffFileInfo[i].filename, name) == 0)
+				return pdi;
+		}
+	}
+	return nullptr;
+}
+
+/**
+ * @brief Mark an item for rescan.
+ * Unlike MarkForRescan(), side flags are kept, so that later changed paths
+ * still find the item. DirScan_UpdateMarkedItems() sets them again anyway.
+ */
+void MarkItem(DIFFITEM& di)
+{
+	di.diffcode.diffcode &= ~(DIFFCODE::TEXTFLAGS | DIFFCODE::COMPAREFLAGS);
+	di.diffcode.diffcode |= DIFFCODE::NEEDSCAN;
+}
+
+}
+
+/** @brief Last scanned state of a file or folder, when polling. */
+struct DirWatcher::Entry
+{
+	bool bDirectory;
+	int64_t mtime;
+	int64_t size;
+};
+
+/**
+ * @brief Start watching folders.
+ * @param [in] folders Folders to watch.
+ * @param [in] bRecursive Watch subfolders too.
+ * @param [in] callback Called on the watcher thread when changes are ready.
+ * @param [in] bPolling Scan the folders instead of asking the system.
+ */
+DirWatcher::DirWatcher(const std::vector<String>& folders, bool bRecursive, std::function<void()> callback, bool bPolling)
+	: m_folders(folders)
+	, m_bRecursive(bRecursive)
+	, m_callback(callback)
+	, m_bPolling(bPolling)
+	, m_hStopEvent(CreateEvent(nullptr, TRUE, FALSE, nullptr))
+	, m_watching(Poco::Event::EVENT_MANUALRESET)
+	, m_dwLastChange(0)
+	, m_dwFirstChange(0)
+	, m_bReported(false)
+{
+	m_thread.startFunc([this] { Run(); });
+}
+
+DirWatcher::~DirWatcher()
+{
+	SetEvent(m_hStopEvent);
+	m_thread.join();
+	CloseHandle(m_hStopEvent);
+}
+
+/**
+ * @brief Check if the watched folders are @p folders.
+ */
+bool DirWatcher::IsWatching(const std::vector<String>& folders, bool bRecursive) const
+{
+	return m_folders == folders && m_bRecursive == bRecursive;
+}
+
+/**
+ * @brief Wait until changes are being watched.
+ * Changes made before are not reported.
+ * @return false if watching did not start in time.
+ */
+bool DirWatcher::WaitUntilWatching(long milliseconds)
+{
+	return m_watching.tryWait(milliseconds);
+}
+
+bool DirWatcher::HasChanges() const
+{
+	Poco::FastMutex::ScopedLock lock(m_mutex);
+	return !m_changes.empty();
+}
+
+/**
+ * @brief Take the reported changes.
+ * The callback is called again for the next changes.
+ */
+DirWatcher::Changes DirWatcher::TakeChanges()
+{
+	Poco::FastMutex::ScopedLock lock(m_mutex);
+	Changes changes;
+	std::swap(changes, m_changes);
+	m_bReported = false;
+	return changes;
+}
+
+void DirWatcher::Run()
+{
+	if (m_bPolling || !WatchNative())
+	{
+		m_bPolling = true;
+		WatchPolling();
+	}
+}
+
+/**
+ * @brief Watch the folders with ReadDirectoryChangesW() until stopped.
+ * @return false if one of the folders cannot be watched this way,
+ * e.g. on a network drive not supporting it, or can no longer be watched.
+ */
+bool DirWatcher::WatchNative()
+{
+	struct Watch
+	{
+		HANDLE hDir = INVALID_HANDLE_VALUE;
+		OVERLAPPED overlapped = {};
+		bool bPending = false;
+		std::vector<DWORD> buffer = std::vector<DWORD>(NotifyBufferSize / sizeof(DWORD));
+	};
+	const DWORD dwNotifyFilter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME |
+		FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
+	std::vector<Watch> watches(m_folders.size());
+
+	auto readChanges = [&](Watch& watch)
+	{
+		watch.bPending = ReadDirectoryChangesW(watch.hDir, watch.buffer.data(), NotifyBufferSize,
+			m_bRecursive, dwNotifyFilter, nullptr, &watch.overlapped, nullptr) != FALSE;
+		return watch.bPending;
+	};
+	auto closeWatches = [&]()
+	{
+		for (auto& watch : watches)
+		{
+			if (watch.bPending)
+			{
+				DWORD dwBytes;
+				CancelIoEx(watch.hDir, &watch.overlapped);
+				GetOverlappedResult(watch.hDir, &watch.overlapped, &dwBytes, TRUE);
+			}
+			if (watch.overlapped.hEvent != nullptr)
+				CloseHandle(watch.overlapped.hEvent);
+			if (watch.hDir != INVALID_HANDLE_VALUE)
+				CloseHandle(watch.hDir);
+		}
+	};
+
+	std::vector<HANDLE> handles{ m_hStopEvent };
+	for (size_t i = 0; i < m_folders.size(); ++i)
+	{
+		Watch& watch = watches[i];
+		watch.hDir = CreateFile(m_folders[i].c_str(), FILE_LIST_DIRECTORY,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+			FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if (watch.hDir != INVALID_HANDLE_VALUE)
+			watch.overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+		if (watch.overlapped.hEvent == nullptr || !readChanges(watch))
+		{
+			closeWatches();
+			return false;
+		}
+		handles.push_back(watch.overlapped.hEvent);
+	}
+
+	m_watching.set();
+	for (;;)
+	{
+		DWORD dwResult = WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(), FALSE, GetWaitTime());
+		if (dwResult == WAIT_TIMEOUT)
+		{
+			ReportChanges();
+			continue;
+		}
+		if (dwResult == WAIT_OBJECT_0)
+			break;
+		if (dwResult >= WAIT_OBJECT_0 + handles.size())
+		{
+			// Waiting failed, changes may be lost from now on
+			AddChange(String());
+			closeWatches();
+			return false;
+		}
+
+		const size_t index = dwResult - WAIT_OBJECT_0 - 1;
+		Watch& watch = watches[index];
+		DWORD dwBytes = 0;
+		watch.bPending = false;
+		ResetEvent(watch.overlapped.hEvent);
+		if (GetOverlappedResult(watch.hDir, &watch.overlapped, &dwBytes, FALSE) && dwBytes > 0)
+		{
+			const BYTE *p = reinterpret_cast<const BYTE *>(watch.buffer.data());
+			for (;;)
+			{
+				const FILE_NOTIFY_INFORMATION *pInfo = reinterpret_cast<const FILE_NOTIFY_INFORMATION *>(p);
+				String path(pInfo->FileName, pInfo->FileNameLength / sizeof(WCHAR));
+				// Folders are modified whenever their contents change, which is reported separately
+				if (pInfo->Action != FILE_ACTION_MODIFIED ||
+					paths::DoesPathExist(paths::ConcatPath(m_folders[index], path)) != paths::IS_EXISTING_DIR)
+					AddChange(path);
+				if (pInfo->NextEntryOffset == 0)
+					break;
+				p += pInfo->NextEntryOffset;
+			}
+		}
+		else
+		{
+			// The buffer overflowed, or the folder is gone
+			AddChange(String());
+		}
+		if (!readChanges(watch))
+		{
+			// The folder cannot be watched anymore, e.g. it was removed
+			AddChange(String());
+			closeWatches();
+			return false;
+		}
+	}
+	closeWatches();
+	return true;
+}
+
+/**
+ * @brief Watch the folders by scanning them every PollInterval milliseconds
+ * until stopped.
+ */
+void DirWatcher::WatchPolling()
+{
+	std::vector<Snapshot> snapshots(m_folders.size());
+	for (size_t i = 0; i < m_folders.size(); ++i)
+		TakeSnapshot(m_folders[i], String(), snapshots[i]);
+	DWORD dwLastScan = GetTickCount();
+
+	m_watching.set();
+	for (;;)
+	{
+		DWORD dwSinceScan = GetTickCount() - dwLastScan;
+		DWORD dwWait = (std::min)(GetWaitTime(), dwSinceScan < PollInterval ? PollInterval - dwSinceScan : 0);
+		if (WaitForSingleObject(m_hStopEvent, dwWait) == WAIT_OBJECT_0)
+			break;
+
+		if (GetTickCount() - dwLastScan >= PollInterval)
+		{
+			for (size_t i = 0; i < m_folders.size(); ++i)
+			{
+				Snapshot snapshot;
+				TakeSnapshot(m_folders[i], String(), snapshot);
+				for (const auto& [path, entry] : snapshot)
+				{
+					auto it = snapshots[i].find(path);
+					if (it == snapshots[i].end() || it->second.bDirectory != entry.bDirectory ||
+						(!entry.bDirectory && (it->second.mtime != entry.mtime || it->second.size != entry.size)))
+						AddChange(path);
+				}
+				for (const auto& [path, entry] : snapshots[i])
+				{
+					if (snapshot.find(path) == snapshot.end())
+						AddChange(path);
+				}
+				snapshots[i].swap(snapshot);
+			}
+			dwLastScan = GetTickCount();
+		}
+		if (GetWaitTime() == 0)
+			ReportChanges();
+	}
+}
+
+/**
+ * @brief Add the files and folders in @p subdir of @p folder to @p snapshot.
+ * Files and folders that cannot be read are left out.
+ */
+void DirWatcher::TakeSnapshot(const String& folder, const String& subdir, Snapshot& snapshot) const
+{
+	try
+	{
+		Poco::DirectoryIterator end;
+		for (Poco::DirectoryIterator it(ucr::toUTF8(paths::ConcatPath(folder, subdir))); it != end; ++it)
+		{
+			String path = paths::ConcatPath(subdir, ucr::toTString(it.name()));
+			try
+			{
+				Entry entry;
+				entry.bDirectory = it->isDirectory();
+				entry.mtime = it->getLastModified().epochMicroseconds();
+				entry.size = entry.bDirectory ? 0 : static_cast<int64_t>(it->getSize());
+				snapshot.emplace(path, entry);
+				if (entry.bDirectory && m_bRecursive && !it->isLink())
+					TakeSnapshot(folder, path, snapshot);
+			}
+			catch (Poco::Exception&)
+			{
+			}
+		}
+	}
+	catch (Poco::Exception&)
+	{
+	}
+}
+
+/**
+ * @brief Add a changed path to the pending changes.
+ * @param [in] path Changed path, empty if changes were lost.
+ */
+void DirWatcher::AddChange(const String& path)
+{
+	DWORD dwNow = GetTickCount();
+	if (m_pending.empty())
+		m_dwFirstChange = dwNow;
+	m_dwLastChange = dwNow;
+	if (path.empty() || m_pending.paths.size() >= MaxChangedPaths)
+	{
+		m_pending.bOverflow = true;
+		m_pending.paths.clear();
+	}
+	else if (!m_pending.bOverflow)
+	{
+		m_pending.paths.insert(path);
+	}
+}
+
+/**
+ * @brief Move the pending changes to the reported changes and call the
+ * callback, unless it was already called for changes not yet taken.
+ */
+void DirWatcher::ReportChanges()
+{
+	if (m_pending.empty())
+		return;
+	bool bCallback = false;
+	{
+		Poco::FastMutex::ScopedLock lock(m_mutex);
+		if (m_pending.bOverflow || m_changes.bOverflow)
+		{
+			m_changes.bOverflow = true;
+			m_changes.paths.clear();
+		}
+		else
+		{
+			m_changes.paths.insert(m_pending.paths.begin(), m_pending.paths.end());
+		}
+		bCallback = !m_bReported;
+		m_bReported = true;
+	}
+	m_pending = Changes();
+	if (bCallback && m_callback)
+		m_callback();
+}
+
+/**
+ * @brief Milliseconds until the pending changes are to be reported.
+ */
+DWORD DirWatcher::GetWaitTime() const
+{
+	if (m_pending.empty())
+		return INFINITE;
+	DWORD dwNow = GetTickCount();
+	DWORD dwSinceLast = dwNow - m_dwLastChange;
+	DWORD dwSinceFirst = dwNow - m_dwFirstChange;
+	if (dwSinceLast >= static_cast<DWORD>(SettleTime) || dwSinceFirst >= MaxDelay)
+		return 0;
+	return (std::min)(SettleTime - dwSinceLast, MaxDelay - dwSinceFirst);
+}
+
+/**
+ * @brief Mark the items of changed paths for rescan.
+ * A changed path that has an item marks that item. A path without an item,
+ * e.g. a new file, marks the folder item it is in, so that the folder is
+ * scanned again.
+ * Paths the filter excludes are ignored, like the folder compare ignores
+ * them: paths in an excluded folder, and paths whose name is excluded as
+ * a file name, unless the item of the path is a folder.
+ * @param [in] paths Changed paths, relative to the compared folders.
+ * @param [in] piFilter Filter of the compare, nullptr if none.
+ * @return false if a path that is not excluded is in none of the folder
+ * items, so that only a full rescan finds it.
+ */
+bool MarkChangedItems(DiffItemList& list, const std::set<String>& paths, const IDiffFilter *piFilter)
+{
+	bool bMarked = true;
+	for (const auto& path : paths)
+	{
+		String relpath = path;
+		std::replace(relpath.begin(), relpath.end(), '/', '\\');
+		const size_t pos = relpath.rfind('\\');
+		const String name = relpath.substr(pos == String::npos ? 0 : pos + 1);
+		bool bExcluded = false;
+		for (size_t end = relpath.find('\\'); piFilter != nullptr && !bExcluded && end != String::npos; end = relpath.find('\\', end + 1))
+			bExcluded = !piFilter->includeDir(relpath.substr(0, end));
+		if (bExcluded)
+			continue;
+
+		DIFFITEM *parent = nullptr;
+		DIFFITEM *pdi = nullptr;
+		for (size_t start = 0; ; )
+		{
+			size_t end = relpath.find('\\', start);
+			pdi = FindChild(list, parent, relpath.substr(start, end == String::npos ? String::npos : end - start));
+			if (pdi == nullptr || end == String::npos)
+				break;
+			parent = pdi;
+			start = end + 1;
+		}
+		if (piFilter != nullptr && (pdi != nullptr && pdi->diffcode.isDirectory() ?
+				!piFilter->includeDir(relpath) : !piFilter->includeFile(name)))
+			continue;
+		if (pdi != nullptr)
+			MarkItem(*pdi);
+		else if (parent != nullptr)
+			MarkItem(*parent);
+		else
+			bMarked = false;
+	}
+	return bMarked;
+}
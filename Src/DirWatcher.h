@@ -0,0 +1,85 @@
+/**
+ * @file  DirWatcher.h
+ *
+ * @brief Declaration of DirWatcher, which watches compared folders for changes.
+ */
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <set>
+#include <vector>
+#include <Poco/Event.h>
+#include <Poco/Mutex.h>
+#include <Poco/Thread.h>
+#include "UnicodeString.h"
+
+class DiffItemList;
+class IDiffFilter;
+
+/**
+ * @brief Collects the paths changed below the compared folders.
+ *
+ * Changes are reported by the system (ReadDirectoryChangesW) when it can
+ * watch all the folders, else the folders are scanned every PollInterval
+ * milliseconds and compared with the previous scan. If the system stops
+ * reporting the changes of a folder, e.g. as it was removed, changes are
+ * reported as lost and the folders are scanned from then on. Paths are
+ * relative to the folder they changed in, so a file changed in several
+ * folders is reported once. Changes are coalesced: the callback is called
+ * once changes have settled for SettleTime milliseconds, and not again
+ * until they have been taken with TakeChanges().
+ */
+class DirWatcher
+{
+public:
+	/** @brief Milliseconds without new changes before changes are reported. */
+	static constexpr int SettleTime = 300;
+	/** @brief Milliseconds between two scans when polling. */
+	static constexpr int PollInterval = 2000;
+
+	/** @brief Paths changed since changes were last taken. */
+	struct Changes
+	{
+		std::set<String> paths; /**< Changed paths, relative to the folders */
+		bool bOverflow = false; /**< Some changes were lost, rescan everything */
+		bool empty() const { return paths.empty() && !bOverflow; }
+	};
+
+	DirWatcher(const std::vector<String>& folders, bool bRecursive, std::function<void()> callback, bool bPolling = false);
+	~DirWatcher();
+	bool WaitUntilWatching(long milliseconds);
+	bool IsWatching(const std::vector<String>& folders, bool bRecursive) const;
+	bool IsPolling() const { return m_bPolling; } /**< Valid once watching */
+	bool HasChanges() const;
+	Changes TakeChanges();
+
+private:
+	struct Entry;
+	using Snapshot = std::map<String, Entry>;
+
+	void Run();
+	bool WatchNative();
+	void WatchPolling();
+	void TakeSnapshot(const String& folder, const String& subdir, Snapshot& snapshot) const;
+	void AddChange(const String& path);
+	void ReportChanges();
+	unsigned long GetWaitTime() const;
+
+	std::vector<String> m_folders;
+	bool m_bRecursive;
+	std::function<void()> m_callback;
+	std::atomic<bool> m_bPolling; /**< Set by the watcher thread when it falls back to polling */
+	void *m_hStopEvent; /**< Event handle set to stop watching */
+	Poco::Event m_watching; /**< Set once changes are being watched */
+	Poco::Thread m_thread;
+	Changes m_pending; /**< Changes not settled yet, used by watcher thread only */
+	unsigned long m_dwLastChange; /**< Tick count of the latest pending change */
+	unsigned long m_dwFirstChange; /**< Tick count of the oldest pending change */
+	mutable Poco::FastMutex m_mutex;
+	Changes m_changes; /**< Settled changes, guarded by m_mutex */
+	bool m_bReported; /**< Callback called since changes were last taken */
+};
+
+bool MarkChangedItems(DiffItemList& list, const std::set<String>& paths, const IDiffFilter *piFilter = nullptr);
@@ -7,11 +7,18 @@
 #include "pch.h"
 #define POCO_NO_UNWINDOWS 1
 #include "Environment.h"
+#ifdef _WIN32
 #include <windows.h>
 #pragma warning (push)			// prevent "warning C4091: 'typedef ': ignored on left of 'tagGPFIDL_FLAGS' when no variable is declared"
 #pragma warning (disable:4091)	// VC bug when using XP enabled toolsets.
 #include <shlobj.h>
 #pragma warning (pop)
+#else
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <unistd.h>
+#endif
 #include <sstream>
 #include <Poco/Path.h>
 #include <Poco/Process.h>
@@ -66,6 +73,7 @@ String GetTemporaryPath()
  */
 String GetTemporaryFileName(const String& lpPathName, const String& lpPrefixString, int * pnerr /*= nullptr*/)
 {
+#ifdef _WIN32
 	TCHAR buffer[MAX_PATH] = {0};
 	if (lpPathName.length() > MAX_PATH-14)
 		return _T(""); // failure
@@ -83,6 +91,25 @@ String GetTemporaryFileName(const String& lpPathName, const String& lpPrefixStri
 		}
 	}
 	return buffer;
+#else
+	String path = paths::ConcatPath(lpPathName, lpPrefixString + _T("XXXXXX"));
+	std::vector<char> buffer(path.begin(), path.end());
+	buffer.push_back('\0');
+	int fd = mkstemp(buffer.data());
+	if (fd == -1)
+	{
+		paths::CreateIfNeeded(lpPathName);
+		fd = mkstemp(buffer.data());
+		if (fd == -1)
+		{
+			if (pnerr != nullptr)
+				*pnerr = errno;
+			return _T("");
+		}
+	}
+	close(fd);
+	return buffer.data();
+#endif
 }
 
 String GetTempChildPath()
@@ -104,9 +131,15 @@ String GetProgPath()
 {
 	if (strProgPath.empty())
 	{
+#ifdef _WIN32
 		TCHAR temp[MAX_PATH] = {0};
 		GetModuleFileName(nullptr, temp, MAX_PATH);
 		strProgPath = paths::GetPathOnly(temp);
+#else
+		char temp[PATH_MAX] = {0};
+		if (readlink("/proc/self/exe", temp, sizeof(temp) - 1) > 0)
+			strProgPath = paths::GetPathOnly(temp);
+#endif
 	}
 	return strProgPath;
 }
@@ -117,10 +150,14 @@ String GetProgPath()
  */
 String GetWindowsDirectory()
 {
+#ifdef _WIN32
 	TCHAR path[MAX_PATH];
 	path[0] = _T('\0');
 	::GetWindowsDirectory(path, MAX_PATH);
 	return path;
+#else
+	return _T("");
+#endif
 }
 
 /**
@@ -130,10 +167,14 @@ String GetWindowsDirectory()
  */
 String GetMyDocuments()
 {
+#ifdef _WIN32
 	TCHAR path[MAX_PATH];
 	path[0] = _T('\0');
 	SHGetFolderPath(nullptr, CSIDL_PERSONAL, nullptr, 0, path);
 	return path;
+#else
+	return ucr::toTString(Path::home());
+#endif
 }
 
 /**
@@ -166,6 +207,7 @@ String GetSystemTempPath()
 	}
 }
 
+#ifdef _WIN32
 static bool launchProgram(const String& sCmd, WORD wShowWindow)
 {
 	STARTUPINFO stInfo = { sizeof(STARTUPINFO) };
@@ -181,9 +223,11 @@ static bool launchProgram(const String& sCmd, WORD wShowWindow)
 	CloseHandle(processInfo.hProcess);
 	return true;
 }
+#endif
 
 String ExpandEnvironmentVariables(const String& text)
 {
+#ifdef _WIN32
 	TCHAR buf[512];
 	buf[0] = 0;
 	const unsigned size = sizeof(buf) / sizeof(buf[0]);
@@ -193,6 +237,9 @@ String ExpandEnvironmentVariables(const String& text)
 	std::vector<TCHAR> newbuf(expandedSize);
 	::ExpandEnvironmentStrings(text.c_str(), newbuf.data(), expandedSize);
 	return newbuf.data();
+#else
+	return ucr::toTString(Path::expand(ucr::toUTF8(text)));
+#endif
 }
 
 /**
@@ -202,7 +249,11 @@ bool LoadRegistryFromFile(const String& sRegFilePath)
 {
 	if (paths::DoesPathExist(sRegFilePath) != paths::IS_EXISTING_FILE)
 		return false;
+#ifdef _WIN32
 	return launchProgram(_T("reg.exe import \"") + sRegFilePath + _T("\""), SW_HIDE);
+#else
+	return false;
+#endif
 }
 
 /** 
@@ -212,8 +263,12 @@ bool SaveRegistryToFile(const String& sRegFilePath, const String& sRegDir)
 {
 	if (paths::DoesPathExist(sRegFilePath) != paths::IS_EXISTING_FILE)
 		return false;
+#ifdef _WIN32
 	DeleteFile(sRegFilePath.c_str());
 	return launchProgram(_T("reg.exe export HKCU\\") + sRegDir + _T(" \"") + sRegFilePath + _T("\""), SW_HIDE);
+#else
+	return false;
+#endif
 }
 
 }
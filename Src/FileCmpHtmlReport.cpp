@@ -0,0 +1,466 @@
+/**
+ * @file  FileCmpHtmlReport.cpp
+ *
+ * @brief Implementation of FileCmpHtmlReport.
+ */
+#include "pch.h"
+#include "FileCmpHtmlReport.h"
+#include <algorithm>
+#include <cstdio>
+#include <Poco/AutoPtr.h>
+#include <Poco/Notification.h>
+#include <Poco/Runnable.h>
+#include "IAbortable.h"
+#include "UniFile.h"
+#include "codepage_detect.h"
+#include "unicoder.h"
+#include "ReportBuffer.h"
+#include "TempFile.h"
+#include "paths.h"
+
+using Poco::AutoPtr;
+using Poco::Notification;
+using Poco::NotificationQueue;
+
+namespace
+{
+
+class ReportWorkNotification : public Notification
+{
+public:
+	ReportWorkNotification(const PathContext& files, const PathContext& titles, const String& sReportFile)
+		: m_files(files), m_titles(titles), m_sReportFile(sReportFile) {}
+	const PathContext& files() const { return m_files; }
+	const PathContext& titles() const { return m_titles; }
+	const String& reportFile() const { return m_sReportFile; }
+private:
+	PathContext m_files;
+	PathContext m_titles;
+	String m_sReportFile;
+};
+
+class ReportDoneNotification : public Notification
+{
+public:
+	explicit ReportDoneNotification(bool bWritten) : m_bWritten(bWritten) {}
+	bool written() const { return m_bWritten; }
+private:
+	bool m_bWritten;
+};
+
+class QuitNotification : public Notification
+{
+};
+
+String FormatColors(COLORREF clrText, COLORREF clrBkgnd)
+{
+	return strutils::format(_T("color: #%02x%02x%02x; background-color: #%02x%02x%02x;"),
+		GetRValue(clrText), GetGValue(clrText), GetBValue(clrText),
+		GetRValue(clrBkgnd), GetGValue(clrBkgnd), GetBValue(clrBkgnd));
+}
+
+/** @brief Class of the line text cells, see FileCmpHtmlReport::GetStyles(). */
+const TCHAR *GetLineClass(OP_TYPE op, bool bGhost)
+{
+	if (op == OP_NONE)
+		return _T("eq");
+	if (op == OP_TRIVIAL)
+		return bGhost ? _T("trg") : _T("tr");
+	return bGhost ? _T("dfg") : _T("df");
+}
+
+}
+
+/**
+ * @brief Lines of one compared file.
+ */
+struct FileCmpHtmlReport::TextFile
+{
+	std::vector<String> lines; /**< Lines without EOL */
+	std::string utf8; /**< Whole file as UTF-8, EOLs included */
+};
+
+FileCmpHtmlReport::FileCmpHtmlReport()
+	: m_diffOptions{}
+	, m_pFilterList(nullptr)
+	, m_iGuessEncodingType(0)
+	, m_colors{}
+	, m_clrText(RGB(0, 0, 0))
+	, m_clrBkgnd(RGB(255, 255, 255))
+	, m_clrMargin(RGB(224, 224, 224))
+	, m_nTabSize(4)
+	, m_nFontSize(10)
+{
+}
+
+/**
+ * @brief Set the colors of lines without differences and of line numbers.
+ */
+void FileCmpHtmlReport::SetTextColors(COLORREF clrText, COLORREF clrBkgnd, COLORREF clrMargin)
+{
+	m_clrText = clrText;
+	m_clrBkgnd = clrBkgnd;
+	m_clrMargin = clrMargin;
+}
+
+/**
+ * @brief Write the report of a two-way file compare.
+ * @param [in] files Compared files.
+ * @param [in] titles Titles of the files, shown above the lines.
+ * @param [in] sReportFile Report file to create.
+ * @return true if the report was written.
+ */
+bool FileCmpHtmlReport::Generate(const PathContext& files, const PathContext& titles, const String& sReportFile) const
+{
+	if (files.GetSize() != 2)
+		return false;
+
+	TextFile textFiles[2];
+	DiffList diffList;
+	for (int nBuffer = 0; nBuffer < 2; nBuffer++)
+	{
+		if (!LoadFile(files[nBuffer], textFiles[nBuffer]))
+			return false;
+	}
+	if (!DiffFiles(files, textFiles, diffList))
+		return false;
+
+	const int nLineCount[2] = {
+		static_cast<int>(textFiles[0].lines.size()),
+		static_cast<int>(textFiles[1].lines.size())
+	};
+
+	ReportBuffer buffer(true);
+	buffer.Append(
+		_T("<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 4.01 Transitional//EN\"\n")
+		_T("\t\"http://www.w3.org/TR/html4/loose.dtd\">\n")
+		_T("<html>\n")
+		_T("<head>\n")
+		_T("<meta http-equiv=\"Content-Type\" content=\"text/html; charset=UTF-8\">\n")
+		_T("<title>WinMerge File Compare Report</title>\n")
+		_T("<style type=\"text/css\">\n")
+		_T("<!--\n"));
+	buffer.Append(GetStyles());
+	buffer.Append(
+		_T("-->\n")
+		_T("</style>\n")
+		_T("</head>\n")
+		_T("<body>\n")
+		_T("<table cellspacing=\"0\" cellpadding=\"0\" style=\"width:100%;\">\n")
+		_T("<colgroup>\n"));
+	double marginWidth = strutils::to_str(std::max(nLineCount[0], nLineCount[1])).length() / 1.5 + 0.5;
+	for (int nBuffer = 0; nBuffer < 2; nBuffer++)
+	{
+		buffer.Append(strutils::format(
+			_T("<col style=\"width: %.1fem;\" />\n")
+			_T("<col style=\"width: calc(100%% / %d - %.1fem);\" />\n"),
+				marginWidth, 2, marginWidth));
+	}
+	buffer.Append(
+		_T("</colgroup>\n")
+		_T("<thead>\n")
+		_T("<tr>\n"));
+	for (int nBuffer = 0; nBuffer < 2; nBuffer++)
+	{
+		buffer.Append(_T("<th colspan=\"2\" class=\"title\">"));
+		buffer.AppendEntities(titles[nBuffer]);
+		buffer.Append(_T("</th>\n"));
+	}
+	buffer.Append(
+		_T("</tr>\n")
+		_T("</thead>\n")
+		_T("<tbody>\n"));
+
+	// Lines before each difference are the same on both sides, the lines
+	// of the shorter side of a difference are padded with ghost lines.
+	int nLine[2] = { 0, 0 };
+	int nDiff = 0;
+	const int nDiffs = diffList.GetSize();
+	for (int i = 0; i <= nDiffs; i++)
+	{
+		DIFFRANGE dr;
+		if (i < nDiffs)
+			diffList.GetDiff(i, dr);
+		else
+		{
+			dr.begin[0] = dr.end[0] = nLineCount[0];
+			dr.begin[1] = dr.end[1] = nLineCount[1];
+			dr.op = OP_NONE;
+		}
+		for (; nLine[0] < dr.begin[0] && nLine[1] < dr.begin[1]; nLine[0]++, nLine[1]++)
+		{
+			buffer.Append(_T("<tr>\n"));
+			for (int nBuffer = 0; nBuffer < 2; nBuffer++)
+				AppendLine(buffer, textFiles[nBuffer], nLine[nBuffer], OP_NONE, 0);
+			buffer.Append(_T("</tr>\n"));
+		}
+		if (i == nDiffs)
+			break;
+
+		const int nDiffLines[2] = {
+			std::max(dr.end[0] - dr.begin[0] + 1, 0),
+			std::max(dr.end[1] - dr.begin[1] + 1, 0)
+		};
+		const int nRows = std::max(nDiffLines[0], nDiffLines[1]);
+		int nAnchor = (dr.op != OP_TRIVIAL && nRows > 0) ? ++nDiff : 0;
+		for (int nRow = 0; nRow < nRows; nRow++)
+		{
+			buffer.Append(_T("<tr>\n"));
+			for (int nBuffer = 0; nBuffer < 2; nBuffer++)
+			{
+				int line = nRow < nDiffLines[nBuffer] ? dr.begin[nBuffer] + nRow : -1;
+				AppendLine(buffer, textFiles[nBuffer], line, dr.op, nBuffer == 0 ? nAnchor : 0);
+			}
+			buffer.Append(_T("</tr>\n"));
+			nAnchor = 0;
+		}
+		nLine[0] = dr.begin[0] + nDiffLines[0];
+		nLine[1] = dr.begin[1] + nDiffLines[1];
+	}
+	buffer.Append(
+		_T("</tbody>\n")
+		_T("</table>\n")
+		_T("</body>\n")
+		_T("</html>\n"));
+
+	FILE *fp = nullptr;
+	if (_tfopen_s(&fp, sReportFile.c_str(), _T("wb")) != 0)
+		return false;
+	bool bWritten = fwrite(buffer.GetData(), 1, buffer.GetSize(), fp) == buffer.GetSize();
+	if (fclose(fp) != 0)
+		bWritten = false;
+	return bWritten;
+}
+
+/**
+ * @brief Read the lines of a file in its detected encoding.
+ */
+bool FileCmpHtmlReport::LoadFile(const String& path, TextFile& file) const
+{
+	UniMemFile ufile;
+	if (!ufile.OpenReadOnly(path))
+		return false;
+	FileTextEncoding encoding = codepage_detect::Guess(path, m_iGuessEncodingType);
+	if (encoding.m_unicoding == ucr::NONE || !ufile.IsUnicode())
+		ufile.SetCodepage(encoding.m_codepage);
+
+	String line, eol;
+	bool lossy = false;
+	while (ufile.ReadString(line, eol, &lossy))
+	{
+		if (line.empty() && eol.empty())
+			break;
+		file.utf8 += ucr::toUTF8(line);
+		file.utf8 += ucr::toUTF8(eol);
+		file.lines.push_back(std::move(line));
+	}
+	ufile.Close();
+	return true;
+}
+
+/**
+ * @brief Diff the UTF-8 copies of the files, as a file compare window does.
+ */
+bool FileCmpHtmlReport::DiffFiles(const PathContext& files, const TextFile textFiles[2], DiffList& diffList) const
+{
+	String sExt;
+	paths::SplitFilename(files[0], nullptr, nullptr, &sExt);
+
+	TempFile tempFiles[2];
+	for (int nBuffer = 0; nBuffer < 2; nBuffer++)
+	{
+		String sTempPath = tempFiles[nBuffer].Create(_T("REP"), sExt.empty() ? String() : _T(".") + sExt);
+		FILE *fp = nullptr;
+		if (sTempPath.empty() || _tfopen_s(&fp, sTempPath.c_str(), _T("wb")) != 0)
+			return false;
+		const std::string& text = textFiles[nBuffer].utf8;
+		bool bWritten = fwrite(text.data(), 1, text.size(), fp) == text.size();
+		if (fclose(fp) != 0 || !bWritten)
+			return false;
+	}
+
+	CDiffWrapper diffWrapper;
+	diffWrapper.SetCreateDiffList(&diffList);
+	diffWrapper.SetOptions(&m_diffOptions);
+	diffWrapper.SetPrediffer(nullptr);
+	diffWrapper.SetFilterList(m_pFilterList);
+	diffWrapper.SetSubstitutionList(m_pSubstitutionList);
+	diffWrapper.SetFilterCommentsSourceDef(sExt);
+	diffWrapper.SetPaths(PathContext(tempFiles[0].GetPath(), tempFiles[1].GetPath()), true);
+	diffWrapper.SetCompareFiles(files);
+	if (!diffWrapper.RunFileDiff())
+		return false;
+
+	DIFFSTATUS status;
+	diffWrapper.GetDiffStatus(&status);
+	return !status.bBinaries;
+}
+
+/**
+ * @brief Style sheet of the report.
+ * Lines are in class eq (no difference), df (difference), dfg (ghost line of
+ * a difference), tr (ignored difference) or trg (ghost line of an ignored
+ * difference).
+ */
+String FileCmpHtmlReport::GetStyles() const
+{
+	String styles = strutils::format(
+		_T("table {margin: 0; border: 1px solid #a0a0a0; box-shadow: 1px 1px 2px rgba(0, 0, 0, 0.15);}\n")
+		_T("td,th {word-break: break-all; font-size: %dpt;padding: 0 3px;}\n")
+		_T("tr { vertical-align: top; }\n")
+		_T("code {white-space: pre-wrap;}\n")
+		_T(".title {color: white; background-color: blue; vertical-align: top; padding: 4px 4px; background: linear-gradient(mediumblue, darkblue);}\n"),
+		m_nFontSize);
+	styles += _T(".eq {") + FormatColors(m_clrText, m_clrBkgnd) + _T("}\n");
+	styles += _T(".df {") + FormatColors(m_colors.clrDiffText, m_colors.clrDiff) + _T("}\n");
+	styles += _T(".dfg {") + FormatColors(m_colors.clrDiffText, m_colors.clrDiffDeleted) + _T("}\n");
+	styles += _T(".tr {") + FormatColors(m_colors.clrTrivialText, m_colors.clrTrivial) + _T("}\n");
+	styles += _T(".trg {") + FormatColors(m_colors.clrTrivialText, m_colors.clrTrivialDeleted) + _T("}\n");
+	styles += _T(".ln {text-align: right; word-break: normal; ") + FormatColors(m_clrText, m_clrMargin) + _T("}\n");
+	return styles;
+}
+
+/**
+ * @brief Append the line number and text cells of one side of a row.
+ * @param [in] nLine Line in @p file, -1 for a ghost line.
+ * @param [in] nAnchor Number of the difference starting at this row, or 0.
+ */
+void FileCmpHtmlReport::AppendLine(ReportBuffer& buffer, const TextFile& file, int nLine, OP_TYPE op, int nAnchor) const
+{
+	buffer.Append(_T("<td class=\"ln\">"));
+	if (nAnchor > 0)
+	{
+		buffer.Append(strutils::format(_T("<a name=\"d%d\" href=\"#d%d\">"), nAnchor, nAnchor));
+		buffer.Append(nLine >= 0 ? strutils::to_str(nLine + 1) : String(_T(".")));
+		buffer.Append(_T("</a>"));
+	}
+	else if (nLine >= 0)
+		buffer.Append(strutils::to_str(nLine + 1));
+	buffer.Append(_T("</td><td class=\""));
+	buffer.Append(GetLineClass(op, nLine < 0));
+	buffer.Append(_T("\"><code>"));
+
+	String expanded;
+	if (nLine >= 0)
+	{
+		const size_t nTabSize = std::max(m_nTabSize, 1);
+		const String& line = file.lines[nLine];
+		expanded.reserve(line.length());
+		for (TCHAR ch : line)
+		{
+			if (ch == '\t')
+				expanded.append(nTabSize - expanded.length() % nTabSize, ' ');
+			else
+				expanded += ch;
+		}
+	}
+	if (expanded.find_first_not_of(' ') == String::npos)
+		buffer.Append(expanded + _T("&nbsp;"));
+	else
+		buffer.AppendEntities(expanded);
+	buffer.Append(_T("</code></td>\n"));
+}
+
+/**
+ * @brief Writes the queued reports.
+ */
+class FileCmpHtmlReportPool::ReportWorker : public Poco::Runnable
+{
+public:
+	explicit ReportWorker(FileCmpHtmlReportPool& pool) : m_pool(pool) {}
+
+	void run() override
+	{
+		AutoPtr<Notification> pNf(m_pool.m_queue.waitDequeueNotification());
+		while (pNf.get() != nullptr && dynamic_cast<QuitNotification*>(pNf.get()) == nullptr)
+		{
+			ReportWorkNotification* pWorkNf = dynamic_cast<ReportWorkNotification*>(pNf.get());
+			if (pWorkNf != nullptr)
+			{
+				// An aborted report is not a failed one
+				bool bWritten = m_pool.ShouldAbort() ||
+					m_pool.m_report.Generate(pWorkNf->files(), pWorkNf->titles(), pWorkNf->reportFile());
+				m_pool.m_queueResult.enqueueNotification(new ReportDoneNotification(bWritten));
+			}
+			pNf = m_pool.m_queue.waitDequeueNotification();
+		}
+	}
+
+private:
+	FileCmpHtmlReportPool& m_pool;
+};
+
+/**
+ * @brief Start the worker threads.
+ * @param [in] report Renderer, copied for the workers.
+ * @param [in] nThreads Number of worker threads.
+ * @param [in] piAbortable Stops writing queued reports, may be nullptr.
+ */
+FileCmpHtmlReportPool::FileCmpHtmlReportPool(const FileCmpHtmlReport& report, int nThreads, const IAbortable *piAbortable)
+	: m_report(report)
+	, m_piAbortable(piAbortable)
+	, m_nThreads(std::max(nThreads, 1))
+	, m_pThreadPool(new Poco::ThreadPool(m_nThreads, m_nThreads))
+	, m_nInFlight(0)
+	, m_nFailed(0)
+{
+	for (int i = 0; i < m_nThreads; ++i)
+	{
+		m_workers.emplace_back(new ReportWorker(*this));
+		m_pThreadPool->start(*m_workers.back());
+	}
+}
+
+FileCmpHtmlReportPool::~FileCmpHtmlReportPool()
+{
+	Finish();
+}
+
+/**
+ * @brief Queue a report, waiting first while too many reports are in flight.
+ * @param [in] files Compared files.
+ * @param [in] titles Titles of the files.
+ * @param [in] sReportFile Report file to create.
+ */
+void FileCmpHtmlReportPool::Add(const PathContext& files, const PathContext& titles, const String& sReportFile)
+{
+	if (m_pThreadPool == nullptr)
+		return;
+	while (m_nInFlight >= m_nThreads * DocumentsInFlightPerThread)
+		ReceiveResult();
+	m_queue.enqueueNotification(new ReportWorkNotification(files, titles, sReportFile));
+	++m_nInFlight;
+}
+
+/**
+ * @brief Wait until all queued reports are written and stop the workers.
+ */
+void FileCmpHtmlReportPool::Finish()
+{
+	if (m_pThreadPool == nullptr)
+		return;
+	while (m_nInFlight > 0)
+		ReceiveResult();
+	for (int i = 0; i < m_nThreads; ++i)
+		m_queue.enqueueNotification(new QuitNotification);
+	m_pThreadPool->joinAll();
+	m_pThreadPool.reset();
+	m_workers.clear();
+}
+
+/**
+ * @brief Wait for one report to finish.
+ */
+void FileCmpHtmlReportPool::ReceiveResult()
+{
+	AutoPtr<Notification> pNf(m_queueResult.waitDequeueNotification());
+	--m_nInFlight;
+	ReportDoneNotification *pDoneNf = dynamic_cast<ReportDoneNotification*>(pNf.get());
+	if (pDoneNf != nullptr && !pDoneNf->written())
+		++m_nFailed;
+}
+
+bool FileCmpHtmlReportPool::ShouldAbort() const
+{
+	return m_piAbortable != nullptr && m_piAbortable->ShouldAbort();
+}
@@ -0,0 +1,100 @@
+/**
+ * @file  FileCmpHtmlReport.h
+ *
+ * @brief Declaration of FileCmpHtmlReport, which writes file compare reports
+ * without opening the files in a file compare window.
+ */
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <Poco/NotificationQueue.h>
+#include <Poco/ThreadPool.h>
+#include "DiffWrapper.h"
+#include "OptionsDiffColors.h"
+#include "UnicodeString.h"
+
+class PathContext;
+class FilterList;
+class SubstitutionList;
+class ReportBuffer;
+class IAbortable;
+
+/**
+ * @brief Writes the HTML report of a two-way text file compare.
+ * The report has the same layout as the report of a file compare window,
+ * side by side lines with line numbers, difference anchors and difference
+ * colors, but is made from the files alone: there is no syntax highlighting
+ * and no word level difference highlighting. As there is no user interface
+ * involved, Generate() can run on any thread, and on several at once.
+ */
+class FileCmpHtmlReport
+{
+public:
+	FileCmpHtmlReport();
+	void SetDiffOptions(const DIFFOPTIONS& options) { m_diffOptions = options; }
+	void SetFilterList(const FilterList *pFilterList) { m_pFilterList = pFilterList; }
+	void SetSubstitutionList(std::shared_ptr<SubstitutionList> pSubstitutionList) { m_pSubstitutionList = pSubstitutionList; }
+	void SetGuessEncodingType(int iGuessEncodingType) { m_iGuessEncodingType = iGuessEncodingType; }
+	void SetColors(const COLORSETTINGS& colors) { m_colors = colors; }
+	void SetTextColors(COLORREF clrText, COLORREF clrBkgnd, COLORREF clrMargin);
+	void SetTabSize(int nTabSize) { m_nTabSize = nTabSize; }
+	void SetFontSize(int nFontSize) { m_nFontSize = nFontSize; }
+	bool Generate(const PathContext& files, const PathContext& titles, const String& sReportFile) const;
+
+private:
+	struct TextFile;
+
+	bool LoadFile(const String& path, TextFile& file) const;
+	bool DiffFiles(const PathContext& files, const TextFile textFiles[2], DiffList& diffList) const;
+	String GetStyles() const;
+	void AppendLine(ReportBuffer& buffer, const TextFile& file, int nLine, OP_TYPE op, int nAnchor) const;
+
+	DIFFOPTIONS m_diffOptions;
+	const FilterList *m_pFilterList; /**< Line filters, owned by the caller */
+	std::shared_ptr<SubstitutionList> m_pSubstitutionList;
+	int m_iGuessEncodingType;
+	COLORSETTINGS m_colors;
+	COLORREF m_clrText; /**< Text color of lines without differences */
+	COLORREF m_clrBkgnd; /**< Background color of lines without differences */
+	COLORREF m_clrMargin; /**< Background color of line numbers */
+	int m_nTabSize;
+	int m_nFontSize; /**< Font size in points */
+};
+
+/**
+ * @brief Writes file compare reports on a pool of worker threads.
+ * Add() queues a report and returns at once, unless as many reports as
+ * DocumentsInFlightPerThread per worker are already queued or being written,
+ * then it first waits for one of them to finish. Each report is written to
+ * its file as soon as it is ready. Finish() waits for all queued reports.
+ * When the abortable aborts, queued reports are not written any more.
+ */
+class FileCmpHtmlReportPool
+{
+public:
+	/** @brief Reports queued or being written per worker thread. */
+	static constexpr int DocumentsInFlightPerThread = 2;
+
+	FileCmpHtmlReportPool(const FileCmpHtmlReport& report, int nThreads, const IAbortable *piAbortable);
+	~FileCmpHtmlReportPool();
+	void Add(const PathContext& files, const PathContext& titles, const String& sReportFile);
+	void Finish();
+	int GetFailedCount() const { return m_nFailed; }
+
+private:
+	class ReportWorker;
+
+	void ReceiveResult();
+	bool ShouldAbort() const;
+
+	FileCmpHtmlReport m_report;
+	const IAbortable *m_piAbortable;
+	int m_nThreads;
+	Poco::NotificationQueue m_queue;
+	Poco::NotificationQueue m_queueResult;
+	std::unique_ptr<Poco::ThreadPool> m_pThreadPool;
+	std::vector<std::unique_ptr<ReportWorker>> m_workers;
+	int m_nInFlight; /**< Reports queued and not yet received back */
+	int m_nFailed; /**< Reports that could not be written */
+};
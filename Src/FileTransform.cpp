@@ -15,12 +15,15 @@
 #include <vector>
 #include <Poco/Exception.h>
 #include <Poco/Mutex.h>
+#ifdef _WIN32
 #include "Plugins.h"
+#endif
 #include "multiformatText.h"
 #include "Environment.h"
 #include "TFile.h"
 #include "paths.h"
 #include "MergeApp.h"
+#include "PerfTrace.h"
 
 using Poco::Exception;
 
@@ -211,6 +214,8 @@ String PluginForFile::MakeArguments(const std::vector<String>& args, const std::
 	return newstr;
 }
 
+#ifdef _WIN32
+
 bool PackingInfo::GetPackUnpackPlugin(const String& filteredFilenames, bool bUrl, bool bReverse,
 	std::vector<std::tuple<PluginInfo*, std::vector<String>, bool>>& plugins,
 	String *pPluginPipelineResolved, String *pURLHandlerResolved, String& errorMessage) const
@@ -367,6 +372,57 @@ bool PackingInfo::pack(String & filepath, const String& dstFilepath, const std::
 	return true;
 }
 
+#else
+
+/**
+ * @brief Check a plugin pipeline where no plugins can be loaded.
+ * `<None>` and `<Automatic>` resolve to no plugin, any other name is an error.
+ */
+static bool CheckPipelineWithoutPlugins(const std::vector<PluginForFile::PipelineItem>& pipeline, String& errorMessage)
+{
+	for (const auto& [pluginName, args, quoteChar] : pipeline)
+	{
+		if (pluginName != _T("<None>") && pluginName != _("<None>") &&
+			pluginName != _T("<Automatic>") && pluginName != _("<Automatic>"))
+		{
+			errorMessage = strutils::format_string1(_("Plugin not found or invalid: %1"), pluginName);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool PackingInfo::GetPackUnpackPlugin(const String& filteredFilenames, bool bUrl, bool bReverse,
+	std::vector<std::tuple<PluginInfo*, std::vector<String>, bool>>& plugins,
+	String *pPluginPipelineResolved, String *pURLHandlerResolved, String& errorMessage) const
+{
+	auto result = ParsePluginPipeline(errorMessage);
+	if (!errorMessage.empty() || !CheckPipelineWithoutPlugins(result, errorMessage))
+		return false;
+	if (pPluginPipelineResolved)
+		pPluginPipelineResolved->clear();
+	if (pURLHandlerResolved)
+		pURLHandlerResolved->clear();
+	return true;
+}
+
+bool PackingInfo::pack(String & filepath, const String& dstFilepath, const std::vector<int>& handlerSubcodes, const std::vector<StringView>& variables) const
+{
+	// no handler : return true
+	if (m_PluginPipeline.empty())
+		return true;
+	String errorMessage;
+	std::vector<std::tuple<PluginInfo*, std::vector<String>, bool>> plugins;
+	if (!GetPackUnpackPlugin(_T(""), false, true, plugins, nullptr, nullptr, errorMessage))
+	{
+		AppErrorMessageBox(errorMessage);
+		return false;
+	}
+	return true;
+}
+
+#endif
+
 bool PackingInfo::Packing(const String& srcFilepath, const String& dstFilepath, const std::vector<int>& handlerSubcodes, const std::vector<StringView>& variables) const
 {
 	String csTempFileName = srcFilepath;
@@ -385,15 +441,22 @@ bool PackingInfo::Packing(const String& srcFilepath, const String& dstFilepath,
 	}
 	catch (Poco::Exception& e)
 	{
+#ifdef _WIN32
 		DWORD dwErrCode = GetLastError();
 		LogErrorStringUTF8(e.displayText());
 		SetLastError(dwErrCode);
+#else
+		LogErrorStringUTF8(e.displayText());
+#endif
 		return false;
 	}
 }
 
+#ifdef _WIN32
+
 bool PackingInfo::Unpacking(std::vector<int> * handlerSubcodes, String & filepath, const String& filteredText, const std::vector<StringView>& variables)
 {
+	PERFTRACE_SCOPE("PackingInfo::Unpacking", filteredText);
 	if (handlerSubcodes)
 		handlerSubcodes->clear();
 
@@ -709,6 +772,89 @@ bool EditorScriptInfo::TransformText(String & text, const std::vector<StringView
 	return true;
 }
 
+#else
+
+bool PackingInfo::Unpacking(std::vector<int> * handlerSubcodes, String & filepath, const String& filteredText, const std::vector<StringView>& variables)
+{
+	if (handlerSubcodes)
+		handlerSubcodes->clear();
+	// no handler : return true
+	if (m_PluginPipeline.empty())
+		return true;
+	String errorMessage;
+	std::vector<std::tuple<PluginInfo*, std::vector<String>, bool>> plugins;
+	if (!GetPackUnpackPlugin(filteredText, false, false, plugins, &m_PluginPipeline, &m_URLHandler, errorMessage))
+	{
+		AppErrorMessageBox(errorMessage);
+		return false;
+	}
+	return true;
+}
+
+String PackingInfo::GetUnpackedFileExtension(const String& filteredFilenames) const
+{
+	return _T("");
+}
+
+bool PrediffingInfo::GetPrediffPlugin(const String& filteredFilenames, bool bReverse,
+	std::vector<std::tuple<PluginInfo*, std::vector<String>, bool>>& plugins,
+	String *pPluginPipelineResolved, String& errorMessage) const
+{
+	auto result = ParsePluginPipeline(errorMessage);
+	if (!errorMessage.empty() || !CheckPipelineWithoutPlugins(result, errorMessage))
+		return false;
+	if (pPluginPipelineResolved)
+		pPluginPipelineResolved->clear();
+	return true;
+}
+
+bool PrediffingInfo::Prediffing(String & filepath, const String& filteredText, bool bMayOverwrite, const std::vector<StringView>& variables)
+{
+	// no handler : return true
+	if (m_PluginPipeline.empty())
+		return true;
+	String errorMessage;
+	std::vector<std::tuple<PluginInfo*, std::vector<String>, bool>> plugins;
+	if (!GetPrediffPlugin(filteredText, false, plugins, &m_PluginPipeline, errorMessage))
+	{
+		AppErrorMessageBox(errorMessage);
+		return false;
+	}
+	return true;
+}
+
+bool EditorScriptInfo::GetEditorScriptPlugin(std::vector<std::tuple<PluginInfo*, std::vector<String>, int>>& plugins,
+	String& errorMessage) const
+{
+	auto result = ParsePluginPipeline(errorMessage);
+	if (!errorMessage.empty())
+		return false;
+	if (!result.empty())
+	{
+		errorMessage = strutils::format_string1(_("Plugin not found or invalid: %1"), result.front().name);
+		return false;
+	}
+	return true;
+}
+
+bool EditorScriptInfo::TransformText(String & text, const std::vector<StringView>& variables, bool& changed)
+{
+	changed = false;
+	// no handler : return true
+	if (m_PluginPipeline.empty())
+		return true;
+	String errorMessage;
+	std::vector<std::tuple<PluginInfo*, std::vector<String>, int>> plugins;
+	if (!GetEditorScriptPlugin(plugins, errorMessage))
+	{
+		AppErrorMessageBox(errorMessage);
+		return false;
+	}
+	return true;
+}
+
+#endif
+
 namespace FileTransform
 {
 
@@ -766,6 +912,7 @@ std::pair<
 >
 CreatePluginMenuInfos(const String& filteredFilenames, const std::vector<std::wstring>& events, unsigned baseId)
 {
+#ifdef _WIN32
 	std::vector<std::tuple<String, String, unsigned, PluginInfo *>> suggestedPlugins;
 	std::map<String, std::vector<std::tuple<String, String, unsigned, PluginInfo *>>> allPlugins;
 	std::map<String, int> captions;
@@ -849,6 +996,9 @@ CreatePluginMenuInfos(const String& filteredFilenames, const std::vector<std::ws
 	for (auto& [processType, plugins] : allPlugins)
 		ResolveConflictMenuCaptions(plugins);
 	return { suggestedPlugins, allPlugins };
+#else
+	return {};
+#endif
 }
 
 }
@@ -204,8 +204,8 @@ std::pair<
 >
 CreatePluginMenuInfos(const String& filteredFilenames, const std::vector<std::wstring>& events, unsigned baseId);
 
-inline const std::vector<String> UnpackerEventNames = { L"BUFFER_PACK_UNPACK", L"FILE_PACK_UNPACK", L"FILE_FOLDER_PACK_UNPACK" };
-inline const std::vector<String> PredifferEventNames = { L"BUFFER_PREDIFF", L"FILE_PREDIFF" };
-inline const std::vector<String> EditorScriptEventNames = { L"EDITOR_SCRIPT" };
+inline const std::vector<String> UnpackerEventNames = { _T("BUFFER_PACK_UNPACK"), _T("FILE_PACK_UNPACK"), _T("FILE_FOLDER_PACK_UNPACK") };
+inline const std::vector<String> PredifferEventNames = { _T("BUFFER_PREDIFF"), _T("FILE_PREDIFF") };
+inline const std::vector<String> EditorScriptEventNames = { _T("EDITOR_SCRIPT") };
 
 }
@@ -13,6 +13,7 @@
 #include "paths.h"
 #include "FilterList.h"
 #include "DiffContext.h"
+#include "CompareOptions.h"
 #include "DiffList.h"
 #include "DiffWrapper.h"
 #include "FileTransform.h"
@@ -22,7 +23,12 @@
 #include "TFile.h"
 #include "FileFilterHelper.h"
 #include "PropertySystem.h"
+#include "StreamingDiff.h"
+#include "SubstitutionList.h"
+#include "xdiff_gnudiff_compat.h"
 #include "MergeApp.h"
+#include "PerfTrace.h"
+#include "CompareStats.h"
 #include "DebugNew.h"
 
 using CompareEngines::ByteCompare;
@@ -30,8 +36,9 @@ using CompareEngines::BinaryCompare;
 using CompareEngines::TimeSizeCompare;
 using CompareEngines::ImageCompare;
 
-FolderCmp::FolderCmp(CDiffContext *pCtxt)
+FolderCmp::FolderCmp(CDiffContext *pCtxt, std::shared_ptr<const FolderCmpSnapshot> pSnapshot /*= nullptr*/)
 : m_pCtxt(pCtxt)
+, m_pSnapshot(pSnapshot ? pSnapshot : std::make_shared<FolderCmpSnapshot>(pCtxt))
 , m_pDiffUtilsEngine(nullptr)
 , m_pByteCompare(nullptr)
 , m_pBinaryCompare(nullptr)
@@ -41,7 +48,16 @@ FolderCmp::FolderCmp(CDiffContext *pCtxt)
 {
 }
 
-FolderCmp::~FolderCmp() = default;
+/**
+ * @brief Destructor, stores the plugin infos resolved during the compare.
+ */
+FolderCmp::~FolderCmp()
+{
+	if (m_pCtxt->m_piPluginInfos == nullptr)
+		return;
+	for (const auto& [filteredFilenames, infoUnpacker, infoPrediffer] : m_resolvedPluginInfos)
+		m_pCtxt->m_piPluginInfos->SetPluginInfos(filteredFilenames, infoUnpacker, infoPrediffer);
+}
 
 bool FolderCmp::RunPlugins(PluginsContext * plugCtxt, String &errStr)
 {
@@ -53,6 +69,119 @@ void FolderCmp::CleanupAfterPlugins(PluginsContext *plugCtxt)
 {
 }
 
+/**
+ * @brief Return text converted to UTF-8 in memory, or `nullptr` if the file
+ * was not converted in memory.
+ */
+static const std::string *GetTranscodedText(const std::string& text)
+{
+	return text.empty() ? nullptr : &text;
+}
+
+/**
+ * @brief Return true if files too big for diffutils can be compared with
+ * StreamingDiff. It does not apply line filters, substitution filters or
+ * comment filtering, so those fall back to quick compare.
+ */
+static bool CanUseStreamingDiff(const CDiffContext *pCtxt, const DiffutilsOptions *pOptions)
+{
+	return pCtxt->m_nStreamingDiffMemoryLimit > 0 && pOptions != nullptr &&
+		!pOptions->m_filterCommentsLines &&
+		(pCtxt->m_pFilterList == nullptr || !pCtxt->m_pFilterList->HasRegExps()) &&
+		(pCtxt->m_pSubstitutionList == nullptr || !pCtxt->m_pSubstitutionList->HasRegExps());
+}
+
+/**
+ * @brief Copy the settings of a folder compare.
+ * @param [in] pCtxt Compare context, with compare options, filters and
+ *  plugin infos set.
+ */
+FolderCmpSnapshot::FolderCmpSnapshot(CDiffContext *pCtxt)
+: nCompMethod(pCtxt->GetCompareMethod())
+, nDirs(pCtxt->GetCompareDirs())
+, pContentOptions(nullptr)
+, pQuickOptions(nullptr)
+, bCanUseStreamingDiff(false)
+, nQuickCompareLimit(pCtxt->m_nQuickCompareLimit)
+, nBinaryCompareLimit(pCtxt->m_nBinaryCompareLimit)
+, nTranscodeInMemoryLimit(pCtxt->m_nTranscodeInMemoryLimit)
+, nStreamingDiffMemoryLimit(pCtxt->m_nStreamingDiffMemoryLimit)
+, iGuessEncodingType(pCtxt->m_iGuessEncodingType)
+, bStopAfterFirstDiff(pCtxt->m_bStopAfterFirstDiff)
+, bIgnoreCodepage(pCtxt->m_bIgnoreCodepage)
+, bEnableImageCompare(pCtxt->m_bEnableImageCompare)
+, dColorDistanceThreshold(pCtxt->m_dColorDistanceThreshold)
+, bIgnoreSmallTimeDiff(pCtxt->m_bIgnoreSmallTimeDiff)
+, bPlugins(pCtxt->m_piPluginInfos != nullptr)
+, bAutoUnpacking(FileTransform::AutoUnpacking)
+, bAutoPrediffing(FileTransform::AutoPrediffing)
+, piAbortable(pCtxt->GetAbortable())
+{
+	if (pCtxt->GetOptions() != nullptr)
+	{
+		pContentOptions = static_cast<const DiffutilsOptions *>(pCtxt->GetCompareOptions(CMP_CONTENT));
+		pQuickOptions = static_cast<const QuickCompareOptions *>(pCtxt->GetCompareOptions(CMP_QUICK_CONTENT));
+		bCanUseStreamingDiff = CanUseStreamingDiff(pCtxt, pContentOptions);
+	}
+	if (pCtxt->m_piPluginInfos != nullptr)
+		pCtxt->m_piPluginInfos->GetPluginInfos(pluginInfos);
+}
+
+/**
+ * @brief Return compare options of a compare method, `nullptr` for methods
+ * without options.
+ */
+const CompareOptions *FolderCmpSnapshot::GetCompareOptions(int compareMethod) const
+{
+	switch (compareMethod)
+	{
+	case CMP_CONTENT:
+		return pContentOptions;
+	case CMP_QUICK_CONTENT:
+		return pQuickOptions;
+	default:
+		return nullptr;
+	}
+}
+
+/**
+ * @brief Return plugin infos for compared files.
+ * Files without infos in the snapshot plugin table get default infos of
+ * their own, kept by KeepResolvedPluginInfos() if plugins resolve them.
+ * @param [in] filteredFilenames Compared files, as in plugin table.
+ * @param [out] infoUnpacker Unpacker infos of the files.
+ * @param [out] infoPrediffer Prediffer infos of the files.
+ */
+void FolderCmp::GetPluginInfos(const String& filteredFilenames, PackingInfo *& infoUnpacker, PrediffingInfo *& infoPrediffer)
+{
+	auto it = m_pSnapshot->pluginInfos.find(filteredFilenames);
+	if (it != m_pSnapshot->pluginInfos.end())
+	{
+		infoUnpacker = it->second.first;
+		infoPrediffer = it->second.second;
+		return;
+	}
+	m_infoUnpacker = PackingInfo(m_pSnapshot->bAutoUnpacking);
+	m_infoPrediffer = PrediffingInfo(m_pSnapshot->bAutoPrediffing);
+	infoUnpacker = &m_infoUnpacker;
+	infoPrediffer = &m_infoPrediffer;
+}
+
+/**
+ * @brief Keep default plugin infos that plugins have resolved, to store
+ * them in the plugin table when the compare is done.
+ * @param [in] filteredFilenames Compared files, as in plugin table.
+ * @param [in] infoUnpacker Unpacker infos returned by GetPluginInfos().
+ */
+void FolderCmp::KeepResolvedPluginInfos(const String& filteredFilenames, const PackingInfo *infoUnpacker)
+{
+	if (infoUnpacker != &m_infoUnpacker)
+		return;
+	if (m_infoUnpacker.GetPluginPipeline() != PackingInfo(m_pSnapshot->bAutoUnpacking).GetPluginPipeline() ||
+		m_infoPrediffer.GetPluginPipeline() != PrediffingInfo(m_pSnapshot->bAutoPrediffing).GetPluginPipeline())
+		m_resolvedPluginInfos.emplace_back(filteredFilenames, m_infoUnpacker, m_infoPrediffer);
+}
+
 /**
  * @brief Prepare files (run plugins) & compare them, and return diffcode.
  * This is function to compare two files in folder compare. It is not used in
@@ -63,21 +192,23 @@ void FolderCmp::CleanupAfterPlugins(PluginsContext *plugCtxt)
  */
 int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 {
+	const String sTracePath = perftrace::IsEnabled() ? di.getItemRelativePath() : String();
+	PERFTRACE_SCOPE("FolderCmp::prepAndCompareFiles", sTracePath);
 	int nIndex;
-	int nCompMethod = m_pCtxt->GetCompareMethod();
-	int nDirs = m_pCtxt->GetCompareDirs();
+	int nCompMethod = m_pSnapshot->nCompMethod;
+	int nDirs = m_pSnapshot->nDirs;
 
 	unsigned code = DIFFCODE::FILE | DIFFCODE::CMPERR;
 
 	if (nCompMethod == CMP_CONTENT || nCompMethod == CMP_QUICK_CONTENT)
 	{
-		if ((di.diffFileInfo[0].size > m_pCtxt->m_nBinaryCompareLimit && di.diffFileInfo[0].size != DirItem::FILE_SIZE_NONE) ||
-			(di.diffFileInfo[1].size > m_pCtxt->m_nBinaryCompareLimit && di.diffFileInfo[1].size != DirItem::FILE_SIZE_NONE) ||
-			(nDirs > 2 && di.diffFileInfo[2].size > m_pCtxt->m_nBinaryCompareLimit && di.diffFileInfo[2].size != DirItem::FILE_SIZE_NONE))
+		if ((di.diffFileInfo[0].size > m_pSnapshot->nBinaryCompareLimit && di.diffFileInfo[0].size != DirItem::FILE_SIZE_NONE) ||
+			(di.diffFileInfo[1].size > m_pSnapshot->nBinaryCompareLimit && di.diffFileInfo[1].size != DirItem::FILE_SIZE_NONE) ||
+			(nDirs > 2 && di.diffFileInfo[2].size > m_pSnapshot->nBinaryCompareLimit && di.diffFileInfo[2].size != DirItem::FILE_SIZE_NONE))
 		{
 			nCompMethod = CMP_BINARY_CONTENT;
 		}
-		else if (m_pCtxt->m_bEnableImageCompare && (
+		else if (m_pSnapshot->bEnableImageCompare && (
 			di.diffFileInfo[0].size != DirItem::FILE_SIZE_NONE && m_pCtxt->m_pImgfileFilter->includeFile(di.diffFileInfo[0].filename) ||
 			di.diffFileInfo[1].size != DirItem::FILE_SIZE_NONE && m_pCtxt->m_pImgfileFilter->includeFile(di.diffFileInfo[1].filename) ||
 			nDirs > 2 && di.diffFileInfo[2].size != DirItem::FILE_SIZE_NONE && m_pCtxt->m_pImgfileFilter->includeFile(di.diffFileInfo[2].filename)))
@@ -102,7 +233,9 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 		DiffFileData diffdata10, diffdata12, diffdata02;
 		String filepathUnpacked[3];
 		String filepathTransformed[3];
+		std::string textTranscoded[3];
 		int codepage = 0;
+		bool bStreamingDiff = false;
 
 		// For user chosen plugins, define bAutomaticUnpacker as false and use the chosen infoHandler
 		// but how can we receive the infoHandler ? DirScan actually only 
@@ -116,12 +249,11 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 		PrediffingInfo * infoPrediffer = nullptr;
 
 		// Get existing or new plugin infos
-		if (m_pCtxt->m_piPluginInfos != nullptr)
-			m_pCtxt->FetchPluginInfos(filteredFilenames, &infoUnpacker,
-					&infoPrediffer);
+		if (m_pSnapshot->bPlugins)
+			GetPluginInfos(filteredFilenames, infoUnpacker, infoPrediffer);
 
 		FileTextEncoding encoding[3];
-		bool bForceUTF8 = m_pCtxt->GetCompareOptions(nCompMethod)->m_bIgnoreCase;
+		bool bForceUTF8 = m_pSnapshot->GetCompareOptions(nCompMethod)->m_bIgnoreCase;
 
 		for (nIndex = 0; nIndex < nDirs; nIndex++)
 		{
@@ -140,18 +272,38 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 			// Unpacked files will be deleted at end of this function.
 			filepathTransformed[nIndex] = filepathUnpacked[nIndex];
 
-			encoding[nIndex] = codepage_detect::Guess(filepathTransformed[nIndex], m_pCtxt->m_iGuessEncodingType);
+			encoding[nIndex] = codepage_detect::Guess(filepathTransformed[nIndex], m_pSnapshot->iGuessEncodingType);
 			m_diffFileData.m_FileLocation[nIndex].encoding = encoding[nIndex];
 		}
 
 		if (!std::equal(encoding + 1, encoding + nDirs, encoding))
 			bForceUTF8 = true;
 		codepage = bForceUTF8 ? CP_UTF8 : (encoding[0].m_unicoding ? CP_UTF8 : encoding[0].m_codepage);
+
+		// If either file is larger than limit compare files by quick contents
+		// This allows us to (faster) compare big binary files
+		// Text files can instead be diffed in bounded memory if enabled
+		if (nCompMethod == CMP_CONTENT && 
+			(di.diffFileInfo[0].size > m_pSnapshot->nQuickCompareLimit ||
+			di.diffFileInfo[1].size > m_pSnapshot->nQuickCompareLimit ||
+			(nDirs > 2 && di.diffFileInfo[2].size > m_pSnapshot->nQuickCompareLimit)))
+		{
+			if (nDirs == 2 && m_pSnapshot->bCanUseStreamingDiff)
+				bStreamingDiff = true;
+			else
+				nCompMethod = CMP_QUICK_CONTENT;
+		}
+
 		for (nIndex = 0; nIndex < nDirs; nIndex++)
 		{
 		// Invoke prediff'ing plugins
-			if (infoPrediffer && !m_diffFileData.Filepath_Transform(bForceUTF8, encoding[nIndex], filepathUnpacked[nIndex], filepathTransformed[nIndex], filteredFilenames, *infoPrediffer))
+			// Text converted in memory can be handed to diffutils only, quick compare reads the files
+			std::string *pTranscoded = (nCompMethod == CMP_CONTENT && !bStreamingDiff) ? &textTranscoded[nIndex] : nullptr;
+			if (infoPrediffer && !m_diffFileData.Filepath_Transform(bForceUTF8, encoding[nIndex], filepathUnpacked[nIndex], filepathTransformed[nIndex], filteredFilenames, *infoPrediffer,
+					pTranscoded, m_pSnapshot->nTranscodeInMemoryLimit))
 				goto exitPrepAndCompare;
+			if (infoPrediffer && DiffFileData::NeedsUTF8Transform(bForceUTF8, encoding[nIndex]) && di.diffcode.exists(nIndex))
+				m_pCtxt->m_pCompareStats->AddTranscodedBytes(di.diffFileInfo[nIndex].size, textTranscoded[nIndex].size());
 		}
 
 		// If options are binary equivalent, we could check for filesize
@@ -166,8 +318,15 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 		{
 			m_diffFileData.SetDisplayFilepaths(tFiles[0], tFiles[1]); // store true names for diff utils patch file
 			// This opens & fstats both files (if it succeeds)
-			if (!m_diffFileData.OpenFiles(filepathTransformed[0], filepathTransformed[1]))
+			if (!m_diffFileData.OpenFiles(filepathTransformed[0], filepathTransformed[1], GetTranscodedText(textTranscoded[0]), GetTranscodedText(textTranscoded[1])))
 				goto exitPrepAndCompare;
+			// Binary files are left to quick compare
+			if (bStreamingDiff && (StreamingDiff::LooksBinary(m_diffFileData.m_inf[0].desc) ||
+				(m_diffFileData.m_inf[1].desc != m_diffFileData.m_inf[0].desc && StreamingDiff::LooksBinary(m_diffFileData.m_inf[1].desc))))
+			{
+				bStreamingDiff = false;
+				nCompMethod = CMP_QUICK_CONTENT;
+			}
 		}
 		else
 		{
@@ -175,33 +334,52 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 			diffdata12.SetDisplayFilepaths(tFiles[1], tFiles[2]); // store true names for diff utils patch file
 			diffdata02.SetDisplayFilepaths(tFiles[0], tFiles[2]); // store true names for diff utils patch file
 
-			if (!diffdata10.OpenFiles(filepathTransformed[1], filepathTransformed[0]))
+			if (!diffdata10.OpenFiles(filepathTransformed[1], filepathTransformed[0], GetTranscodedText(textTranscoded[1]), GetTranscodedText(textTranscoded[0])))
 				goto exitPrepAndCompare;
 
-			if (!diffdata12.OpenFiles(filepathTransformed[1], filepathTransformed[2]))
+			if (!diffdata12.OpenFiles(filepathTransformed[1], filepathTransformed[2], GetTranscodedText(textTranscoded[1]), GetTranscodedText(textTranscoded[2])))
 				goto exitPrepAndCompare;
 
-			if (!diffdata02.OpenFiles(filepathTransformed[0], filepathTransformed[2]))
+			if (!diffdata02.OpenFiles(filepathTransformed[0], filepathTransformed[2], GetTranscodedText(textTranscoded[0]), GetTranscodedText(textTranscoded[2])))
 				goto exitPrepAndCompare;
 		}
 
-		// If either file is larger than limit compare files by quick contents
-		// This allows us to (faster) compare big binary files
-		if (nCompMethod == CMP_CONTENT && 
-			(di.diffFileInfo[0].size > m_pCtxt->m_nQuickCompareLimit ||
-			di.diffFileInfo[1].size > m_pCtxt->m_nQuickCompareLimit ||
-			(nDirs > 2 && di.diffFileInfo[2].size > m_pCtxt->m_nQuickCompareLimit)))
+		if (bStreamingDiff)
 		{
-			nCompMethod = CMP_QUICK_CONTENT;
-		}
+			StreamingDiff streamingDiff(make_xdl_flags(*m_pSnapshot->pContentOptions), m_pSnapshot->nStreamingDiffMemoryLimit);
+			streamingDiff.SetAbortable(m_pSnapshot->piAbortable);
+			switch (streamingDiff.Compare(m_diffFileData.m_inf[0].desc, m_diffFileData.m_inf[1].desc))
+			{
+			case StreamingDiff::Result::Aborted:
+				code = DIFFCODE::FILE | DIFFCODE::TEXT | DIFFCODE::CMPABORT;
+				break;
+			case StreamingDiff::Result::Error:
+				code = DIFFCODE::FILE | DIFFCODE::TEXT | DIFFCODE::CMPERR;
+				break;
+			default:
+				m_ndiffs = streamingDiff.GetDiffCount();
+				m_ntrivialdiffs = streamingDiff.GetTrivialDiffCount();
+				code = DIFFCODE::FILE | DIFFCODE::TEXT | (m_ndiffs > 0 ? DIFFCODE::DIFF : DIFFCODE::SAME);
+				break;
+			}
+			streamingDiff.GetTextStats(0, &m_diffFileData.m_textStats[0]);
+			streamingDiff.GetTextStats(1, &m_diffFileData.m_textStats[1]);
 
-		if (nCompMethod == CMP_CONTENT)
+			// If unique item, it was being compared to itself to determine encoding
+			// and the #diffs is invalid
+			if (di.diffcode.isSideSecondOnly() || di.diffcode.isSideFirstOnly())
+			{
+				m_ndiffs = CDiffContext::DIFFS_UNKNOWN;
+				m_ntrivialdiffs = CDiffContext::DIFFS_UNKNOWN;
+			}
+		}
+		else if (nCompMethod == CMP_CONTENT)
 		{
 			if (m_pDiffUtilsEngine == nullptr)
 			{
 				m_pDiffUtilsEngine.reset(new CompareEngines::DiffUtils());
 				m_pDiffUtilsEngine->SetCodepage(codepage);
-				m_pDiffUtilsEngine->SetCompareOptions(*m_pCtxt->GetCompareOptions(CMP_CONTENT));
+				m_pDiffUtilsEngine->SetCompareOptions(*m_pSnapshot->pContentOptions);
 				if (m_pCtxt->m_pFilterList != nullptr)
 					m_pDiffUtilsEngine->SetFilterList(m_pCtxt->m_pFilterList.get());
 				else
@@ -322,10 +500,10 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 			if (m_pByteCompare == nullptr)
 			{
 				m_pByteCompare.reset(new ByteCompare());
-				m_pByteCompare->SetCompareOptions(*m_pCtxt->GetCompareOptions(CMP_QUICK_CONTENT));
+				m_pByteCompare->SetCompareOptions(*m_pSnapshot->pQuickOptions);
 
-				m_pByteCompare->SetAdditionalOptions(m_pCtxt->m_bStopAfterFirstDiff);
-				m_pByteCompare->SetAbortable(m_pCtxt->GetAbortable());
+				m_pByteCompare->SetAdditionalOptions(m_pSnapshot->bStopAfterFirstDiff);
+				m_pByteCompare->SetAbortable(m_pSnapshot->piAbortable);
 			}
 			if (tFiles.GetSize() == 2)
 			{
@@ -425,16 +603,21 @@ exitPrepAndCompare:
 		if (nDirs > 2 && filepathUnpacked[2] != tFiles[2] && !filepathUnpacked[2].empty())
 			try { TFile(filepathUnpacked[2]).remove(); } catch (...) { LogErrorString(strutils::format(_T("DeleteFile(%s) failed"), filepathUnpacked[2])); }
 
+		if (m_pSnapshot->bPlugins)
+			KeepResolvedPluginInfos(filteredFilenames, infoUnpacker);
+
 		// When comparing empty file and nonexistent file, `DIFFCODE::SAME` flag is set to the variable `code`, so change the flag to `DIFFCODE::DIFF`
 		// Also when disabling ignore codepage option and the encodings of files are not equal, change the flag to `DIFFCODE::DIFF even if  `DIFFCODE::SAME` flag is set to the variable `code`
-		if (!di.diffcode.existAll() || (!m_pCtxt->m_bIgnoreCodepage && !std::equal(encoding + 1, encoding + nDirs, encoding)))
+		if (!di.diffcode.existAll() || (!m_pSnapshot->bIgnoreCodepage && !std::equal(encoding + 1, encoding + nDirs, encoding)))
 			code = (code & ~DIFFCODE::COMPAREFLAGS) | DIFFCODE::DIFF;
 	}
 	else if (nCompMethod == CMP_BINARY_CONTENT)
 	{
 		if (m_pBinaryCompare == nullptr)
+		{
 			m_pBinaryCompare.reset(new BinaryCompare());
-		m_pBinaryCompare->SetAbortable(m_pCtxt->GetAbortable());
+			m_pBinaryCompare->SetAbortable(m_pSnapshot->piAbortable);
+		}
 		PathContext tFiles;
 		m_pCtxt->GetComparePaths(di, tFiles);
 		code = m_pBinaryCompare->CompareFiles(tFiles, di);
@@ -442,17 +625,19 @@ exitPrepAndCompare:
 	else if (nCompMethod == CMP_DATE || nCompMethod == CMP_DATE_SIZE || nCompMethod == CMP_SIZE)
 	{
 		if (m_pTimeSizeCompare == nullptr)
+		{
 			m_pTimeSizeCompare.reset(new TimeSizeCompare());
-
-		m_pTimeSizeCompare->SetAdditionalOptions(m_pCtxt->m_bIgnoreSmallTimeDiff);
-		code = m_pTimeSizeCompare->CompareFiles(nCompMethod, m_pCtxt->GetCompareDirs(), di);
+			m_pTimeSizeCompare->SetAdditionalOptions(m_pSnapshot->bIgnoreSmallTimeDiff);
+		}
+		code = m_pTimeSizeCompare->CompareFiles(nCompMethod, nDirs, di);
 	}
 	else if (nCompMethod == CMP_IMAGE_CONTENT)
 	{
 		if (!m_pImageCompare)
 		{
 			m_pImageCompare.reset(new ImageCompare());
-			m_pImageCompare->SetColorDistanceThreshold(m_pCtxt->m_dColorDistanceThreshold);
+			m_pImageCompare->SetColorDistanceThreshold(m_pSnapshot->dColorDistanceThreshold);
+			m_pImageCompare->SetAbortable(m_pSnapshot->piAbortable);
 		}
 
 		PathContext tFiles;
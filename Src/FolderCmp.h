@@ -6,6 +6,8 @@
 #pragma once
 
 #include <memory>
+#include <tuple>
+#include <vector>
 #include "DiffFileData.h"
 #include "Wrap_DiffUtils.h"
 #include "ByteCompare.h"
@@ -13,10 +15,12 @@
 #include "TimeSizeCompare.h"
 #include "ImageCompare.h"
 #include "PathContext.h"
+#include "DiffContext.h"
+#include "FileTransform.h"
 
-class CDiffContext;
-class PackingInfo;
-class PrediffingInfo;
+class CompareOptions;
+class DiffutilsOptions;
+class QuickCompareOptions;
 
 /**
  * @brief Holds plugin-related paths and information.
@@ -30,16 +34,52 @@ struct PluginsContext
 	PrediffingInfo * infoPrediffer;
 };
 
+/**
+ * @brief Settings of a folder compare read by FolderCmp for each item.
+ *
+ * The settings are copied from CDiffContext once, before the compare
+ * threads start, and the FolderCmp instances of all threads then read them
+ * without locking. Plugin infos set for particular files are looked up in a
+ * copy of the plugin table taken at the same time.
+ */
+struct FolderCmpSnapshot
+{
+	explicit FolderCmpSnapshot(CDiffContext *pCtxt);
+	const CompareOptions *GetCompareOptions(int compareMethod) const;
+
+	int nCompMethod;
+	int nDirs;
+	const DiffutilsOptions *pContentOptions; /**< Owned by the context */
+	const QuickCompareOptions *pQuickOptions; /**< Owned by the context */
+	bool bCanUseStreamingDiff;
+	int nQuickCompareLimit;
+	int nBinaryCompareLimit;
+	int nTranscodeInMemoryLimit;
+	int nStreamingDiffMemoryLimit;
+	int iGuessEncodingType;
+	bool bStopAfterFirstDiff;
+	bool bIgnoreCodepage;
+	bool bEnableImageCompare;
+	double dColorDistanceThreshold;
+	bool bIgnoreSmallTimeDiff;
+	bool bPlugins; /**< Are plugin infos provided? */
+	bool bAutoUnpacking; /**< Default unpacker of files not in pluginInfos */
+	bool bAutoPrediffing; /**< Default prediffer of files not in pluginInfos */
+	IPluginInfos::PluginInfoTable pluginInfos;
+	const IAbortable *piAbortable;
+};
+
 /**
  * @brief Class implementing file compare for folder compare.
  * This class implements (called from DirScan.cpp) compare of two files
  * during folder compare. The class implements both diffutils compare and
- * quick compare.
+ * quick compare. Compare engines are created on first use and reused for
+ * all items compared by the instance.
  */
 class FolderCmp
 {
 public:
-	explicit FolderCmp(CDiffContext *pCtxt);
+	explicit FolderCmp(CDiffContext *pCtxt, std::shared_ptr<const FolderCmpSnapshot> pSnapshot = nullptr);
 	~FolderCmp();
 	bool RunPlugins(PluginsContext * plugCtxt, String &errStr);
 	void CleanupAfterPlugins(PluginsContext *plugCtxt);
@@ -52,6 +92,14 @@ public:
 	CDiffContext *const m_pCtxt;
 
 private:
+	void GetPluginInfos(const String& filteredFilenames, PackingInfo *& infoUnpacker, PrediffingInfo *& infoPrediffer);
+	void KeepResolvedPluginInfos(const String& filteredFilenames, const PackingInfo *infoUnpacker);
+
+	std::shared_ptr<const FolderCmpSnapshot> m_pSnapshot;
+	PackingInfo m_infoUnpacker; /**< Unpacker of files not in the snapshot plugin table */
+	PrediffingInfo m_infoPrediffer; /**< Prediffer of files not in the snapshot plugin table */
+	/** Plugin infos resolved for files not in the snapshot plugin table, stored when done */
+	std::vector<std::tuple<String, PackingInfo, PrediffingInfo>> m_resolvedPluginInfos;
 	std::unique_ptr<CompareEngines::DiffUtils> m_pDiffUtilsEngine;
 	std::unique_ptr<CompareEngines::ByteCompare> m_pByteCompare;
 	std::unique_ptr<CompareEngines::BinaryCompare> m_pBinaryCompare;
@@ -1,69 +1,358 @@
-/** 
+/**
  * @file  HashCalc.cpp
  *
  * @brief Implementation file for HashCalc
  */
 #include "pch.h"
 #include "HashCalc.h"
-
-#ifdef _WIN64
+#include <cstring>
+#include <Poco/Exception.h>
+#include <Poco/FileStream.h>
+#include "unicoder.h"
+#ifdef _WIN32
+#include <Windows.h>
+#include <bcrypt.h>
 
 #pragma comment(lib, "bcrypt.lib")
- 
-static NTSTATUS CalculateHashValue(HANDLE hFile, BCRYPT_HASH_HANDLE hHash, ULONG hashSize, std::vector<uint8_t>& hash)
+#else
+#include <Poco/MD5Engine.h>
+#include <Poco/SHA1Engine.h>
+#include <Poco/SHA2Engine.h>
+#endif
+
+using Poco::FileInputStream;
+
+/** @brief Bytes read from a file at once. */
+static constexpr unsigned ReadBufferSize = 1024 * 1024;
+
+/**
+ * @brief Computes the digest of one algorithm.
+ */
+class HashCalculator::Engine
+{
+public:
+	virtual ~Engine() = default;
+	virtual void Update(const void *data, size_t size) = 0;
+	virtual HashDigest Finish() = 0;
+};
+
+namespace
 {
-	hash.resize(hashSize);
-	std::vector<uint8_t> buffer(64 * 1024);
-	NTSTATUS status = 0;
-	while (status == 0)
+
+#ifdef _WIN32
+
+/**
+ * @brief Return the CNG provider of an algorithm.
+ * Providers are opened once and kept for the process lifetime, as opening
+ * them is slow and their handles can be used by several threads.
+ */
+static BCRYPT_ALG_HANDLE GetAlgorithmProvider(HashAlgorithm algorithm)
+{
+	static const BCRYPT_ALG_HANDLE providers[] = {
+		[] { BCRYPT_ALG_HANDLE hAlg = nullptr; BCryptOpenAlgorithmProvider(&hAlg, BCRYPT_MD5_ALGORITHM, nullptr, 0); return hAlg; }(),
+		[] { BCRYPT_ALG_HANDLE hAlg = nullptr; BCryptOpenAlgorithmProvider(&hAlg, BCRYPT_SHA1_ALGORITHM, nullptr, 0); return hAlg; }(),
+		[] { BCRYPT_ALG_HANDLE hAlg = nullptr; BCryptOpenAlgorithmProvider(&hAlg, BCRYPT_SHA256_ALGORITHM, nullptr, 0); return hAlg; }(),
+	};
+	return providers[static_cast<int>(algorithm)];
+}
+
+/**
+ * @brief Engine using Windows CNG, which uses the hash instructions of the
+ * processor when there are some.
+ */
+class BCryptEngine : public HashCalculator::Engine
+{
+public:
+	explicit BCryptEngine(BCRYPT_ALG_HANDLE hAlg) : m_hHash(nullptr), m_hashSize(0), m_status(1) // STATUS_UNSUCCESSFUL
 	{
-		DWORD dwRead = 0;
-		if (!ReadFile(hFile, buffer.data(), static_cast<DWORD>(buffer.size()), &dwRead, nullptr))
+		if (hAlg == nullptr)
+			return;
+		ULONG bytesWritten = 0;
+		ULONG objectSize = 0;
+		m_status = BCryptGetProperty(hAlg, BCRYPT_OBJECT_LENGTH, reinterpret_cast<PUCHAR>(&objectSize), sizeof(DWORD), &bytesWritten, 0);
+		if (m_status == 0)
+			m_status = BCryptGetProperty(hAlg, BCRYPT_HASH_LENGTH, reinterpret_cast<PUCHAR>(&m_hashSize), sizeof(DWORD), &bytesWritten, 0);
+		if (m_status == 0 && m_hashSize > HashDigest::MaxSize)
+			m_status = 1;
+		if (m_status == 0)
 		{
-			status = 1; // STATUS_UNSUCCESSFUL
-			hash.clear();
-			break;
+			m_hashObject.resize(objectSize);
+			m_status = BCryptCreateHash(hAlg, &m_hHash, m_hashObject.data(), static_cast<ULONG>(m_hashObject.size()), nullptr, 0, 0);
 		}
-		status = BCryptHashData(hHash, buffer.data(), dwRead, 0);
-		if (buffer.size() != dwRead)
-			break;
 	}
-	if (status == 0)
+
+	~BCryptEngine()
+	{
+		if (m_hHash != nullptr)
+			BCryptDestroyHash(m_hHash);
+	}
+
+	void Update(const void *data, size_t size) override
+	{
+		if (m_status == 0)
+			m_status = BCryptHashData(m_hHash, static_cast<PUCHAR>(const_cast<void *>(data)), static_cast<ULONG>(size), 0);
+	}
+
+	HashDigest Finish() override
+	{
+		uint8_t digest[HashDigest::MaxSize];
+		if (m_status == 0)
+			m_status = BCryptFinishHash(m_hHash, digest, m_hashSize, 0);
+		return m_status == 0 ? HashDigest(digest, m_hashSize) : HashDigest();
+	}
+
+private:
+	std::vector<uint8_t> m_hashObject;
+	BCRYPT_HASH_HANDLE m_hHash;
+	ULONG m_hashSize;
+	NTSTATUS m_status;
+};
+
+#else
+
+/**
+ * @brief Engine using a Poco digest engine.
+ */
+class PocoEngine : public HashCalculator::Engine
+{
+public:
+	explicit PocoEngine(Poco::DigestEngine *pEngine) : m_pEngine(pEngine) {}
+
+	void Update(const void *data, size_t size) override
+	{
+		m_pEngine->update(data, size);
+	}
+
+	HashDigest Finish() override
 	{
-		status = BCryptFinishHash(hHash, hash.data(), static_cast<ULONG>(hash.size()), 0);
+		const Poco::DigestEngine::Digest& digest = m_pEngine->digest();
+		return HashDigest(digest.data(), digest.size());
 	}
-	return status;
+
+private:
+	std::unique_ptr<Poco::DigestEngine> m_pEngine;
+};
+
+#endif
+
+/**
+ * @brief Engine computing XXH64 digests.
+ * XXH64 is much faster than cryptographic digests, which makes it suited to
+ * find duplicate files. The digest is stored big endian, as printed by
+ * xxhsum.
+ */
+class XXH64Engine : public HashCalculator::Engine
+{
+public:
+	XXH64Engine()
+		: m_acc{ Prime1 + Prime2, Prime2, 0, 0 - Prime1 }
+		, m_totalSize(0)
+		, m_bufferSize(0)
+	{
+	}
+
+	void Update(const void *data, size_t size) override
+	{
+		const uint8_t *p = static_cast<const uint8_t *>(data);
+		const uint8_t *const end = p + size;
+		m_totalSize += size;
+		if (m_bufferSize + size < StripeSize)
+		{
+			std::memcpy(m_buffer + m_bufferSize, p, size);
+			m_bufferSize += size;
+			return;
+		}
+		if (m_bufferSize > 0)
+		{
+			size_t fill = StripeSize - m_bufferSize;
+			std::memcpy(m_buffer + m_bufferSize, p, fill);
+			ProcessStripe(m_buffer);
+			p += fill;
+			m_bufferSize = 0;
+		}
+		for (; p + StripeSize <= end; p += StripeSize)
+			ProcessStripe(p);
+		m_bufferSize = end - p;
+		std::memcpy(m_buffer, p, m_bufferSize);
+	}
+
+	HashDigest Finish() override
+	{
+		uint64_t h;
+		if (m_totalSize >= StripeSize)
+		{
+			h = RotateLeft(m_acc[0], 1) + RotateLeft(m_acc[1], 7) + RotateLeft(m_acc[2], 12) + RotateLeft(m_acc[3], 18);
+			for (uint64_t acc : m_acc)
+				h = (h ^ Round(0, acc)) * Prime1 + Prime4;
+		}
+		else
+			h = Prime5;
+		h += m_totalSize;
+
+		const uint8_t *p = m_buffer;
+		const uint8_t *const end = m_buffer + m_bufferSize;
+		for (; p + 8 <= end; p += 8)
+			h = RotateLeft(h ^ Round(0, Read64(p)), 27) * Prime1 + Prime4;
+		if (p + 4 <= end)
+		{
+			h = RotateLeft(h ^ (Read32(p) * Prime1), 23) * Prime2 + Prime3;
+			p += 4;
+		}
+		for (; p < end; ++p)
+			h = RotateLeft(h ^ (*p * Prime5), 11) * Prime1;
+
+		h ^= h >> 33;
+		h *= Prime2;
+		h ^= h >> 29;
+		h *= Prime3;
+		h ^= h >> 32;
+
+		uint8_t digest[8];
+		for (int i = 0; i < 8; ++i)
+			digest[i] = static_cast<uint8_t>(h >> (56 - 8 * i));
+		return HashDigest(digest, sizeof(digest));
+	}
+
+private:
+	static constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+	static constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+	static constexpr uint64_t Prime3 = 0x165667B19E3779F9ULL;
+	static constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+	static constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+	static constexpr size_t StripeSize = 32;
+
+	static uint64_t RotateLeft(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+	static uint64_t Round(uint64_t acc, uint64_t input) { return RotateLeft(acc + input * Prime2, 31) * Prime1; }
+
+	static uint64_t Read64(const uint8_t *p)
+	{
+		uint64_t v = 0;
+		for (int i = 7; i >= 0; --i)
+			v = (v << 8) | p[i];
+		return v;
+	}
+
+	static uint64_t Read32(const uint8_t *p)
+	{
+		return static_cast<uint64_t>(p[0]) | (static_cast<uint64_t>(p[1]) << 8) |
+			(static_cast<uint64_t>(p[2]) << 16) | (static_cast<uint64_t>(p[3]) << 24);
+	}
+
+	void ProcessStripe(const uint8_t *p)
+	{
+		for (int i = 0; i < 4; ++i)
+			m_acc[i] = Round(m_acc[i], Read64(p + 8 * i));
+	}
+
+	uint64_t m_acc[4];
+	uint64_t m_totalSize;
+	uint8_t m_buffer[StripeSize];
+	size_t m_bufferSize;
+};
+
 }
 
-NTSTATUS CalculateHashValue(HANDLE hFile, const wchar_t *pAlgoId, std::vector<uint8_t>& hash)
+HashDigest::HashDigest(const uint8_t *data, size_t size)
+	: m_size(static_cast<uint8_t>(size < MaxSize ? size : MaxSize))
+{
+	std::memcpy(m_bytes.data(), data, m_size);
+}
+
+bool HashDigest::operator==(const HashDigest& other) const
+{
+	return m_size == other.m_size && std::memcmp(m_bytes.data(), other.m_bytes.data(), m_size) == 0;
+}
+
+/**
+ * @brief Return the first bytes of a digest, which are already evenly
+ * distributed.
+ */
+size_t HashDigest::Hasher::operator()(const HashDigest& digest) const
 {
-	hash.clear();
-	BCRYPT_ALG_HANDLE hAlg = nullptr;
-	NTSTATUS status = BCryptOpenAlgorithmProvider(&hAlg, pAlgoId, nullptr, 0);
-	if (status == 0)
+	size_t value = digest.size();
+	std::memcpy(&value, digest.data(), sizeof(value) < digest.size() ? sizeof(value) : digest.size());
+	return value;
+}
+
+HashCalculator::HashCalculator(const std::vector<HashAlgorithm>& algorithms)
+{
+	for (HashAlgorithm algorithm : algorithms)
 	{
-		ULONG bytesWritten = 0;
-		ULONG objectSize = 0;
-		status = BCryptGetProperty(hAlg, BCRYPT_OBJECT_LENGTH, reinterpret_cast<PUCHAR>(&objectSize), sizeof(DWORD), &bytesWritten, 0);
-		if (status == 0)
+		switch (algorithm)
 		{
-			std::vector<uint8_t> hashObject(objectSize);
-			BCRYPT_HASH_HANDLE hHash = nullptr;
-			status = BCryptCreateHash(hAlg, &hHash, hashObject.data(), static_cast<ULONG>(hashObject.size()), nullptr, 0, 0);
-			if (status == 0)
-			{
-				ULONG hashSize = 0;
-				status = BCryptGetProperty(hAlg, BCRYPT_HASH_LENGTH, reinterpret_cast<PUCHAR>(&hashSize), sizeof(DWORD), &bytesWritten, 0);
-				if (status == 0)
-				{
-					status = CalculateHashValue(hFile, hHash, hashSize, hash);
-				}
-				BCryptDestroyHash(hHash);
-			}
+#ifdef _WIN32
+		case HashAlgorithm::MD5:
+		case HashAlgorithm::SHA1:
+		case HashAlgorithm::SHA256:
+			m_engines.emplace_back(new BCryptEngine(GetAlgorithmProvider(algorithm)));
+			break;
+#else
+		case HashAlgorithm::MD5:
+			m_engines.emplace_back(new PocoEngine(new Poco::MD5Engine()));
+			break;
+		case HashAlgorithm::SHA1:
+			m_engines.emplace_back(new PocoEngine(new Poco::SHA1Engine()));
+			break;
+		case HashAlgorithm::SHA256:
+			m_engines.emplace_back(new PocoEngine(new Poco::SHA2Engine(Poco::SHA2Engine::SHA_256)));
+			break;
+#endif
+		case HashAlgorithm::XXH64:
+			m_engines.emplace_back(new XXH64Engine());
+			break;
 		}
-		BCryptCloseAlgorithmProvider(hAlg, 0);
 	}
-	return status;
 }
 
-#endif
\ No newline at end of file
+HashCalculator::~HashCalculator() = default;
+
+/**
+ * @brief Add data to the digests of all algorithms.
+ */
+void HashCalculator::Update(const void *data, size_t size)
+{
+	for (auto& pEngine : m_engines)
+		pEngine->Update(data, size);
+}
+
+/**
+ * @brief Return the digests, in the order of the algorithms.
+ */
+std::vector<HashDigest> HashCalculator::Finish()
+{
+	std::vector<HashDigest> digests;
+	digests.reserve(m_engines.size());
+	for (auto& pEngine : m_engines)
+		digests.push_back(pEngine->Finish());
+	return digests;
+}
+
+/**
+ * @brief Compute the digests of a file for several algorithms.
+ * The file is read once, in large blocks, whatever the number of algorithms.
+ * @param [in] path File to read.
+ * @param [in] algorithms Algorithms of the digests.
+ * @param [out] digests Digests in the order of @p algorithms, empty digests
+ *  if the file could not be read.
+ * @return true if the file was read.
+ */
+bool CalculateHashValues(const String& path, const std::vector<HashAlgorithm>& algorithms, std::vector<HashDigest>& digests)
+{
+	digests.assign(algorithms.size(), HashDigest());
+	HashCalculator calculator(algorithms);
+	try
+	{
+		FileInputStream fin(ucr::toUTF8(path), std::ios::in | std::ios::binary);
+		std::vector<char> buffer(ReadBufferSize);
+		while (fin.read(buffer.data(), ReadBufferSize) || fin.gcount() > 0)
+			calculator.Update(buffer.data(), static_cast<size_t>(fin.gcount()));
+		if (fin.bad())
+			return false;
+	}
+	catch (Poco::Exception&)
+	{
+		return false;
+	}
+	digests = calculator.Finish();
+	return true;
+}
@@ -1,11 +1,71 @@
-/** 
+/**
  * @file  HashCalc.h
  *
  * @brief Declaration file for HashCalc
  */
 #pragma once
 
-#include <Windows.h>
+#include <array>
+#include <cstdint>
+#include <memory>
 #include <vector>
+#include "UnicodeString.h"
 
-NTSTATUS CalculateHashValue(HANDLE hFile, const wchar_t* pAlgoId, std::vector<uint8_t>& hash);
+/**
+ * @brief Digest algorithms of the hash properties.
+ */
+enum class HashAlgorithm
+{
+	MD5,
+	SHA1,
+	SHA256,
+	XXH64, /**< Fast non-cryptographic digest, for finding duplicate files */
+};
+
+/**
+ * @brief Digest of any HashAlgorithm.
+ * The bytes are stored inline, so digests are compared and used as keys of
+ * unordered containers without allocating.
+ */
+class HashDigest
+{
+public:
+	static constexpr size_t MaxSize = 32;
+
+	/** @brief Hash function of unordered containers. */
+	struct Hasher
+	{
+		size_t operator()(const HashDigest& digest) const;
+	};
+
+	HashDigest() = default;
+	HashDigest(const uint8_t *data, size_t size);
+	const uint8_t *data() const { return m_bytes.data(); }
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+	bool operator==(const HashDigest& other) const;
+	bool operator!=(const HashDigest& other) const { return !(*this == other); }
+
+private:
+	std::array<uint8_t, MaxSize> m_bytes{};
+	uint8_t m_size = 0;
+};
+
+/**
+ * @brief Computes the digests of several algorithms in one pass over data.
+ */
+class HashCalculator
+{
+public:
+	class Engine;
+
+	explicit HashCalculator(const std::vector<HashAlgorithm>& algorithms);
+	~HashCalculator();
+	void Update(const void *data, size_t size);
+	std::vector<HashDigest> Finish();
+
+private:
+	std::vector<std::unique_ptr<Engine>> m_engines;
+};
+
+bool CalculateHashValues(const String& path, const std::vector<HashAlgorithm>& algorithms, std::vector<HashDigest>& digests);
@@ -58,6 +58,7 @@
 #include "TestMain.h"
 #include "charsets.h" // For shutdown cleanup
 #include "OptionsProject.h"
+#include "PerfTrace.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -275,6 +276,11 @@ BOOL CMergeApp::InitInstance()
 
 	Options::Init(m_pOptions.get()); // Implementation in OptionsInit.cpp
 	ApplyCommandLineConfigOptions(cmdInfo);
+	if (!cmdInfo.m_sTraceFile.empty())
+	{
+		m_sTraceFile = cmdInfo.m_sTraceFile;
+		perftrace::Enable();
+	}
 	if (cmdInfo.m_sErrorMessages.size() > 0)
 	{
 		if (AttachConsole(ATTACH_PARENT_PROCESS))
@@ -302,6 +308,9 @@ BOOL CMergeApp::InitInstance()
 
 	int nSingleInstance = cmdInfo.m_nSingleInstance.has_value() ?
 		*cmdInfo.m_nSingleInstance : GetOptionsMgr()->GetInt(OPT_SINGLE_INSTANCE);
+	// A traced compare must run in this process
+	if (!m_sTraceFile.empty())
+		nSingleInstance = 0;
 
 	HANDLE hMutex = CreateMutexHandle();
 	if (hMutex != nullptr)
@@ -509,6 +518,9 @@ void CMergeApp::OnAppAbout()
  */
 int CMergeApp::ExitInstance()
 {
+	if (!m_sTraceFile.empty())
+		perftrace::Dump(m_sTraceFile);
+
 	charsets_cleanup();
 
 	//  Save registry keys if existing WinMerge.reg
@@ -172,6 +172,7 @@ private:
 	LONG m_nActiveOperations; /**< Active operations count. */
 	bool m_bMergingMode; /**< Merging or Edit mode */
 	bool m_bEnableExitCode;
+	String m_sTraceFile; /**< Chrome trace file written on exit, empty if tracing is off */
 	CFont m_fontGUI;
 	ATL::CImage m_imageForInitializingGdiplus;
 };
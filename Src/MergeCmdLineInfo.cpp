@@ -14,7 +14,7 @@
 #include "pch.h"
 #include "MergeCmdLineInfo.h"
 #include "Constants.h"
-#include "Paths.h"
+#include "paths.h"
 #include "OptionsDef.h"
 #include "unicoder.h"
 
@@ -164,7 +164,9 @@ void MergeCmdLineInfo::AddPath(const String &path)
 	{
 		// Convert paths given in Linux-style ('/' as separator) given from
 		// Cygwin to Windows style ('\' as separator)
+#ifdef _WIN32
 		strutils::replace(param, _T("/"), _T("\\"));
+#endif
 
 		// If shortcut, expand it first
 		if (paths::IsShortcut(param))
@@ -527,6 +529,16 @@ void MergeCmdLineInfo::ParseWinMergeCmdLine(const TCHAR *q)
 		{
 			q = EatParam(q, m_sIniFilepath);
 		}
+		else if (param == _T("trace"))
+		{
+			// -trace "tracefilename" - write the timings of the compare phases as a Chrome trace
+			q = EatParam(q, m_sTraceFile);
+		}
+		else if (param == _T("snapshot"))
+		{
+			// -snapshot "snapshotfilename" - load and save the folder compare results
+			q = EatParam(q, m_sSnapshotFile);
+		}
 		else
 		{
 			m_sErrorMessages.emplace_back(_T("Unknown option '/") + param + _T("'"));
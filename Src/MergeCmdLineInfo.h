@@ -102,6 +102,10 @@ public:
 
 	String m_sIniFilepath;
 
+	String m_sTraceFile; /**< Chrome trace file to write the timings of the compare phases to. */
+
+	String m_sSnapshotFile; /**< Snapshot file to load the folder compare results from and save them to. */
+
 	PathContext m_Files; /**< Files (or directories) to compare. */
 
 	std::map<String, String> m_Options;
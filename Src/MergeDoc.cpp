@@ -15,6 +15,7 @@
 #include "MergeDoc.h"
 #include <io.h>
 #include <Poco/Timestamp.h>
+#include <Poco/Environment.h>
 #include "UnicodeString.h"
 #include "Merge.h"
 #include "MainFrm.h"
@@ -54,6 +55,7 @@
 #include "charsets.h"
 #include "markdown.h"
 #include "stringdiffs.h"
+#include "PerfTrace.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -174,6 +176,13 @@ CMergeDoc::CMergeDoc()
 	m_bInvertDiffContext = GetOptionsMgr()->GetBool(OPT_INVERT_DIFF_CONTEXT);
 
 	m_diffWrapper.SetDetectMovedBlocks(GetOptionsMgr()->GetBool(OPT_CMP_MOVED_BLOCKS));
+	// Only one file pair is compared at a time here, so big files may be split
+	// between threads. The split regions may align differently than a diff of
+	// the whole file, so it is off unless enabled.
+	int nDiffThreads = GetOptionsMgr()->GetInt(OPT_CMP_DIFF_THREADS);
+	if (nDiffThreads == 0)
+		nDiffThreads = static_cast<int>(Poco::Environment::processorCount());
+	m_diffWrapper.SetThreadCount(nDiffThreads);
 	Options::DiffOptions::Load(GetOptionsMgr(), options);
 
 	m_diffWrapper.SetOptions(&options);
@@ -318,6 +327,7 @@ static void SaveBuffForDiff(CDiffTextBuffer & buf, const String& filepath, int n
 int CMergeDoc::Rescan(bool &bBinary, IDENTLEVEL &identical,
 		bool bForced /* =false */)
 {
+	PERFTRACE_SCOPE("CMergeDoc::Rescan");
 	DIFFOPTIONS diffOptions = {0};
 	DiffFileInfo fileInfo;
 	bool diffSuccess = false;
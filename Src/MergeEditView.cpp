@@ -639,7 +639,8 @@ std::vector<TEXTBLOCK> CMergeEditView::GetAdditionalTextBlocks (int nLineIndex)
 	if ((dwLineFlags & LF_SNP) == LF_SNP || (dwLineFlags & LF_DIFF) != LF_DIFF || (dwLineFlags & LF_MOVED) == LF_MOVED)
 		return emptyBlocks;
 
-	if (!GetOptionsMgr()->GetBool(OPT_WORDDIFF_HIGHLIGHT))
+	static const OptionHandle hWordDiffHighlight = COptionsMgr::GetHandle(OPT_WORDDIFF_HIGHLIGHT);
+	if (!GetOptionsMgr()->GetBool(hWordDiffHighlight))
 		return emptyBlocks;
 
 	CMergeDoc *pDoc = GetDocument();
@@ -769,6 +770,7 @@ void CMergeEditView::GetLineColors2(int nLineIndex, DWORD ignoreFlags, COLORREF
 	if (GetLineCount() <= nLineIndex)
 		return;
 
+	static const OptionHandle hSyntaxHighlight = COptionsMgr::GetHandle(OPT_SYNTAX_HIGHLIGHT);
 	DWORD dwLineFlags = GetLineFlags(nLineIndex);
 
 	if (dwLineFlags & ignoreFlags)
@@ -791,7 +793,7 @@ void CMergeEditView::GetLineColors2(int nLineIndex, DWORD ignoreFlags, COLORREF
 		else
 		{
 			// If no syntax hilighting
-			if (!GetOptionsMgr()->GetBool(OPT_SYNTAX_HIGHLIGHT))
+			if (!GetOptionsMgr()->GetBool(hSyntaxHighlight))
 			{
 				crBkgnd = GetColor (COLORINDEX_BKGND);
 				crText = GetColor (COLORINDEX_NORMALTEXT);
@@ -902,7 +904,7 @@ void CMergeEditView::GetLineColors2(int nLineIndex, DWORD ignoreFlags, COLORREF
 	else
 	{
 		// Line not inside diff,
-		if (!GetOptionsMgr()->GetBool(OPT_SYNTAX_HIGHLIGHT))
+		if (!GetOptionsMgr()->GetBool(hSyntaxHighlight))
 		{
 			// If no syntax hilighting, get windows default colors
 			crBkgnd = GetColor (COLORINDEX_BKGND);
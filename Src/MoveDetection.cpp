@@ -0,0 +1,501 @@
+/**
+ * @file  MoveDetection.cpp
+ *
+ * @brief Pairs the files of a folder compare which were moved or renamed.
+ *
+ * Files found in one folder only are paired with files found in the other
+ * folder only by their contents, never by comparing every file with every
+ * other. Identical files are found with hash indexes of decreasing cost:
+ * files are grouped by size, groups with files of both sides by a digest of
+ * the first block, and the remaining groups by a digest of the whole file.
+ * Most files are never read, and most of the others only once.
+ *
+ * Text files which were also edited are paired by similarity: each file is
+ * summarized by the smallest hashes of its distinct lines (a bottom-k
+ * MinHash sketch), which estimates the share of lines two files have in
+ * common. Candidates are found through an index of these hashes, skipping
+ * the hashes of lines found in many files, like blank lines or braces.
+ */
+#include "pch.h"
+#include "MoveDetection.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <io.h>
+#include <fcntl.h>
+#include <Poco/Runnable.h>
+#include <Poco/ThreadPool.h>
+#include "DiffItemList.h"
+#include "PathContext.h"
+#include "IAbortable.h"
+#include "HashCalc.h"
+#include "TFile.h"
+#include "paths.h"
+
+namespace
+{
+
+/** @brief Bytes of the digest grouping files of the same size, also read to tell binary files. */
+constexpr unsigned PrefixSize = 4096;
+/** @brief Largest text file paired by similarity. */
+constexpr int64_t SimilarityMaxSize = 1024 * 1024;
+/** @brief Number of line hashes in the sketch of a text file. */
+constexpr size_t SketchSize = 32;
+/** @brief Line hashes found in more files than this do not find candidates. */
+constexpr size_t MaxPostings = 64;
+
+/** @brief A file found in one side only. */
+struct Candidate
+{
+	DIFFITEM *pdi;
+	int side;
+	int64_t size;
+	String path;
+	String filename;
+	uint64_t prefixDigest = 0;
+	uint64_t digest = 0;
+	bool bBinary = false;
+	bool bError = false; /**< File could not be read */
+	bool bPaired = false;
+	std::vector<uint64_t> sketch; /**< Sorted smallest hashes of distinct lines */
+
+	bool IsAvailable() const { return !bPaired && !bError; }
+};
+
+using Group = std::vector<size_t>;
+
+uint64_t ToUInt64(const HashDigest& digest)
+{
+	uint64_t value = 0;
+	for (size_t i = 0; i < digest.size() && i < sizeof(value); ++i)
+		value = (value << 8) | digest.data()[i];
+	return value;
+}
+
+/** @brief Spread the bits of a hash, so that the smallest hashes are a random sample. */
+uint64_t Mix(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xBF58476D1CE4E5B9ULL;
+	x ^= x >> 27;
+	x *= 0x94D049BB133111EBULL;
+	x ^= x >> 31;
+	return x;
+}
+
+/**
+ * @brief Read the first bytes of a file.
+ * @return false if the file could not be read.
+ */
+bool ReadFileHead(const String& path, size_t maxSize, std::vector<char>& buffer)
+{
+	buffer.resize(maxSize);
+	int fd = -1;
+	if (_tsopen_s(&fd, TFile(path).wpath().c_str(), O_BINARY | O_RDONLY | O_SEQUENTIAL, _SH_DENYNO, _S_IREAD) != 0)
+		return false;
+	size_t total = 0;
+	int size = 0;
+	while (total < maxSize && (size = _read(fd, buffer.data() + total, static_cast<unsigned>((std::min)(maxSize - total, size_t(1024 * 1024))))) > 0)
+		total += size;
+	_close(fd);
+	buffer.resize(total);
+	return size >= 0;
+}
+
+bool LooksBinary(const std::vector<char>& buffer)
+{
+	return std::find(buffer.begin(), buffer.begin() + (std::min)(buffer.size(), size_t(PrefixSize)), '\0') != buffer.begin() + (std::min)(buffer.size(), size_t(PrefixSize));
+}
+
+/**
+ * @brief Return the SketchSize smallest hashes of the distinct lines of a text.
+ * Lines are compared without their leading and trailing white space, and
+ * blank lines are ignored.
+ */
+std::vector<uint64_t> MakeSketch(const std::vector<char>& text)
+{
+	std::vector<uint64_t> hashes;
+	const char *p = text.data();
+	const char *const end = p + text.size();
+	while (p < end)
+	{
+		const char *eol = std::find(p, end, '\n');
+		const char *first = p;
+		const char *last = eol;
+		while (first < last && (*first == ' ' || *first == '\t'))
+			++first;
+		while (last > first && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r'))
+			--last;
+		if (first < last)
+			hashes.push_back(Mix(std::hash<std::string_view>()(std::string_view(first, last - first))));
+		p = eol < end ? eol + 1 : end;
+	}
+	std::sort(hashes.begin(), hashes.end());
+	hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+	if (hashes.size() > SketchSize)
+		hashes.resize(SketchSize);
+	return hashes;
+}
+
+/**
+ * @brief Estimate the share of distinct lines two texts have in common,
+ * from the smallest hashes of the lines of both texts.
+ */
+double EstimateSimilarity(const std::vector<uint64_t>& sketch1, const std::vector<uint64_t>& sketch2)
+{
+	size_t i = 0, j = 0, common = 0, n = 0;
+	for (; n < SketchSize && i < sketch1.size() && j < sketch2.size(); ++n)
+	{
+		if (sketch1[i] == sketch2[j])
+		{
+			++common;
+			++i;
+			++j;
+		}
+		else if (sketch1[i] < sketch2[j])
+			++i;
+		else
+			++j;
+	}
+	n += (std::min)(SketchSize - n, sketch1.size() - i + sketch2.size() - j);
+	return n > 0 ? static_cast<double>(common) / n : 0.0;
+}
+
+/**
+ * @brief Calls a function for each index of a range, on several threads.
+ */
+class IndexWorker : public Poco::Runnable
+{
+public:
+	IndexWorker(std::atomic_size_t& next, size_t count, const std::function<void(size_t)>& func, const IAbortable *piAbortable)
+		: m_next(next), m_count(count), m_func(func), m_piAbortable(piAbortable) {}
+	void run() override
+	{
+		for (size_t i = m_next++; i < m_count; i = m_next++)
+		{
+			if (m_piAbortable && m_piAbortable->ShouldAbort())
+				break;
+			m_func(i);
+		}
+	}
+private:
+	std::atomic_size_t& m_next;
+	size_t m_count;
+	const std::function<void(size_t)>& m_func;
+	const IAbortable *m_piAbortable;
+};
+
+void ParallelFor(size_t count, int nThreads, const IAbortable *piAbortable, const std::function<void(size_t)>& func)
+{
+	std::atomic_size_t next{ 0 };
+	nThreads = static_cast<int>((std::min)(static_cast<size_t>((std::max)(nThreads, 1)), count));
+	if (nThreads <= 1)
+	{
+		IndexWorker(next, count, func, piAbortable).run();
+		return;
+	}
+	Poco::ThreadPool threadPool(nThreads, nThreads);
+	std::vector<std::unique_ptr<IndexWorker>> workers;
+	for (int i = 0; i < nThreads; ++i)
+	{
+		workers.emplace_back(new IndexWorker(next, count, func, piAbortable));
+		threadPool.start(*workers.back());
+	}
+	threadPool.joinAll();
+}
+
+/**
+ * @brief Split groups of candidates by a key, keeping the groups which have
+ * candidates of both sides.
+ */
+template<class Key, class KeyFunc>
+std::vector<Group> SplitGroups(const std::vector<Candidate>& candidates, const std::vector<Group>& groups, KeyFunc key)
+{
+	std::vector<Group> result;
+	std::unordered_map<Key, std::pair<Group, int>> subgroups;
+	for (const auto& group : groups)
+	{
+		subgroups.clear();
+		for (size_t i : group)
+		{
+			auto& subgroup = subgroups[key(candidates[i])];
+			subgroup.first.push_back(i);
+			subgroup.second |= 1 << candidates[i].side;
+		}
+		for (auto& subgroup : subgroups)
+		{
+			if (subgroup.second.second == 3)
+				result.push_back(std::move(subgroup.second.first));
+		}
+	}
+	return result;
+}
+
+/**
+ * @brief Pair the candidates of a group of identical files, files with the
+ * same name first.
+ */
+void PairIdenticalFiles(std::vector<Candidate>& candidates, const Group& group, std::vector<MovedItem>& moved)
+{
+	std::vector<size_t> lefts, rights;
+	std::unordered_map<String, std::vector<size_t>> rightsByName;
+	for (size_t i : group)
+	{
+		if (!candidates[i].IsAvailable())
+			continue;
+		if (candidates[i].side == 0)
+			lefts.push_back(i);
+		else
+		{
+			rights.push_back(i);
+			rightsByName[candidates[i].filename].push_back(i);
+		}
+	}
+	auto pair = [&](size_t l, size_t r) {
+		candidates[l].bPaired = candidates[r].bPaired = true;
+		moved.push_back({ { candidates[l].pdi, candidates[r].pdi }, true, candidates[l].bBinary });
+	};
+	for (size_t l : lefts)
+	{
+		auto it = rightsByName.find(candidates[l].filename);
+		if (it == rightsByName.end())
+			continue;
+		auto itRight = std::find_if(it->second.begin(), it->second.end(),
+			[&](size_t r) { return !candidates[r].bPaired; });
+		if (itRight != it->second.end())
+			pair(l, *itRight);
+	}
+	auto itRight = rights.begin();
+	for (size_t l : lefts)
+	{
+		if (candidates[l].bPaired)
+			continue;
+		itRight = std::find_if(itRight, rights.end(), [&](size_t r) { return !candidates[r].bPaired; });
+		if (itRight == rights.end())
+			break;
+		pair(l, *itRight);
+	}
+}
+
+void FindIdenticalFiles(std::vector<Candidate>& candidates, const MoveDetectionOptions& options, std::vector<MovedItem>& moved)
+{
+	Group all;
+	for (size_t i = 0; i < candidates.size(); ++i)
+	{
+		// All empty files are identical, they tell nothing about moves
+		if (candidates[i].size > 0)
+			all.push_back(i);
+	}
+	std::vector<Group> sizeGroups = SplitGroups<int64_t>(candidates, { all },
+		[](const Candidate& c) { return c.size; });
+
+	Group toRead;
+	for (const auto& group : sizeGroups)
+		toRead.insert(toRead.end(), group.begin(), group.end());
+	ParallelFor(toRead.size(), options.nThreads, options.piAbortable, [&](size_t n) {
+		Candidate& c = candidates[toRead[n]];
+		std::vector<char> buffer;
+		if (!ReadFileHead(c.path, PrefixSize, buffer))
+		{
+			c.bError = true;
+			return;
+		}
+		HashCalculator calculator({ HashAlgorithm::XXH64 });
+		calculator.Update(buffer.data(), buffer.size());
+		c.prefixDigest = ToUInt64(calculator.Finish()[0]);
+		c.digest = c.prefixDigest;
+		c.bBinary = LooksBinary(buffer);
+	});
+	if (options.piAbortable && options.piAbortable->ShouldAbort())
+		return;
+
+	std::vector<Group> prefixGroups = SplitGroups<uint64_t>(candidates, sizeGroups,
+		[](const Candidate& c) { return c.prefixDigest; });
+
+	toRead.clear();
+	for (const auto& group : prefixGroups)
+	{
+		for (size_t i : group)
+		{
+			if (candidates[i].size > PrefixSize && !candidates[i].bError)
+				toRead.push_back(i);
+		}
+	}
+	ParallelFor(toRead.size(), options.nThreads, options.piAbortable, [&](size_t n) {
+		Candidate& c = candidates[toRead[n]];
+		std::vector<HashDigest> digests;
+		if (CalculateHashValues(c.path, { HashAlgorithm::XXH64 }, digests))
+			c.digest = ToUInt64(digests[0]);
+		else
+			c.bError = true;
+	});
+	if (options.piAbortable && options.piAbortable->ShouldAbort())
+		return;
+
+	for (const auto& group : SplitGroups<uint64_t>(candidates, prefixGroups, [](const Candidate& c) { return c.digest; }))
+		PairIdenticalFiles(candidates, group, moved);
+}
+
+void FindSimilarFiles(std::vector<Candidate>& candidates, const MoveDetectionOptions& options, std::vector<MovedItem>& moved)
+{
+	Group toRead;
+	for (size_t i = 0; i < candidates.size(); ++i)
+	{
+		const Candidate& c = candidates[i];
+		if (c.IsAvailable() && !c.bBinary && c.size > 0 && c.size <= SimilarityMaxSize)
+			toRead.push_back(i);
+	}
+	ParallelFor(toRead.size(), options.nThreads, options.piAbortable, [&](size_t n) {
+		Candidate& c = candidates[toRead[n]];
+		std::vector<char> buffer;
+		if (ReadFileHead(c.path, static_cast<size_t>(SimilarityMaxSize), buffer) && !LooksBinary(buffer))
+			c.sketch = MakeSketch(buffer);
+	});
+	if (options.piAbortable && options.piAbortable->ShouldAbort())
+		return;
+
+	std::unordered_map<uint64_t, Group> index;
+	for (size_t i : toRead)
+	{
+		if (candidates[i].side == 1)
+		{
+			for (uint64_t hash : candidates[i].sketch)
+				index[hash].push_back(i);
+		}
+	}
+
+	struct Match
+	{
+		double similarity;
+		bool bSameName;
+		size_t left;
+		size_t right;
+	};
+	std::vector<Match> matches;
+	std::unordered_map<size_t, int> counts;
+	const double minSimilarity = options.nSimilarity / 100.0;
+	for (size_t l : toRead)
+	{
+		const Candidate& left = candidates[l];
+		if (left.side != 0 || left.sketch.empty())
+			continue;
+		counts.clear();
+		for (uint64_t hash : left.sketch)
+		{
+			auto it = index.find(hash);
+			if (it != index.end() && it->second.size() <= MaxPostings)
+			{
+				for (size_t r : it->second)
+					++counts[r];
+			}
+		}
+		for (const auto& count : counts)
+		{
+			const Candidate& right = candidates[count.first];
+			// A sketch sharing fewer hashes cannot reach the minimum similarity
+			if (count.second < minSimilarity * (std::max)(left.sketch.size(), right.sketch.size()))
+				continue;
+			if ((std::max)(left.size, right.size) > 2 * (std::min)(left.size, right.size))
+				continue;
+			double similarity = EstimateSimilarity(left.sketch, right.sketch);
+			if (similarity >= minSimilarity)
+			{
+				bool bSameName = left.filename == right.filename;
+				matches.push_back({ similarity, bSameName, l, count.first });
+			}
+		}
+	}
+
+	// Most similar pairs first, each file is paired once
+	std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) {
+		if (a.similarity != b.similarity)
+			return a.similarity > b.similarity;
+		if (a.bSameName != b.bSameName)
+			return a.bSameName;
+		return a.left != b.left ? a.left < b.left : a.right < b.right;
+	});
+	for (const auto& match : matches)
+	{
+		Candidate& left = candidates[match.left];
+		Candidate& right = candidates[match.right];
+		if (left.bPaired || right.bPaired)
+			continue;
+		left.bPaired = right.bPaired = true;
+		moved.push_back({ { left.pdi, right.pdi }, false, false });
+	}
+}
+
+}
+
+/**
+ * @brief Find the files only in the left folder and the files only in the
+ * right folder which are the same file, moved or renamed.
+ * Only two-way compares are supported.
+ * @param [in] list Compared items.
+ * @param [in] paths Compared folders.
+ * @param [in] options Settings, see MoveDetectionOptions.
+ * @return Pairs of items, identical files first. Nothing is paired if the
+ *  compare is aborted.
+ */
+std::vector<MovedItem> FindMovedItems(const DiffItemList& list, const PathContext& paths, const MoveDetectionOptions& options)
+{
+	std::vector<MovedItem> moved;
+	if (paths.GetSize() != 2)
+		return moved;
+
+	std::vector<Candidate> candidates;
+	for (DIFFITEM *pos = list.GetFirstDiffPosition(); pos != nullptr; )
+	{
+		DIFFITEM *pdi = pos;
+		const DIFFITEM& di = list.GetNextDiffPosition(pos);
+		if (di.diffcode.isDirectory() || di.diffcode.isResultFiltered() || di.diffcode.isResultError())
+			continue;
+		const int side = di.diffcode.isSideFirstOnly() ? 0 : (di.diffcode.isSideSecondOnly() ? 1 : -1);
+		if (side < 0)
+			continue;
+		Candidate c;
+		c.pdi = pdi;
+		c.side = side;
+		c.size = static_cast<int64_t>(di.diffFileInfo[side].size);
+		c.path = paths::ConcatPath(paths[side], di.diffFileInfo[side].GetFile());
+		c.filename = di.diffFileInfo[side].filename;
+		candidates.push_back(std::move(c));
+	}
+
+	FindIdenticalFiles(candidates, options, moved);
+	if (options.nSimilarity > 0 && !(options.piAbortable && options.piAbortable->ShouldAbort()))
+		FindSimilarFiles(candidates, options, moved);
+	if (options.piAbortable && options.piAbortable->ShouldAbort())
+		moved.clear();
+	return moved;
+}
+
+/**
+ * @brief Merge the right only item of a pair into the left only item.
+ * The left item gets the right file as its right side and is marked as
+ * moved; the right item is removed. Identical files get their compare
+ * result, similar files are left to be compared.
+ * @return The merged item.
+ */
+DIFFITEM *PairMovedItems(DiffItemList& list, const MovedItem& moved)
+{
+	DIFFITEM& di = *moved.pdi[0];
+	di.diffFileInfo[1] = std::move(moved.pdi[1]->diffFileInfo[1]);
+	list.RemoveDiff(moved.pdi[1]);
+	di.diffcode.diffcode = DIFFCODE::FILE | DIFFCODE::BOTH | DIFFCODE::MOVED;
+	if (moved.bIdentical)
+	{
+		di.diffcode.diffcode |= DIFFCODE::SAME | (moved.bBinary ? DIFFCODE::BIN : DIFFCODE::TEXT);
+		di.nsdiffs = 0;
+		di.nidiffs = 0;
+	}
+	else
+	{
+		di.nsdiffs = -1;
+		di.nidiffs = -1;
+	}
+	return &di;
+}
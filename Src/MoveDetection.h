@@ -0,0 +1,37 @@
+/**
+ * @file  MoveDetection.h
+ *
+ * @brief Declaration of the functions pairing moved and renamed files of a folder compare.
+ */
+#pragma once
+
+#include <vector>
+
+class DIFFITEM;
+class DiffItemList;
+class PathContext;
+class IAbortable;
+
+/**
+ * @brief A file only in the left folder and a file only in the right folder
+ * which are the same file, moved or renamed.
+ */
+struct MovedItem
+{
+	DIFFITEM *pdi[2]; /**< Left only item and right only item */
+	bool bIdentical; /**< Contents are identical, else similar text */
+	bool bBinary; /**< Identical contents are binary */
+};
+
+/**
+ * @brief Settings of FindMovedItems().
+ */
+struct MoveDetectionOptions
+{
+	int nSimilarity = 0; /**< Minimum percentage of common lines of similar text files, 0 to pair identical files only */
+	int nThreads = 1; /**< Number of threads reading the files */
+	const IAbortable *piAbortable = nullptr;
+};
+
+std::vector<MovedItem> FindMovedItems(const DiffItemList& list, const PathContext& paths, const MoveDetectionOptions& options);
+DIFFITEM *PairMovedItems(DiffItemList& list, const MovedItem& moved);
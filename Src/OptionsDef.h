@@ -73,6 +73,7 @@ inline const String OPT_ACTIVE_PANE {_T("Settings/ActivePane"s)};
 inline const String OPT_REPORTFILES_REPORTTYPE {_T("ReportFiles/ReportType"s)};
 inline const String OPT_REPORTFILES_COPYTOCLIPBOARD {_T("ReportFiles/CopyToClipboard"s)};
 inline const String OPT_REPORTFILES_INCLUDEFILECMPREPORT {_T("ReportFiles/IncludeFileCmpReport"s)};
+inline const String OPT_REPORTFILES_FASTFILECMPREPORT {_T("ReportFiles/FastFileCmpReport"s)};
 
 // File compare
 inline const String OPT_AUTOMATIC_RESCAN {_T("Settings/AutomaticRescan"s)};
@@ -210,10 +211,17 @@ inline const String OPT_CMP_MATCH_SIMILAR_LINES {_T("Settings/MatchSimilarLines"
 inline const String OPT_CMP_STOP_AFTER_FIRST {_T("Settings/StopAfterFirst"s)};
 inline const String OPT_CMP_QUICK_LIMIT {_T("Settings/QuickMethodLimit"s)};
 inline const String OPT_CMP_BINARY_LIMIT {_T("Settings/BinaryMethodLimit"s)};
+inline const String OPT_CMP_TRANSCODE_IN_MEMORY_LIMIT {_T("Settings/TranscodeInMemoryLimit"s)};
+inline const String OPT_CMP_STREAMING_DIFF_MEMORY_LIMIT {_T("Settings/StreamingDiffMemoryLimit"s)};
 inline const String OPT_CMP_COMPARE_THREADS {_T("Settings/CompareThreads"s)};
+inline const String OPT_CMP_PREFETCH_THREADS {_T("Settings/PrefetchThreads"s)};
+inline const String OPT_CMP_DIFF_THREADS {_T("Settings/DiffThreads"s)};
 inline const String OPT_CMP_WALK_UNIQUE_DIRS {_T("Settings/ScanUnpairedDir"s)};
 inline const String OPT_CMP_IGNORE_REPARSE_POINTS {_T("Settings/IgnoreReparsePoints"s)};
 inline const String OPT_CMP_INCLUDE_SUBDIRS {_T("Settings/Recurse"s)};
+inline const String OPT_CMP_WATCH_FOLDERS {_T("Settings/WatchFolders"s)};
+inline const String OPT_CMP_DETECT_MOVED {_T("Settings/DetectMoved"s)};
+inline const String OPT_CMP_DETECT_MOVED_SIMILARITY {_T("Settings/DetectMovedSimilarity"s)};
 inline const String OPT_CMP_DIFF_ALGORITHM {_T("Settings/DiffAlgorithm"s)};
 inline const String OPT_CMP_INDENT_HEURISTIC {_T("Settings/IndentHeuristic"s)};
 inline const String OPT_CMP_COMPLETELY_BLANK_OUT_IGNORED_CHANGES {_T("Settings/CompletelyBlankOutIgnoredChanges"s)};
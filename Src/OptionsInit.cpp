@@ -114,6 +114,7 @@ void Init(COptionsMgr *pOptions)
 	pOptions->InitOption(OPT_REPORTFILES_REPORTTYPE, 0, 0, 3);
 	pOptions->InitOption(OPT_REPORTFILES_COPYTOCLIPBOARD, false);
 	pOptions->InitOption(OPT_REPORTFILES_INCLUDEFILECMPREPORT, false);
+	pOptions->InitOption(OPT_REPORTFILES_FASTFILECMPREPORT, false);
 
 	pOptions->InitOption(OPT_AUTOMATIC_RESCAN, false);
 	pOptions->InitOption(OPT_ALLOW_MIXED_EOL, false);
@@ -142,11 +143,18 @@ void Init(COptionsMgr *pOptions)
 	pOptions->InitOption(OPT_CMP_STOP_AFTER_FIRST, false);
 	pOptions->InitOption(OPT_CMP_QUICK_LIMIT, 4 * 1024 * 1024); // 4 Megs
 	pOptions->InitOption(OPT_CMP_BINARY_LIMIT, 64 * 1024 * 1024); // 64 Megs
+	pOptions->InitOption(OPT_CMP_TRANSCODE_IN_MEMORY_LIMIT, 64 * 1024 * 1024); // 64 Megs
+	pOptions->InitOption(OPT_CMP_STREAMING_DIFF_MEMORY_LIMIT, 0); // 0 = disabled
 	pOptions->InitOption(OPT_CMP_COMPARE_THREADS, -1, -128, 128);
+	pOptions->InitOption(OPT_CMP_PREFETCH_THREADS, 0, -1, 128); // 0 = automatic, -1 = disabled
+	pOptions->InitOption(OPT_CMP_DIFF_THREADS, 1, 0, 128); // 0 = processor count, 1 = disabled
 	pOptions->InitOption(OPT_CMP_WALK_UNIQUE_DIRS, true);
 	pOptions->InitOption(OPT_CMP_IGNORE_REPARSE_POINTS, false);
 	pOptions->InitOption(OPT_CMP_IGNORE_CODEPAGE, false);
 	pOptions->InitOption(OPT_CMP_INCLUDE_SUBDIRS, true);
+	pOptions->InitOption(OPT_CMP_WATCH_FOLDERS, false);
+	pOptions->InitOption(OPT_CMP_DETECT_MOVED, false);
+	pOptions->InitOption(OPT_CMP_DETECT_MOVED_SIMILARITY, 60, 0, 100); // 0 = identical files only
 	pOptions->InitOption(OPT_CMP_ENABLE_IMGCMP_IN_DIRCMP, false);
 
 	pOptions->InitOption(OPT_CMP_BIN_FILEPATTERNS, _T("*.bin;*.frx"));
@@ -0,0 +1,365 @@
+/**
+ * @file  PatchCreator.cpp
+ *
+ * @brief Implementation of PatchCreator.
+ */
+#include "pch.h"
+#include "PatchCreator.h"
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <Poco/AutoPtr.h>
+#include <Poco/Exception.h>
+#include <Poco/Notification.h>
+#include <Poco/NotificationQueue.h>
+#include <Poco/Runnable.h>
+#include <Poco/ThreadPool.h>
+#include "IAbortable.h"
+#include "Environment.h"
+#include "PathContext.h"
+#include "TFile.h"
+
+using Poco::AutoPtr;
+using Poco::Notification;
+using Poco::NotificationQueue;
+
+namespace
+{
+
+/** @brief Patches bigger than this are copied from the worker's scratch file instead of memory. */
+constexpr __int64 MaxBufferedPatchSize = 16 * 1024 * 1024;
+/** @brief Buffer size of the patch file and of copying scratch files. */
+constexpr size_t WriteBufferSize = 1024 * 1024;
+
+class PatchWorkNotification : public Notification
+{
+public:
+	explicit PatchWorkNotification(size_t index) : m_index(index) {}
+	size_t index() const { return m_index; }
+private:
+	size_t m_index;
+};
+
+class QuitNotification : public Notification
+{
+};
+
+/**
+ * @brief Open a scratch file for the output of diffutils.
+ * The file is deleted when closed and Windows keeps it in memory when it can.
+ */
+FILE *OpenScratchFile()
+{
+	String path = env::GetTemporaryFileName(env::GetTemporaryPath(), _T("PAT"));
+	if (path.empty())
+		return nullptr;
+	FILE *fp = nullptr;
+	if (_tfopen_s(&fp, path.c_str(), _T("w+bTD")) != 0)
+	{
+		try
+		{
+			TFile(path).remove();
+		}
+		catch (Poco::Exception&)
+		{
+		}
+		return nullptr;
+	}
+	return fp;
+}
+
+}
+
+/**
+ * @brief Patch of one file pair, as rendered by a worker.
+ */
+struct PatchCreator::FilePatch
+{
+	FilePatch() = default;
+	FilePatch(const FilePatch&) = delete;
+	FilePatch& operator=(const FilePatch&) = delete;
+	~FilePatch()
+	{
+		if (spill != nullptr)
+			fclose(spill);
+	}
+
+	bool bAborted = false;
+	bool bDiffSuccess = false;
+	DIFFSTATUS status;
+	std::string text; /**< Patch text, unless it is in @p spill */
+	FILE *spill = nullptr; /**< Scratch file holding a big patch, owned */
+	__int64 nSpillSize = 0;
+};
+
+class PatchCreator::PatchDoneNotification : public Notification
+{
+public:
+	explicit PatchDoneNotification(size_t index) : m_index(index) {}
+	size_t index() const { return m_index; }
+	FilePatch& patch() { return m_patch; }
+private:
+	size_t m_index;
+	FilePatch m_patch;
+};
+
+/**
+ * @brief Renders the patches of queued file pairs.
+ */
+class PatchCreator::PatchWorker : public Poco::Runnable
+{
+public:
+	PatchWorker(const PatchCreator& creator, const std::vector<PATCHFILES>& fileList,
+		NotificationQueue& queue, NotificationQueue& queueResult)
+		: m_creator(creator), m_fileList(fileList), m_queue(queue), m_queueResult(queueResult)
+	{
+	}
+
+	void run() override
+	{
+		CDiffWrapper diffWrapper;
+		m_creator.InitDiffWrapper(diffWrapper);
+		FILE *scratch = nullptr;
+
+		AutoPtr<Notification> pNf(m_queue.waitDequeueNotification());
+		while (pNf.get() != nullptr && dynamic_cast<QuitNotification*>(pNf.get()) == nullptr)
+		{
+			PatchWorkNotification* pWorkNf = dynamic_cast<PatchWorkNotification*>(pNf.get());
+			if (pWorkNf != nullptr)
+			{
+				PatchDoneNotification *pDoneNf = new PatchDoneNotification(pWorkNf->index());
+				FilePatch& patch = pDoneNf->patch();
+				if (scratch == nullptr)
+					scratch = OpenScratchFile();
+				if (m_creator.ShouldAbort())
+					patch.bAborted = true;
+				else if (scratch == nullptr)
+					patch.status.bPatchFileFailed = true;
+				else
+				{
+					m_creator.RenderPatch(diffWrapper, scratch, m_fileList[pWorkNf->index()], patch);
+					// A big patch keeps the scratch file, the next pair gets a new one
+					if (patch.spill != nullptr)
+						scratch = nullptr;
+				}
+				m_queueResult.enqueueNotification(pDoneNf);
+			}
+			pNf = m_queue.waitDequeueNotification();
+		}
+		if (scratch != nullptr)
+			fclose(scratch);
+	}
+
+private:
+	const PatchCreator& m_creator;
+	const std::vector<PATCHFILES>& m_fileList;
+	NotificationQueue& m_queue;
+	NotificationQueue& m_queueResult;
+};
+
+PatchCreator::PatchCreator()
+	: m_diffOptions{}
+	, m_patchOptions{ OUTPUT_NORMAL, 0, false }
+	, m_nStreamingDiffMemoryLimit(0)
+	, m_nThreads(1)
+	, m_piAbortable(nullptr)
+	, m_nWrittenFiles(0)
+	, m_bBinaries(false)
+	, m_nFailedIndex(SIZE_MAX)
+{
+}
+
+/**
+ * @brief Set compare options and patch style.
+ */
+void PatchCreator::SetOptions(const DIFFOPTIONS& diffOptions, const PATCHOPTIONS& patchOptions)
+{
+	m_diffOptions = diffOptions;
+	m_patchOptions = patchOptions;
+}
+
+/**
+ * @brief Write the patch of all file pairs in @p fileList.
+ * Like diffing the pairs in order, binary pairs are skipped and the first
+ * pair that can not be read stops the patch. The patches of the pairs before
+ * it are kept in the patch file.
+ * @param [in] sPatchFile Patch file to create.
+ * @param [in] bAppendFile Append to @p sPatchFile if it exists.
+ * @param [in] fileList File pairs to diff.
+ * @return Result::Ok if all pairs were processed.
+ */
+PatchCreator::Result PatchCreator::CreatePatch(const String& sPatchFile, bool bAppendFile, const std::vector<PATCHFILES>& fileList)
+{
+	m_sPatchFile = sPatchFile;
+	m_nWrittenFiles = 0;
+	m_bBinaries = false;
+	m_nFailedIndex = SIZE_MAX;
+
+	CDiffWrapper diffWrapper;
+	InitDiffWrapper(diffWrapper);
+	DIFFSTATUS status;
+	diffWrapper.WritePatchFileHeader(m_patchOptions.outputStyle, bAppendFile);
+	diffWrapper.GetDiffStatus(&status);
+	if (status.bPatchFileFailed)
+		return Result::WriteError;
+
+	// Text mode like the patch files diffutils writes itself
+	FILE *pPatchFile = nullptr;
+	if (_tfopen_s(&pPatchFile, m_sPatchFile.c_str(), _T("a")) != 0)
+		return Result::WriteError;
+	setvbuf(pPatchFile, nullptr, _IOFBF, WriteBufferSize);
+
+	const int nWorkers = std::max(m_nThreads, 1);
+	const size_t nMaxInFlight = static_cast<size_t>(nWorkers) * FilesInFlightPerThread;
+	NotificationQueue queue;
+	NotificationQueue queueResult;
+	Poco::ThreadPool threadPool(nWorkers, nWorkers);
+	std::vector<std::unique_ptr<PatchWorker>> workers;
+	for (int i = 0; i < nWorkers; ++i)
+	{
+		workers.emplace_back(new PatchWorker(*this, fileList, queue, queueResult));
+		threadPool.start(*workers.back());
+	}
+
+	// Patches finishing out of order wait here until their turn
+	std::map<size_t, AutoPtr<PatchDoneNotification>> finished;
+	size_t nQueued = 0;
+	size_t nReceived = 0;
+	size_t nWritten = 0;
+	Result result = Result::Ok;
+	for (;;)
+	{
+		if (result == Result::Ok && ShouldAbort())
+			result = Result::Aborted;
+		while (result == Result::Ok && nQueued < fileList.size() && nQueued - nWritten < nMaxInFlight)
+			queue.enqueueNotification(new PatchWorkNotification(nQueued++));
+		if (nReceived == nQueued)
+			break;
+
+		AutoPtr<Notification> pNf(queueResult.waitDequeueNotification());
+		++nReceived;
+		PatchDoneNotification *pDoneNf = dynamic_cast<PatchDoneNotification*>(pNf.get());
+		if (pDoneNf == nullptr || result != Result::Ok)
+			continue;
+		finished.emplace(pDoneNf->index(), AutoPtr<PatchDoneNotification>(pDoneNf, true));
+		for (auto it = finished.find(nWritten); it != finished.end() && result == Result::Ok; it = finished.find(nWritten))
+		{
+			result = WritePatch(pPatchFile, nWritten, it->second->patch());
+			finished.erase(it);
+			++nWritten;
+			if (m_progressCallback)
+				m_progressCallback(nWritten, fileList.size());
+		}
+	}
+
+	for (int i = 0; i < nWorkers; ++i)
+		queue.enqueueNotification(new QuitNotification);
+	threadPool.joinAll();
+
+	if (fclose(pPatchFile) != 0 && result == Result::Ok)
+		result = Result::WriteError;
+
+	diffWrapper.WritePatchFileTerminator(m_patchOptions.outputStyle);
+	diffWrapper.GetDiffStatus(&status);
+	if (status.bPatchFileFailed && result == Result::Ok)
+		result = Result::WriteError;
+	return result;
+}
+
+/**
+ * @brief Set up a CDiffWrapper of a worker to write patches.
+ */
+void PatchCreator::InitDiffWrapper(CDiffWrapper& diffWrapper) const
+{
+	diffWrapper.SetCreatePatchFile(m_sPatchFile);
+	diffWrapper.SetAppendFiles(true);
+	diffWrapper.SetPrediffer(nullptr);
+	diffWrapper.SetPatchOptions(&m_patchOptions);
+	diffWrapper.SetOptions(&m_diffOptions);
+	diffWrapper.SetStreamingDiffMemoryLimit(m_nStreamingDiffMemoryLimit);
+}
+
+/**
+ * @brief Diff one file pair and keep its patch in @p patch.
+ * @param [in] scratch Scratch file diffutils writes the patch to.
+ */
+void PatchCreator::RenderPatch(CDiffWrapper& diffWrapper, FILE *scratch, const PATCHFILES& files, FilePatch& patch) const
+{
+	String filename1 = files.lfile.length() == 0 ? _T("NUL") : files.lfile;
+	String filename2 = files.rfile.length() == 0 ? _T("NUL") : files.rfile;
+
+	rewind(scratch);
+	diffWrapper.SetPatchStream(scratch);
+	diffWrapper.SetPaths(PathContext(filename1, filename2), false);
+	diffWrapper.SetAlternativePaths(PathContext(files.pathLeft, files.pathRight));
+	diffWrapper.SetCompareFiles(PathContext(files.lfile, files.rfile));
+	patch.bDiffSuccess = diffWrapper.RunFileDiff();
+	diffWrapper.GetDiffStatus(&patch.status);
+	diffWrapper.SetPatchStream(nullptr);
+	if (!patch.bDiffSuccess || patch.status.bBinaries || patch.status.bPatchFileFailed)
+		return;
+
+	// The scratch file is reused, so anything past the current position is stale
+	const __int64 size = _ftelli64(scratch);
+	if (size < 0 || fflush(scratch) != 0)
+	{
+		patch.status.bPatchFileFailed = true;
+	}
+	else if (size > MaxBufferedPatchSize)
+	{
+		patch.spill = scratch;
+		patch.nSpillSize = size;
+	}
+	else
+	{
+		patch.text.resize(static_cast<size_t>(size));
+		rewind(scratch);
+		if (size > 0 && fread(&patch.text[0], 1, patch.text.size(), scratch) != patch.text.size())
+			patch.status.bPatchFileFailed = true;
+	}
+}
+
+/**
+ * @brief Append the patch of the pair at @p index to the patch file.
+ * @return Result::Ok to continue with the next pair.
+ */
+PatchCreator::Result PatchCreator::WritePatch(FILE *pPatchFile, size_t index, FilePatch& patch)
+{
+	if (patch.bAborted)
+		return Result::Aborted;
+	if (!patch.bDiffSuccess)
+	{
+		m_nFailedIndex = index;
+		return Result::FileError;
+	}
+	if (patch.status.bBinaries)
+	{
+		m_bBinaries = true;
+		return Result::Ok;
+	}
+	if (patch.status.bPatchFileFailed)
+		return Result::WriteError;
+
+	if (!patch.text.empty() && fwrite(patch.text.data(), 1, patch.text.size(), pPatchFile) != patch.text.size())
+		return Result::WriteError;
+	if (patch.spill != nullptr)
+	{
+		std::unique_ptr<char[]> buffer(new char[WriteBufferSize]);
+		rewind(patch.spill);
+		for (__int64 remaining = patch.nSpillSize; remaining > 0; )
+		{
+			const size_t chunk = static_cast<size_t>(std::min<__int64>(remaining, WriteBufferSize));
+			if (fread(buffer.get(), 1, chunk, patch.spill) != chunk ||
+				fwrite(buffer.get(), 1, chunk, pPatchFile) != chunk)
+				return Result::WriteError;
+			remaining -= chunk;
+		}
+	}
+	++m_nWrittenFiles;
+	return Result::Ok;
+}
+
+bool PatchCreator::ShouldAbort() const
+{
+	return m_piAbortable != nullptr && m_piAbortable->ShouldAbort();
+}
@@ -0,0 +1,98 @@
+/**
+ * @file  PatchCreator.h
+ *
+ * @brief Declaration of PatchCreator, which writes a patch of many file pairs.
+ */
+#pragma once
+
+#include <cstdio>
+#include <functional>
+#include <vector>
+#include "DiffWrapper.h"
+#include "UnicodeString.h"
+
+class IAbortable;
+
+/**
+ * @brief Files used for patch creating.
+ * Stores paths of two files used to create a patch. Left side file
+ * is considered as "original" file and right side file as "changed" file.
+ * Times are for printing filetimes to patch file.
+ */
+struct PATCHFILES
+{
+	String lfile; /**< Left file */
+	String pathLeft; /**< Left path added to patch file */
+	String rfile; /**< Right file */
+	String pathRight; /**< Right path added to patch file */
+	time_t ltime; /**< Left time */
+	time_t rtime; /**< Right time */
+	PATCHFILES() : ltime(0), rtime(0) {};
+	/**
+	 * @brief Swap diff sides.
+	 */
+	void swap_sides()
+	{
+		std::swap(lfile, rfile);
+		std::swap(pathLeft, pathRight);
+		std::swap(ltime, rtime);
+	}
+};
+
+/**
+ * @brief Creates one patch file from a list of file pairs.
+ * The pairs are diffed on a pool of worker threads. Each worker renders the
+ * patch of one pair into memory, and the calling thread appends the results
+ * to the patch file in list order, so the output is the same as diffing the
+ * pairs one after another. Only a few pairs per worker are in flight at a
+ * time, which bounds the memory held by finished but unwritten patches.
+ *
+ * PatchCreator has no user interface, errors are returned to the caller.
+ */
+class PatchCreator
+{
+public:
+	/** @brief Outcome of CreatePatch(). */
+	enum class Result
+	{
+		Ok,
+		FileError, /**< A file pair could not be read, see GetFailedIndex() */
+		WriteError, /**< Writing the patch file failed */
+		Aborted,
+	};
+
+	/** @brief Files in flight per worker thread. */
+	static constexpr int FilesInFlightPerThread = 4;
+
+	PatchCreator();
+	void SetOptions(const DIFFOPTIONS& diffOptions, const PATCHOPTIONS& patchOptions);
+	void SetStreamingDiffMemoryLimit(int nMemoryLimit) { m_nStreamingDiffMemoryLimit = nMemoryLimit; }
+	void SetThreadCount(int nThreads) { m_nThreads = nThreads; }
+	void SetAbortable(const IAbortable *piAbortable) { m_piAbortable = piAbortable; }
+	void SetProgressCallback(std::function<void(size_t nDone, size_t nTotal)> callback) { m_progressCallback = callback; }
+	Result CreatePatch(const String& sPatchFile, bool bAppendFile, const std::vector<PATCHFILES>& fileList);
+	int GetWrittenFileCount() const { return m_nWrittenFiles; }
+	bool HasBinaries() const { return m_bBinaries; }
+	size_t GetFailedIndex() const { return m_nFailedIndex; }
+
+private:
+	class PatchWorker;
+	class PatchDoneNotification;
+	struct FilePatch;
+
+	void InitDiffWrapper(CDiffWrapper& diffWrapper) const;
+	void RenderPatch(CDiffWrapper& diffWrapper, FILE *scratch, const PATCHFILES& files, FilePatch& patch) const;
+	Result WritePatch(FILE *pPatchFile, size_t index, FilePatch& patch);
+	bool ShouldAbort() const;
+
+	DIFFOPTIONS m_diffOptions;
+	PATCHOPTIONS m_patchOptions;
+	int m_nStreamingDiffMemoryLimit;
+	int m_nThreads;
+	const IAbortable *m_piAbortable;
+	std::function<void(size_t nDone, size_t nTotal)> m_progressCallback;
+	String m_sPatchFile;
+	int m_nWrittenFiles; /**< Pairs with a patch written, identical pairs included */
+	bool m_bBinaries; /**< Some pairs were skipped as binary */
+	size_t m_nFailedIndex; /**< Index of the pair that failed with Result::FileError */
+};
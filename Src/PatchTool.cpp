@@ -20,11 +20,25 @@
 #include "OptionsMgr.h"
 #include "OptionsDef.h"
 #include "ClipBoard.h"
+#include "IAbortable.h"
+#include <Poco/Environment.h>
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
 #endif
 
+namespace
+{
+
+/** @brief Cancels patch creation when Esc is held down. */
+class PatchAbortable : public IAbortable
+{
+public:
+	bool ShouldAbort() const override { return (::GetAsyncKeyState(VK_ESCAPE) & 0x8000) != 0; }
+};
+
+}
+
 /**
  * @brief Default constructor.
  */
@@ -83,7 +97,6 @@ void CPatchTool::AddFiles(const String &file1, const String &altPath1,
  */
 int CPatchTool::CreatePatch()
 {
-	DIFFSTATUS status;
 	int retVal = 0;
 
 	CPatchDlg dlgPatch;
@@ -104,11 +117,6 @@ int CPatchTool::CreatePatch()
 			return 0;
 		}
 
-		// Select patch create -mode
-		m_diffWrapper.SetCreatePatchFile(dlgPatch.m_fileResult);
-		m_diffWrapper.SetAppendFiles(dlgPatch.m_appendFile);
-		m_diffWrapper.SetPrediffer(nullptr);
-
 		size_t fileCount = dlgPatch.GetItemCount();
 
 		std::vector<PATCHFILES> fileList;
@@ -132,56 +140,54 @@ int CPatchTool::CreatePatch()
 				fileList.push_back(tFiles);
 			}
 		}
-		fileCount = fileList.size();
-
-		m_diffWrapper.WritePatchFileHeader(dlgPatch.m_outputStyle, dlgPatch.m_appendFile);
-		m_diffWrapper.SetAppendFiles(true);
 
-		bool bShowedBinaryMessage = false;
-		int writeFileCount = 0;
-
-		for (size_t index = 0; index < fileCount; index++)
+		PatchAbortable abortable;
+		m_patchCreator.SetAbortable(&abortable);
+		CFrameWnd *pFrame = dynamic_cast<CFrameWnd *>(AfxGetMainWnd());
+		if (pFrame != nullptr)
 		{
-			const PATCHFILES& tFiles = fileList[index];
-			String filename1 = tFiles.lfile.length() == 0 ? _T("NUL") : tFiles.lfile;
-			String filename2 = tFiles.rfile.length() == 0 ? _T("NUL") : tFiles.rfile;
-			
-			// Set up DiffWrapper
-			m_diffWrapper.SetPaths(PathContext(filename1, filename2), false);
-			m_diffWrapper.SetAlternativePaths(PathContext(tFiles.pathLeft, tFiles.pathRight));
-			m_diffWrapper.SetCompareFiles(PathContext(tFiles.lfile, tFiles.rfile));
-			bool bDiffSuccess = m_diffWrapper.RunFileDiff();
-			m_diffWrapper.GetDiffStatus(&status);
-
-			if (!bDiffSuccess)
-			{
-				LangMessageBox(IDS_FILEERROR, MB_ICONSTOP);
-				bResult = false;
-				break;
-			}
-			else if (status.bBinaries)
-			{
-				if (!bShowedBinaryMessage)
+			m_patchCreator.SetProgressCallback([pFrame](size_t nDone, size_t nTotal)
 				{
-					LangMessageBox(IDS_CANNOT_CREATE_BINARYPATCH, MB_ICONWARNING);
-					bShowedBinaryMessage = true;
-				}
-			}
-			else if (status.bPatchFileFailed)
-			{
-				String errMsg = strutils::format_string1(_("Could not write to file %1."), dlgPatch.m_fileResult);
-				AfxMessageBox(errMsg.c_str(), MB_ICONSTOP);
-				bResult = false;
-				break;
-			}
-			else
-			{
-				writeFileCount++;
-			}
+					if (nDone % 64 != 0 && nDone != nTotal)
+						return;
+					String text = strutils::format_string2(_("Creating patch: %1 of %2 files (Esc to cancel)"),
+						strutils::to_str(nDone), strutils::to_str(nTotal));
+					pFrame->SetMessageText(text.c_str());
+					if (CWnd *pMessageBar = pFrame->GetMessageBar())
+						pMessageBar->UpdateWindow();
+				});
+		}
+
+		PatchCreator::Result result;
+		{
+			CWaitCursor waitstatus;
+			result = m_patchCreator.CreatePatch(dlgPatch.m_fileResult, dlgPatch.m_appendFile, fileList);
+		}
+		if (pFrame != nullptr)
+			pFrame->SetMessageText(AFX_IDS_IDLEMESSAGE);
 
+		if (m_patchCreator.HasBinaries())
+			LangMessageBox(IDS_CANNOT_CREATE_BINARYPATCH, MB_ICONWARNING);
+		switch (result)
+		{
+		case PatchCreator::Result::FileError:
+			LangMessageBox(IDS_FILEERROR, MB_ICONSTOP);
+			bResult = false;
+			break;
+		case PatchCreator::Result::WriteError:
+		{
+			String errMsg = strutils::format_string1(_("Could not write to file %1."), dlgPatch.m_fileResult);
+			AfxMessageBox(errMsg.c_str(), MB_ICONSTOP);
+			bResult = false;
+			break;
+		}
+		case PatchCreator::Result::Aborted:
+			bResult = false;
+			break;
+		default:
+			break;
 		}
-		
-		m_diffWrapper.WritePatchFileTerminator(dlgPatch.m_outputStyle);
+		const int writeFileCount = m_patchCreator.GetWrittenFileCount();
 
 		if (bResult && writeFileCount > 0)
 		{
@@ -243,12 +249,17 @@ bool CPatchTool::ShowDialog(CPatchDlg *pDlgPatch)
 
 		// Checkbox - can't be wrong
 		patchOptions.bAddCommandline = pDlgPatch->m_includeCmdLine;
-		m_diffWrapper.SetPatchOptions(&patchOptions);
 
 		// These are from checkboxes and radiobuttons - can't be wrong
-		m_diffWrapper.SetAppendFiles(pDlgPatch->m_appendFile);
 		Options::DiffOptions::Load(GetOptionsMgr(), diffOptions);
-		m_diffWrapper.SetOptions(&diffOptions);
+		m_patchCreator.SetOptions(diffOptions, patchOptions);
+		m_patchCreator.SetStreamingDiffMemoryLimit(GetOptionsMgr()->GetInt(OPT_CMP_STREAMING_DIFF_MEMORY_LIMIT));
+
+		// Same number of threads as folder compare
+		int nThreads = GetOptionsMgr()->GetInt(OPT_CMP_COMPARE_THREADS);
+		if (nThreads <= 0)
+			nThreads += Poco::Environment::processorCount();
+		m_patchCreator.SetThreadCount(std::clamp(nThreads, 1, static_cast<int>(Poco::Environment::processorCount())));
 	}
 	else
 		return false;
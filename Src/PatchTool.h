@@ -6,37 +6,11 @@
  */
 #pragma once
 
-#include "DiffWrapper.h"
+#include "PatchCreator.h"
 #include "DiffItem.h"
 
 class CPatchDlg;
 
-/** 
- * @brief Files used for patch creating.
- * Stores paths of two files used to create a patch. Left side file
- * is considered as "original" file and right side file as "changed" file.
- * Times are for printing filetimes to patch file.
- */
-struct PATCHFILES
-{
-	String lfile; /**< Left file */
-	String pathLeft; /**< Left path added to patch file */
-	String rfile; /**< Right file */
-	String pathRight; /**< Right path added to patch file */
-	time_t ltime; /**< Left time */
-	time_t rtime; /**< Right time */
-	PATCHFILES() : ltime(0), rtime(0) {};
-	/**
-	 * @brief Swap diff sides.
-	 */
-	void swap_sides()
-	{
-		std::swap(lfile, rfile);
-		std::swap(pathLeft, pathRight);
-		std::swap(ltime, rtime);
-	}
-};
-
 /** 
  * @brief A class which creates patch files.
  * This class is used to create patch files. The files to patch can be added
@@ -63,7 +37,7 @@ private:
 
 private:
     std::vector<PATCHFILES> m_fileList; /**< List of files to patch. */
-	CDiffWrapper m_diffWrapper; /**< DiffWrapper instance we use to create patch. */
+	PatchCreator m_patchCreator; /**< Diffs the files and writes the patch. */
 	String m_sPatchFile; /**< Patch file path and filename. */
 	bool m_bOpenToEditor; /**< Is patch file opened to external editor? */
 	bool m_bCopyToClipbard; /**< Is patch file copied to clipboard? */
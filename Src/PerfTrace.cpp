@@ -0,0 +1,248 @@
+/**
+ * @file  PerfTrace.cpp
+ *
+ * @brief Implementation of the phase tracing of compares.
+ *
+ * Each thread records into its own buffer, so that recording threads do
+ * not wait for each other. When a thread ends its buffer goes to a free
+ * list and is reused by the next new thread, so the buffers are bounded by
+ * the threads running at once. The events of ended threads are kept until
+ * they are overwritten, since the compare threads have often ended when
+ * the trace is written.
+ */
+#include "pch.h"
+#include "PerfTrace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <Poco/Exception.h>
+#include <Poco/FileStream.h>
+#include <Poco/Process.h>
+#include <Poco/Thread.h>
+#include "unicoder.h"
+
+using Poco::FileOutputStream;
+
+namespace perftrace
+{
+
+std::atomic<bool> g_bEnabled { false };
+
+namespace
+{
+
+struct Event
+{
+	const char *name;
+	int64_t start;
+	int64_t duration;
+	uint64_t tid;
+	String detail;
+};
+
+/** @brief Ring buffer of the events of one thread at a time. */
+struct ThreadBuffer
+{
+	std::mutex mutex;
+	std::vector<Event> events;
+	size_t capacity = 0;
+	uint64_t count = 0; /**< Events recorded, including the overwritten ones */
+	uint64_t ownerTid = 0; /**< Thread recording into the buffer, 0 when it is free */
+};
+
+const std::chrono::steady_clock::time_point Origin = std::chrono::steady_clock::now();
+
+std::mutex g_buffersMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> g_buffers;
+std::vector<ThreadBuffer *> g_freeBuffers;
+std::map<uint64_t, std::string> g_threadNames;
+size_t g_capacity = DefaultCapacity;
+
+/** @brief Buffer of the current thread, given back to the free list when the thread ends. */
+struct ThreadBufferLease
+{
+	ThreadBuffer *pBuffer = nullptr;
+	uint64_t tid = 0;
+
+	~ThreadBufferLease()
+	{
+		if (pBuffer == nullptr)
+			return;
+		std::lock_guard<std::mutex> lock(g_buffersMutex);
+		{
+			std::lock_guard<std::mutex> bufferLock(pBuffer->mutex);
+			pBuffer->ownerTid = 0;
+		}
+		g_freeBuffers.push_back(pBuffer);
+	}
+};
+
+thread_local ThreadBufferLease t_lease;
+
+ThreadBufferLease& GetThreadBuffer()
+{
+	if (t_lease.pBuffer == nullptr)
+	{
+		const uint64_t tid = static_cast<uint64_t>(Poco::Thread::currentTid());
+		Poco::Thread *pThread = Poco::Thread::current();
+		std::string threadName = pThread != nullptr ? pThread->getName() : "main";
+		std::lock_guard<std::mutex> lock(g_buffersMutex);
+		ThreadBuffer *pBuffer;
+		if (!g_freeBuffers.empty())
+		{
+			pBuffer = g_freeBuffers.back();
+			g_freeBuffers.pop_back();
+		}
+		else
+		{
+			g_buffers.emplace_back(new ThreadBuffer);
+			pBuffer = g_buffers.back().get();
+			pBuffer->capacity = g_capacity;
+		}
+		{
+			std::lock_guard<std::mutex> bufferLock(pBuffer->mutex);
+			pBuffer->ownerTid = tid;
+		}
+		g_threadNames[tid] = std::move(threadName);
+		t_lease.pBuffer = pBuffer;
+		t_lease.tid = tid;
+	}
+	return t_lease;
+}
+
+std::string JsonString(const std::string& str)
+{
+	std::string result = "\"";
+	for (char c : str)
+	{
+		switch (c)
+		{
+		case '"': result += "\\\""; break;
+		case '\\': result += "\\\\"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char buf[8];
+				snprintf(buf, sizeof(buf), "\\u%04x", c);
+				result += buf;
+			}
+			else
+				result += c;
+		}
+	}
+	return result + "\"";
+}
+
+}
+
+/**
+ * @brief Start recording, dropping the events recorded before.
+ * @param [in] capacity Number of events kept per thread.
+ */
+void Enable(size_t capacity)
+{
+	std::lock_guard<std::mutex> lock(g_buffersMutex);
+	g_capacity = (std::max)(capacity, static_cast<size_t>(1));
+	// Only the names of the running threads are needed without the events of the ended ones
+	std::map<uint64_t, std::string> threadNames;
+	for (auto& pBuffer : g_buffers)
+	{
+		std::lock_guard<std::mutex> bufferLock(pBuffer->mutex);
+		pBuffer->events.clear();
+		pBuffer->capacity = g_capacity;
+		pBuffer->count = 0;
+		if (pBuffer->ownerTid != 0)
+			threadNames[pBuffer->ownerTid] = g_threadNames[pBuffer->ownerTid];
+	}
+	g_threadNames.swap(threadNames);
+	g_bEnabled = true;
+}
+
+/** @brief Stop recording, the recorded events are kept for Dump(). */
+void Disable()
+{
+	g_bEnabled = false;
+}
+
+/** @brief Microseconds since the process started. */
+int64_t Now()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - Origin).count();
+}
+
+void Record(const char *name, int64_t start, int64_t duration, const String *detail)
+{
+	ThreadBufferLease& lease = GetThreadBuffer();
+	ThreadBuffer *pBuffer = lease.pBuffer;
+	std::lock_guard<std::mutex> lock(pBuffer->mutex);
+	if (pBuffer->events.size() < pBuffer->capacity)
+		pBuffer->events.push_back({ name, start, duration, lease.tid });
+	Event& event = pBuffer->events[pBuffer->count++ % pBuffer->capacity];
+	event.name = name;
+	event.start = start;
+	event.duration = duration;
+	event.tid = lease.tid;
+	if (detail != nullptr)
+		event.detail = *detail;
+	else
+		event.detail.clear();
+}
+
+/**
+ * @brief Write the recorded events as a Chrome trace JSON file.
+ * @return false if the file could not be written.
+ */
+bool Dump(const String& filename)
+{
+	const unsigned long pid = static_cast<unsigned long>(Poco::Process::id());
+	std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool bFirst = true;
+	auto append = [&](const std::string& event)
+	{
+		json += bFirst ? "\n" : ",\n";
+		json += event;
+		bFirst = false;
+	};
+	{
+		std::lock_guard<std::mutex> lock(g_buffersMutex);
+		auto ids = [pid](uint64_t tid) { return ",\"pid\":" + std::to_string(pid) + ",\"tid\":" + std::to_string(tid); };
+		for (const auto& [tid, threadName] : g_threadNames)
+			append("{\"name\":\"thread_name\",\"ph\":\"M\"" + ids(tid) + ",\"args\":{\"name\":" + JsonString(threadName) + "}}");
+		for (auto& pBuffer : g_buffers)
+		{
+			std::lock_guard<std::mutex> bufferLock(pBuffer->mutex);
+			// Oldest first, the oldest event is the next one to be overwritten
+			const size_t size = pBuffer->events.size();
+			const size_t first = pBuffer->count > size ? static_cast<size_t>(pBuffer->count % size) : 0;
+			for (size_t i = 0; i < size; ++i)
+			{
+				const Event& event = pBuffer->events[(first + i) % size];
+				std::string str = "{\"name\":" + JsonString(event.name) + ",\"cat\":\"compare\",\"ph\":\"X\""
+					+ ",\"ts\":" + std::to_string(event.start) + ",\"dur\":" + std::to_string(event.duration) + ids(event.tid);
+				if (!event.detail.empty())
+					str += ",\"args\":{\"detail\":" + JsonString(ucr::toUTF8(event.detail)) + "}";
+				append(str + "}");
+			}
+		}
+	}
+	json += "\n]}\n";
+
+	try
+	{
+		FileOutputStream fout(ucr::toUTF8(filename), std::ios::out | std::ios::binary | std::ios::trunc);
+		fout.write(json.data(), json.size());
+		fout.close();
+		return fout.good();
+	}
+	catch (Poco::Exception&)
+	{
+		return false;
+	}
+}
+
+}
@@ -0,0 +1,66 @@
+/**
+ * @file  PerfTrace.h
+ *
+ * @brief Declaration of the phase tracing of compares.
+ *
+ * Scoped trace points record how long each phase of a compare takes, into
+ * a ring buffer of the recording thread. The buffers are written as a
+ * Chrome trace JSON file, which chrome://tracing and Perfetto show as a
+ * timeline. Until tracing is enabled a trace point only checks a flag.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "UnicodeString.h"
+
+namespace perftrace
+{
+
+/** @brief Default number of events kept per thread, older events are overwritten. */
+constexpr size_t DefaultCapacity = 64 * 1024;
+
+extern std::atomic<bool> g_bEnabled;
+
+inline bool IsEnabled()
+{
+	return g_bEnabled.load(std::memory_order_relaxed);
+}
+
+void Enable(size_t capacity = DefaultCapacity);
+void Disable();
+int64_t Now();
+void Record(const char *name, int64_t start, int64_t duration, const String *detail = nullptr);
+bool Dump(const String& filename);
+
+/**
+ * @brief Records the time from its construction to its destruction.
+ * @p name must be a string literal and @p detail must outlive the scope,
+ * both are kept as pointers.
+ */
+class Scope
+{
+public:
+	explicit Scope(const char *name) : m_name(IsEnabled() ? name : nullptr), m_detail(nullptr), m_start(m_name ? Now() : 0) {}
+	Scope(const char *name, const String& detail) : m_name(IsEnabled() ? name : nullptr), m_detail(&detail), m_start(m_name ? Now() : 0) {}
+	~Scope()
+	{
+		if (m_name != nullptr)
+			Record(m_name, m_start, Now() - m_start, m_detail);
+	}
+	Scope(const char *name, String&& detail) = delete;
+	Scope(const Scope&) = delete;
+	Scope& operator=(const Scope&) = delete;
+
+private:
+	const char *m_name;
+	const String *m_detail;
+	int64_t m_start;
+};
+
+}
+
+#define PERFTRACE_CONCAT2(a, b) a##b
+#define PERFTRACE_CONCAT(a, b) PERFTRACE_CONCAT2(a, b)
+/** @brief Traces the rest of the enclosing block, with an optional String detail (e.g. a path). */
+#define PERFTRACE_SCOPE(...) perftrace::Scope PERFTRACE_CONCAT(perftraceScope, __LINE__)(__VA_ARGS__)
@@ -37,6 +37,32 @@ void PluginManager::FetchPluginInfos(const String& filteredFilenames,
 	*infoPrediffer = &fi->m_infoPrediffer;
 }
 
+/**
+ * @brief Copy the plugin settings known for particular comparisons
+ * The settings stay owned by the manager.
+ */
+void PluginManager::GetPluginInfos(PluginInfoTable& infos)
+{
+	FastMutex::ScopedLock lock(m_mutex);
+	infos.clear();
+	for (PluginFileInfoMap::iterator it = m_pluginSettings.begin(); it != m_pluginSettings.end(); ++it)
+		infos.emplace(it->first, std::make_pair(&it->second->m_infoUnpacker, &it->second->m_infoPrediffer));
+}
+
+/**
+ * @brief Store plugin settings resolved for specified comparison
+ */
+void PluginManager::SetPluginInfos(const String& filteredFilenames,
+                                   const PackingInfo& infoUnpacker,
+                                   const PrediffingInfo& infoPrediffer)
+{
+	PackingInfo * pInfoUnpacker = nullptr;
+	PrediffingInfo * pInfoPrediffer = nullptr;
+	FetchPluginInfos(filteredFilenames, &pInfoUnpacker, &pInfoPrediffer);
+	*pInfoUnpacker = infoUnpacker;
+	*pInfoPrediffer = infoPrediffer;
+}
+
 void PluginManager::SetUnpackerSettingAll(bool automatic)
 {
 	FastMutex::ScopedLock lock(m_mutex);
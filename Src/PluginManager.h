@@ -37,6 +37,10 @@ public:
 	virtual void FetchPluginInfos(const String& filteredFilenames, 
                                       PackingInfo ** infoUnpacker, 
                                       PrediffingInfo ** infoPrediffer) override;
+	virtual void GetPluginInfos(PluginInfoTable& infos) override;
+	virtual void SetPluginInfos(const String& filteredFilenames,
+                                    const PackingInfo& infoUnpacker,
+                                    const PrediffingInfo& infoPrediffer) override;
 private:
 	// Data
 	PluginFileInfoMap m_pluginSettings;
@@ -30,6 +30,7 @@ PropCompareFolder::PropCompareFolder(COptionsMgr *optionsMgr)
  , m_bIncludeSubdirs(false)
  , m_bExpandSubdirs(false)
  , m_bIgnoreReparsePoints(false)
+ , m_bDetectMoved(false)
  , m_nQuickCompareLimit(4 * Mega)
  , m_nBinaryCompareLimit(64 * Mega)
  , m_nCompareThreads(-1)
@@ -48,6 +49,7 @@ void PropCompareFolder::DoDataExchange(CDataExchange* pDX)
 	DDX_Check(pDX, IDC_RECURS_CHECK, m_bIncludeSubdirs);
 	DDX_Check(pDX, IDC_EXPAND_SUBDIRS, m_bExpandSubdirs);
 	DDX_Check(pDX, IDC_IGNORE_REPARSEPOINTS, m_bIgnoreReparsePoints);
+	DDX_Check(pDX, IDC_COMPARE_DETECT_MOVED, m_bDetectMoved);
 	DDX_Text(pDX, IDC_COMPARE_QUICKC_LIMIT, m_nQuickCompareLimit);
 	DDX_Text(pDX, IDC_COMPARE_BINARYC_LIMIT, m_nBinaryCompareLimit);
 	DDX_Text(pDX, IDC_COMPARE_THREAD_COUNT, m_nCompareThreads);
@@ -78,6 +80,7 @@ void PropCompareFolder::ReadOptions()
 	m_bIncludeSubdirs = GetOptionsMgr()->GetBool(OPT_CMP_INCLUDE_SUBDIRS);
 	m_bExpandSubdirs = GetOptionsMgr()->GetBool(OPT_DIRVIEW_EXPAND_SUBDIRS);
 	m_bIgnoreReparsePoints = GetOptionsMgr()->GetBool(OPT_CMP_IGNORE_REPARSE_POINTS);
+	m_bDetectMoved = GetOptionsMgr()->GetBool(OPT_CMP_DETECT_MOVED);
 	m_nQuickCompareLimit = GetOptionsMgr()->GetInt(OPT_CMP_QUICK_LIMIT) / Mega ;
 	m_nBinaryCompareLimit = GetOptionsMgr()->GetInt(OPT_CMP_BINARY_LIMIT) / Mega ;
 	m_nCompareThreadsPrev = GetOptionsMgr()->GetInt(OPT_CMP_COMPARE_THREADS);
@@ -101,6 +104,7 @@ void PropCompareFolder::WriteOptions()
 	GetOptionsMgr()->SaveOption(OPT_CMP_INCLUDE_SUBDIRS, m_bIncludeSubdirs);
 	GetOptionsMgr()->SaveOption(OPT_DIRVIEW_EXPAND_SUBDIRS, m_bExpandSubdirs);
 	GetOptionsMgr()->SaveOption(OPT_CMP_IGNORE_REPARSE_POINTS, m_bIgnoreReparsePoints);
+	GetOptionsMgr()->SaveOption(OPT_CMP_DETECT_MOVED, m_bDetectMoved);
 
 	if (m_nQuickCompareLimit > 2000)
 		m_nQuickCompareLimit = 2000;
@@ -150,6 +154,7 @@ void PropCompareFolder::OnDefaults()
 	m_bIncludeSubdirs = GetOptionsMgr()->GetDefault<bool>(OPT_CMP_INCLUDE_SUBDIRS);
 	m_bExpandSubdirs = GetOptionsMgr()->GetDefault<bool>(OPT_DIRVIEW_EXPAND_SUBDIRS);
 	m_bIgnoreReparsePoints = GetOptionsMgr()->GetDefault<bool>(OPT_CMP_IGNORE_REPARSE_POINTS);
+	m_bDetectMoved = GetOptionsMgr()->GetDefault<bool>(OPT_CMP_DETECT_MOVED);
 	m_nQuickCompareLimit = GetOptionsMgr()->GetDefault<unsigned>(OPT_CMP_QUICK_LIMIT) / Mega;
 	m_nBinaryCompareLimit = GetOptionsMgr()->GetDefault<unsigned>(OPT_CMP_BINARY_LIMIT) / Mega;
 	m_nCompareThreads = GetOptionsMgr()->GetDefault<unsigned>(OPT_CMP_COMPARE_THREADS);
@@ -42,6 +42,7 @@ public:
 	bool    m_bIncludeSubdirs;
 	bool    m_bExpandSubdirs;
 	bool    m_bIgnoreReparsePoints;
+	bool    m_bDetectMoved;
 	unsigned m_nQuickCompareLimit;
 	unsigned m_nBinaryCompareLimit;
 	int     m_nCompareThreads;
@@ -5,7 +5,6 @@
  */
 #include "pch.h"
 #include "PropertySystem.h"
-#include "HashCalc.h"
 #ifdef _WIN64
 #include <shobjidl.h>
 #include <propsys.h>
@@ -22,19 +21,22 @@
 static const PROPERTYKEY PKEY_HASH_MD5 = { {0xeca2d096, 0x7c87, 0x4dff, 0x94, 0xe7, 0xe7, 0xfe, 0x9b, 0xa3, 0x4b, 0xe8}, 100 };
 static const PROPERTYKEY PKEY_HASH_SHA1 ={ {0xeca2d096, 0x7c87, 0x4dff, 0x94, 0xe7, 0xe7, 0xfe, 0x9b, 0xa3, 0x4b, 0xe8}, 101 }; 
 static const PROPERTYKEY PKEY_HASH_SHA256 = { {0xeca2d096, 0x7c87, 0x4dff, 0x94, 0xe7, 0xe7, 0xfe, 0x9b, 0xa3, 0x4b, 0xe8}, 102 };
+static const PROPERTYKEY PKEY_HASH_XXH64 = { {0xeca2d096, 0x7c87, 0x4dff, 0x94, 0xe7, 0xe7, 0xfe, 0x9b, 0xa3, 0x4b, 0xe8}, 103 };
 
 struct PROPERTYINFO
 {
 	const PROPERTYKEY* pKey;
 	const wchar_t *pszCanonicalName;
 	const wchar_t *pszDisplayName;
+	HashAlgorithm algorithm;
 };
 
 static const PROPERTYINFO g_HashProperties[] =
 {
-	{ &PKEY_HASH_MD5,    L"Hash.MD5",    L"MD5" },
-	{ &PKEY_HASH_SHA1,   L"Hash.SHA1",   L"SHA1" },
-	{ &PKEY_HASH_SHA256, L"Hash.SHA256", L"SHA256" },
+	{ &PKEY_HASH_MD5,    L"Hash.MD5",    L"MD5",    HashAlgorithm::MD5 },
+	{ &PKEY_HASH_SHA1,   L"Hash.SHA1",   L"SHA1",   HashAlgorithm::SHA1 },
+	{ &PKEY_HASH_SHA256, L"Hash.SHA256", L"SHA256", HashAlgorithm::SHA256 },
+	{ &PKEY_HASH_XXH64,  L"Hash.XXH64",  L"XXH64",  HashAlgorithm::XXH64 },
 };
 
 static int GetPropertyIndexFromKey(const PROPERTYKEY& key)
@@ -57,24 +59,6 @@ static const PROPERTYKEY *GetPropertyKeyFromName(const String& canonicalName)
 	return nullptr;
 }
 
-static bool CalculateHashValue(const String& path, const PROPERTYKEY& key, PROPVARIANT& value)
-{
-	int i = GetPropertyIndexFromKey(key);
-	if (i >= 0)
-	{
-		std::vector<uint8_t> hash;
-		HANDLE hFile = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
-		if (hFile != INVALID_HANDLE_VALUE)
-		{
-			CalculateHashValue(hFile, g_HashProperties[i].pszDisplayName, hash);
-			CloseHandle(hFile);
-		}
-		InitPropVariantFromBuffer(hash.data(), static_cast<unsigned>(hash.size()), &value);
-		return true;
-	}
-	return false;
-}
-
 PropertyValues::PropertyValues() = default;
 
 PropertyValues::~PropertyValues()
@@ -139,11 +123,11 @@ bool PropertyValues::IsHashValue(size_t index) const
 	return (index < m_values.size() && m_values[index].vt == (VT_VECTOR | VT_UI1));
 }
 
-std::vector<uint8_t> PropertyValues::GetHashValue(size_t index) const
+HashDigest PropertyValues::GetHashValue(size_t index) const
 {
 	if (index >= m_values.size() || m_values[index].vt != (VT_VECTOR | VT_UI1))
 		return {};
-	return { m_values[index].caub.pElems, m_values[index].caub.pElems + m_values[index].caub.cElems };
+	return HashDigest(m_values[index].caub.pElems, m_values[index].caub.cElems);
 }
 
 PropertySystem::PropertySystem(ENUMFILTER filter)
@@ -196,6 +180,8 @@ void PropertySystem::AddProperties(const std::vector<String>& canonicalNames)
 			if (pKey)
 			{
 				key = *pKey;
+				m_hashIndexes.push_back(m_keys.size());
+				m_hashAlgorithms.push_back(g_HashProperties[GetPropertyIndexFromKey(key)].algorithm);
 				m_keys.push_back(key);
 				m_canonicalNames.push_back(name);
 			}
@@ -209,43 +195,36 @@ void PropertySystem::AddProperties(const std::vector<String>& canonicalNames)
 	}
 }
 
+/**
+ * @brief Get the values of the properties of a file.
+ * All hash properties are computed in one pass over the file.
+ * @return false if the values of properties other than hashes could not
+ *  be read, they are left empty.
+ */
 bool PropertySystem::GetPropertyValues(const String& path, PropertyValues& values)
 {
 	IPropertyStore* pps = nullptr;
+	bool result = false;
 	values.m_values.clear();
+	values.m_values.resize(m_keys.size());
 	if (!m_onlyHashProperties && SUCCEEDED(SHGetPropertyStoreFromParsingName(path.c_str(), nullptr, GPS_DEFAULT, IID_PPV_ARGS(&pps))))
 	{
-		values.m_values.reserve(m_keys.size());
-		for (const auto& key : m_keys)
+		for (size_t i = 0; i < m_keys.size(); ++i)
 		{
-			PROPVARIANT value{};
-			if (GetPropertyIndexFromKey(key) >= 0)
-				CalculateHashValue(path, key, value);
-			else
-				pps->GetValue(key, &value);
-			values.m_values.push_back(value);
+			if (GetPropertyIndexFromKey(m_keys[i]) < 0)
+				pps->GetValue(m_keys[i], &values.m_values[i]);
 		}
 		pps->Release();
-		return true;
+		result = true;
 	}
-	else
+	if (!m_hashIndexes.empty())
 	{
-		for (const auto& key : m_keys)
-		{
-			PROPVARIANT value2{};
-			if (GetPropertyIndexFromKey(key) >= 0)
-			{
-				CalculateHashValue(path, key, value2);
-			}
-			else
-			{
-				PROPVARIANT value{};
-				InitPropVariantFromString(_T("Error"), &value);
-			}
-			values.m_values.push_back(value2);
-		}
+		std::vector<HashDigest> digests;
+		CalculateHashValues(path, m_hashAlgorithms, digests);
+		for (size_t i = 0; i < m_hashIndexes.size(); ++i)
+			InitPropVariantFromBuffer(digests[i].data(), static_cast<unsigned>(digests[i].size()), &values.m_values[m_hashIndexes[i]]);
 	}
-	return false;
+	return result;
 }
 
 String PropertySystem::FormatPropertyValue(const PropertyValues& values, unsigned index)
@@ -307,12 +286,7 @@ bool PropertySystem::GetDisplayNames(std::vector<String>& names)
 
 bool PropertySystem::HasHashProperties() const
 {
-	for (const auto& key : m_keys)
-	{
-		if (GetPropertyIndexFromKey(key) >= 0)
-			return true;
-	}
-	return false;
+	return !m_hashIndexes.empty();
 }
 
 #else
@@ -350,7 +324,7 @@ bool PropertyValues::IsHashValue(size_t index) const
 	return false;
 }
 
-std::vector<uint8_t> PropertyValues::GetHashValue(size_t index) const
+HashDigest PropertyValues::GetHashValue(size_t index) const
 {
 	return {};
 }
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "UnicodeString.h"
+#include "HashCalc.h"
 #include <vector>
 #include <memory>
 #include <PropIdl.h>
@@ -21,7 +22,7 @@ public:
 	static int CompareAllValues(const PropertyValues& values1, const PropertyValues& values2);
 	bool IsEmptyValue(size_t index) const;
 	bool IsHashValue(size_t index) const;
-	std::vector<uint8_t> GetHashValue(size_t index) const;
+	HashDigest GetHashValue(size_t index) const;
 	size_t GetSize() const { return m_values.size(); }
 	void Resize(size_t size) { m_values.resize(size); }
 private:
@@ -51,5 +52,7 @@ private:
 	void AddProperties(const std::vector<String>& canonicalNames);
 	std::vector<String> m_canonicalNames;
 	std::vector<PROPERTYKEY> m_keys;
+	std::vector<size_t> m_hashIndexes; /**< Indexes of hash properties in m_keys */
+	std::vector<HashAlgorithm> m_hashAlgorithms; /**< Algorithms of hash properties */
 	bool m_onlyHashProperties = true;
 };
\ No newline at end of file
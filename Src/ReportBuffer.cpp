@@ -0,0 +1,122 @@
+/**
+ * @file  ReportBuffer.cpp
+ *
+ * @brief Implementation of ReportBuffer.
+ */
+#include "pch.h"
+#include "ReportBuffer.h"
+#include <cstring>
+#include <type_traits>
+#include "unicoder.h"
+
+namespace
+{
+
+/** @brief Longest output of one input unit: "&quot;" */
+constexpr size_t MaxOctetsPerUnit = 6;
+
+/**
+ * @brief Entity for @p ch, as CMarkdown::Entities() writes it.
+ * @return nullptr if @p ch is written as is.
+ */
+inline const char *GetEntity(unsigned ch)
+{
+	switch (ch)
+	{
+	case '&': return "&amp;";
+	case '"': return "&quot;";
+	case '\'': return "&apos;";
+	case '<': return "&lt;";
+	case '>': return "&gt;";
+	}
+	return nullptr;
+}
+
+/**
+ * @brief Write one ASCII unit, turning LF to CR LF and optionally special
+ * chars to entities.
+ */
+inline char *PutAscii(char *p, unsigned ch, bool bEntities)
+{
+	if (ch == '\n')
+	{
+		*p++ = '\r';
+		*p++ = '\n';
+	}
+	else if (const char *entity = bEntities ? GetEntity(ch) : nullptr)
+	{
+		size_t len = strlen(entity);
+		memcpy(p, entity, len);
+		p += len;
+	}
+	else
+		*p++ = static_cast<char>(ch);
+	return p;
+}
+
+}
+
+/**
+ * @brief Append text, encoded as UTF-8 or in the thread code page.
+ * @param [in] bEntities Write &, ", ', < and > as entities.
+ */
+void ReportBuffer::Append(const TCHAR *pchText, size_t cchText, bool bEntities)
+{
+#ifdef _UNICODE
+	const size_t start = m_octets.size();
+	m_octets.resize(start + cchText * MaxOctetsPerUnit);
+	char *const begin = &m_octets[start];
+	char *p = begin;
+	for (size_t i = 0; i < cchText; ++i)
+	{
+		unsigned uc = static_cast<std::make_unsigned_t<TCHAR>>(pchText[i]);
+		if (uc < 0x80)
+		{
+			p = PutAscii(p, uc, bEntities);
+			continue;
+		}
+		if (!m_bUTF8)
+		{
+			// Let the system code page conversion handle the whole fragment
+			m_octets.resize(start);
+			std::string sOctets = ucr::toThreadCP(String(pchText, cchText));
+			AppendOctets(sOctets.c_str(), sOctets.length(), bEntities);
+			return;
+		}
+		// Same surrogate handling as ucr::toUTF8()
+		if (uc >= 0xd800 && uc < 0xdc00 && i + 1 < cchText)
+		{
+			unsigned uc2 = static_cast<std::make_unsigned_t<TCHAR>>(pchText[++i]);
+			uc = ((uc & 0x3ff) << 10) + (uc2 & 0x3ff) + 0x10000;
+		}
+		p += ucr::Ucs4_to_Utf8(uc, reinterpret_cast<unsigned char *>(p));
+	}
+	m_octets.resize(start + (p - begin));
+#else
+	String sText(pchText, cchText);
+	std::string sOctets = m_bUTF8 ? ucr::toUTF8(sText) : ucr::toThreadCP(sText);
+	AppendOctets(sOctets.c_str(), sOctets.length(), bEntities);
+#endif
+}
+
+/**
+ * @brief Append encoded octets, turning LF to CR LF and optionally special
+ * chars to entities. Trail bytes of DBCS code pages are never below 0x40, so
+ * none of them is taken for one of these chars.
+ */
+void ReportBuffer::AppendOctets(const char *pchOctets, size_t cchOctets, bool bEntities)
+{
+	const size_t start = m_octets.size();
+	m_octets.resize(start + cchOctets * MaxOctetsPerUnit);
+	char *const begin = &m_octets[start];
+	char *p = begin;
+	for (size_t i = 0; i < cchOctets; ++i)
+	{
+		unsigned ch = static_cast<unsigned char>(pchOctets[i]);
+		if (ch < 0x80)
+			p = PutAscii(p, ch, bEntities);
+		else
+			*p++ = static_cast<char>(ch);
+	}
+	m_octets.resize(start + (p - begin));
+}
@@ -0,0 +1,42 @@
+/**
+ * @file  ReportBuffer.h
+ *
+ * @brief Declaration of ReportBuffer, which collects encoded report text.
+ */
+#pragma once
+
+#include <string>
+#include "UnicodeString.h"
+
+/**
+ * @brief Collects report text as UTF-8 or thread code page octets.
+ * Text is encoded, and optionally entity-escaped, in one pass straight into
+ * one growing octet string. Line feeds are written as CR LF, as reports have
+ * always been. Clear() keeps the storage, so the owner can flush the buffer
+ * in large writes whenever IsFull() and reuse it for the rest of the report.
+ */
+class ReportBuffer
+{
+public:
+	/** @brief Size at which the owner should write the buffer out. */
+	static constexpr size_t FlushSize = 1 << 20;
+
+	explicit ReportBuffer(bool bUTF8 = true) : m_bUTF8(bUTF8) {}
+	void SetUTF8(bool bUTF8) { m_bUTF8 = bUTF8; }
+	bool IsUTF8() const { return m_bUTF8; }
+	void Append(const String& sText) { Append(sText.c_str(), sText.length(), false); }
+	void Append(const TCHAR *pszText) { Append(pszText, _tcslen(pszText), false); }
+	void Append(const ReportBuffer& other) { m_octets.append(other.m_octets); }
+	void AppendEntities(const String& sText) { Append(sText.c_str(), sText.length(), true); }
+	void Append(const TCHAR *pchText, size_t cchText, bool bEntities);
+	const char *GetData() const { return m_octets.data(); }
+	size_t GetSize() const { return m_octets.size(); }
+	bool IsFull() const { return m_octets.size() >= FlushSize; }
+	void Clear() { m_octets.clear(); }
+
+private:
+	void AppendOctets(const char *pchOctets, size_t cchOctets, bool bEntities);
+
+	std::string m_octets;
+	bool m_bUTF8;
+};
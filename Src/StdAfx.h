@@ -58,6 +58,8 @@ const UINT MSG_UI_UPDATE = WM_USER + 1;
 const UINT MSG_STORE_PANESIZES = WM_USER + 2;
 /// Request to generate file compare report
 const UINT MSG_GENERATE_FLIE_COMPARE_REPORT = WM_USER + 3;
+/// Watched folders of a folder compare have changed
+const UINT MSG_WATCHED_FOLDERS_CHANGED = WM_USER + 4;
 /* @} */
 
 /// Seconds ignored in filetime differences if option enabled
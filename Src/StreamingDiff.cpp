@@ -0,0 +1,508 @@
+/**
+ * @file  StreamingDiff.cpp
+ *
+ * @brief Implementation of StreamingDiff, a line diff with bounded memory use.
+ */
+#include "pch.h"
+#include "StreamingDiff.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <io.h>
+#include "IAbortable.h"
+
+namespace
+{
+
+/** @brief Bytes checked for zero bytes to detect binary files. */
+constexpr size_t BinaryCheckSize = 8 * 1024;
+/** @brief Common lines skipped between checks for abort. */
+constexpr unsigned AbortCheckInterval = 0x10000;
+
+const char EmptyBuffer[1] = "";
+
+int hunk_func(long start_a, long count_a, long start_b, long count_b, void *cb_data)
+{
+	return 0;
+}
+
+bool HasEol(const xrecord_t& line)
+{
+	return line.size > 0 && (line.ptr[line.size - 1] == '\n' || line.ptr[line.size - 1] == '\r');
+}
+
+/**
+ * @brief Append a line of a patch, marking a missing newline at end of file
+ * as diffutils does.
+ */
+void AppendPatchLine(std::string& text, const char *prefix, const xrecord_t& line)
+{
+	text += prefix;
+	text.append(line.ptr, line.size);
+	if (!HasEol(line))
+		text += "\n\\ No newline at end of file\n";
+}
+
+/**
+ * @brief Writes changes in the diffutils "normal" format as they arrive.
+ */
+class NormalPatchWriter : public StreamingDiff::Listener
+{
+public:
+	explicit NormalPatchWriter(FILE *outfile) : m_outfile(outfile) {}
+
+	bool OnCommon(const xrecord_t& line) override { return true; }
+
+	bool OnChange(const xdiff_hunk& hunk, const xrecord_t *deleted, const xrecord_t *inserted) override
+	{
+		std::string text;
+		if (hunk.chg1 == 0)
+			text = std::to_string(hunk.i1) + 'a' + Range(hunk.i2, hunk.chg2);
+		else if (hunk.chg2 == 0)
+			text = Range(hunk.i1, hunk.chg1) + 'd' + std::to_string(hunk.i2);
+		else
+			text = Range(hunk.i1, hunk.chg1) + 'c' + Range(hunk.i2, hunk.chg2);
+		text += '\n';
+		for (long i = 0; i < hunk.chg1; ++i)
+			AppendPatchLine(text, "< ", deleted[i]);
+		if (hunk.chg1 > 0 && hunk.chg2 > 0)
+			text += "---\n";
+		for (long i = 0; i < hunk.chg2; ++i)
+			AppendPatchLine(text, "> ", inserted[i]);
+		return fwrite(text.data(), 1, text.size(), m_outfile) == text.size();
+	}
+
+private:
+	static std::string Range(long start, long count)
+	{
+		if (count == 1)
+			return std::to_string(start + 1);
+		return std::to_string(start + 1) + ',' + std::to_string(start + count);
+	}
+
+	FILE *m_outfile;
+};
+
+/**
+ * @brief Writes changes in the unified format.
+ * Changes closer than two contexts are merged into one hunk like diffutils
+ * does, unless the hunk text would grow over the size limit.
+ */
+class UnifiedPatchWriter : public StreamingDiff::Listener
+{
+public:
+	UnifiedPatchWriter(FILE *outfile, int nContext, size_t nMaxHunkSize)
+		: m_outfile(outfile), m_nContext(std::max(nContext, 0)), m_nMaxHunkSize(nMaxHunkSize)
+	{
+	}
+
+	bool OnCommon(const xrecord_t& line) override
+	{
+		if (!m_bOpen)
+		{
+			m_leading.emplace_back(line.ptr, line.size);
+			if (static_cast<int>(m_leading.size()) > m_nContext)
+				m_leading.pop_front();
+			return true;
+		}
+		AddLine(" ", line);
+		++m_count1;
+		++m_count2;
+		if (++m_nTrailing <= 2 * m_nContext)
+			return true;
+		// Too far from the next change: keep nContext lines of trailing
+		// context, the last nContext lines are leading context of the next hunk
+		const int nDrop = m_nTrailing - m_nContext;
+		for (int i = static_cast<int>(m_body.size()) - m_nContext; i < static_cast<int>(m_body.size()); ++i)
+			m_leading.push_back(m_body[i].substr(1));
+		m_body.resize(m_body.size() - nDrop);
+		m_count1 -= nDrop;
+		m_count2 -= nDrop;
+		return Flush();
+	}
+
+	bool OnChange(const xdiff_hunk& hunk, const xrecord_t *deleted, const xrecord_t *inserted) override
+	{
+		if (!m_bOpen)
+		{
+			m_bOpen = true;
+			m_start1 = hunk.i1 - static_cast<long>(m_leading.size());
+			m_start2 = hunk.i2 - static_cast<long>(m_leading.size());
+			m_count1 = m_count2 = static_cast<long>(m_leading.size());
+			for (const auto& line : m_leading)
+				m_body.push_back(' ' + line);
+			m_leading.clear();
+		}
+		for (long i = 0; i < hunk.chg1; ++i)
+			AddLine("-", deleted[i]);
+		for (long i = 0; i < hunk.chg2; ++i)
+			AddLine("+", inserted[i]);
+		m_count1 += hunk.chg1;
+		m_count2 += hunk.chg2;
+		m_nTrailing = 0;
+		return m_nBodySize <= m_nMaxHunkSize || Flush();
+	}
+
+	bool OnEnd() override
+	{
+		if (!m_bOpen)
+			return true;
+		if (m_nTrailing > m_nContext)
+		{
+			const int nDrop = m_nTrailing - m_nContext;
+			m_body.resize(m_body.size() - nDrop);
+			m_count1 -= nDrop;
+			m_count2 -= nDrop;
+		}
+		return Flush();
+	}
+
+private:
+	static std::string Range(long start, long count)
+	{
+		if (count == 1)
+			return std::to_string(start + 1);
+		if (count == 0)
+			return std::to_string(start) + ",0";
+		return std::to_string(start + 1) + ',' + std::to_string(count);
+	}
+
+	void AddLine(const char *prefix, const xrecord_t& line)
+	{
+		m_body.emplace_back();
+		AppendPatchLine(m_body.back(), prefix, line);
+		m_nBodySize += m_body.back().size();
+	}
+
+	bool Flush()
+	{
+		std::string header = "@@ -" + Range(m_start1, m_count1) + " +" + Range(m_start2, m_count2) + " @@\n";
+		bool bOk = fwrite(header.data(), 1, header.size(), m_outfile) == header.size();
+		for (const auto& line : m_body)
+			bOk = bOk && fwrite(line.data(), 1, line.size(), m_outfile) == line.size();
+		m_body.clear();
+		m_nBodySize = 0;
+		m_nTrailing = 0;
+		m_bOpen = false;
+		return bOk;
+	}
+
+	FILE *m_outfile;
+	int m_nContext;
+	size_t m_nMaxHunkSize;
+	std::deque<std::string> m_leading;
+	std::vector<std::string> m_body;
+	size_t m_nBodySize = 0;
+	bool m_bOpen = false;
+	long m_start1 = 0, m_start2 = 0;
+	long m_count1 = 0, m_count2 = 0;
+	int m_nTrailing = 0;
+};
+
+}
+
+/**
+ * @brief Reads a file a window at a time and splits it into lines like xdiff.
+ */
+class StreamingDiff::LineReader
+{
+public:
+	LineReader(int fd, size_t nWindowSize, unsigned long flags, FileTextStats& stats)
+		: m_fd(fd), m_buf(nWindowSize), m_begin(0), m_end(0), m_flags(flags)
+		, m_bEof(false), m_bError(false), m_bMissingNewline(false), m_stats(stats)
+	{
+	}
+
+	bool Eof() const { return m_bEof; }
+	bool Error() const { return m_bError; }
+	bool MissingNewline() const { return m_bMissingNewline; }
+
+	/**
+	 * @brief Get the next complete line without consuming it.
+	 * @return false at end of file or on read error.
+	 */
+	bool PeekLine(xrecord_t& rec)
+	{
+		for (;;)
+		{
+			const char *ptr = m_buf.data() + m_begin;
+			const char *top = m_buf.data() + m_end;
+			if (ptr < top)
+			{
+				const char *cur = ptr;
+				unsigned long ha = xdl_hash_record(&cur, top, static_cast<long>(m_flags));
+				// A line reaching the end of the buffer may continue (or be CR of CRLF)
+				if (cur < top || m_bEof)
+				{
+					rec = { nullptr, ptr, static_cast<long>(cur - ptr), ha };
+					return true;
+				}
+			}
+			else if (m_bEof)
+				return false;
+			if (!Read())
+				return false;
+		}
+	}
+
+	void Consume(const xrecord_t& rec)
+	{
+		CountEol(rec);
+		m_begin += rec.size;
+	}
+
+	/**
+	 * @brief Buffer a full window and return its complete lines.
+	 * A single line longer than the window is still read whole.
+	 */
+	bool FillWindow(std::vector<xrecord_t>& recs)
+	{
+		while (!m_bEof && m_end - m_begin < m_buf.size())
+		{
+			if (!Read())
+				return false;
+		}
+		for (;;)
+		{
+			mmfile_t mf = { m_buf.data() + m_begin, static_cast<long>(m_end - m_begin) };
+			xdiff_parallel::split_records(mf, m_flags, recs);
+			if (!m_bEof && !recs.empty() && recs.back().ptr + recs.back().size == m_buf.data() + m_end)
+				recs.pop_back();
+			if (!recs.empty() || m_bEof)
+				return true;
+			if (!Read())
+				return false;
+		}
+	}
+
+	void ConsumeLines(const std::vector<xrecord_t>& recs, long count)
+	{
+		for (long i = 0; i < count; ++i)
+			Consume(recs[i]);
+	}
+
+private:
+	/**
+	 * @brief Read more data after the unconsumed part of the buffer.
+	 * The buffer grows only when one line does not fit in it.
+	 */
+	bool Read()
+	{
+		if (m_begin > 0)
+		{
+			memmove(m_buf.data(), m_buf.data() + m_begin, m_end - m_begin);
+			m_end -= m_begin;
+			m_begin = 0;
+		}
+		if (m_end == m_buf.size())
+			m_buf.resize(m_buf.size() * 2);
+		const size_t nSpace = std::min<size_t>(m_buf.size() - m_end, INT_MAX);
+		const int nRead = _read(m_fd, m_buf.data() + m_end, static_cast<unsigned>(nSpace));
+		if (nRead < 0)
+		{
+			m_bError = true;
+			return false;
+		}
+		if (nRead == 0)
+			m_bEof = true;
+		m_end += nRead;
+		return true;
+	}
+
+	void CountEol(const xrecord_t& rec)
+	{
+		if (rec.size > 0 && rec.ptr[rec.size - 1] == '\n')
+		{
+			if (rec.size > 1 && rec.ptr[rec.size - 2] == '\r')
+				++m_stats.ncrlfs;
+			else
+				++m_stats.nlfs;
+		}
+		else if (rec.size > 0 && rec.ptr[rec.size - 1] == '\r')
+			++m_stats.ncrs;
+		else
+			m_bMissingNewline = true;
+	}
+
+	int m_fd;
+	std::vector<char> m_buf;
+	size_t m_begin; /**< Start of unconsumed data in m_buf */
+	size_t m_end; /**< End of data read into m_buf */
+	unsigned long m_flags;
+	bool m_bEof;
+	bool m_bError;
+	bool m_bMissingNewline;
+	FileTextStats& m_stats;
+};
+
+/**
+ * @brief Constructor.
+ * @param [in] xdl_flags xdiff flags, as from make_xdl_flags().
+ * @param [in] nMemoryLimit Approximate memory use limit in bytes. xdiff
+ * needs a few times the size of the text for its line tables, so each
+ * file is read a window of one eighth of the limit at a time.
+ */
+StreamingDiff::StreamingDiff(unsigned long xdl_flags, size_t nMemoryLimit)
+	: m_xdl_flags(xdl_flags)
+	, m_nWindowSize(std::max(nMemoryLimit, MinMemoryLimit) / 8)
+	, m_piAbortable(nullptr)
+	, m_nDiffs(0)
+	, m_nTrivialDiffs(0)
+	, m_bMissingNewline{ false, false }
+{
+}
+
+StreamingDiff::~StreamingDiff() = default;
+
+/**
+ * @brief Return true if the beginning of the file contains a zero byte.
+ * The file position is reset to the beginning of the file.
+ */
+bool StreamingDiff::LooksBinary(int fd)
+{
+	char buf[BinaryCheckSize];
+	const int nRead = _read(fd, buf, sizeof(buf));
+	_lseek(fd, 0, SEEK_SET);
+	return nRead > 0 && memchr(buf, 0, nRead) != nullptr;
+}
+
+/**
+ * @brief Create a listener writing the changes as a patch to @p outfile.
+ * @param [in] bUnified Unified format if true, diffutils "normal" format otherwise.
+ * @param [in] nMaxHunkSize Unified hunks bigger than this (in bytes) are
+ * split instead of merged with the following change.
+ */
+std::unique_ptr<StreamingDiff::Listener> StreamingDiff::CreatePatchWriter(FILE *outfile, bool bUnified, int nContext, size_t nMaxHunkSize)
+{
+	if (bUnified)
+		return std::make_unique<UnifiedPatchWriter>(outfile, nContext, nMaxHunkSize);
+	return std::make_unique<NormalPatchWriter>(outfile);
+}
+
+/**
+ * @brief Compare two files, reading both from their current position.
+ * @param [in] pListener Receives common lines and changes, can be `nullptr`
+ * when only the counts are needed.
+ */
+StreamingDiff::Result StreamingDiff::Compare(int fd1, int fd2, Listener *pListener)
+{
+	m_nDiffs = 0;
+	m_nTrivialDiffs = 0;
+	m_textStats[0].clear();
+	m_textStats[1].clear();
+	m_bMissingNewline[0] = m_bMissingNewline[1] = false;
+	if (fd1 == fd2)
+		return (pListener == nullptr || pListener->OnEnd()) ? Result::Same : Result::Error;
+
+	LineReader reader1(fd1, m_nWindowSize, m_xdl_flags, m_textStats[0]);
+	LineReader reader2(fd2, m_nWindowSize, m_xdl_flags, m_textStats[1]);
+	long line1 = 0, line2 = 0;
+	for (unsigned nLines = 0; ; ++nLines)
+	{
+		if (nLines % AbortCheckInterval == 0 && m_piAbortable != nullptr && m_piAbortable->ShouldAbort())
+			return Result::Aborted;
+
+		xrecord_t rec1, rec2;
+		const bool bHasLine1 = reader1.PeekLine(rec1);
+		const bool bHasLine2 = reader2.PeekLine(rec2);
+		if (reader1.Error() || reader2.Error())
+			return Result::Error;
+		if (bHasLine1 && bHasLine2 && rec1.ha == rec2.ha &&
+			xdl_recmatch(rec1.ptr, rec1.size, rec2.ptr, rec2.size, static_cast<long>(m_xdl_flags)))
+		{
+			if (pListener != nullptr && !pListener->OnCommon(rec1))
+				return Result::Error;
+			reader1.Consume(rec1);
+			reader2.Consume(rec2);
+			++line1;
+			++line2;
+			continue;
+		}
+		if (!bHasLine1 && !bHasLine2)
+			break;
+
+		long nConsumed1 = 0, nConsumed2 = 0;
+		if (!DiffWindow(reader1, reader2, line1, line2, pListener, nConsumed1, nConsumed2))
+			return Result::Error;
+		line1 += nConsumed1;
+		line2 += nConsumed2;
+	}
+	m_bMissingNewline[0] = reader1.MissingNewline();
+	m_bMissingNewline[1] = reader2.MissingNewline();
+	if (pListener != nullptr && !pListener->OnEnd())
+		return Result::Error;
+	return (m_nDiffs + m_nTrivialDiffs > 0) ? Result::Different : Result::Same;
+}
+
+/**
+ * @brief Diff the buffered windows up to their last unique common line.
+ * @param [in] line1 Line number of the first line in the window of file 1.
+ * @param [in] line2 Line number of the first line in the window of file 2.
+ * @param [out] nConsumed1 Lines of file 1 done with.
+ * @param [out] nConsumed2 Lines of file 2 done with.
+ */
+bool StreamingDiff::DiffWindow(LineReader& reader1, LineReader& reader2, long line1, long line2,
+	Listener *pListener, long& nConsumed1, long& nConsumed2)
+{
+	std::vector<xrecord_t> recs1, recs2;
+	if (!reader1.FillWindow(recs1) || !reader2.FillWindow(recs2))
+		return false;
+
+	long n1 = static_cast<long>(recs1.size());
+	long n2 = static_cast<long>(recs2.size());
+	if (!reader1.Eof() || !reader2.Eof())
+	{
+		// The lines after the last anchor are compared again with the
+		// following data. Without an anchor the whole window is a change.
+		const std::vector<std::pair<long, long>> anchors = xdiff_parallel::find_anchors(recs1, recs2, m_xdl_flags);
+		if (!anchors.empty())
+		{
+			n1 = anchors.back().first;
+			n2 = anchors.back().second;
+		}
+	}
+
+	mmfile_t mf1, mf2;
+	mf1.ptr = const_cast<char *>(n1 > 0 ? recs1[0].ptr : EmptyBuffer);
+	mf1.size = n1 > 0 ? static_cast<long>(recs1[n1 - 1].ptr + recs1[n1 - 1].size - recs1[0].ptr) : 0;
+	mf2.ptr = const_cast<char *>(n2 > 0 ? recs2[0].ptr : EmptyBuffer);
+	mf2.size = n2 > 0 ? static_cast<long>(recs2[n2 - 1].ptr + recs2[n2 - 1].size - recs2[0].ptr) : 0;
+
+	xpparam_t xpp = { 0 };
+	xdemitconf_t xecfg = { 0 };
+	xdemitcb_t ecb = { 0 };
+	xdfenv_t xe;
+	xdchange_t *xscr = nullptr;
+	xpp.flags = m_xdl_flags;
+	xecfg.hunk_func = hunk_func;
+	if (xdl_diff_modified(&mf1, &mf2, &xpp, &xecfg, &ecb, &xe, &xscr) != 0)
+		return false;
+
+	bool bOk = true;
+	long next1 = 0;
+	for (xdchange_t *xcur = xscr; xcur && bOk; xcur = xcur->next)
+	{
+		for (; pListener != nullptr && bOk && next1 < xcur->i1; ++next1)
+			bOk = pListener->OnCommon(recs1[next1]);
+		const xdiff_hunk hunk = { line1 + xcur->i1, line2 + xcur->i2, xcur->chg1, xcur->chg2, xcur->ignore };
+		if (xcur->ignore)
+			++m_nTrivialDiffs;
+		else
+			++m_nDiffs;
+		if (pListener != nullptr && bOk)
+			bOk = pListener->OnChange(hunk, recs1.data() + xcur->i1, recs2.data() + xcur->i2);
+		next1 = xcur->i1 + xcur->chg1;
+	}
+	for (; pListener != nullptr && bOk && next1 < n1; ++next1)
+		bOk = pListener->OnCommon(recs1[next1]);
+	xdl_free_script(xscr);
+	xdl_free_env(&xe);
+
+	reader1.ConsumeLines(recs1, n1);
+	reader2.ConsumeLines(recs2, n2);
+	nConsumed1 = n1;
+	nConsumed2 = n2;
+	return bOk;
+}
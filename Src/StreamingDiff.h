@@ -0,0 +1,71 @@
+/**
+ * @file  StreamingDiff.h
+ *
+ * @brief Declaration of StreamingDiff, a line diff with bounded memory use.
+ */
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include "FileTextStats.h"
+#include "xdiff_parallel.h"
+
+class IAbortable;
+
+/**
+ * @brief Compares two text files of any size within a memory budget.
+ * Both files are read through fixed size windows. Common lines are skipped
+ * a line at a time; at a difference both windows are filled, the changes up
+ * to the last unique line common to both windows are found with xdiff, and
+ * reading continues from that line. Only the current window has a line table.
+ *
+ * The result is a valid diff but not always a minimal one: a window without
+ * any unique common line is reported as one change, and changes are never
+ * moved across window boundaries.
+ */
+class StreamingDiff
+{
+public:
+	/** @brief Receives the result in file order. Lines are valid during the call only. */
+	class Listener
+	{
+	public:
+		virtual ~Listener() = default;
+		virtual bool OnCommon(const xrecord_t& line) = 0;
+		virtual bool OnChange(const xdiff_hunk& hunk, const xrecord_t *deleted, const xrecord_t *inserted) = 0;
+		virtual bool OnEnd() { return true; }
+	};
+
+	enum class Result { Same, Different, Error, Aborted };
+
+	/** @brief Smallest accepted memory budget. */
+	static constexpr size_t MinMemoryLimit = 1024 * 1024;
+
+	StreamingDiff(unsigned long xdl_flags, size_t nMemoryLimit);
+	~StreamingDiff();
+
+	void SetAbortable(const IAbortable * piAbortable) { m_piAbortable = piAbortable; }
+	Result Compare(int fd1, int fd2, Listener *pListener = nullptr);
+	int GetDiffCount() const { return m_nDiffs; }
+	int GetTrivialDiffCount() const { return m_nTrivialDiffs; }
+	bool IsMissingNewline(int side) const { return m_bMissingNewline[side]; }
+	void GetTextStats(int side, FileTextStats *stats) const { *stats = m_textStats[side]; }
+	size_t GetWindowSize() const { return m_nWindowSize; }
+
+	static bool LooksBinary(int fd);
+	static std::unique_ptr<Listener> CreatePatchWriter(FILE *outfile, bool bUnified, int nContext, size_t nMaxHunkSize);
+
+private:
+	class LineReader;
+
+	bool DiffWindow(LineReader& reader1, LineReader& reader2, long line1, long line2,
+		Listener *pListener, long& nConsumed1, long& nConsumed2);
+
+	unsigned long m_xdl_flags;
+	size_t m_nWindowSize; /**< Bytes read ahead per file when looking for the end of a change */
+	const IAbortable *m_piAbortable;
+	int m_nDiffs;
+	int m_nTrivialDiffs;
+	bool m_bMissingNewline[2];
+	FileTextStats m_textStats[2];
+};
@@ -12,4 +12,7 @@ public:
 	void copyTo(const String& path) const { File::copyTo(ucr::toUTF8(path)); }
 	void moveTo(const String& path) { File::moveTo(ucr::toUTF8(path)); }
 	void renameTo(const String& path) { File::renameTo(ucr::toUTF8(path)); }
+#ifndef _WIN32
+	const std::string& wpath() const { return path(); }
+#endif
 };
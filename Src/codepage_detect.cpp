@@ -17,6 +17,7 @@
 #include "FileTextEncoding.h"
 #include "paths.h"
 #include "markdown.h"
+#include "PerfTrace.h"
 
 /**
  * @brief Prefixes to handle when searching for codepage names
@@ -196,6 +197,7 @@ namespace codepage_detect
  */
 FileTextEncoding Guess(const String& ext, const void * src, size_t len, int guessEncodingType)
 {
+	PERFTRACE_SCOPE("codepage_detect::Guess");
 	FileTextEncoding encoding;
 	encoding.SetUnicoding(ucr::DetermineEncoding(reinterpret_cast<const unsigned char *>(src), len, &encoding.m_bom));
 	if (encoding.m_unicoding != ucr::NONE)
@@ -39,9 +39,7 @@ the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
 #include "diff.h"
 #include "cmpbuf.h"
 #include <assert.h>
-#ifdef _WIN32
-#  include <io.h>
-#endif
+#include <io.h>
 
 DECL_TLS int no_discards;
 DECL_TLS int need_free_buffers=0;
@@ -875,7 +873,7 @@ struct change * diff_2_files (struct file_data filevec[], int depth, int * bin_s
 			{
 				//  Read a buffer's worth from both files.  
 				for (i = 0; i < 2; i++)
-					while (filevec[i].buffered_chars < buffer_size)
+					while (!filevec[i].preloaded && filevec[i].buffered_chars < buffer_size)
 					  {
 						int r = _read (filevec[i].desc,
 									   filevec[i].buffer	+ filevec[i].buffered_chars,
@@ -304,6 +304,10 @@ struct file_data {
 
     /* text stats for WinMerge */
     int count_crlfs, count_crs, count_lfs, count_zeros;
+
+    /* WinMerge: nonzero if the whole (transcoded) text is already in
+       buffer, so nothing is read from desc. */
+    int preloaded;
 };
 
 /* Describe the two files currently being compared.  */
@@ -389,6 +393,10 @@ extern char const version_string[];
 /* mystat.cpp */
 int myfstat(int fd, struct _stat64 *buf);
 int mywstat(const wchar_t *filename, struct _stat64 *buf);
+#else
+/* mystat.cpp */
+int myfstat(int fd, struct stat *buf);
+int mywstat(const char *filename, struct stat *buf);
 #endif
 
 #ifdef __cplusplus
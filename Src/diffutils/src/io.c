@@ -20,6 +20,7 @@ the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
 #include "diff.h"
 #include <io.h>
 #include <assert.h>
+#include <stdint.h>
 
 /* Rotate a value n bits to the left. */
 #define UINT_BIT (sizeof (unsigned) * CHAR_BIT)
@@ -140,8 +141,14 @@ int
 sip (struct file_data *current, int skip_test)
 {
   int isbinary = 0;
+  if (current->preloaded)
+    {
+      /* WinMerge: the text was converted in memory by the caller. */
+      if (!skip_test && !get_unicode_signature(current, NULL))
+        isbinary = binary_file_p(current->buffer, current->buffered_chars);
+    }
   /* If we have a nonexistent file (or NUL: device) at this stage, treat it as empty.  */
-  if (current->desc < 0 || !(S_ISREG (current->stat.st_mode)))
+  else if (current->desc < 0 || !(S_ISREG (current->stat.st_mode)))
     {
       /* Leave room for a sentinel.  */
       current->buffer = xmalloc (sizeof (word));
@@ -184,8 +191,8 @@ slurp (struct file_data *current)
 {
   size_t cc;
 
-  if (current->desc < 0)
-    /* The file is nonexistent.  */
+  if (current->desc < 0 || current->preloaded)
+    /* The file is nonexistent, or already in memory.  */
     ;
   else if (always_text_flag || current->buffered_chars != 0)
     {
@@ -256,6 +263,54 @@ ISWSPACE (char ch)
   return ch==' ' || ch=='\t';
 }
 
+#define ONES64 0x0101010101010101ULL
+#define HAS_ZERO_BYTE(v) (((v) - ONES64) & ~(v) & (ONES64 * 0x80))
+#define HAS_EOL_BYTE(v) \
+  (HAS_ZERO_BYTE ((v) ^ (ONES64 * '\n')) | HAS_ZERO_BYTE ((v) ^ (ONES64 * '\r')))
+
+/* Return the first '\n' or '\r' in [P, END), or END if there is none.
+   Eight bytes are tested at a time. */
+static char const HUGE *
+find_eol_byte (char const HUGE *p, char const HUGE *end)
+{
+  uint64_t w;
+
+  for (; end - p >= 8; p += 8)
+    {
+      memcpy (&w, p, 8);
+      if (HAS_EOL_BYTE (w))
+        break;
+    }
+  while (p < end && *p != '\n' && *p != '\r')
+    p++;
+  return p;
+}
+
+/* Hash [P, END) eight bytes at a time.  Used instead of HASH when lines
+   are compared verbatim; equal lines still get equal hashes, so the
+   equivalence classes are the same. */
+static unsigned
+hash_line_bytes (char const HUGE *p, char const HUGE *end)
+{
+  uint64_t h = (uint64_t) (end - p) * 0x9E3779B97F4A7C15ULL;
+  uint64_t w;
+
+  for (; end - p >= 8; p += 8)
+    {
+      memcpy (&w, p, 8);
+      h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+      h ^= h >> 29;
+    }
+  if (p < end)
+    {
+      w = 0;
+      memcpy (&w, p, end - p);
+      h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+      h ^= h >> 29;
+    }
+  return (unsigned) (h ^ (h >> 32));
+}
+
 /* Split the file into lines, simultaneously computing the equivalence class for
    each line. */
 static void
@@ -299,7 +354,18 @@ find_and_hash_each_line (struct file_data *current)
          respecting UNIX (\r), MS-DOS/Windows (\r\n), and MAC (\r) eols */
 
       /* Hash this line until we find a newline. */
-      if (ignore_case_flag)
+      if (!ignore_case_flag && !ignore_all_space_flag
+          && !ignore_space_change_flag && !ignore_numbers_flag)
+        {
+          /* Same line end as below: \n, or \r not followed by \n.
+             The \r of \r\n is hashed. */
+          char const HUGE *eol = find_eol_byte (ip, bufend);
+          if (eol < bufend - 1 && eol[0] == '\r' && eol[1] == '\n')
+            eol++;
+          h = hash_line_bytes (ip, eol);
+          p = (unsigned char const HUGE *) eol + 1;
+        }
+      else if (ignore_case_flag)
         {
           if (ignore_all_space_flag)
             while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
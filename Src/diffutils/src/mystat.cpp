@@ -3,6 +3,7 @@
 #include <sys/stat.h>
 #include <io.h>
 #include <cerrno>
+#ifdef _WIN32
 #include <Windows.h>
 
 inline time_t filetime_to_time_t(const FILETIME& ft)
@@ -91,3 +92,17 @@ extern "C" int mywstat(const wchar_t *filename, struct _stat64 *buf)
 	set_statbuf(ffd, *buf);
 	return 0;
 }
+
+#else
+
+extern "C" int myfstat(int fd, struct stat *buf)
+{
+	return fstat(fd, buf);
+}
+
+extern "C" int mywstat(const char *filename, struct stat *buf)
+{
+	return stat(filename, buf);
+}
+
+#endif
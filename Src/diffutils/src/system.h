@@ -30,6 +30,9 @@ the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#ifndef _WIN32
+#define _stat64 stat
+#endif
 
 #if STAT_MACROS_BROKEN
 #undef S_ISBLK
@@ -187,7 +190,7 @@ char *memchr ();
 extern int errno;
 #endif
 
-#ifndef min
+#if !defined(min) && !defined(__cplusplus)
 #define min(a,b) ((a) <= (b) ? (a) : (b))
 #define max(a,b) ((a) >= (b) ? (a) : (b))
 #endif
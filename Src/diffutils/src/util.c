@@ -64,7 +64,11 @@ pfatal_with_name (char const *text)
   errno = e;
   perror (text);
   //exit (2);
+#ifdef _WIN32
   RaiseException(STATUS_ACCESS_VIOLATION, 0, 0, NULL);
+#else
+  abort ();
+#endif
 }
 
 /* Print an error message from the format-string FORMAT
@@ -86,7 +90,11 @@ fatal (char const *m)
   print_message_queue ();
   error ("%s", m, 0);
   //exit (2);
+#ifdef _WIN32
   RaiseException(STATUS_ACCESS_VIOLATION, 0, 0, NULL);
+#else
+  abort ();
+#endif
 }
 
 /* Like printf, except if -l in effect then save the message and print later.
@@ -9,12 +9,18 @@
 #include <windows.h>
 #include <cassert>
 #include <cstring>
+#ifdef _WIN32
 #include <direct.h>
 #pragma warning (push)			// prevent "warning C4091: 'typedef ': ignored on left of 'tagGPFIDL_FLAGS' when no variable is declared"
 #pragma warning (disable:4091)	// VC bug when using XP enabled toolsets.
 #include <shlobj.h>
 #pragma warning (pop)
 #include <shlwapi.h>
+#else
+#include <sys/stat.h>
+#include <Poco/Exception.h>
+#include <Poco/Path.h>
+#endif
 #include "PathContext.h"
 #include "coretools.h"
 #include "TFile.h"
@@ -23,7 +29,9 @@ namespace paths
 {
 
 static bool IsSlash(const String& pszStart, size_t nPos);
+#ifdef _WIN32
 static bool GetDirName(const String& sDir, String& sName);
+#endif
 
 /** 
  * @brief Checks if char in string is slash.
@@ -66,6 +74,7 @@ PATH_EXISTENCE DoesPathExist(const String& szPath, bool (*IsArchiveFile)(const S
 	if (szPath.empty())
 		return DOES_NOT_EXIST;
 
+#ifdef _WIN32
 	// Expand environment variables:
 	// Convert "%userprofile%\My Documents" to "C:\Documents and Settings\username\My Documents"
 	const TCHAR *lpcszPath = szPath.c_str();
@@ -79,6 +88,11 @@ PATH_EXISTENCE DoesPathExist(const String& szPath, bool (*IsArchiveFile)(const S
 	}
 
 	DWORD attr = GetFileAttributes(TFile(String(lpcszPath)).wpath().c_str());
+#else
+	struct stat st;
+	DWORD attr = (stat(szPath.c_str(), &st) != 0) ? ((DWORD) -1) :
+		S_ISDIR(st.st_mode) ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_NORMAL;
+#endif
 
 	if (attr == ((DWORD) -1))
 	{
@@ -120,7 +134,13 @@ String FindFileName(const String& path)
  */
 String FindExtension(const String& path)
 {
+#ifdef _WIN32
 	return ::PathFindExtension(path.c_str());
+#else
+	const String filename = FindFileName(path);
+	const size_t pos = filename.rfind('.');
+	return (pos != String::npos) ? filename.substr(pos) : _T("");
+#endif
 }
 
 String RemoveExtension(const String& path)
@@ -160,6 +180,7 @@ void normalize(String & sPath)
  * @return true if canonical name exists.
  * @todo Should we return empty string as sName when returning false?
  */
+#ifdef _WIN32
 static bool GetDirName(const String& sDir, String& sName)
 {
 	// FindFirstFile doesn't work for root:
@@ -189,6 +210,7 @@ static bool GetDirName(const String& sDir, String& sName)
 	FindClose(h);
 	return true;
 }
+#endif
 
 /**
  * Convert path to canonical long path.
@@ -208,6 +230,7 @@ String GetLongPath(const String& szPath, bool bExpandEnvs)
 	if (len < 1)
 		return sPath;
 
+#ifdef _WIN32
 	TCHAR fullPath[MAX_PATH_FULL] = {0};
 	TCHAR *pFullPath = &fullPath[0];
 	TCHAR *lpPart;
@@ -299,6 +322,19 @@ String GetLongPath(const String& szPath, bool bExpandEnvs)
 		FindClose(h);
 	}
 	return sLong;
+#else
+	// Make the path absolute and resolve . and .., like GetFullPathName()
+	if (bExpandEnvs && sPath.find('$') != String::npos)
+		sPath = Poco::Path::expand(sPath);
+	try
+	{
+		return Poco::Path(sPath).makeAbsolute().toString();
+	}
+	catch (Poco::Exception&)
+	{
+		return sPath;
+	}
+#endif
 }
 
 /**
@@ -315,6 +351,7 @@ bool CreateIfNeeded(const String& szPath)
 	if (szPath.empty())
 		return false;
 
+#ifdef _WIN32
 	String sTemp;
 	if (GetDirName(szPath, sTemp))
 		return true;
@@ -382,6 +419,19 @@ bool CreateIfNeeded(const String& szPath)
 			*end = '\\';
 	}
 	return true;
+#else
+	if (IsDirectory(szPath))
+		return true;
+	try
+	{
+		TFile(szPath).createDirectories();
+	}
+	catch (Poco::Exception&)
+	{
+		return false;
+	}
+	return IsDirectory(szPath);
+#endif
 }
 
 /** 
@@ -434,6 +484,7 @@ PATH_EXISTENCE GetPairComparability(const PathContext & paths, bool (*IsArchiveF
  */
 bool IsShortcut(const String& inPath)
 {
+#ifdef _WIN32
 	const TCHAR ShortcutExt[] = _T(".lnk");
 	TCHAR ext[_MAX_EXT] = {0};
 	_tsplitpath_s(inPath.c_str(), nullptr, 0, nullptr, 0, nullptr, 0, ext, _MAX_EXT);
@@ -441,11 +492,19 @@ bool IsShortcut(const String& inPath)
 		return true;
 	else
 		return false;
+#else
+	return false;
+#endif
 }
 
 bool IsDirectory(const String &path)
 {
+#ifdef _WIN32
 	return !!PathIsDirectory(path.c_str());
+#else
+	struct stat st;
+	return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+#endif
 }
 
 //////////////////////////////////////////////////////////////////
@@ -470,6 +529,7 @@ String ExpandShortcut(const String &inFile)
 	if (inFile.empty())
 		return _T("");
 
+#ifdef _WIN32
 	String outFile;
 	IShellLink* psl;
 	HRESULT hres;
@@ -504,6 +564,9 @@ String ExpandShortcut(const String &inFile)
 
 	// if this fails, outFile == ""
 	return outFile;
+#else
+	return _T("");
+#endif
 }
 
 /** 
@@ -533,7 +596,7 @@ String ConcatPath(const String & path, const String & subpath)
 		}
 		else
 		{
-			return path + _T("\\") + subpath;
+			return path + PathSeparator + subpath;
 		}
 	}
 }
@@ -551,19 +614,23 @@ String GetParentPath(const String& path)
 	size_t len = parentPath.length();
 
 	// Remove last '\' from paths
-	if (parentPath[len - 1] == '\\')
+	if (parentPath[len - 1] == PathSeparator)
 	{
 		parentPath.resize(len - 1);
 		--len;
 	}
 
 	// Remove last part of path
-	size_t pos = parentPath.rfind('\\');
+	size_t pos = parentPath.rfind(PathSeparator);
 
 	if (pos != parentPath.npos)
 	{
 		// Do not remove trailing slash from root directories
+#ifdef _WIN32
 		parentPath.resize(pos == 2 ? pos + 1 : pos);
+#else
+		parentPath.resize(pos == 0 ? pos + 1 : pos);
+#endif
 	}
 	return parentPath;
 }
@@ -583,14 +650,14 @@ String GetLastSubdir(const String & path)
 	size_t len = parentPath.length();
 
 	// Remove last '\' from paths
-	if (parentPath[len - 1] == '\\')
+	if (parentPath[len - 1] == PathSeparator)
 	{
 		parentPath.erase(len - 1, 1);
 		--len;
 	}
 
 	// Find last part of path
-	size_t pos = parentPath.find_last_of('\\');
+	size_t pos = parentPath.find_last_of(PathSeparator);
 	if (pos >= 2 && pos != String::npos)
 		parentPath.erase(0, pos);
 	return parentPath;
@@ -603,6 +670,7 @@ String GetLastSubdir(const String & path)
  */
 bool IsPathAbsolute(const String &path)
 {
+#ifdef _WIN32
 	if (path.length() < 3)
 		return false;
 	
@@ -622,6 +690,9 @@ bool IsPathAbsolute(const String &path)
 		return true;
 	else
 		return false;
+#else
+	return !path.empty() && path[0] == '/';
+#endif
 }
 
 /**
@@ -789,7 +860,11 @@ String ToUnixPath(const String& path)
 bool IsValidName(const String& name)
 {
 	for (String::const_iterator it = name.begin(); it != name.end(); ++it)
+#ifdef _WIN32
 		if (!(PathGetCharType(*it) & GCT_LFNCHAR))
+#else
+		if (*it == '/' || *it == '\0')
+#endif
 			return false;
 
 	return true;
@@ -25,6 +25,13 @@ typedef enum
 	IS_EXISTING_DIR, /**< It is existing folder */
 } PATH_EXISTENCE;
 
+/** @brief Separator of the folder names in the paths of this platform. */
+#ifdef _WIN32
+inline constexpr TCHAR PathSeparator = '\\';
+#else
+inline constexpr TCHAR PathSeparator = '/';
+#endif
+
 bool EndsWithSlash(const String& s);
 
 PATH_EXISTENCE DoesPathExist(const String& szPath, bool (*IsArchiveFile)(const String&) = nullptr);
@@ -48,7 +55,7 @@ String GetPathOnly(const String& fullpath);
 bool IsURL(const String& path);
 bool IsURLorCLSID(const String& path);
 bool IsDecendant(const String& path, const String& ancestor);
-inline String AddTrailingSlash(const String& path) { return !EndsWithSlash(path) ? path + _T("\\") : path; }
+inline String AddTrailingSlash(const String& path) { return !EndsWithSlash(path) ? path + PathSeparator : path; }
 String ToWindowsPath(const String& path);
 String ToUnixPath(const String& path);
 bool IsValidName(const String& name);
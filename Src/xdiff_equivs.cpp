@@ -0,0 +1,130 @@
+/**
+ * @file  xdiff_equivs.cpp
+ *
+ * @brief Implementation of EquivClassTable.
+ */
+#include "pch.h"
+#include "xdiff_equivs.h"
+#include <cstdint>
+
+namespace
+{
+
+constexpr size_t MinSlots = 64;
+constexpr int MinShift = 64 - 6;
+constexpr size_t InitialSlotsMax = 1 << 16;
+
+}
+
+EquivClassTable::EquivClassTable()
+	: m_nUsed(0), m_shift(MinShift)
+{
+}
+
+/**
+ * @brief Forget all classes and size the table for @p nExpectedLines lines.
+ */
+void EquivClassTable::Clear(size_t nExpectedLines)
+{
+	size_t nSlots = MinSlots;
+	int shift = MinShift;
+	// Lines are often repeated, so start at most at a cache friendly size
+	// and let Append() grow the table when there are more distinct lines.
+	while (nSlots < nExpectedLines * 2 && nSlots < InitialSlotsMax)
+	{
+		nSlots *= 2;
+		--shift;
+	}
+	// Do not hold on to the memory of one huge compare
+	if (m_slots.capacity() > MaxRetainedSlots)
+	{
+		std::vector<Slot>().swap(m_slots);
+		std::vector<ChainNode>().swap(m_chain);
+		std::vector<const xrecord_t *>().swap(m_classes);
+	}
+	m_slots.assign(nSlots, Slot{ 0, -1, -1 });
+	m_chain.clear();
+	m_classes.clear();
+	m_nUsed = 0;
+	m_shift = shift;
+}
+
+/**
+ * @brief Assign class ids to @p nrec lines, continuing the existing classes.
+ * @param [out] equivs Receives the class id of each line.
+ */
+void EquivClassTable::Append(xrecord_t * const *recs, long nrec, int *equivs, unsigned long xdl_flags)
+{
+	for (long i = 0; i < nrec; ++i)
+	{
+		const xrecord_t *rec = recs[i];
+		if ((m_nUsed + 1) * 2 > m_slots.size())
+			Resize(m_slots.empty() ? MinSlots : m_slots.size() * 2);
+
+		size_t index = SlotIndex(rec->ha);
+		while (m_slots[index].cls >= 0 && m_slots[index].ha != rec->ha)
+			index = (index + 1) & (m_slots.size() - 1);
+
+		Slot& slot = m_slots[index];
+		if (slot.cls < 0)
+		{
+			slot.ha = rec->ha;
+			slot.cls = NewClass(rec);
+			++m_nUsed;
+			equivs[i] = slot.cls;
+			continue;
+		}
+
+		int cls = -1;
+		const xrecord_t *first = m_classes[slot.cls];
+		if (xdl_recmatch(first->ptr, first->size, rec->ptr, rec->size, xdl_flags))
+			cls = slot.cls;
+		for (int node = slot.chain; cls < 0 && node >= 0; node = m_chain[node].next)
+		{
+			const xrecord_t *other = m_classes[m_chain[node].cls];
+			if (xdl_recmatch(other->ptr, other->size, rec->ptr, rec->size, xdl_flags))
+				cls = m_chain[node].cls;
+		}
+		if (cls < 0)
+		{
+			// Same hash, different line
+			cls = NewClass(rec);
+			m_chain.push_back({ cls, slot.chain });
+			slot.chain = static_cast<int>(m_chain.size() - 1);
+		}
+		equivs[i] = cls;
+	}
+}
+
+/**
+ * @brief Home slot of a hash. xdiff hashes are weak in the low bits, so
+ * they are spread with a multiplicative hash first.
+ */
+size_t EquivClassTable::SlotIndex(unsigned long ha) const
+{
+	return static_cast<size_t>((static_cast<uint64_t>(ha) * 0x9E3779B97F4A7C15ULL) >> m_shift);
+}
+
+void EquivClassTable::Resize(size_t nSlots)
+{
+	std::vector<Slot> oldSlots(nSlots, Slot{ 0, -1, -1 });
+	oldSlots.swap(m_slots);
+	m_shift = 64;
+	for (size_t n = nSlots; n > 1; n /= 2)
+		--m_shift;
+	for (const Slot& slot : oldSlots)
+	{
+		if (slot.cls < 0)
+			continue;
+		size_t index = SlotIndex(slot.ha);
+		while (m_slots[index].cls >= 0)
+			index = (index + 1) & (m_slots.size() - 1);
+		m_slots[index] = slot;
+	}
+}
+
+int EquivClassTable::NewClass(const xrecord_t *rec)
+{
+	m_classes.push_back(rec);
+	return static_cast<int>(m_classes.size() - 1);
+}
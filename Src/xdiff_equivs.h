@@ -0,0 +1,57 @@
+/**
+ * @file  xdiff_equivs.h
+ *
+ * @brief Declaration of EquivClassTable, which numbers equal xdiff lines.
+ */
+#pragma once
+
+#include <vector>
+extern "C" {
+#include "../Externals/xdiff/xinclude.h"
+}
+
+/**
+ * @brief Assigns equivalence class ids to lines for moved block detection.
+ * Lines that match with the current xdiff flags get the same id, ids are
+ * numbered in order of first appearance across all appended files.
+ *
+ * The table is keyed by the xdiff line hash and uses open addressing with
+ * linear probing. Each slot holds its first class inline; classes whose
+ * lines only share the hash are chained through one shared node array.
+ * Clear() keeps the storage, so a table can be reused for many compares
+ * without allocating again.
+ */
+class EquivClassTable
+{
+public:
+	/** @brief Storage beyond this many slots is released by Clear(). */
+	static constexpr size_t MaxRetainedSlots = 1 << 20;
+
+	EquivClassTable();
+	void Clear(size_t nExpectedLines);
+	void Append(xrecord_t * const *recs, long nrec, int *equivs, unsigned long xdl_flags);
+	int GetClassCount() const { return static_cast<int>(m_classes.size()); }
+
+private:
+	struct Slot
+	{
+		unsigned long ha;
+		int cls; /**< First class with this hash, -1 if the slot is empty */
+		int chain; /**< Index of further classes in m_chain, -1 if none */
+	};
+	struct ChainNode
+	{
+		int cls;
+		int next;
+	};
+
+	size_t SlotIndex(unsigned long ha) const;
+	void Resize(size_t nSlots);
+	int NewClass(const xrecord_t *rec);
+
+	std::vector<Slot> m_slots;
+	std::vector<ChainNode> m_chain;
+	std::vector<const xrecord_t *> m_classes; /**< First line of each class */
+	size_t m_nUsed; /**< Number of non-empty slots */
+	int m_shift; /**< 64 - log2 of the slot count */
+};
@@ -1,10 +1,10 @@
 #include "pch.h"
+#include <algorithm>
 #include <io.h>
 #include <sys/stat.h>
 #include "CompareOptions.h"
-extern "C" {
-#include "../Externals/xdiff/xinclude.h"
-}
+#include "xdiff_parallel.h"
+#include "xdiff_equivs.h"
 
 static bool read_mmfile(int fd, mmfile_t& mmfile)
 {
@@ -71,66 +71,114 @@ static int hunk_func(long start_a, long count_a, long start_b, long count_b, voi
 	return 0;
 }
 
-static void append_equivs(const xdfile_t& xdf, struct file_data& filevec, std::vector<xrecord_t *>& equivs, unsigned xdl_flags)
+static int is_missing_newline(const mmfile_t& mmfile)
+{
+	if (mmfile.size == 0 || mmfile.ptr[mmfile.size - 1] == '\r' || mmfile.ptr[mmfile.size - 1] == '\n')
+		return 0;
+	return 1;
+}
+
+static bool set_file_data(struct file_data& filevec, const mmfile_t& mmfile, xrecord_t * const *recs, long nrec)
+{
+	filevec.buffer = mmfile.ptr;
+	filevec.bufsize = mmfile.size;
+	filevec.buffered_chars = mmfile.size;
+	filevec.linbuf_base = 0;
+	filevec.valid_lines = nrec;
+	filevec.linbuf = static_cast<const char **>(malloc(sizeof(char *) * (nrec + 1)));
+	if (!filevec.linbuf)
+		return false;
+	filevec.equivs = static_cast<int *>(malloc(sizeof(int) * (nrec ? nrec : 1)));
+	if (!filevec.equivs)
+		return false;
+	for (long i = 0; i < nrec; ++i)
+	{
+		filevec.linbuf[i] = recs[i]->ptr;
+		filevec.equivs[i] = -1;
+	}
+	if (nrec > 0)
+		filevec.linbuf[nrec] = recs[nrec - 1]->ptr + recs[nrec - 1]->size;
+	filevec.missing_newline = is_missing_newline(mmfile);
+	return true;
+}
+
+/**
+ * @brief Fill @p filevec and build the diffutils script from xdiff hunks.
+ * @return false if out of memory.
+ */
+static bool make_script(struct file_data filevec[], const mmfile_t& mmfile1, const mmfile_t& mmfile2,
+	xrecord_t * const *recs1, long nrec1, xrecord_t * const *recs2, long nrec2,
+	const std::vector<xdiff_hunk>& hunks, int bMoved_blocks_flag, unsigned xdl_flags, change*& script)
 {
-	std::unordered_map<unsigned long, std::vector<int>> equivs_map;
-	for (int i = 0; i < static_cast<int>(equivs.size()); ++i)
+	if (!set_file_data(filevec[0], mmfile1, recs1, nrec1) ||
+	    !set_file_data(filevec[1], mmfile2, recs2, nrec2))
+		return false;
+
+	change *prev = nullptr;
+	for (const xdiff_hunk& hunk : hunks)
 	{
-		unsigned long ha = equivs[i]->ha;
-		if (equivs_map.find(ha) != equivs_map.end())
-			equivs_map[ha].push_back(i);
-		else
-			equivs_map.emplace(ha, std::vector<int>{i});
+		change* e = static_cast<change*>(malloc(sizeof(change)));
+		if (!e)
+			return false;
+		if (!script)
+			script = e;
+		e->line0 = hunk.i1;
+		e->line1 = hunk.i2;
+		e->deleted = hunk.chg1;
+		e->inserted = hunk.chg2;
+		e->match0 = -1;
+		e->match1 = -1;
+		e->trivial = static_cast<char>(hunk.ignore);
+		e->link = nullptr;
+		e->ignore = 0;
+		if (prev)
+			prev->link = e;
+		prev = e;
 	}
 
-	for (int i = 0; i < xdf.nrec; ++i)
+	if (bMoved_blocks_flag)
 	{
-		unsigned long ha = xdf.recs[i]->ha;
-		if (equivs_map.find(ha) != equivs_map.end())
-		{
-			bool found = false;
-			for (auto j: equivs_map[ha])
-			{
-				if (xdl_recmatch(equivs[j]->ptr, equivs[j]->size, xdf.recs[i]->ptr, xdf.recs[i]->size, xdl_flags))
-				{
-					found = true;
-					filevec.equivs[i] = j;
-					equivs_map.emplace(ha, std::vector<int>{j});
-					break;
-				}
-			}
-			if (!found)
-			{
-				filevec.equivs[i] = static_cast<int>(equivs.size());
-				equivs_map[ha].push_back(filevec.equivs[i]);
-				equivs.push_back(xdf.recs[i]);
-			}
-		}
-		else
-		{
-			filevec.equivs[i] = static_cast<int>(equivs.size());
-			equivs_map.emplace(ha, std::vector<int>{filevec.equivs[i]});
-			equivs.push_back(xdf.recs[i]);
-		}
+		// Reused by the compares of this thread to avoid rebuilding the table storage
+		thread_local EquivClassTable equivTable;
+		equivTable.Clear(static_cast<size_t>(nrec1 + nrec2));
+		equivTable.Append(recs1, nrec1, filevec[0].equivs, xdl_flags);
+		equivTable.Append(recs2, nrec2, filevec[1].equivs, xdl_flags);
+		moved_block_analysis(&script, filevec);
 	}
+	return true;
 }
 
-static int is_missing_newline(const mmfile_t& mmfile)
+/**
+ * @brief Check if the files have enough lines to split them between threads.
+ * Every line has at least one byte, so small files are rejected without
+ * counting their lines.
+ */
+static bool is_worth_partitioning(const mmfile_t& mmfile1, const mmfile_t& mmfile2)
 {
-	if (mmfile.size == 0 || mmfile.ptr[mmfile.size - 1] == '\r' || mmfile.ptr[mmfile.size - 1] == '\n')
-		return 0;
-	return 1;
+	if (mmfile1.size + mmfile2.size < xdiff_parallel::MinLinesForPartitioning)
+		return false;
+	long nlines = 0;
+	for (const mmfile_t *mmfile : { &mmfile1, &mmfile2 })
+	{
+		nlines += static_cast<long>(std::count(mmfile->ptr, mmfile->ptr + mmfile->size, '\n'));
+		if (mmfile->size > 0 && mmfile->ptr[mmfile->size - 1] != '\n')
+			++nlines;
+	}
+	return nlines >= xdiff_parallel::MinLinesForPartitioning;
 }
 
-struct change * diff_2_files_xdiff (struct file_data filevec[], int bMoved_blocks_flag, unsigned xdl_flags)
+/**
+ * @brief Compare two files with xdiff and return a diffutils script.
+ * @param [in] nThreads Large inputs are split at unique common lines and the
+ * parts are compared in up to this many threads (see xdiff_parallel.cpp).
+ * Files with fewer lines than xdiff_parallel::MinLinesForPartitioning are
+ * compared in the calling thread.
+ */
+struct change * diff_2_files_xdiff (struct file_data filevec[], int bMoved_blocks_flag, unsigned xdl_flags, int nThreads)
 {
 	mmfile_t mmfile1 = { 0 }, mmfile2 = { 0 };
 	change *script = nullptr;
-	xdfenv_t xe;
-	xdchange_t *xscr;
 	xpparam_t xpp = { 0 };
-	xdemitconf_t xecfg = { 0 };
-	xdemitcb_t ecb = { 0 };
 
 	if (!read_mmfile(filevec[0].desc, mmfile1))
 		goto abort;
@@ -138,80 +186,42 @@ struct change * diff_2_files_xdiff (struct file_data filevec[], int bMoved_block
 		goto abort;
 
 	xpp.flags = xdl_flags;
-	xecfg.hunk_func = hunk_func;
-	if (xdl_diff_modified(&mmfile1, &mmfile2, &xpp, &xecfg, &ecb, &xe, &xscr) == 0)
+	if (nThreads > 1 && !(xdl_flags & XDF_NONE_DIFF) && is_worth_partitioning(mmfile1, mmfile2))
 	{
-		filevec[0].buffer = mmfile1.ptr;
-		filevec[1].buffer = mmfile2.ptr;
-		filevec[0].bufsize = mmfile1.size;
-		filevec[1].bufsize = mmfile2.size;
-		filevec[0].buffered_chars = mmfile1.size;
-		filevec[1].buffered_chars = mmfile2.size;
-		filevec[0].linbuf_base = 0;
-		filevec[1].linbuf_base = 0;
-		filevec[0].valid_lines = xe.xdf1.nrec;
-		filevec[1].valid_lines = xe.xdf2.nrec;
-		filevec[0].linbuf = static_cast<const char **>(malloc(sizeof(char *) * (xe.xdf1.nrec + 1)));
-		if (!filevec[0].linbuf)
-			goto abort;
-		filevec[1].linbuf = static_cast<const char **>(malloc(sizeof(char *) * (xe.xdf2.nrec + 1)));
-		if (!filevec[1].linbuf)
+		std::vector<xrecord_t> recs1, recs2;
+		std::vector<xdiff_hunk> hunks;
+		if (!xdiff_parallel::diff(mmfile1, mmfile2, xpp, nThreads, recs1, recs2, hunks))
 			goto abort;
-		filevec[0].equivs = static_cast<int *>(malloc(sizeof(int) * xe.xdf1.nrec));
-		if (!filevec[0].equivs)
+		std::vector<xrecord_t *> precs1(recs1.size()), precs2(recs2.size());
+		for (size_t i = 0; i < recs1.size(); ++i)
+			precs1[i] = &recs1[i];
+		for (size_t i = 0; i < recs2.size(); ++i)
+			precs2[i] = &recs2[i];
+		if (!make_script(filevec, mmfile1, mmfile2,
+			precs1.data(), static_cast<long>(precs1.size()), precs2.data(), static_cast<long>(precs2.size()),
+			hunks, bMoved_blocks_flag, xdl_flags, script))
 			goto abort;
-		filevec[1].equivs = static_cast<int *>(malloc(sizeof(int) * xe.xdf2.nrec));
-		if (!filevec[1].equivs)
-			goto abort;
-		for (int i = 0; i < xe.xdf1.nrec; ++i)
-		{
-			filevec[0].linbuf[i] = xe.xdf1.recs[i]->ptr;
-			filevec[0].equivs[i] = -1;
-		}
-		if (xe.xdf1.nrec > 0)
-			filevec[0].linbuf[xe.xdf1.nrec] = xe.xdf1.recs[xe.xdf1.nrec - 1]->ptr + xe.xdf1.recs[xe.xdf1.nrec - 1]->size;
-		for (int i = 0; i < xe.xdf2.nrec; ++i)
-		{
-			filevec[1].linbuf[i] = xe.xdf2.recs[i]->ptr;
-			filevec[1].equivs[i] = -1;
-		}
-		if (xe.xdf2.nrec > 0)
-			filevec[1].linbuf[xe.xdf2.nrec] = xe.xdf2.recs[xe.xdf2.nrec - 1]->ptr + xe.xdf2.recs[xe.xdf2.nrec - 1]->size;
-		filevec[0].missing_newline = is_missing_newline(mmfile1);
-		filevec[1].missing_newline = is_missing_newline(mmfile2);
-
-		change *prev = nullptr;
-		for (xdchange_t* xcur = xscr; xcur; xcur = xcur->next)
+	}
+	else
+	{
+		xdfenv_t xe;
+		xdchange_t *xscr;
+		xdemitconf_t xecfg = { 0 };
+		xdemitcb_t ecb = { 0 };
+		xecfg.hunk_func = hunk_func;
+		if (xdl_diff_modified(&mmfile1, &mmfile2, &xpp, &xecfg, &ecb, &xe, &xscr) == 0)
 		{
-			change* e = static_cast<change*>(malloc(sizeof(change)));
-			if (!e)
+			std::vector<xdiff_hunk> hunks;
+			for (xdchange_t* xcur = xscr; xcur; xcur = xcur->next)
+				hunks.push_back({ xcur->i1, xcur->i2, xcur->chg1, xcur->chg2, xcur->ignore });
+			bool ok = make_script(filevec, mmfile1, mmfile2,
+				xe.xdf1.recs, xe.xdf1.nrec, xe.xdf2.recs, xe.xdf2.nrec,
+				hunks, bMoved_blocks_flag, xdl_flags, script);
+			xdl_free_script(xscr);
+			xdl_free_env(&xe);
+			if (!ok)
 				goto abort;
-			if (!script)
-				script = e;
-			e->line0 = xcur->i1;
-			e->line1 = xcur->i2;
-			e->deleted = xcur->chg1;
-			e->inserted = xcur->chg2;
-			e->match0 = -1;
-			e->match1 = -1;
-			e->trivial = static_cast<char>(xcur->ignore);
-			e->link = nullptr;
-			e->ignore = 0;
-			if (prev)
-				prev->link = e;
-			prev = e;
 		}
-
-		if (bMoved_blocks_flag)
-		{
-			std::vector<xrecord_t *> equivs;
-			append_equivs(xe.xdf1, filevec[0], equivs, xdl_flags);
-			append_equivs(xe.xdf2, filevec[1], equivs, xdl_flags);
-			moved_block_analysis(&script, filevec);
-		}
-
-		xdl_free_script(xscr);
-		xdl_free_env(&xe);
 	}
 
 	return script;
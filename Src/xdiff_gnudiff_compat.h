@@ -2,4 +2,4 @@
 
 class DiffutilsOptions;
 unsigned long make_xdl_flags(const DiffutilsOptions& options);
-struct change * diff_2_files_xdiff(struct file_data filevec[], int bMoved_blocks_flag, unsigned xdl_flags);
+struct change * diff_2_files_xdiff(struct file_data filevec[], int bMoved_blocks_flag, unsigned xdl_flags, int nThreads = 1);
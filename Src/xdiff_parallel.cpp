@@ -0,0 +1,302 @@
+/**
+ * @file  xdiff_parallel.cpp
+ *
+ * @brief Anchor-partitioned parallel driver for xdiff.
+ *
+ * Lines that occur exactly once in both files (the patience diff anchors)
+ * and keep their relative order split the file pair into independent
+ * regions. The regions are diffed concurrently with xdl_diff_modified() and
+ * the hunks are offset back to whole-file line numbers and concatenated.
+ *
+ * The result is the same as diffing the whole files when every chosen split
+ * point is a line the sequential diff also keeps as common. Split points are
+ * preferred inside runs of unchanged lines to make that the usual case, but
+ * it is not guaranteed: xdiff's own heuristics (e.g. discarding frequent
+ * lines, sliding hunks) see only one region at a time.
+ */
+#include "pch.h"
+#include "xdiff_parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <Poco/Runnable.h>
+#include <Poco/ThreadPool.h>
+
+namespace
+{
+
+/** @brief How far past the ideal split point to look for an anchor in an unchanged run. */
+constexpr size_t MaxAnchorLookahead = 64;
+
+struct AnchorCandidate
+{
+	long line1 = -1;
+	long line2 = -1;
+	int count1 = 0;
+	int count2 = 0;
+};
+
+int hunk_func(long start_a, long count_a, long start_b, long count_b, void *cb_data)
+{
+	return 0;
+}
+
+bool records_match(const xrecord_t& rec1, const xrecord_t& rec2, unsigned long flags)
+{
+	return rec1.ha == rec2.ha && xdl_recmatch(rec1.ptr, rec1.size, rec2.ptr, rec2.size, flags);
+}
+
+/**
+ * @brief Diffs the regions between split points, shared by the workers.
+ */
+class PartitionedDiff
+{
+public:
+	PartitionedDiff(const mmfile_t& mf1, const mmfile_t& mf2, const xpparam_t& xpp,
+		const std::vector<xrecord_t>& recs1, const std::vector<xrecord_t>& recs2,
+		const std::vector<std::pair<long, long>>& splits)
+		: m_mf1(mf1), m_mf2(mf2), m_xpp(xpp), m_recs1(recs1), m_recs2(recs2), m_splits(splits)
+		, m_regionHunks(splits.size() - 1), m_nextRegion(0), m_failed(false)
+	{
+	}
+
+	void RunRegions()
+	{
+		for (size_t k = m_nextRegion++; k < m_regionHunks.size() && !m_failed; k = m_nextRegion++)
+		{
+			if (!DiffRegion(k))
+				m_failed = true;
+		}
+	}
+
+	bool Failed() const { return m_failed; }
+
+	void MoveHunks(std::vector<xdiff_hunk>& hunks)
+	{
+		size_t count = 0;
+		for (const auto& regionHunks : m_regionHunks)
+			count += regionHunks.size();
+		hunks.clear();
+		hunks.reserve(count);
+		for (auto& regionHunks : m_regionHunks)
+		{
+			hunks.insert(hunks.end(), regionHunks.begin(), regionHunks.end());
+			std::vector<xdiff_hunk>().swap(regionHunks);
+		}
+	}
+
+private:
+	static mmfile_t Slice(const mmfile_t& mf, const std::vector<xrecord_t>& recs, long begin, long end)
+	{
+		const char *top = mf.ptr + mf.size;
+		const char *ptr = begin < static_cast<long>(recs.size()) ? recs[begin].ptr : top;
+		const char *lim = end < static_cast<long>(recs.size()) ? recs[end].ptr : top;
+		mmfile_t slice;
+		slice.ptr = const_cast<char *>(ptr);
+		slice.size = static_cast<long>(lim - ptr);
+		return slice;
+	}
+
+	bool DiffRegion(size_t k)
+	{
+		const auto [begin1, begin2] = m_splits[k];
+		const auto [end1, end2] = m_splits[k + 1];
+		mmfile_t mf1 = Slice(m_mf1, m_recs1, begin1, end1);
+		mmfile_t mf2 = Slice(m_mf2, m_recs2, begin2, end2);
+		xdemitconf_t xecfg = { 0 };
+		xdemitcb_t ecb = { 0 };
+		xdfenv_t xe;
+		xdchange_t *xscr = nullptr;
+		xecfg.hunk_func = hunk_func;
+		if (xdl_diff_modified(&mf1, &mf2, &m_xpp, &xecfg, &ecb, &xe, &xscr) != 0)
+			return false;
+		std::vector<xdiff_hunk>& hunks = m_regionHunks[k];
+		for (xdchange_t *xcur = xscr; xcur; xcur = xcur->next)
+			hunks.push_back({ xcur->i1 + begin1, xcur->i2 + begin2, xcur->chg1, xcur->chg2, xcur->ignore });
+		xdl_free_script(xscr);
+		xdl_free_env(&xe);
+		return true;
+	}
+
+	const mmfile_t& m_mf1;
+	const mmfile_t& m_mf2;
+	const xpparam_t& m_xpp;
+	const std::vector<xrecord_t>& m_recs1;
+	const std::vector<xrecord_t>& m_recs2;
+	const std::vector<std::pair<long, long>>& m_splits;
+	std::vector<std::vector<xdiff_hunk>> m_regionHunks;
+	std::atomic<size_t> m_nextRegion;
+	std::atomic<bool> m_failed;
+};
+
+class RegionWorker : public Poco::Runnable
+{
+public:
+	explicit RegionWorker(PartitionedDiff& diff) : m_diff(diff) {}
+	void run() override { m_diff.RunRegions(); }
+private:
+	PartitionedDiff& m_diff;
+};
+
+}
+
+namespace xdiff_parallel
+{
+
+/**
+ * @brief Return lines unique in both files, as the longest sequence that
+ * increases in both files (patience sorting).
+ */
+std::vector<std::pair<long, long>> find_anchors(const std::vector<xrecord_t>& recs1,
+	const std::vector<xrecord_t>& recs2, unsigned long flags)
+{
+	std::unordered_map<unsigned long, AnchorCandidate> candidates;
+	candidates.reserve(recs1.size());
+	for (long i = 0; i < static_cast<long>(recs1.size()); ++i)
+	{
+		// Hash collisions only make a line look non-unique, so they cost
+		// an anchor but never produce a wrong one.
+		AnchorCandidate& c = candidates[recs1[i].ha];
+		if (c.count1++ == 0)
+			c.line1 = i;
+	}
+	for (long i = 0; i < static_cast<long>(recs2.size()); ++i)
+	{
+		auto it = candidates.find(recs2[i].ha);
+		if (it != candidates.end() && it->second.count2++ == 0)
+			it->second.line2 = i;
+	}
+
+	std::vector<std::pair<long, long>> unique;
+	for (const auto& [ha, c] : candidates)
+	{
+		if (c.count1 == 1 && c.count2 == 1 && records_match(recs1[c.line1], recs2[c.line2], flags))
+			unique.emplace_back(c.line1, c.line2);
+	}
+	std::sort(unique.begin(), unique.end());
+
+	// Longest increasing subsequence of line2, as in xpatience.c
+	std::vector<size_t> tails;
+	std::vector<size_t> prev(unique.size(), SIZE_MAX);
+	for (size_t i = 0; i < unique.size(); ++i)
+	{
+		auto pos = std::lower_bound(tails.begin(), tails.end(), unique[i].second,
+			[&unique](size_t j, long line2) { return unique[j].second < line2; });
+		if (pos != tails.begin())
+			prev[i] = *(pos - 1);
+		if (pos == tails.end())
+			tails.push_back(i);
+		else
+			*pos = i;
+	}
+	std::vector<std::pair<long, long>> anchors;
+	for (size_t i = tails.empty() ? SIZE_MAX : tails.back(); i != SIZE_MAX; i = prev[i])
+		anchors.push_back(unique[i]);
+	std::reverse(anchors.begin(), anchors.end());
+	return anchors;
+}
+
+/**
+ * @brief Split a buffer into lines exactly as xdl_prepare_env() does.
+ */
+void split_records(const mmfile_t& mf, unsigned long flags, std::vector<xrecord_t>& recs)
+{
+	recs.clear();
+	recs.reserve(static_cast<size_t>(mf.size / 32 + 1));
+	const char *cur = mf.ptr;
+	const char *top = mf.ptr + mf.size;
+	while (cur < top)
+	{
+		const char *prev = cur;
+		unsigned long ha = xdl_hash_record(&cur, top, static_cast<long>(flags));
+		recs.push_back({ nullptr, prev, static_cast<long>(cur - prev), ha });
+	}
+}
+
+/**
+ * @brief Choose split points for about @p nRegions regions of similar size.
+ * @return Strictly increasing (line1, line2) pairs, starting with (0, 0) and
+ * ending with the line counts of both files. Each inner pair is an anchor
+ * line, which becomes the first line of its region on both sides.
+ */
+std::vector<std::pair<long, long>> find_split_points(const std::vector<xrecord_t>& recs1,
+	const std::vector<xrecord_t>& recs2, unsigned long flags, int nRegions)
+{
+	const long n1 = static_cast<long>(recs1.size());
+	const long n2 = static_cast<long>(recs2.size());
+	std::vector<std::pair<long, long>> splits{ { 0, 0 } };
+	if (nRegions > 1)
+	{
+		const std::vector<std::pair<long, long>> anchors = find_anchors(recs1, recs2, flags);
+		// An anchor right after another common line is unlikely to be
+		// part of a hunk in the sequential diff either.
+		auto inUnchangedRun = [&](const std::pair<long, long>& a)
+		{
+			return a.first > 0 && a.second > 0 && records_match(recs1[a.first - 1], recs2[a.second - 1], flags);
+		};
+		const long step = std::max<long>((n1 + n2) / nRegions, 1);
+		long next = step;
+		for (size_t k = 0; k < anchors.size() && static_cast<int>(splits.size()) < nRegions; ++k)
+		{
+			if (anchors[k].first + anchors[k].second < next)
+				continue;
+			size_t best = k;
+			for (size_t m = k; m < anchors.size() && m < k + MaxAnchorLookahead; ++m)
+			{
+				if (inUnchangedRun(anchors[m]))
+				{
+					best = m;
+					break;
+				}
+			}
+			splits.push_back(anchors[best]);
+			k = best;
+			next = anchors[best].first + anchors[best].second + step;
+		}
+	}
+	splits.emplace_back(n1, n2);
+	return splits;
+}
+
+/**
+ * @brief Diff two buffers, splitting the work between @p nThreads threads.
+ * @param [out] recs1 Lines of the first buffer.
+ * @param [out] recs2 Lines of the second buffer.
+ * @param [out] hunks Differences in whole-file line numbers, in order.
+ * @return false if xdiff failed on any region.
+ */
+bool diff(const mmfile_t& mf1, const mmfile_t& mf2, const xpparam_t& xpp, int nThreads,
+	std::vector<xrecord_t>& recs1, std::vector<xrecord_t>& recs2, std::vector<xdiff_hunk>& hunks)
+{
+	split_records(mf1, xpp.flags, recs1);
+	split_records(mf2, xpp.flags, recs2);
+	const bool partition = nThreads > 1 &&
+		static_cast<long>(recs1.size() + recs2.size()) >= MinLinesForPartitioning;
+	const std::vector<std::pair<long, long>> splits =
+		find_split_points(recs1, recs2, xpp.flags, partition ? nThreads * RegionsPerThread : 1);
+
+	PartitionedDiff partitionedDiff(mf1, mf2, xpp, recs1, recs2, splits);
+	const int nWorkers = std::min(nThreads, static_cast<int>(splits.size() - 1));
+	if (nWorkers <= 1)
+	{
+		partitionedDiff.RunRegions();
+	}
+	else
+	{
+		Poco::ThreadPool threadPool(nWorkers, nWorkers);
+		std::vector<std::unique_ptr<RegionWorker>> workers;
+		for (int i = 0; i < nWorkers; ++i)
+		{
+			workers.emplace_back(new RegionWorker(partitionedDiff));
+			threadPool.start(*workers.back());
+		}
+		threadPool.joinAll();
+	}
+	if (partitionedDiff.Failed())
+		return false;
+	partitionedDiff.MoveHunks(hunks);
+	return true;
+}
+
+}
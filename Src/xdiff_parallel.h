@@ -0,0 +1,40 @@
+/**
+ * @file  xdiff_parallel.h
+ *
+ * @brief Declaration of the anchor-partitioned parallel driver for xdiff.
+ */
+#pragma once
+
+#include <vector>
+extern "C" {
+#include "../Externals/xdiff/xinclude.h"
+}
+
+/**
+ * @brief One difference hunk in whole-file line numbers.
+ * Same fields as xdchange_t, without the list link.
+ */
+struct xdiff_hunk
+{
+	long i1, i2;
+	long chg1, chg2;
+	int ignore;
+};
+
+namespace xdiff_parallel
+{
+
+/** @brief Inputs smaller than this (both files together) are not worth splitting. */
+constexpr long MinLinesForPartitioning = 100000;
+/** @brief Number of regions queued per thread, so uneven regions still balance. */
+constexpr int RegionsPerThread = 4;
+
+void split_records(const mmfile_t& mf, unsigned long flags, std::vector<xrecord_t>& recs);
+std::vector<std::pair<long, long>> find_anchors(const std::vector<xrecord_t>& recs1,
+	const std::vector<xrecord_t>& recs2, unsigned long flags);
+std::vector<std::pair<long, long>> find_split_points(const std::vector<xrecord_t>& recs1,
+	const std::vector<xrecord_t>& recs2, unsigned long flags, int nRegions);
+bool diff(const mmfile_t& mf1, const mmfile_t& mf2, const xpparam_t& xpp, int nThreads,
+	std::vector<xrecord_t>& recs1, std::vector<xrecord_t>& recs2, std::vector<xdiff_hunk>& hunks);
+
+}
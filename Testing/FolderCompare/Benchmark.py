@@ -0,0 +1,149 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+
+# Benchmarks folder compares on a generated tree with FolderCompare.exe.
+#
+# Each compare method runs at each thread count, a few times, and the fastest
+# run is kept. The results, with items/s, MB/s and the peak working set, are
+# written as JSON so that they can be kept as a baseline of a machine, and
+# later runs compared against it:
+#
+#   Benchmark.py --save baseline.json
+#   (change the code, rebuild)
+#   Benchmark.py --baseline baseline.json
+#
+# The second run exits with 1 if a result is slower or uses more memory than
+# the baseline by more than the tolerance. Baselines are only comparable on
+# the same machine with the same tree parameters.
+
+import argparse
+import json
+import os
+import platform
+import subprocess
+import sys
+import tempfile
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+
+# Methods that read the file contents, so that MB/s means something
+CONTENT_METHODS = ('full', 'quick', 'binary')
+
+def parse_list(text):
+    return [item for item in text.split(',') if item]
+
+def parse_args():
+    parser = argparse.ArgumentParser(description='Benchmark folder compares on a generated tree.')
+    parser.add_argument('--exe', default=os.path.join(SCRIPT_DIR, 'Release', 'FolderCompare.exe'),
+        help='FolderCompare executable (default Release\\FolderCompare.exe)')
+    parser.add_argument('--tree', default=os.path.join(tempfile.gettempdir(), 'WinMergeBenchmarkTree'),
+        help='folder of the generated tree, generated if it has no tree.json (default %%TEMP%%\\WinMergeBenchmarkTree)')
+    parser.add_argument('--generate', default='', help='arguments of GenerateTree.py, e.g. "--depth 4 --files 50"; regenerates the tree')
+    parser.add_argument('--methods', type=parse_list, default=['full', 'quick', 'binary', 'date', 'size'],
+        help='compare methods (default full,quick,binary,date,size)')
+    parser.add_argument('--threads', type=lambda text: [int(item) for item in parse_list(text)], default=None,
+        help='compare thread counts (default 1,2,4,... up to the processor count)')
+    parser.add_argument('--repeat', type=int, default=3, help='runs of each benchmark, the fastest is kept (default 3)')
+    parser.add_argument('--save', help='write the results to this baseline file')
+    parser.add_argument('--baseline', help='compare the results against this baseline file')
+    parser.add_argument('--tolerance', type=float, default=10, help='allowed regression in percent (default 10)')
+    return parser.parse_args()
+
+def default_threads():
+    threads, count = [], 1
+    while count < os.cpu_count():
+        threads.append(count)
+        count *= 2
+    return threads + [os.cpu_count()]
+
+def prepare_tree(args):
+    info_file = os.path.join(args.tree, 'tree.json')
+    if args.generate or not os.path.exists(info_file):
+        command = [sys.executable, os.path.join(SCRIPT_DIR, 'GenerateTree.py'), args.tree] + args.generate.split()
+        subprocess.run(command, check=True, stdout=subprocess.DEVNULL)
+    with open(info_file) as f:
+        return json.load(f)
+
+def run_compare(args, method, threads):
+    """Runs one compare and returns its summary record."""
+    fd, report = tempfile.mkstemp(suffix='.json')
+    os.close(fd)
+    try:
+        command = [args.exe, '/r', '/m', method, '/cfg', 'Settings/CompareThreads=%d' % threads,
+            '/or', report, os.path.join(args.tree, 'left'), os.path.join(args.tree, 'right')]
+        subprocess.run(command, check=True)
+        with open(report, encoding='utf-8') as f:
+            lines = f.read().splitlines()
+        return json.loads(lines[-1])
+    finally:
+        os.remove(report)
+
+def run_benchmark(args, method, threads):
+    best = None
+    for _ in range(args.repeat):
+        summary = run_compare(args, method, threads)
+        if best is None or summary['elapsed_ms'] < best['elapsed_ms']:
+            best = summary
+    seconds = max(best['elapsed_ms'], 1) / 1000.0
+    return {
+        'method': method,
+        'threads': threads,
+        'items': best['items'],
+        'bytes': best['bytes'],
+        'elapsed_ms': best['elapsed_ms'],
+        'scan_ms': best['scan_ms'],
+        'items_per_s': round(best['items'] / seconds, 1),
+        'mb_per_s': round(best['bytes'] / seconds / (1024 * 1024), 1) if method in CONTENT_METHODS else None,
+        'peak_rss': best['peak_rss'],
+    }
+
+def compare_results(results, baseline, tolerance):
+    """Prints the changes from the baseline, returns the number of regressions."""
+    regressions = 0
+    previous = { (item['method'], item['threads']): item for item in baseline['results'] }
+    for result in results:
+        old = previous.get((result['method'], result['threads']))
+        if old is None:
+            continue
+        speed = (result['items_per_s'] / old['items_per_s'] - 1) * 100 if old['items_per_s'] else 0
+        memory = (result['peak_rss'] / old['peak_rss'] - 1) * 100 if old['peak_rss'] else 0
+        regressed = speed < -tolerance or memory > tolerance
+        regressions += regressed
+        print('%-8s %3d threads  items/s %+6.1f%%  peak RSS %+6.1f%%%s' %
+            (result['method'], result['threads'], speed, memory, '  REGRESSION' if regressed else ''))
+    return regressions
+
+def main():
+    args = parse_args()
+    tree = prepare_tree(args)
+    results = []
+    for method in args.methods:
+        # Only the full and quick contents compares use more than one thread
+        threads = (args.threads or default_threads()) if method in ('full', 'quick') else [1]
+        for count in threads:
+            result = run_benchmark(args, method, count)
+            print('%-8s %3d threads  %9.1f items/s  %8s MB/s  %6d MB peak RSS' % (method, count,
+                result['items_per_s'], '-' if result['mb_per_s'] is None else '%.1f' % result['mb_per_s'],
+                result['peak_rss'] // (1024 * 1024)))
+            results.append(result)
+
+    output = {
+        'machine': { 'platform': platform.platform(), 'processor': platform.processor(), 'cpu_count': os.cpu_count() },
+        'tree': tree,
+        'results': results,
+    }
+    if args.save:
+        with open(args.save, 'w') as f:
+            json.dump(output, f, indent=1)
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        if baseline['tree']['parameters'] != tree['parameters']:
+            print('The baseline was made with a different tree: %s' % json.dumps(baseline['tree']['parameters']))
+            return 2
+        if compare_results(results, baseline, args.tolerance) > 0:
+            return 1
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
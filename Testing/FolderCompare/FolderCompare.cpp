@@ -4,90 +4,513 @@
 #include "DiffThread.h"
 #include "DiffWrapper.h"
 #include "FileFilterHelper.h"
-#include "FolderCmp.h"
 #include "DirScan.h"
+#include "PatchCreator.h"
+#include "MergeCmdLineInfo.h"
+#include "MergeApp.h"
+#include "OptionsMgr.h"
+#include "OptionsDef.h"
+#include "OptionsDiffOptions.h"
+#include "PerfTrace.h"
+#include "paths.h"
+#include "unicoder.h"
+#include <fstream>
 #include <iostream>
+#include <Poco/Environment.h>
+#include <Poco/Stopwatch.h>
 #include <Poco/Thread.h>
 #ifdef _MSC_VER
 #include <crtdbg.h>
 #endif
+#ifdef _WIN32
+#include <Windows.h>
+#include <psapi.h>
 
-int main()
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+
+/** @brief Names of the compare methods, as given to /m. */
+const char *const CompareMethodNames[] = { "full", "quick", "binary", "date", "sizedate", "size" };
+
+const char Usage[] =
+	"Usage: FolderCompare [options] left [middle] right\n"
+	"Compares folders like WinMerge and writes one result per item, with the\n"
+	"options of the WinMerge command line that apply to folder compares:\n"
+	"Options can also start with '-', as they must on Linux.\n"
+	"  /r                 compare subfolders\n"
+	"  /m method          full, quick, binary, date, sizedate or size\n"
+	"  /f filter          file mask or file filter name\n"
+	"  /cp codepage       default codepage\n"
+	"  /ignorews /ignoreblanklines /ignorecase /ignoreeol /ignorecodepage\n"
+	"  /ignorecomments    line compare options\n"
+	"  /cfg name=value    any other setting, e.g. /cfg Settings/CompareThreads=4\n"
+	"  /or file           write the results to file, CSV if it ends with .csv,\n"
+	"                     else JSON lines; default is JSON lines to stdout\n"
+	"  /o file            also write a unified patch of the different text files\n"
+	"  /enableexitcode    exit with 0 if identical, 1 if different, 2 on error\n"
+	"  /trace file        write the timings of the compare phases as a Chrome trace\n"
+	"  /snapshot file     load the results from the snapshot file and compare only\n"
+	"                     the items changed since, then save the results to it\n"
+	"JSON output ends with a summary record with the timings, the compare\n"
+	"threads, the bytes of the compared files and the peak working set.\n"
+	"With /snapshot, the items and compared counts are of the rescanned items.\n"
+	"CSV output has the summary written to stderr.\n";
+
+/**
+ * @brief Set the folder compare settings to the defaults of WinMerge.
+ * The settings are not read from nor saved to the registry, so that results
+ * and timings depend on the command line only.
+ */
+void InitOptions(COptionsMgr *pOptions)
+{
+	pOptions->SetSerializing(false);
+	Options::DiffOptions::Init(pOptions);
+	pOptions->InitOption(OPT_CMP_METHOD, (int)CMP_CONTENT, 0, CMP_SIZE);
+	pOptions->InitOption(OPT_IGNORE_SMALL_FILETIME, false);
+	pOptions->InitOption(OPT_CMP_STOP_AFTER_FIRST, false);
+	pOptions->InitOption(OPT_CMP_QUICK_LIMIT, 4 * 1024 * 1024);
+	pOptions->InitOption(OPT_CMP_BINARY_LIMIT, 64 * 1024 * 1024);
+	pOptions->InitOption(OPT_CMP_TRANSCODE_IN_MEMORY_LIMIT, 64 * 1024 * 1024);
+	pOptions->InitOption(OPT_CMP_STREAMING_DIFF_MEMORY_LIMIT, 0);
+	pOptions->InitOption(OPT_CMP_COMPARE_THREADS, -1, -128, 128);
+	pOptions->InitOption(OPT_CMP_PREFETCH_THREADS, 0, -1, 128);
+	pOptions->InitOption(OPT_CMP_WALK_UNIQUE_DIRS, true);
+	pOptions->InitOption(OPT_CMP_IGNORE_REPARSE_POINTS, false);
+	pOptions->InitOption(OPT_CMP_IGNORE_CODEPAGE, false);
+	pOptions->InitOption(OPT_CMP_DETECT_MOVED, false);
+	pOptions->InitOption(OPT_CMP_DETECT_MOVED_SIMILARITY, 60, 0, 100);
+	pOptions->InitOption(OPT_CP_DETECT, (int)(50001 << 16) | 1);
+}
+
+/**
+ * @brief Apply the command line to the settings, like WinMerge does.
+ * @return false if the command line has errors.
+ */
+bool ApplyCommandLine(COptionsMgr *pOptions, MergeCmdLineInfo& cmdInfo)
+{
+	for (const auto& it : cmdInfo.m_Options)
+	{
+		if (pOptions->Set(it.first, it.second) == COption::OPT_NOTFOUND)
+		{
+			String longname = pOptions->ExpandShortName(it.first);
+			if (longname.empty() || pOptions->Set(longname, it.second) == COption::OPT_NOTFOUND)
+				cmdInfo.m_sErrorMessages.push_back(_T("Invalid key '") + it.first + _T("' specified in /config option"));
+		}
+	}
+	if (cmdInfo.m_nCompMethod.has_value())
+		pOptions->Set(OPT_CMP_METHOD, static_cast<int>(*cmdInfo.m_nCompMethod));
+	if (cmdInfo.m_nCodepage)
+		ucr::setDefaultCodepage(cmdInfo.m_nCodepage);
+	for (int nIndex = 0; nIndex < cmdInfo.m_Files.GetSize(); ++nIndex)
+	{
+		if (paths::DoesPathExist(cmdInfo.m_Files[nIndex]) != paths::IS_EXISTING_DIR)
+			cmdInfo.m_sErrorMessages.push_back(_T("Not a folder: ") + cmdInfo.m_Files[nIndex]);
+	}
+	return cmdInfo.m_sErrorMessages.empty();
+}
+
+/** @brief Set up the compare context like CDirDoc::InitDiffContext(). */
+void InitDiffContext(CDiffContext& ctx, const COptionsMgr *pOptions)
+{
+	DIFFOPTIONS options = {0};
+	Options::DiffOptions::Load(pOptions, options);
+	ctx.CreateCompareOptions(pOptions->GetInt(OPT_CMP_METHOD), options);
+
+	ctx.m_iGuessEncodingType = pOptions->GetInt(OPT_CP_DETECT);
+	if ((ctx.m_iGuessEncodingType >> 16) == 0)
+		ctx.m_iGuessEncodingType |= 50001 << 16;
+	ctx.m_bIgnoreSmallTimeDiff = pOptions->GetBool(OPT_IGNORE_SMALL_FILETIME);
+	ctx.m_bStopAfterFirstDiff = pOptions->GetBool(OPT_CMP_STOP_AFTER_FIRST);
+	ctx.m_nQuickCompareLimit = pOptions->GetInt(OPT_CMP_QUICK_LIMIT);
+	ctx.m_nBinaryCompareLimit = pOptions->GetInt(OPT_CMP_BINARY_LIMIT);
+	ctx.m_nTranscodeInMemoryLimit = pOptions->GetInt(OPT_CMP_TRANSCODE_IN_MEMORY_LIMIT);
+	ctx.m_nStreamingDiffMemoryLimit = pOptions->GetInt(OPT_CMP_STREAMING_DIFF_MEMORY_LIMIT);
+	ctx.m_bPluginsEnabled = false;
+	ctx.m_bWalkUniques = pOptions->GetBool(OPT_CMP_WALK_UNIQUE_DIRS);
+	ctx.m_bDetectMovedItems = pOptions->GetBool(OPT_CMP_DETECT_MOVED);
+	ctx.m_nMovedSimilarity = pOptions->GetInt(OPT_CMP_DETECT_MOVED_SIMILARITY);
+	ctx.m_bIgnoreReparsePoints = pOptions->GetBool(OPT_CMP_IGNORE_REPARSE_POINTS);
+	ctx.m_bIgnoreCodepage = pOptions->GetBool(OPT_CMP_IGNORE_CODEPAGE);
+	ctx.m_bEnableImageCompare = false;
+}
+
+/** @brief Number of threads comparing file contents, like CompareItemsOnWorkers() uses. */
+int GetCompareThreadCount(const CDiffContext& ctx, const COptionsMgr *pOptions)
+{
+	const int compareMethod = ctx.GetCompareMethod();
+	if (compareMethod != CMP_CONTENT && compareMethod != CMP_QUICK_CONTENT)
+		return 1;
+	int nThreads = pOptions->GetInt(OPT_CMP_COMPARE_THREADS);
+	if (nThreads <= 0)
+		nThreads += Poco::Environment::processorCount();
+	return std::clamp(nThreads, 1, static_cast<int>(Poco::Environment::processorCount()));
+}
+
+/** @brief Peak working set of this process, in bytes. */
+size_t GetPeakWorkingSetSize()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters = { sizeof(counters) };
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.PeakWorkingSetSize;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+	return static_cast<size_t>(usage.ru_maxrss) * 1024; // kilobytes on Linux
+#endif
+}
+
+#ifndef _WIN32
+/**
+ * @brief Join the arguments into a command line like GetCommandLine() returns.
+ * The options start with '-' here, so the other arguments are quoted to be
+ * read as paths even when they start with '/'.
+ */
+String JoinArguments(int argc, TCHAR *argv[])
+{
+	String cmdLine;
+	for (int i = 0; i < argc; ++i)
+	{
+		if (i > 0)
+			cmdLine += _T(" ");
+		if (argv[i][0] == '-')
+			cmdLine += argv[i];
+		else
+			cmdLine += _T("\"") + String(argv[i]) + _T("\"");
+	}
+	return cmdLine;
+}
+#endif
+
+const char *GetStatus(const DIFFITEM& di)
+{
+	if (di.diffcode.isResultFiltered())
+		return "skipped";
+	if (di.diffcode.isResultError())
+		return "error";
+	if (di.diffcode.isResultAbort())
+		return "aborted";
+	if (!di.diffcode.existAll())
+		return "unique";
+	if (di.diffcode.isResultSame())
+		return "identical";
+	if (di.diffcode.isResultDiff())
+		return "different";
+	return "not-compared";
+}
+
+/** @brief Sides the item exists in, e.g. "LR", or "L" for a left only item. */
+std::string GetSides(const DIFFITEM& di, int nDirs)
+{
+	static const char Names2[] = "LR", Names3[] = "LMR";
+	std::string sides;
+	for (int nIndex = 0; nIndex < nDirs; ++nIndex)
+	{
+		if (di.diffcode.exists(nIndex))
+			sides += (nDirs == 2 ? Names2 : Names3)[nIndex];
+	}
+	return sides;
+}
+
+std::string JsonString(const String& str)
+{
+	std::string result = "\"";
+	for (char c : ucr::toUTF8(str))
+	{
+		switch (c)
+		{
+		case '"': result += "\\\""; break;
+		case '\\': result += "\\\\"; break;
+		case '\n': result += "\\n"; break;
+		case '\r': result += "\\r"; break;
+		case '\t': result += "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char buf[8];
+				snprintf(buf, sizeof(buf), "\\u%04x", c);
+				result += buf;
+			}
+			else
+				result += c;
+		}
+	}
+	return result + "\"";
+}
+
+std::string CsvString(const String& str)
+{
+	std::string utf8 = ucr::toUTF8(str);
+	if (utf8.find_first_of(",\"\r\n") == std::string::npos)
+		return utf8;
+	std::string result = "\"";
+	for (char c : utf8)
+	{
+		if (c == '"')
+			result += '"';
+		result += c;
+	}
+	return result + "\"";
+}
+
+/** @brief Writes the results of the items in JSON lines or CSV. */
+class ResultWriter
+{
+public:
+	ResultWriter(std::ostream& ostr, bool bCsv, int nDirs) : m_ostr(ostr), m_bCsv(bCsv), m_nDirs(nDirs)
+	{
+		if (!m_bCsv)
+			return;
+		m_ostr << "path,type,status,sides,diffs,moved_to";
+		for (int nIndex = 0; nIndex < m_nDirs; ++nIndex)
+			m_ostr << ",size" << nIndex + 1;
+		m_ostr << "\n";
+	}
+
+	void WriteItem(const DIFFITEM& di)
+	{
+		String path = di.getItemRelativePath();
+		String movedTo = di.diffcode.isMoved() ? di.diffFileInfo[1].GetFile() : String();
+		const char *type = di.diffcode.isDirectory() ? "dir" : "file";
+		if (m_bCsv)
+		{
+			m_ostr << CsvString(path) << ',' << type << ',' << GetStatus(di) << ','
+				<< GetSides(di, m_nDirs) << ',' << di.nsdiffs << ',' << CsvString(movedTo);
+			for (int nIndex = 0; nIndex < m_nDirs; ++nIndex)
+			{
+				m_ostr << ',';
+				if (di.diffFileInfo[nIndex].size != DirItem::FILE_SIZE_NONE)
+					m_ostr << di.diffFileInfo[nIndex].size;
+			}
+		}
+		else
+		{
+			m_ostr << "{\"type\":\"" << type << "\",\"path\":" << JsonString(path)
+				<< ",\"status\":\"" << GetStatus(di) << "\",\"sides\":\"" << GetSides(di, m_nDirs) << "\"";
+			if (!di.diffcode.isDirectory())
+				m_ostr << ",\"diffs\":" << di.nsdiffs;
+			if (di.diffcode.isMoved())
+				m_ostr << ",\"moved_to\":" << JsonString(movedTo);
+			m_ostr << ",\"sizes\":[";
+			for (int nIndex = 0; nIndex < m_nDirs; ++nIndex)
+			{
+				if (nIndex > 0)
+					m_ostr << ',';
+				if (di.diffFileInfo[nIndex].size != DirItem::FILE_SIZE_NONE)
+					m_ostr << di.diffFileInfo[nIndex].size;
+				else
+					m_ostr << "null";
+			}
+			m_ostr << "]}";
+		}
+		m_ostr << "\n";
+	}
+
+private:
+	std::ostream& m_ostr;
+	bool m_bCsv;
+	int m_nDirs;
+};
+
+}
+
+/**
+ * Headless folder compare, for measuring and regression testing the compare
+ * engine without the GUI. See Usage.
+ */
+int _tmain(int argc, TCHAR *argv[])
 {
 #ifdef _MSC_VER
 	_CrtSetDbgFlag( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif
-	CompareStats cmpstats(2);
+	COptionsMgr *pOptions = GetOptionsMgr();
+	InitOptions(pOptions);
 
-	FileFilterHelper filter;
-	filter.UseMask(true);
-//	filter.SetMask(_T("*.cpp;*.c;*.h;*.vcproj;*.vcxproj"));
-	filter.SetMask(_T("*.*"));
+#ifdef _WIN32
+	MergeCmdLineInfo cmdInfo(GetCommandLine());
+#else
+	MergeCmdLineInfo cmdInfo(JoinArguments(argc, argv).c_str());
+#endif
+	if (cmdInfo.m_bShowUsage || cmdInfo.m_Files.GetSize() < 2)
+	{
+		std::cerr << Usage;
+		return cmdInfo.m_bShowUsage ? 0 : 2;
+	}
+	if (!ApplyCommandLine(pOptions, cmdInfo))
+	{
+		for (const auto& msg : cmdInfo.m_sErrorMessages)
+			std::cerr << ucr::toUTF8(msg) << std::endl;
+		return 2;
+	}
 
-	CDiffContext ctx(
-		PathContext(_T("c:/windows"), _T("c:/windows")),
-		CMP_CONTENT);
+	if (!cmdInfo.m_sTraceFile.empty())
+		perftrace::Enable();
 
-	DIFFOPTIONS options = {0};
-	options.nIgnoreWhitespace = false;
-	options.bIgnoreBlankLines = false;
-	options.bFilterCommentsLines = false;
-	options.bIgnoreCase = false;
-	options.bIgnoreEol = false;
+	const int nDirs = cmdInfo.m_Files.GetSize();
+	CompareStats cmpstats(nDirs);
 
-	ctx.InitDiffItemList();
-	//ctx.CreateCompareOptions(CMP_CONTENT, options);
-	ctx.CreateCompareOptions(CMP_DATE, options);
+	FileFilterHelper filter;
+	filter.SetFilter(cmdInfo.m_sFileFilter);
 
-	ctx.m_iGuessEncodingType = 0;//(50001 << 16) + 2;
-	ctx.m_bIgnoreSmallTimeDiff = true;
-	ctx.m_bStopAfterFirstDiff = false;
-	ctx.m_nQuickCompareLimit = 4 * 1024 * 1024;
-	ctx.m_bPluginsEnabled = false;
-	ctx.m_bWalkUniques = true;
+	CDiffContext ctx(cmdInfo.m_Files, pOptions->GetInt(OPT_CMP_METHOD));
+	ctx.InitDiffItemList();
+	InitDiffContext(ctx, pOptions);
 	ctx.m_pCompareStats = &cmpstats;
-	ctx.m_bRecursive = true;
+	ctx.m_bRecursive = cmdInfo.m_bRecurse;
 	ctx.m_piFilterGlobal = &filter;
 
+	Poco::Stopwatch stopwatch;
+	Poco::Timestamp::TimeDiff scanTime = 0;
+	stopwatch.start();
+
+	// Results of an earlier compare, with the changed items marked for rescan
+	bool bFromSnapshot = false;
+	if (!cmdInfo.m_sSnapshotFile.empty() &&
+		paths::DoesPathExist(cmdInfo.m_sSnapshotFile) == paths::IS_EXISTING_FILE)
+	{
+		bool bCompleteRescan = false;
+		bFromSnapshot = ctx.LoadSnapshot(cmdInfo.m_sSnapshotFile, true, bCompleteRescan) && !bCompleteRescan;
+		if (!bFromSnapshot)
+		{
+			ctx.RemoveAll();
+			ctx.InitDiffItemList();
+		}
+	}
+
 	// Folder names to compare are in the compare context
 	CDiffThread diffThread;
 	diffThread.SetContext(&ctx);
-	diffThread.SetCollectFunction([](DiffFuncStruct* myStruct) {
-		bool casesensitive = false;
-		int depth = myStruct->context->m_bRecursive ? -1 : 0;
-		PathContext paths = myStruct->context->GetNormalizedPaths();
-		String subdir[3] = { _T(""), _T(""), _T("") }; // blank to start at roots specified in diff context
-		// Build results list (except delaying file comparisons until below)
-		DirScan_GetItems(paths, subdir, myStruct,
-			casesensitive, depth, nullptr, myStruct->context->m_bWalkUniques);
-	});
-	diffThread.SetCompareFunction([](DiffFuncStruct* myStruct) {
-		DirScan_CompareItems(myStruct, nullptr);
-	});
+	if (bFromSnapshot)
+	{
+		diffThread.SetCollectFunction([&](DiffFuncStruct* myStruct) {
+			int nItems = DirScan_UpdateMarkedItems(myStruct, nullptr);
+			myStruct->context->m_pCompareStats->IncreaseTotalItems(nItems);
+			scanTime = stopwatch.elapsed();
+		});
+		diffThread.SetCompareFunction([](DiffFuncStruct* myStruct) {
+			DirScan_CompareRequestedItems(myStruct, nullptr);
+		});
+		diffThread.SetMarkedRescan(true);
+	}
+	else
+	{
+		diffThread.SetCollectFunction([&](DiffFuncStruct* myStruct) {
+			bool casesensitive = false;
+			int depth = myStruct->context->m_bRecursive ? -1 : 0;
+			PathContext paths = myStruct->context->GetNormalizedPaths();
+			String subdir[3] = { _T(""), _T(""), _T("") }; // blank to start at roots specified in diff context
+			// Build results list (except delaying file comparisons until below)
+			DirScan_GetItems(paths, subdir, myStruct,
+				casesensitive, depth, nullptr, myStruct->context->m_bWalkUniques);
+			scanTime = stopwatch.elapsed();
+		});
+		diffThread.SetCompareFunction([](DiffFuncStruct* myStruct) {
+			DirScan_CompareItems(myStruct, nullptr);
+			if (myStruct->context->m_bDetectMovedItems)
+				DirScan_DetectMovedItems(myStruct);
+		});
+	}
 	diffThread.CompareDirectories();
-
 	while (diffThread.GetThreadState() != CDiffThread::THREAD_COMPLETED)
+		Poco::Thread::sleep(10);
+	stopwatch.stop();
+
+	std::ofstream ofstr;
+	bool bCsv = false;
+	if (!cmdInfo.m_sReportFile.empty())
 	{
-		Poco::Thread::sleep(200);
-		std::cout << cmpstats.GetComparedItems() << std::endl;
+		ofstr.open(cmdInfo.m_sReportFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!ofstr)
+		{
+			std::cerr << "Cannot write " << ucr::toUTF8(cmdInfo.m_sReportFile) << std::endl;
+			return 2;
+		}
+		bCsv = strutils::compare_nocase(paths::FindExtension(cmdInfo.m_sReportFile), _T(".csv")) == 0;
 	}
+	std::ostream& ostr = ofstr.is_open() ? static_cast<std::ostream&>(ofstr) : std::cout;
+	ResultWriter writer(ostr, bCsv, nDirs);
 
-	DIFFITEM *pos = ctx.GetFirstDiffPosition();
-	while (pos)
+	int nDifferent = 0, nErrors = 0;
+	uint64_t nBytes = 0;
+	std::vector<PATCHFILES> fileList;
+	for (DIFFITEM *pos = ctx.GetFirstDiffPosition(); pos != nullptr; )
 	{
-		DIFFITEM& di = ctx.GetNextDiffRefPosition(pos);
-		if (ctx.m_piFilterGlobal->includeFile(di.diffFileInfo[0].filename, di.diffFileInfo[1].filename))
+		const DIFFITEM& di = ctx.GetNextDiffRefPosition(pos);
+		writer.WriteItem(di);
+		if (di.diffcode.isResultFiltered())
+			continue;
+		if (!di.diffcode.isDirectory() && di.diffcode.existAll())
 		{
-			FolderCmp folderCmp(&ctx);
-			folderCmp.prepAndCompareFiles(di);
-#ifdef _UNICODE
-//		std::wcout << di.diffFileInfo[0].filename << ":" << di.diffcode.isResultDiff() << std::endl;
-#else
-//		std::cout << di.diffFileInfo[0].filename << ":" << di.diffcode.isResultDiff() << std::endl;
-#endif
+			for (int nIndex = 0; nIndex < nDirs; ++nIndex)
+				nBytes += di.diffFileInfo[nIndex].size;
 		}
+		if (di.diffcode.isResultError())
+			++nErrors;
+		else if (!di.diffcode.isDirectory() && (di.diffcode.isResultDiff() || !di.diffcode.existAll()))
+			++nDifferent;
+		if (nDirs != 2 || di.diffcode.isDirectory() || di.diffcode.isBin() || !di.diffcode.isResultDiff())
+			continue;
+		PATCHFILES files;
+		files.lfile = paths::ConcatPath(di.getFilepath(0, ctx.GetNormalizedPath(0)), di.diffFileInfo[0].filename);
+		files.rfile = paths::ConcatPath(di.getFilepath(1, ctx.GetNormalizedPath(1)), di.diffFileInfo[1].filename);
+		files.pathLeft = paths::ConcatPath(di.diffFileInfo[0].path, di.diffFileInfo[0].filename);
+		files.pathRight = paths::ConcatPath(di.diffFileInfo[1].path, di.diffFileInfo[1].filename);
+		fileList.push_back(files);
+	}
 
+	std::ostringstream summary;
+	summary << "{\"type\":\"summary\",\"method\":\"" << CompareMethodNames[ctx.GetCompareMethod()]
+		<< "\",\"items\":" << cmpstats.GetTotalItems()
+		<< ",\"compared\":" << cmpstats.GetComparedItems()
+		<< ",\"different\":" << nDifferent
+		<< ",\"errors\":" << nErrors
+		<< ",\"threads\":" << GetCompareThreadCount(ctx, pOptions)
+		<< ",\"bytes\":" << nBytes
+		<< ",\"scan_ms\":" << scanTime / 1000
+		<< ",\"elapsed_ms\":" << stopwatch.elapsed() / 1000;
+
+	if (!cmdInfo.m_sOutputpath.empty())
+	{
+		DIFFOPTIONS options = {0};
+		Options::DiffOptions::Load(pOptions, options);
+		PATCHOPTIONS patchOptions = { OUTPUT_UNIFIED, 3, true };
+		PatchCreator patchCreator;
+		patchCreator.SetOptions(options, patchOptions);
+		patchCreator.SetThreadCount(static_cast<int>(Poco::Environment::processorCount()));
+		Poco::Stopwatch patchStopwatch;
+		patchStopwatch.start();
+		PatchCreator::Result result = patchCreator.CreatePatch(cmdInfo.m_sOutputpath, false, fileList);
+		summary << ",\"patch_files\":" << patchCreator.GetWrittenFileCount()
+			<< ",\"patch_ms\":" << patchStopwatch.elapsed() / 1000;
+		if (result != PatchCreator::Result::Ok)
+			++nErrors;
+	}
+	if (!cmdInfo.m_sSnapshotFile.empty())
+	{
+		summary << ",\"from_snapshot\":" << (bFromSnapshot ? "true" : "false");
+		if (!ctx.SaveSnapshot(cmdInfo.m_sSnapshotFile))
+		{
+			std::cerr << "Cannot write " << ucr::toUTF8(cmdInfo.m_sSnapshotFile) << std::endl;
+			++nErrors;
+		}
+	}
+	summary << ",\"peak_rss\":" << GetPeakWorkingSetSize() << "}";
+	(bCsv ? std::cerr : ostr) << summary.str() << std::endl;
+
+	if (!cmdInfo.m_sTraceFile.empty() && !perftrace::Dump(cmdInfo.m_sTraceFile))
+	{
+		std::cerr << "Cannot write " << ucr::toUTF8(cmdInfo.m_sTraceFile) << std::endl;
+		++nErrors;
 	}
 
-	return 0;
+	if (nErrors > 0)
+		return 2;
+	return cmdInfo.m_bEnableExitCode && nDifferent > 0 ? 1 : 0;
 }
@@ -0,0 +1,158 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+
+# Generates a pair of folder trees for benchmarking folder compares.
+#
+# The trees depend on the arguments only: the same arguments give the same
+# file names, contents and modification times on every machine, so timings
+# of different builds and machines compare the same work.
+#
+# Usage: GenerateTree.py [options] output_folder
+#   Creates output_folder/left and output_folder/right. Run with -h for the
+#   options.
+
+import argparse
+import json
+import math
+import os
+import random
+import shutil
+
+# Modification time of all files; changed files get a later time on the right
+BASE_MTIME = 1600000000
+
+WORDS = (
+    'alpha', 'beta', 'gamma', 'delta', 'epsilon', 'zeta', 'theta', 'lambda',
+    'value', 'result', 'index', 'count', 'buffer', 'string', 'return', 'const',
+    'if', 'else', 'for', 'while', 'int', 'void', 'class', 'struct', '{', '}',
+    '(', ')', ';', '=', '+', '==', 'café', 'naïve', 'Größe', 'déjà', 'señor',
+)
+
+ENCODINGS = ('utf-8', 'utf-8-sig', 'utf-16', 'cp1252')
+
+def parse_encodings(text):
+    """Parses 'utf-8=70,utf-16=30' into a list of (encoding, weight)."""
+    result = []
+    for item in text.split(','):
+        name, _, weight = item.partition('=')
+        if name not in ENCODINGS:
+            raise argparse.ArgumentTypeError('unknown encoding %s, use one of %s' % (name, ', '.join(ENCODINGS)))
+        result.append((name, float(weight) if weight else 1.0))
+    return result
+
+def parse_args():
+    parser = argparse.ArgumentParser(description='Generate folder trees for benchmarking folder compares.')
+    parser.add_argument('output', help='folder to create the left and right trees in')
+    parser.add_argument('--seed', type=int, default=1, help='random seed (default 1)')
+    parser.add_argument('--depth', type=int, default=3, help='levels of subfolders (default 3)')
+    parser.add_argument('--fanout', type=int, default=4, help='subfolders per folder (default 4)')
+    parser.add_argument('--files', type=int, default=20, help='files per folder (default 20)')
+    parser.add_argument('--min-size', type=int, default=256, help='smallest file size in bytes (default 256)')
+    parser.add_argument('--max-size', type=int, default=1024 * 1024, help='largest file size in bytes (default 1 MiB)')
+    parser.add_argument('--changed', type=float, default=10, help='percentage of files changed on the right (default 10)')
+    parser.add_argument('--unique', type=float, default=5, help='percentage of files only on one side (default 5)')
+    parser.add_argument('--binary', type=float, default=10, help='percentage of binary files (default 10)')
+    parser.add_argument('--encodings', type=parse_encodings, default=parse_encodings('utf-8=70,utf-8-sig=10,utf-16=10,cp1252=10'),
+        help='encodings of the text files with weights (default utf-8=70,utf-8-sig=10,utf-16=10,cp1252=10)')
+    return parser.parse_args()
+
+class Generator:
+    def __init__(self, args):
+        self.args = args
+        self.rng = random.Random(args.seed)
+        self.stats = { 'folders': 0, 'files': 0, 'changed': 0, 'unique': 0, 'binary': 0, 'bytes': 0 }
+
+    def file_size(self):
+        """File sizes are log-uniform, so that most files are small like in source trees."""
+        low, high = math.log(max(self.args.min_size, 1)), math.log(max(self.args.max_size, self.args.min_size, 1))
+        return int(math.exp(self.rng.uniform(low, high)))
+
+    def text_lines(self, size):
+        lines, length = [], 0
+        while length < size:
+            line = ' '.join(self.rng.choice(WORDS) for _ in range(self.rng.randint(1, 12)))
+            lines.append(line)
+            length += len(line) + 2
+        return lines
+
+    def encode(self, lines, encoding):
+        text = '\r\n'.join(lines) + '\r\n'
+        if encoding == 'utf-16':
+            return b'\xff\xfe' + text.encode('utf-16-le')
+        return text.encode(encoding)
+
+    def change_lines(self, lines):
+        """Replaces about one line in 50, at least one."""
+        lines = list(lines)
+        for _ in range(max(1, len(lines) // 50)):
+            lines[self.rng.randrange(len(lines))] = ' '.join(self.rng.choice(WORDS) for _ in range(6)) + ' changed'
+        return lines
+
+    def change_bytes(self, data):
+        data = bytearray(data)
+        for _ in range(max(1, len(data) // 4096)):
+            data[self.rng.randrange(len(data))] ^= 0xff
+        return bytes(data)
+
+    def file_contents(self):
+        """Returns the left and right contents of a file, and its extension."""
+        size = self.file_size()
+        changed = self.rng.uniform(0, 100) < self.args.changed
+        if self.rng.uniform(0, 100) < self.args.binary:
+            self.stats['binary'] += 1
+            # Zero bytes make the compare treat the file as binary
+            left = self.rng.randbytes(size).replace(b'\0', b'\1') + b'\0'
+            right = self.change_bytes(left) if changed else left
+            extension = '.bin'
+        else:
+            names, weights = zip(*self.args.encodings)
+            encoding = self.rng.choices(names, weights)[0]
+            lines = self.text_lines(size)
+            left = self.encode(lines, encoding)
+            right = self.encode(self.change_lines(lines), encoding) if changed else left
+            extension = '.txt'
+        if changed:
+            self.stats['changed'] += 1
+        return left, right, extension
+
+    def write_file(self, path, data, mtime):
+        with open(path, 'wb') as f:
+            f.write(data)
+        os.utime(path, (mtime, mtime))
+        self.stats['bytes'] += len(data)
+
+    def generate(self, relpath, level):
+        for side in ('left', 'right'):
+            os.makedirs(os.path.join(self.args.output, side, relpath), exist_ok=True)
+        self.stats['folders'] += 1
+        for index in range(self.args.files):
+            left, right, extension = self.file_contents()
+            name = 'file%04d%s' % (index, extension)
+            sides = ('left', 'right')
+            if self.rng.uniform(0, 100) < self.args.unique:
+                sides = (self.rng.choice(sides),)
+                self.stats['unique'] += 1
+            for side in sides:
+                data = left if side == 'left' else right
+                mtime = BASE_MTIME if data is left else BASE_MTIME + 3600
+                self.write_file(os.path.join(self.args.output, side, relpath, name), data, mtime)
+            self.stats['files'] += 1
+        if level < self.args.depth:
+            for index in range(self.args.fanout):
+                self.generate(os.path.join(relpath, 'dir%02d' % index), level + 1)
+
+def main():
+    args = parse_args()
+    for side in ('left', 'right'):
+        shutil.rmtree(os.path.join(args.output, side), ignore_errors=True)
+    generator = Generator(args)
+    generator.generate('', 0)
+    parameters = dict(vars(args))
+    del parameters['output']
+    info = { 'parameters': parameters, 'stats': generator.stats }
+    with open(os.path.join(args.output, 'tree.json'), 'w') as f:
+        json.dump(info, f, indent=1)
+    print(json.dumps(info))
+
+if __name__ == '__main__':
+    main()
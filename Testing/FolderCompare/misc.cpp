@@ -3,9 +3,63 @@
 #include "UnicodeString.h"
 #include "unicoder.h"
 #include "OptionsMgr.h"
+#ifdef _WIN32
 #include "RegOptionsMgr.h"
 
 CRegOptionsMgr m_optionsMgr;
+#else
+#include <cstring>
+
+/**
+ * @brief Options kept in memory only: there is no registry to save them to,
+ * and the folder compares never save their settings.
+ */
+class CMemoryOptionsMgr : public COptionsMgr
+{
+public:
+	int InitOption(const String& name, const varprop::VariantValue& defaultValue) override
+	{
+		if (defaultValue.GetType() == varprop::VT_NULL)
+			return COption::OPT_ERR;
+		return AddOption(name, defaultValue);
+	}
+	int InitOption(const String& name, const String& defaultValue) override
+	{
+		varprop::VariantValue defValue;
+		defValue.SetString(defaultValue);
+		return InitOption(name, defValue);
+	}
+	int InitOption(const String& name, const TCHAR *defaultValue) override
+	{
+		return InitOption(name, String(defaultValue));
+	}
+	int InitOption(const String& name, int defaultValue, bool serializable = true) override
+	{
+		varprop::VariantValue defValue;
+		defValue.SetInt(defaultValue);
+		return InitOption(name, defValue);
+	}
+	using COptionsMgr::InitOption;
+	int InitOption(const String& name, bool defaultValue) override
+	{
+		varprop::VariantValue defValue;
+		defValue.SetBool(defaultValue);
+		return InitOption(name, defValue);
+	}
+
+	int SaveOption(const String& name) override { return COption::OPT_OK; }
+	int SaveOption(const String& name, const varprop::VariantValue& value) override { return Set(name, value); }
+	int SaveOption(const String& name, const String& value) override { return Set(name, value); }
+	int SaveOption(const String& name, const TCHAR *value) override { return Set(name, value); }
+	int SaveOption(const String& name, int value) override { return Set(name, value); }
+	int SaveOption(const String& name, bool value) override { return Set(name, value); }
+	using COptionsMgr::SaveOption;
+
+	void SetSerializing(bool serializing = true) override {}
+};
+
+CMemoryOptionsMgr m_optionsMgr;
+#endif
 
 COptionsMgr * GetOptionsMgr()
 {
@@ -14,6 +68,7 @@ COptionsMgr * GetOptionsMgr()
 
 String GetSysError(int nerr /* =-1 */)
 {
+#ifdef _WIN32
 	if (nerr == -1)
 		nerr = GetLastError();
 	LPVOID lpMsgBuf;
@@ -35,6 +90,11 @@ String GetSysError(int nerr /* =-1 */)
 	// Free the buffer.
 	LocalFree( lpMsgBuf );
 	return str;
+#else
+	if (nerr == -1)
+		nerr = errno;
+	return strerror(nerr);
+#endif
 }
 
 String LoadResString(unsigned id)
@@ -54,7 +114,11 @@ void LogErrorString(const String& sz)
 
 void AppErrorMessageBox(const String& msg)
 {
+#ifdef _WIN32
 	MessageBox(NULL, msg.c_str(), NULL, MB_ICONSTOP);
+#else
+	std::cerr << ucr::toUTF8(msg) << std::endl;
+#endif
 }
 
 String tr(const std::string& str)
@@ -62,6 +126,8 @@ String tr(const std::string& str)
 	return ucr::toTString(str);
 }
 
+#ifdef _WIN32
 void NTAPI LangTranslateDialog(HWND h)
 {
 }
+#endif
@@ -0,0 +1,22 @@
+/**
+ * @file  PropIdl.h
+ *
+ * @brief Property types of the Windows API for the POSIX build.
+ *
+ * The Windows property system is not available; PropertySystem reads no
+ * properties there, so the types only need to exist.
+ */
+#pragma once
+
+#include "windows.h"
+
+typedef struct tagPROPVARIANT
+{
+	WORD vt;
+} PROPVARIANT;
+
+typedef struct _tagpropertykey
+{
+	BYTE fmtid[16];
+	DWORD pid;
+} PROPERTYKEY;
@@ -0,0 +1,57 @@
+/**
+ * @file  StdAfx.h
+ *
+ * @brief Precompiled header of the crystaledit parsers for the POSIX build.
+ *
+ * The parsers are built without MFC, so the few MFC names they use are here.
+ */
+#pragma once
+
+#include <windows.h>
+#include "pch.h"
+
+#define ASSERT(f) assert(f)
+#define _countof(array) (sizeof(array) / sizeof((array)[0]))
+
+static inline int _tcscpy_s(TCHAR *dest, size_t size, const TCHAR *src)
+{
+	if (size == 0 || strlen(src) >= size)
+		return ERANGE;
+	strcpy(dest, src);
+	return 0;
+}
+
+static inline int _tcscat_s(TCHAR *dest, size_t size, const TCHAR *src)
+{
+	size_t len = strlen(dest);
+	if (len + strlen(src) >= size)
+		return ERANGE;
+	strcpy(dest + len, src);
+	return 0;
+}
+
+/** @brief The part of CString of MFC that the parsers use. */
+class CString
+{
+public:
+	CString() = default;
+	CString(const TCHAR *psz) : m_str(psz) {}
+	CString(const std::basic_string<TCHAR>& str) : m_str(str) {}
+	operator const TCHAR *() const { return m_str.c_str(); }
+	int GetLength() const { return static_cast<int>(m_str.length()); }
+	bool IsEmpty() const { return m_str.empty(); }
+	int Find(TCHAR ch) const { return ToIndex(m_str.find(ch)); }
+	int Find(const TCHAR *psz) const { return ToIndex(m_str.find(psz)); }
+	CString Left(int count) const { return m_str.substr(0, count); }
+	CString Right(int count) const { return m_str.substr(m_str.length() - std::min<size_t>(count, m_str.length())); }
+	CString& MakeLower()
+	{
+		for (auto& c : m_str)
+			c = _totlower(c);
+		return *this;
+	}
+
+private:
+	static int ToIndex(size_t pos) { return pos == std::basic_string<TCHAR>::npos ? -1 : static_cast<int>(pos); }
+	std::basic_string<TCHAR> m_str;
+};
@@ -0,0 +1,47 @@
+/**
+ * @file  crtcompat.h
+ *
+ * @brief Extensions of the Microsoft CRT for the POSIX build.
+ *
+ * Included in every source file of the POSIX build by the compiler
+ * (-include), like the CRT headers declare them on Windows.
+ */
+#pragma once
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#define __int64 long long
+
+#define _strdup strdup
+#define _stricmp strcasecmp
+#define _strnicmp strncasecmp
+#define _ftelli64 ftello
+#define _fseeki64 fseeko
+#define sprintf_s snprintf
+#define sscanf_s sscanf
+
+static inline int ctime_s(char *buffer, size_t numberOfElements, const time_t *sourceTime)
+{
+	if (numberOfElements < 26)
+		return ERANGE;
+	return ctime_r(sourceTime, buffer) ? 0 : errno;
+}
+
+#ifdef __cplusplus
+
+template <size_t N>
+int _itoa_s(int value, char (&buffer)[N], int radix)
+{
+	if (radix != 10)
+		return EINVAL;
+	int len = snprintf(buffer, N, "%d", value);
+	return (len >= 0 && static_cast<size_t>(len) < N) ? 0 : ERANGE;
+}
+#define _itot_s _itoa_s
+
+#endif
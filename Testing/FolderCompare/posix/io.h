@@ -0,0 +1,45 @@
+/**
+ * @file  io.h
+ *
+ * @brief Low-level I/O of the Windows CRT for the POSIX build.
+ */
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+#ifndef O_SEQUENTIAL
+#define O_SEQUENTIAL 0
+#endif
+#define _O_BINARY O_BINARY
+#define _O_RDONLY O_RDONLY
+
+#define _SH_DENYNO 0
+#define _S_IREAD S_IRUSR
+#define _S_IWRITE S_IWUSR
+#define _S_IFDIR S_IFDIR
+#define _S_IFREG S_IFREG
+#define _S_IFCHR S_IFCHR
+#define _S_IFIFO S_IFIFO
+
+#define _read read
+#define _write write
+#define _close close
+#define _lseek lseek
+#define _fileno fileno
+#define _isatty isatty
+
+/** @brief open() with the error returned like _tsopen_s(); files are never locked on POSIX. */
+static inline int _tsopen_s(int *pfh, const char *filename, int oflag, int shflag, int pmode)
+{
+	(void)shflag;
+	*pfh = open(filename, oflag, pmode);
+	return *pfh >= 0 ? 0 : errno;
+}
+#define _sopen_s _tsopen_s
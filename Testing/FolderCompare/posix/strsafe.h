@@ -0,0 +1,20 @@
+/**
+ * @file  strsafe.h
+ *
+ * @brief Safe string functions of the Windows SDK for the POSIX build.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+/** @brief Copy a string, truncated to the buffer size; always null-terminated. */
+inline int StringCchCopy(char *dst, size_t cchDest, const char *src)
+{
+	if (cchDest == 0)
+		return -1;
+	size_t len = strnlen(src, cchDest - 1);
+	memcpy(dst, src, len);
+	dst[len] = '\0';
+	return src[len] == '\0' ? 0 : -1;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file  tchar.h
+ *
+ * @brief Generic-text mappings of the Windows CRT for the POSIX build.
+ *
+ * _UNICODE is not defined, so TCHAR is char and String holds UTF-8.
+ * Only the mappings the compare engine uses are here.
+ */
+#pragma once
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <wchar.h>
+
+typedef char TCHAR;
+typedef char _TCHAR;
+typedef const char *LPCTSTR;
+typedef char *LPTSTR;
+
+#define _T(x) x
+#define _TEXT(x) x
+#define _tmain main
+
+#define _tcslen strlen
+#define _tcschr strchr
+#define _tcsstr strstr
+#define _tcsspn strspn
+#define _tcspbrk strpbrk
+#define _tcsncmp strncmp
+#define _tcsdup strdup
+#define _tcscoll strcoll
+#define _tcsicoll strcasecmp
+#define _tcsicmp strcasecmp
+#define _tcsnicmp strncasecmp
+#define _tcstol strtol
+#define _ttoi atoi
+#define _ttol atol
+#define _tremove remove
+#define _tcsinc(p) ((p) + 1)
+
+#define _istspace(c) isspace((unsigned char)(c))
+#define _istalpha(c) isalpha((unsigned char)(c))
+#define _istalnum(c) isalnum((unsigned char)(c))
+#define _istdigit(c) isdigit((unsigned char)(c))
+#define _istupper(c) isupper((unsigned char)(c))
+#define _totlower(c) (char)(tolower((unsigned char)(c)))
+#define _totupper(c) (char)(toupper((unsigned char)(c)))
+
+#define _TRUNCATE ((size_t)-1)
+
+/** @brief vsnprintf() returning -1 like _vsntprintf_s() when the output is truncated. */
+static inline int _vsntprintf_s(char *buffer, size_t sizeOfBuffer, size_t count, const char *format, va_list argptr)
+{
+	va_list args;
+	(void)count;
+	va_copy(args, argptr);
+	int len = vsnprintf(buffer, sizeOfBuffer, format, args);
+	va_end(args);
+	return (len < 0 || (size_t)len >= sizeOfBuffer) ? -1 : len;
+}
+
+/** @brief Return -1 if the byte at current is a trail byte; the multibyte strings are UTF-8. */
+static inline int _ismbstrail(const unsigned char *string, const unsigned char *current)
+{
+	(void)string;
+	return (*current & 0xC0) == 0x80 ? -1 : 0;
+}
+
+static inline int _memicmp(const void *buf1, const void *buf2, size_t count)
+{
+	const unsigned char *p1 = (const unsigned char *)buf1;
+	const unsigned char *p2 = (const unsigned char *)buf2;
+	for (size_t i = 0; i < count; ++i)
+	{
+		int diff = tolower(p1[i]) - tolower(p2[i]);
+		if (diff != 0)
+			return diff;
+	}
+	return 0;
+}
+
+/** @brief fopen() with the error returned like _tfopen_s(); the "T" and "D" mode flags are dropped. */
+static inline int _tfopen_s(FILE **pFile, const char *filename, const char *mode)
+{
+	char cmode[16];
+	size_t len = 0;
+	for (; *mode && len < sizeof(cmode) - 1; ++mode)
+	{
+		if (*mode != 'T' && *mode != 'D')
+			cmode[len++] = *mode;
+	}
+	cmode[len] = '\0';
+	*pFile = fopen(filename, cmode);
+	return *pFile ? 0 : errno;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file  windows.h
+ *
+ * @brief Types and constants of the Windows API for the POSIX build.
+ *
+ * Only the declarations the compare engine shares between the platforms are
+ * here; code calling the Windows API itself is inside #ifdef _WIN32.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "tchar.h"
+
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef unsigned int UINT;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONGLONG;
+typedef void *LPVOID;
+typedef const void *LPCVOID;
+typedef char *LPSTR;
+typedef const char *LPCSTR;
+typedef wchar_t WCHAR;
+typedef wchar_t *LPWSTR;
+typedef const wchar_t *LPCWSTR;
+
+#define VOID void
+
+typedef void *HANDLE;
+typedef void *HMODULE;
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#define MAX_PATH 260
+
+#define CP_ACP 0
+#define CP_OEMCP 1
+#define CP_THREAD_ACP 3
+#define CP_UTF7 65000
+#define CP_UTF8 65001
+
+#define FILE_ATTRIBUTE_READONLY 0x00000001
+#define FILE_ATTRIBUTE_HIDDEN 0x00000002
+#define FILE_ATTRIBUTE_SYSTEM 0x00000004
+#define FILE_ATTRIBUTE_DIRECTORY 0x00000010
+#define FILE_ATTRIBUTE_ARCHIVE 0x00000020
+#define FILE_ATTRIBUTE_NORMAL 0x00000080
+#define FILE_ATTRIBUTE_REPARSE_POINT 0x00000400
+#define INVALID_FILE_ATTRIBUTES ((DWORD)-1)
+
+/** @brief Codepage of the narrow strings: String holds UTF-8 on POSIX. */
+static inline UINT GetACP(void)
+{
+	return CP_UTF8;
+}
+
+/** @brief Next character of a string; the strings are walked by bytes like the ANSI builds do. */
+static inline LPTSTR CharNext(LPCTSTR lpsz)
+{
+	return (LPTSTR)(*lpsz ? lpsz + 1 : lpsz);
+}
+
+static inline LPTSTR CharPrev(LPCTSTR lpszStart, LPCTSTR lpszCurrent)
+{
+	return (LPTSTR)(lpszCurrent > lpszStart ? lpszCurrent - 1 : lpszStart);
+}
+
+#include "winnls.h"
@@ -0,0 +1,213 @@
+/**
+ * @file  winnls.c
+ *
+ * @brief Codepage conversion of the Windows API for the POSIX build.
+ */
+#include <windows.h>
+#include <errno.h>
+#include <iconv.h>
+#include <stdio.h>
+#include <string.h>
+#include <wchar.h>
+
+static __thread DWORD m_dwLastError = ERROR_SUCCESS;
+
+DWORD GetLastError(void)
+{
+	return m_dwLastError;
+}
+
+void SetLastError(DWORD dwErrCode)
+{
+	m_dwLastError = dwErrCode;
+}
+
+UINT GetOEMCP(void)
+{
+	return CP_UTF8;
+}
+
+/**
+ * @brief Return the iconv name of a Windows codepage.
+ * The codepages without a name of their own are tried as "CPnnn",
+ * which is how iconv names the Windows and DOS codepages.
+ */
+static const char *GetCodepageName(UINT codepage, char *buf, size_t size)
+{
+	switch (codepage)
+	{
+	case CP_ACP:
+	case CP_OEMCP:
+	case CP_THREAD_ACP:
+	case CP_UTF8:
+		return "UTF-8";
+	case CP_UTF7:
+		return "UTF-7";
+	case 1200:
+		return "UTF-16LE";
+	case 1201:
+		return "UTF-16BE";
+	case 12000:
+		return "UTF-32LE";
+	case 12001:
+		return "UTF-32BE";
+	case 936:
+		return "GBK";
+	case 949:
+		return "UHC";
+	case 950:
+		return "BIG5";
+	case 10000:
+		return "MACINTOSH";
+	case 20127:
+		return "ASCII";
+	case 20866:
+		return "KOI8-R";
+	case 21866:
+		return "KOI8-U";
+	case 20932:
+	case 51932:
+		return "EUC-JP";
+	case 50220:
+		return "ISO-2022-JP";
+	case 51949:
+		return "EUC-KR";
+	case 54936:
+		return "GB18030";
+	}
+	if (codepage >= 28591 && codepage <= 28606)
+		snprintf(buf, size, "ISO-8859-%u", codepage - 28590);
+	else
+		snprintf(buf, size, "CP%u", codepage);
+	return buf;
+}
+
+static iconv_t OpenConverter(UINT toCodepage, UINT fromCodepage, int toWide)
+{
+	char buf[32];
+	if (toWide)
+		return iconv_open("WCHAR_T", GetCodepageName(fromCodepage, buf, sizeof(buf)));
+	return iconv_open(GetCodepageName(toCodepage, buf, sizeof(buf)), "WCHAR_T");
+}
+
+/**
+ * @brief Convert with iconv, replacing what cannot be converted.
+ * @param [in] unit Size of the input skipped for each replacement.
+ * @param [in] failOnInvalid Fail instead of replacing.
+ * @return Number of bytes written (or needed when dst is NULL), -1 on error.
+ */
+static int Convert(iconv_t cd, const char *src, size_t srclen, char *dst, size_t dstlen,
+	size_t unit, const char *replacement, size_t replen, int failOnInvalid, BOOL *usedDefault)
+{
+	char tmp[256];
+	char *in = (char *)src;
+	size_t inleft = srclen;
+	size_t total = 0;
+	int flushed = 0;
+	while (!flushed)
+	{
+		char *out = dst ? dst + total : tmp;
+		size_t room = dst ? dstlen - total : sizeof(tmp);
+		size_t outleft = room;
+		size_t r;
+		if (inleft > 0)
+			r = iconv(cd, &in, &inleft, &out, &outleft);
+		else
+		{
+			// Write the sequence returning stateful encodings to the initial state
+			r = iconv(cd, NULL, NULL, &out, &outleft);
+			flushed = (r != (size_t)-1);
+		}
+		total += room - outleft;
+		if (r != (size_t)-1)
+			continue;
+		if (errno == E2BIG)
+		{
+			if (dst == NULL)
+				continue;
+			SetLastError(ERROR_INSUFFICIENT_BUFFER);
+			return -1;
+		}
+		if (failOnInvalid)
+		{
+			SetLastError(ERROR_NO_UNICODE_TRANSLATION);
+			return -1;
+		}
+		if (usedDefault)
+			*usedDefault = TRUE;
+		if (dst)
+		{
+			if (dstlen - total < replen)
+			{
+				SetLastError(ERROR_INSUFFICIENT_BUFFER);
+				return -1;
+			}
+			memcpy(dst + total, replacement, replen);
+		}
+		total += replen;
+		size_t skip = unit < inleft ? unit : inleft;
+		in += skip;
+		inleft -= skip;
+	}
+	return (int)total;
+}
+
+BOOL IsValidCodePage(UINT CodePage)
+{
+	iconv_t cd = OpenConverter(CP_UTF8, CodePage, 1);
+	if (cd == (iconv_t)-1)
+		return FALSE;
+	iconv_close(cd);
+	return TRUE;
+}
+
+int MultiByteToWideChar(UINT CodePage, DWORD dwFlags, LPCSTR lpMultiByteStr, int cbMultiByte,
+	LPWSTR lpWideCharStr, int cchWideChar)
+{
+	if (cbMultiByte == -1)
+		cbMultiByte = (int)strlen(lpMultiByteStr) + 1;
+	if (cbMultiByte <= 0 || cchWideChar < 0)
+	{
+		SetLastError(ERROR_INVALID_PARAMETER);
+		return 0;
+	}
+	iconv_t cd = OpenConverter(0, CodePage, 1);
+	if (cd == (iconv_t)-1)
+	{
+		SetLastError(ERROR_INVALID_PARAMETER);
+		return 0;
+	}
+	const wchar_t replacement = 0xFFFD;
+	int bytes = Convert(cd, lpMultiByteStr, cbMultiByte,
+		cchWideChar ? (char *)lpWideCharStr : NULL, cchWideChar * sizeof(wchar_t),
+		1, (const char *)&replacement, sizeof(replacement), (dwFlags & MB_ERR_INVALID_CHARS) != 0, NULL);
+	iconv_close(cd);
+	return bytes < 0 ? 0 : bytes / (int)sizeof(wchar_t);
+}
+
+int WideCharToMultiByte(UINT CodePage, DWORD dwFlags, LPCWSTR lpWideCharStr, int cchWideChar,
+	LPSTR lpMultiByteStr, int cbMultiByte, LPCSTR lpDefaultChar, BOOL *lpUsedDefaultChar)
+{
+	(void)dwFlags;
+	if (cchWideChar == -1)
+		cchWideChar = (int)wcslen(lpWideCharStr) + 1;
+	if (cchWideChar <= 0 || cbMultiByte < 0)
+	{
+		SetLastError(ERROR_INVALID_PARAMETER);
+		return 0;
+	}
+	iconv_t cd = OpenConverter(CodePage, 0, 0);
+	if (cd == (iconv_t)-1)
+	{
+		SetLastError(ERROR_INVALID_PARAMETER);
+		return 0;
+	}
+	if (lpUsedDefaultChar)
+		*lpUsedDefaultChar = FALSE;
+	const char *replacement = lpDefaultChar ? lpDefaultChar : "?";
+	int bytes = Convert(cd, (const char *)lpWideCharStr, cchWideChar * sizeof(wchar_t),
+		cbMultiByte ? lpMultiByteStr : NULL, cbMultiByte,
+		sizeof(wchar_t), replacement, strlen(replacement), 0, lpUsedDefaultChar);
+	iconv_close(cd);
+	return bytes < 0 ? 0 : bytes;
+}
@@ -0,0 +1,41 @@
+/**
+ * @file  winnls.h
+ *
+ * @brief Codepage conversion of the Windows API for the POSIX build.
+ *
+ * The conversions are done with iconv. wchar_t holds UTF-32 here, not
+ * UTF-16, so UCS-2 text is converted as the codepages 1200 and 1201.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MB_ERR_INVALID_CHARS 0x00000008
+
+#define WC_DISCARDNS 0x00000010
+#define WC_SEPCHARS 0x00000020
+#define WC_DEFAULTCHAR 0x00000040
+#define WC_COMPOSITECHECK 0x00000200
+#define WC_NO_BEST_FIT_CHARS 0x00000400
+
+#define ERROR_SUCCESS 0
+#define ERROR_INVALID_PARAMETER 87
+#define ERROR_INSUFFICIENT_BUFFER 122
+#define ERROR_INVALID_FLAGS 1004
+#define ERROR_NO_UNICODE_TRANSLATION 1113
+
+DWORD GetLastError(void);
+void SetLastError(DWORD dwErrCode);
+
+UINT GetOEMCP(void);
+BOOL IsValidCodePage(UINT CodePage);
+int MultiByteToWideChar(UINT CodePage, DWORD dwFlags, LPCSTR lpMultiByteStr, int cbMultiByte,
+	LPWSTR lpWideCharStr, int cchWideChar);
+int WideCharToMultiByte(UINT CodePage, DWORD dwFlags, LPCWSTR lpWideCharStr, int cchWideChar,
+	LPSTR lpMultiByteStr, int cbMultiByte, LPCSTR lpDefaultChar, BOOL *lpUsedDefaultChar);
+
+#ifdef __cplusplus
+}
+#endif
@@ -4,7 +4,7 @@ rem set PATH=C:\Program Files (x86)\Microsoft Visual Studio 10.0\Team Tools\Perf
 
 rem VSInstr Release\FolderCompare.exe
 VSPerfCmd /start:sample /output:FolderCompare.vsp
-VSPerfCmd /launch:%~dp0\Release\FolderCompare.exe
+VSPerfCmd /launch:%~dp0\Release\FolderCompare.exe /args:"/r /or %TEMP%\FolderCompare.json C:\Windows C:\Windows"
 VSPerfCmd /shutdown
 VSPerfReport FolderCompare.vsp /summary:all
 
@@ -3,6 +3,7 @@
 #include "DiffContext.h"
 #include "PathContext.h"
 #include "CompareEngines/BinaryCompare.h"
+#include "IAbortable.h"
 #include <fstream>
 
 namespace
@@ -230,4 +231,23 @@ namespace
 		EXPECT_EQ(DIFFCODE::CMPERR, bc.CompareFiles(files, di));
 	}
 
+	TEST_F(BinaryCompareTest, CompareFileContents)
+	{
+		struct Aborted : IAbortable
+		{
+			bool ShouldAbort() const override { return true; }
+		} aborted;
+		std::string data(1024 * 1024, 'x');
+
+		TempFile l1("A", data.c_str(), data.size());
+		TempFile r1("B", data.c_str(), data.size());
+		data[data.size() - 1] = 'y';
+		TempFile r2("C", data.c_str(), data.size());
+
+		EXPECT_EQ(DIFFCODE::SAME, CompareEngines::BinaryCompare::CompareFileContents(_T("A"), _T("B"), nullptr));
+		EXPECT_EQ(DIFFCODE::DIFF, CompareEngines::BinaryCompare::CompareFileContents(_T("A"), _T("C"), nullptr));
+		EXPECT_EQ(DIFFCODE::CMPERR, CompareEngines::BinaryCompare::CompareFileContents(_T("A"), _T("/1>"), nullptr));
+		EXPECT_EQ(DIFFCODE::CMPABORT, CompareEngines::BinaryCompare::CompareFileContents(_T("A"), _T("B"), &aborted));
+	}
+
 }  // namespace
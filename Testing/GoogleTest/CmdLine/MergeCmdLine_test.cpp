@@ -2214,6 +2214,13 @@ namespace
 		}
 	}
 
+	// Snapshot file
+	TEST_F(MergeCmdLineInfoTest, SnapshotFile)
+	{
+		MergeCmdLineInfo cmdInfo(_T("C:\\WinMerge\\WinMerge.exe c:\\dir1 c:\\dir2 /snapshot c:\\tmp\\dirs.snapshot"));
+		EXPECT_EQ(_T("c:\\tmp\\dirs.snapshot"), cmdInfo.m_sSnapshotFile);
+	}
+
 	// Compare method
 	TEST_F(MergeCmdLineInfoTest, CompareMethod)
 	{
@@ -0,0 +1,151 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include <string>
+#include "ConflictFileParser.h"
+#include "../UnitTests/TempFolder.h"
+
+using namespace ConflictFileParser;
+
+namespace
+{
+	struct Revisions
+	{
+		bool result;
+		bool nested;
+		bool threeWay;
+		std::string working;
+		std::string theirs;
+		std::string base;
+	};
+
+	std::string join(const std::string& text, const Slices& slices)
+	{
+		std::string result;
+		for (const auto& slice : slices)
+			result.append(text, slice.offset, slice.length);
+		return result;
+	}
+
+	Revisions split(const std::string& text)
+	{
+		Slices working, theirs, base;
+		Revisions r;
+		r.result = SplitConflictText(text.data(), text.size(), working, theirs, base, r.nested, r.threeWay);
+		r.working = join(text, working);
+		r.theirs = join(text, theirs);
+		r.base = join(text, base);
+		return r;
+	}
+}
+
+TEST(ConflictFileParser, no_conflict)
+{
+	Revisions r = split("line1\nline2 ======= \nline3");
+	EXPECT_FALSE(r.result);
+	EXPECT_FALSE(r.nested);
+	EXPECT_FALSE(r.threeWay);
+	EXPECT_EQ("line1\nline2 ======= \nline3", r.working);
+	EXPECT_EQ(r.working, r.theirs);
+	EXPECT_EQ(r.working, r.base);
+}
+
+TEST(ConflictFileParser, two_way)
+{
+	Revisions r = split(
+		"common1\r\n"
+		"<<<<<<< .mine\r\n"
+		"mine\r\n"
+		"=======\r\n"
+		"theirs\r\n"
+		">>>>>>> .r2\r\n"
+		"common2");
+	EXPECT_TRUE(r.result);
+	EXPECT_FALSE(r.nested);
+	EXPECT_FALSE(r.threeWay);
+	EXPECT_EQ("common1\r\nmine\r\ncommon2", r.working);
+	EXPECT_EQ("common1\r\ntheirs\r\ncommon2", r.theirs);
+	EXPECT_EQ("common1\r\ncommon2", r.base);
+}
+
+TEST(ConflictFileParser, three_way)
+{
+	Revisions r = split(
+		"<<<<<<< HEAD\n"
+		"mine\n"
+		"||||||| merged common ancestors\n"
+		"base\n"
+		"=======\n"
+		"theirs\n"
+		">>>>>>> branch\n"
+		"end\n");
+	EXPECT_TRUE(r.result);
+	EXPECT_TRUE(r.threeWay);
+	EXPECT_EQ("mine\nend\n", r.working);
+	EXPECT_EQ("theirs\nend\n", r.theirs);
+	EXPECT_EQ("base\nend\n", r.base);
+}
+
+TEST(ConflictFileParser, utf8_bom)
+{
+	const std::string bom = "\xEF\xBB\xBF";
+	Revisions r = split(bom +
+		"<<<<<<< .mine\n"
+		"mine\n"
+		"=======\n"
+		"theirs\n"
+		">>>>>>> .r2\n");
+	EXPECT_TRUE(r.result);
+	EXPECT_EQ(bom + "mine\n", r.working);
+	EXPECT_EQ(bom + "theirs\n", r.theirs);
+	EXPECT_EQ(bom, r.base);
+
+	TempFolder folder(_T("ConflictFileParserTest"));
+	EXPECT_TRUE(IsConflictFile(folder.WriteFile(_T("conflict.txt"), bom + "<<<<<<< .mine\nmine\n=======\ntheirs\n>>>>>>> .r2\n")));
+	EXPECT_FALSE(IsConflictFile(folder.WriteFile(_T("noconflict.txt"), bom + "text <<<<<<< .mine\n")));
+}
+
+TEST(ConflictFileParser, markers_after_text)
+{
+	Revisions r = split(
+		"<<<<<<< HEAD\n"
+		"mine=======\n"
+		"theirs>>>>>>> branch\n");
+	EXPECT_TRUE(r.result);
+	EXPECT_EQ("mine\n", r.working);
+	EXPECT_EQ("theirs\n", r.theirs);
+	EXPECT_EQ("", r.base);
+}
+
+TEST(ConflictFileParser, nested)
+{
+	Revisions r = split(
+		"<<<<<<< outer\n"
+		"<<<<<<< inner\n"
+		"a\n"
+		"=======\n"
+		"b\n"
+		">>>>>>> inner\n"
+		"=======\n"
+		"c\n"
+		">>>>>>> outer\n");
+	EXPECT_TRUE(r.result);
+	EXPECT_TRUE(r.nested);
+	EXPECT_EQ("<<<<<<< inner\na\n=======\nb\n>>>>>>> inner\n", r.working);
+	EXPECT_EQ("c\n", r.theirs);
+}
+
+TEST(ConflictFileParser, common_lines_are_one_slice)
+{
+	std::string common;
+	for (int i = 0; i < 1000; ++i)
+		common += "common line <<< === >>> |||\n";
+	std::string text = common + "<<<<<<< a\nx\n=======\ny\n>>>>>>> b\n" + common;
+	Slices working, theirs, base;
+	bool nested, threeWay;
+	EXPECT_TRUE(SplitConflictText(text.data(), text.size(), working, theirs, base, nested, threeWay));
+	ASSERT_EQ(3u, working.size());
+	EXPECT_EQ(0u, working[0].offset);
+	EXPECT_EQ(common.size(), working[0].length);
+	ASSERT_EQ(2u, base.size());
+	EXPECT_EQ(common + common, join(text, base));
+}
@@ -82,5 +82,37 @@ namespace
 		EXPECT_EQ(String(_T("Dir1\\File2")), pdi->diffFileInfo[0].GetFile());
 	}
 
+	TEST_F(DiffItemListTest, RemoveDiff)
+	{
+		DiffItemList list;
+		list.InitDiffItemList();
+		DIFFITEM *pDir1 = list.AddNewDiff(nullptr);
+		DIFFITEM *pDir2 = list.AddNewDiff(nullptr);
+		DIFFITEM *pFile1 = list.AddNewDiff(pDir1);
+		list.AddNewDiff(pDir1);
+		SetFile(*pDir1, _T("Dir1"));
+		SetFile(*pDir2, _T("Dir2"));
+		SetFile(*pFile1, _T("Dir1\\File1"));
+
+		list.RemoveChildren(pDir1);
+		EXPECT_FALSE(pDir1->HasChildren());
+
+		// Slots of removed items are reused
+		DIFFITEM *pFile3 = list.AddNewDiff(pDir2);
+		DIFFITEM *pFile4 = list.AddNewDiff(pDir2);
+		EXPECT_TRUE(pFile3 == pFile1 || pFile4 == pFile1);
+		SetFile(*pFile3, _T("Dir2\\File3"));
+		EXPECT_EQ(String(_T("Dir2\\File3")), pFile3->diffFileInfo[0].GetFile());
+
+		list.RemoveDiff(pDir1);
+		DIFFITEM *pdi = list.GetFirstDiffPosition();
+		EXPECT_EQ(pDir2, pdi);
+		list.GetNextSiblingDiffPosition(pdi);
+		EXPECT_EQ(nullptr, pdi);
+
+		list.RemoveAll();
+		list.InitDiffItemList();
+		EXPECT_EQ(nullptr, list.GetFirstDiffPosition());
+	}
 
 }  // namespace
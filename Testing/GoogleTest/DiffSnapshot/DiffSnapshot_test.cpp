@@ -0,0 +1,276 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#include "DiffSnapshot.h"
+#include "DiffItemList.h"
+#include "DiffContext.h"
+#include "PathContext.h"
+#include "TFile.h"
+#include "paths.h"
+#include "unicoder.h"
+#include "../UnitTests/TempFolder.h"
+
+namespace
+{
+	class DiffSnapshotTest : public testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			m_paths = PathContext(m_folder.GetPath(SideNames[0]), m_folder.GetPath(SideNames[1]));
+			m_snapshot = m_folder.GetPath(_T("snapshot.bin"));
+			TFile(paths::ConcatPath(m_paths[0], _T("sub"))).createDirectories();
+			TFile(paths::ConcatPath(m_paths[1], _T("sub"))).createDirectories();
+			m_list.InitDiffItemList();
+		}
+
+		void WriteFile(int side, const String& relpath, const std::string& text)
+		{
+			m_folder.WriteFile(paths::ConcatPath(SideNames[side], relpath), text);
+		}
+
+		// Adds an item with the current state of the files on both sides
+		DIFFITEM *AddItem(DIFFITEM *parent, const String& dir, const String& name, unsigned type)
+		{
+			DIFFITEM *pdi = m_list.AddNewDiff(parent);
+			pdi->diffcode.diffcode = type | DIFFCODE::SAME;
+			for (int i = 0; i < 2; i++)
+			{
+				pdi->diffFileInfo[i].path = dir;
+				pdi->diffFileInfo[i].filename = name;
+				if (pdi->diffFileInfo[i].Update(paths::ConcatPath(m_paths[i], pdi->diffFileInfo[i].GetFile())))
+					pdi->diffcode.setSideFlag(i);
+			}
+			return pdi;
+		}
+
+		// Offsets of the layout in DiffSnapshot.cpp
+		static constexpr size_t ParentPos = 16;
+		static constexpr size_t FilenamePos = 24 + 32;
+
+		// Overwrites a field of a record of the snapshot file
+		void PatchRecord(uint32_t index, size_t offset, uint32_t value)
+		{
+			const size_t RecordsOffsetPos = 80;
+			const size_t RecordSize = 24 + 2 * 72;
+			std::fstream fstr(ucr::toUTF8(m_snapshot).c_str(), std::ios::in | std::ios::out | std::ios::binary);
+			uint64_t recordsOffset = 0;
+			fstr.seekg(RecordsOffsetPos);
+			fstr.read(reinterpret_cast<char *>(&recordsOffset), sizeof(recordsOffset));
+			fstr.seekp(recordsOffset + index * RecordSize + offset);
+			fstr.write(reinterpret_cast<const char *>(&value), sizeof(value));
+		}
+
+		static int CountItems(const DiffItemList& list, const DIFFITEM *parent)
+		{
+			int count = 0;
+			for (const DIFFITEM *pdi = list.GetFirstChildDiffPosition(parent); pdi != nullptr; pdi = pdi->GetFwdSiblingLink())
+				count += 1 + CountItems(list, pdi);
+			return count;
+		}
+
+		static constexpr const TCHAR *SideNames[] = { _T("left"), _T("right") };
+
+		TempFolder m_folder { _T("DiffSnapshotTest") };
+		PathContext m_paths;
+		String m_snapshot;
+		DiffItemList m_list;
+	};
+
+	TEST_F(DiffSnapshotTest, SaveAndLoad)
+	{
+		DIFFITEM *pFolder = m_list.AddNewDiff(nullptr);
+		pFolder->diffcode.diffcode = DIFFCODE::DIR | DIFFCODE::BOTH | DIFFCODE::DIFF;
+		pFolder->customFlags = ViewCustomFlags::VISIBLE | ViewCustomFlags::EXPANDED;
+		DIFFITEM *pFile = m_list.AddNewDiff(pFolder);
+		pFile->diffcode.diffcode = DIFFCODE::FILE | DIFFCODE::TEXT | DIFFCODE::BOTH | DIFFCODE::DIFF;
+		pFile->nsdiffs = 3;
+		pFile->nidiffs = 1;
+		DIFFITEM *pUnique = m_list.AddNewDiff(nullptr);
+		pUnique->diffcode.diffcode = DIFFCODE::FILE | DIFFCODE::SECOND;
+		for (int i = 0; i < 2; i++)
+		{
+			pFolder->diffFileInfo[i].filename = _T("sub");
+			pFile->diffFileInfo[i].path = _T("sub");
+			pFile->diffFileInfo[i].filename = i == 0 ? _T("a.txt") : _T("ä.txt");
+			pFile->diffFileInfo[i].size = 1000 + i;
+			pFile->diffFileInfo[i].mtime = Poco::Timestamp(1600000000000000LL + i);
+			pFile->diffFileInfo[i].ctime = Poco::Timestamp(1500000000000000LL);
+			pFile->diffFileInfo[i].version.SetFileVersion(0x10002, 0x30004);
+			pFile->diffFileInfo[i].encoding.SetUnicoding(ucr::UTF8);
+			pFile->diffFileInfo[i].encoding.m_bom = i == 1;
+			pFile->diffFileInfo[i].m_textStats.ncrlfs = 10 + i;
+			pFile->diffFileInfo[i].m_textStats.nzeros = 0;
+			pUnique->diffFileInfo[i].filename = _T("b.txt");
+		}
+		pUnique->diffFileInfo[1].size = 5;
+		ASSERT_TRUE(SaveDiffSnapshot(m_snapshot, m_list, m_paths, 1));
+
+		DiffSnapshotInfo info;
+		ASSERT_TRUE(ReadDiffSnapshotInfo(m_snapshot, info));
+		EXPECT_EQ(2, info.nDirs);
+		EXPECT_EQ(1, info.nCompareMethod);
+		EXPECT_EQ(m_paths[1], info.paths[1]);
+
+		DiffItemList list;
+		list.InitDiffItemList();
+		list.AddNewDiff(nullptr);
+		ASSERT_TRUE(LoadDiffSnapshot(m_snapshot, list, info));
+		EXPECT_EQ(3, CountItems(list, nullptr));
+		const DIFFITEM *pFolder2 = list.GetFirstDiffPosition();
+		const DIFFITEM *pFile2 = pFolder2->GetFirstChild();
+		const DIFFITEM *pUnique2 = pFolder2->GetFwdSiblingLink();
+		ASSERT_NE(nullptr, pFile2);
+		ASSERT_NE(nullptr, pUnique2);
+		EXPECT_EQ(pFolder->diffcode.diffcode, pFolder2->diffcode.diffcode);
+		EXPECT_EQ(pFolder->customFlags, pFolder2->customFlags);
+		EXPECT_EQ(pFile->diffcode.diffcode, pFile2->diffcode.diffcode);
+		EXPECT_EQ(3, pFile2->nsdiffs);
+		EXPECT_EQ(1, pFile2->nidiffs);
+		EXPECT_EQ(pFolder2, pFile2->GetParentLink());
+		for (int i = 0; i < 2; i++)
+		{
+			const DiffFileInfo& fi = pFile->diffFileInfo[i];
+			const DiffFileInfo& fi2 = pFile2->diffFileInfo[i];
+			EXPECT_EQ(fi.GetFile(), fi2.GetFile());
+			EXPECT_EQ(fi.size, fi2.size);
+			EXPECT_EQ(fi.mtime, fi2.mtime);
+			EXPECT_EQ(fi.ctime, fi2.ctime);
+			EXPECT_EQ(fi.version.GetFileVersionQWORD(), fi2.version.GetFileVersionQWORD());
+			EXPECT_EQ(fi.encoding.m_unicoding, fi2.encoding.m_unicoding);
+			EXPECT_EQ(fi.encoding.m_bom, fi2.encoding.m_bom);
+			EXPECT_EQ(fi.m_textStats.ncrlfs, fi2.m_textStats.ncrlfs);
+		}
+		EXPECT_EQ(DirItem::FILE_SIZE_NONE, pUnique2->diffFileInfo[0].size);
+		EXPECT_EQ(5u, pUnique2->diffFileInfo[1].size);
+	}
+
+	TEST_F(DiffSnapshotTest, InvalidFile)
+	{
+		DiffSnapshotInfo info;
+		WriteFile(0, _T("garbage"), std::string(200, 'x'));
+		String garbage = paths::ConcatPath(m_paths[0], _T("garbage"));
+		EXPECT_FALSE(ReadDiffSnapshotInfo(garbage, info));
+		EXPECT_FALSE(LoadDiffSnapshot(garbage, m_list, info));
+		EXPECT_FALSE(ReadDiffSnapshotInfo(m_folder.GetPath(_T("missing")), info));
+
+		DIFFITEM *pdi = m_list.AddNewDiff(nullptr);
+		pdi->diffcode.diffcode = DIFFCODE::FILE | DIFFCODE::FIRST;
+		pdi->diffFileInfo[0].filename = _T("c.txt");
+		ASSERT_TRUE(SaveDiffSnapshot(m_snapshot, m_list, m_paths, 0));
+		TFile(m_snapshot).setSize(TFile(m_snapshot).getSize() - 1);
+		EXPECT_FALSE(ReadDiffSnapshotInfo(m_snapshot, info));
+	}
+
+	TEST_F(DiffSnapshotTest, InvalidRecord)
+	{
+		WriteFile(0, _T("a.txt"), "a");
+		WriteFile(0, _T("sub/b.txt"), "b");
+		AddItem(nullptr, _T(""), _T("a.txt"), DIFFCODE::FILE);
+		DIFFITEM *pFolder = AddItem(nullptr, _T(""), _T("sub"), DIFFCODE::DIR);
+		AddItem(pFolder, _T("sub"), _T("b.txt"), DIFFCODE::FILE);
+		ASSERT_TRUE(SaveDiffSnapshot(m_snapshot, m_list, m_paths, 0));
+
+		DiffSnapshotInfo info;
+		DiffItemList list;
+		list.InitDiffItemList();
+		list.AddNewDiff(nullptr);
+		// A file as the parent of an item
+		PatchRecord(2, ParentPos, 0);
+		EXPECT_FALSE(ReadDiffSnapshotInfo(m_snapshot, info));
+		EXPECT_FALSE(LoadDiffSnapshot(m_snapshot, list, info));
+		EXPECT_EQ(1, CountItems(list, nullptr));
+		// A parent after its child
+		PatchRecord(2, ParentPos, 2);
+		EXPECT_FALSE(LoadDiffSnapshot(m_snapshot, list, info));
+		EXPECT_EQ(1, CountItems(list, nullptr));
+		// A string index past the strings
+		PatchRecord(2, ParentPos, 1);
+		ASSERT_TRUE(LoadDiffSnapshot(m_snapshot, list, info));
+		EXPECT_EQ(3, CountItems(list, nullptr));
+		PatchRecord(0, FilenamePos, UINT32_MAX);
+		EXPECT_FALSE(LoadDiffSnapshot(m_snapshot, list, info));
+		EXPECT_EQ(3, CountItems(list, nullptr));
+	}
+
+	TEST_F(DiffSnapshotTest, DiffContext)
+	{
+		WriteFile(0, _T("a.txt"), "a");
+		WriteFile(1, _T("a.txt"), "a");
+		CDiffContext ctxt(m_paths, 0);
+		ctxt.InitDiffItemList();
+		DIFFITEM *pdi = ctxt.AddNewDiff(nullptr);
+		pdi->diffcode.diffcode = DIFFCODE::FILE | DIFFCODE::BOTH | DIFFCODE::SAME;
+		for (int i = 0; i < 2; i++)
+		{
+			pdi->diffFileInfo[i].filename = _T("a.txt");
+			pdi->diffFileInfo[i].Update(paths::ConcatPath(m_paths[i], _T("a.txt")));
+		}
+		ASSERT_TRUE(ctxt.SaveSnapshot(m_snapshot));
+
+		bool bCompleteRescan = true;
+		CDiffContext ctxt2(m_paths, 0);
+		ctxt2.InitDiffItemList();
+		ASSERT_TRUE(ctxt2.LoadSnapshot(m_snapshot, true, bCompleteRescan));
+		EXPECT_FALSE(bCompleteRescan);
+		const DIFFITEM *pdi2 = ctxt2.GetFirstDiffPosition();
+		ASSERT_NE(nullptr, pdi2);
+		EXPECT_EQ(pdi->diffcode.diffcode, pdi2->diffcode.diffcode);
+		EXPECT_EQ(_T("a.txt"), pdi2->diffFileInfo[1].filename.get());
+		EXPECT_FALSE(pdi2->diffcode.isScanNeeded());
+		EXPECT_EQ(1, CountItems(ctxt2, nullptr));
+
+		// A snapshot of another compare method is not loaded
+		CDiffContext ctxt3(m_paths, 1);
+		ctxt3.InitDiffItemList();
+		ctxt3.AddNewDiff(nullptr);
+		ctxt3.AddNewDiff(nullptr);
+		EXPECT_FALSE(ctxt3.LoadSnapshot(m_snapshot, true, bCompleteRescan));
+		EXPECT_EQ(2, CountItems(ctxt3, nullptr));
+
+		// An invalid record leaves the items as they were
+		PatchRecord(0, ParentPos, 0);
+		EXPECT_FALSE(ctxt2.LoadSnapshot(m_snapshot, true, bCompleteRescan));
+		EXPECT_EQ(1, CountItems(ctxt2, nullptr));
+	}
+
+	TEST_F(DiffSnapshotTest, MarkChangedItems)
+	{
+		WriteFile(0, _T("same.txt"), "same");
+		WriteFile(1, _T("same.txt"), "same");
+		WriteFile(0, _T("changed.txt"), "old");
+		WriteFile(1, _T("changed.txt"), "old");
+		WriteFile(0, _T("sub/a.txt"), "a");
+		WriteFile(1, _T("sub/a.txt"), "a");
+		AddItem(nullptr, _T(""), _T("same.txt"), DIFFCODE::FILE);
+		AddItem(nullptr, _T(""), _T("changed.txt"), DIFFCODE::FILE);
+		DIFFITEM *pFolder = AddItem(nullptr, _T(""), _T("sub"), DIFFCODE::DIR);
+		AddItem(pFolder, _T("sub"), _T("a.txt"), DIFFCODE::FILE);
+		ASSERT_TRUE(SaveDiffSnapshot(m_snapshot, m_list, m_paths, 0));
+
+		DiffSnapshotInfo info;
+		DiffItemList list;
+		list.InitDiffItemList();
+		ASSERT_TRUE(LoadDiffSnapshot(m_snapshot, list, info));
+		EXPECT_TRUE(MarkChangedSnapshotItems(list, m_paths, info));
+		for (const DIFFITEM *pdi = list.GetFirstDiffPosition(); pdi != nullptr; pdi = pdi->GetFwdSiblingLink())
+			EXPECT_FALSE(pdi->diffcode.isScanNeeded());
+
+		WriteFile(1, _T("changed.txt"), "new contents");
+		WriteFile(1, _T("sub/b.txt"), "b");
+		TFile(paths::ConcatPath(m_paths[1], _T("sub"))).setLastModified(Poco::Timestamp(1000000));
+		ASSERT_TRUE(LoadDiffSnapshot(m_snapshot, list, info));
+		EXPECT_TRUE(MarkChangedSnapshotItems(list, m_paths, info));
+		const DIFFITEM *pSame = list.GetFirstDiffPosition();
+		const DIFFITEM *pChanged = pSame->GetFwdSiblingLink();
+		const DIFFITEM *pFolder2 = pChanged->GetFwdSiblingLink();
+		EXPECT_FALSE(pSame->diffcode.isScanNeeded());
+		EXPECT_TRUE(pChanged->diffcode.isScanNeeded());
+		EXPECT_TRUE(pChanged->diffcode.isSideBoth());
+		EXPECT_TRUE(pFolder2->diffcode.isScanNeeded());
+
+		TFile(m_paths[0]).setLastModified(Poco::Timestamp(1000000));
+		ASSERT_TRUE(LoadDiffSnapshot(m_snapshot, list, info));
+		EXPECT_FALSE(MarkChangedSnapshotItems(list, m_paths, info));
+	}
+}
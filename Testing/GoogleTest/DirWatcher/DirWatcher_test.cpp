@@ -0,0 +1,161 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <Poco/Event.h>
+#include <Poco/Timestamp.h>
+#include "DirWatcher.h"
+#include "DiffItemList.h"
+#include "FileFilterHelper.h"
+#include "TFile.h"
+#include "paths.h"
+#include "../UnitTests/TempFolder.h"
+
+namespace
+{
+	// Longest time changes may take to be reported
+	const long MaxReportTime = 10 * (DirWatcher::PollInterval + DirWatcher::SettleTime);
+
+	void SetFile(DIFFITEM& di, const String& file, bool bDirectory = false)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			di.diffcode.setSideFlag(i);
+			di.diffFileInfo[i].path = paths::GetPathOnly(file);
+			di.diffFileInfo[i].filename = paths::FindFileName(file);
+		}
+		di.diffcode.diffcode |= bDirectory ? DIFFCODE::DIR : DIFFCODE::FILE;
+	}
+
+	// Mutates a folder tree and waits until the watcher has reported all changes
+	void TestChangesReported(bool bPolling)
+	{
+		TempFolder folder(bPolling ? _T("DirWatcherTestPolling") : _T("DirWatcherTest"));
+		const String& root = folder.GetPath();
+		folder.WriteFile(paths::ConcatPath(_T("sub"), _T("a.txt")), "a");
+		folder.WriteFile(_T("b.txt"), "b");
+
+		Poco::Event reported;
+		{
+			DirWatcher watcher({ root }, true, [&reported] { reported.set(); }, bPolling);
+			ASSERT_TRUE(watcher.WaitUntilWatching(MaxReportTime));
+			EXPECT_EQ(bPolling, watcher.IsPolling());
+			EXPECT_TRUE(watcher.IsWatching({ root }, true));
+			EXPECT_FALSE(watcher.IsWatching({ root }, false));
+			EXPECT_FALSE(watcher.IsWatching({ root, root }, true));
+
+			folder.WriteFile(paths::ConcatPath(_T("sub"), _T("a.txt")), "a changed");
+			folder.WriteFile(paths::ConcatPath(_T("sub"), _T("c.txt")), "c");
+			TFile(folder.GetPath(_T("b.txt"))).remove();
+
+			const std::set<String> expected = {
+				paths::ConcatPath(_T("sub"), _T("a.txt")),
+				paths::ConcatPath(_T("sub"), _T("c.txt")),
+				_T("b.txt"),
+			};
+			std::set<String> changed;
+			Poco::Timestamp start;
+			while (!std::includes(changed.begin(), changed.end(), expected.begin(), expected.end()) &&
+				start.elapsed() < MaxReportTime * 1000)
+			{
+				reported.tryWait(100);
+				DirWatcher::Changes changes = watcher.TakeChanges();
+				EXPECT_FALSE(changes.bOverflow);
+				changed.insert(changes.paths.begin(), changes.paths.end());
+			}
+			EXPECT_TRUE(std::includes(changed.begin(), changed.end(), expected.begin(), expected.end()));
+
+			// The changes mark the items to rescan
+			DiffItemList list;
+			list.InitDiffItemList();
+			DIFFITEM *pSub = list.AddNewDiff(nullptr);
+			DIFFITEM *pB = list.AddNewDiff(nullptr);
+			DIFFITEM *pA = list.AddNewDiff(pSub);
+			SetFile(*pSub, _T("sub"), true);
+			SetFile(*pB, _T("b.txt"));
+			SetFile(*pA, paths::ConcatPath(_T("sub"), _T("a.txt")));
+			EXPECT_TRUE(MarkChangedItems(list, changed));
+			EXPECT_TRUE(pSub->diffcode.isScanNeeded());
+			EXPECT_TRUE(pA->diffcode.isScanNeeded());
+			EXPECT_TRUE(pB->diffcode.isScanNeeded());
+		}
+	}
+
+	TEST(DirWatcher, ChangesReported)
+	{
+		TestChangesReported(false);
+	}
+
+	TEST(DirWatcher, ChangesReportedPolling)
+	{
+		TestChangesReported(true);
+	}
+
+	TEST(DirWatcher, MarkChangedItems)
+	{
+		DiffItemList list;
+		list.InitDiffItemList();
+		DIFFITEM *pDir1 = list.AddNewDiff(nullptr);
+		DIFFITEM *pFile1 = list.AddNewDiff(pDir1);
+		DIFFITEM *pFile2 = list.AddNewDiff(pDir1);
+		SetFile(*pDir1, _T("Dir1"), true);
+		SetFile(*pFile1, _T("Dir1\\File1"));
+		SetFile(*pFile2, _T("Dir1\\File2"));
+		pFile1->diffcode.diffcode |= DIFFCODE::TEXT | DIFFCODE::DIFF;
+
+		// Existing file, names are not case sensitive
+		EXPECT_TRUE(MarkChangedItems(list, { _T("dir1\\FILE1") }));
+		EXPECT_TRUE(pFile1->diffcode.isScanNeeded());
+		EXPECT_TRUE(pFile1->diffcode.isResultNone());
+		EXPECT_FALSE(pFile2->diffcode.isScanNeeded());
+		EXPECT_FALSE(pDir1->diffcode.isScanNeeded());
+
+		// New file in an existing folder
+		EXPECT_TRUE(MarkChangedItems(list, { _T("Dir1/Dir2/File3") }));
+		EXPECT_TRUE(pDir1->diffcode.isScanNeeded());
+		EXPECT_FALSE(pFile2->diffcode.isScanNeeded());
+
+		// New file in the compared folder itself
+		EXPECT_FALSE(MarkChangedItems(list, { _T("File4") }));
+	}
+
+	// Excludes *.obj files and folders named build
+	class TestFilter : public IDiffFilter
+	{
+	public:
+		bool includeFile(const String& szFileName) const override
+		{
+			String name = strutils::makelower(szFileName);
+			return name.length() < 4 || name.compare(name.length() - 4, 4, _T(".obj")) != 0;
+		}
+		bool includeDir(const String& szDirName) const override
+		{
+			return strutils::makelower(paths::FindFileName(szDirName)) != _T("build");
+		}
+	};
+
+	TEST(DirWatcher, MarkChangedItemsFiltered)
+	{
+		DiffItemList list;
+		list.InitDiffItemList();
+		DIFFITEM *pDir1 = list.AddNewDiff(nullptr);
+		DIFFITEM *pFile1 = list.AddNewDiff(pDir1);
+		DIFFITEM *pObj = list.AddNewDiff(pDir1);
+		SetFile(*pDir1, _T("Dir1"), true);
+		SetFile(*pFile1, _T("Dir1\\File1"));
+		SetFile(*pObj, _T("Dir1\\File1.obj"));
+		TestFilter filter;
+
+		// Excluded files and paths in excluded folders need no rescan
+		EXPECT_TRUE(MarkChangedItems(list, { _T("File4.obj"), _T("Build\\File5"), _T("Dir1/build/sub/File6") }, &filter));
+		EXPECT_TRUE(MarkChangedItems(list, { _T("Dir1\\File1.obj"), _T("Dir1\\File7.OBJ") }, &filter));
+		EXPECT_FALSE(pDir1->diffcode.isScanNeeded());
+		EXPECT_FALSE(pFile1->diffcode.isScanNeeded());
+		EXPECT_FALSE(pObj->diffcode.isScanNeeded());
+
+		// Paths that are not excluded are marked as without a filter
+		EXPECT_TRUE(MarkChangedItems(list, { _T("Dir1\\File1") }, &filter));
+		EXPECT_TRUE(pFile1->diffcode.isScanNeeded());
+		EXPECT_FALSE(pDir1->diffcode.isScanNeeded());
+		EXPECT_FALSE(MarkChangedItems(list, { _T("File4.obj"), _T("File4") }, &filter));
+	}
+}
@@ -0,0 +1,58 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include "FileCmpHtmlReport.h"
+#include "PathContext.h"
+#include "TFile.h"
+#include "../UnitTests/TempFolder.h"
+
+namespace
+{
+	class FileCmpHtmlReportTest : public testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			m_files = PathContext(m_folder.WriteFile(_T("left.txt"), "same\nold <b>&\nsame2\n"),
+				m_folder.WriteFile(_T("right.txt"), "same\nnew \"x\"\nadded\nsame2\n"));
+		}
+
+		TempFolder m_folder { _T("FileCmpHtmlReportTest") };
+		PathContext m_files;
+	};
+
+	TEST_F(FileCmpHtmlReportTest, Generate)
+	{
+		FileCmpHtmlReport report;
+		String sReportFile = m_folder.GetPath(_T("report.html"));
+		ASSERT_TRUE(report.Generate(m_files, PathContext(_T("<left>"), _T("right & more")), sReportFile));
+		std::string html = TempFolder::ReadFile(sReportFile);
+
+		EXPECT_NE(std::string::npos, html.find("<th colspan=\"2\" class=\"title\">&lt;left&gt;</th>"));
+		EXPECT_NE(std::string::npos, html.find("<th colspan=\"2\" class=\"title\">right &amp; more</th>"));
+		EXPECT_NE(std::string::npos, html.find("<td class=\"ln\">1</td><td class=\"eq\"><code>same</code></td>"));
+		// The difference starts with an anchor on the left side
+		EXPECT_NE(std::string::npos, html.find("<td class=\"ln\"><a name=\"d1\" href=\"#d1\">2</a></td><td class=\"df\"><code>old &lt;b&gt;&amp;</code></td>"));
+		EXPECT_NE(std::string::npos, html.find("<td class=\"ln\">2</td><td class=\"df\"><code>new &quot;x&quot;</code></td>"));
+		// The left side of the longer right side of the difference is a ghost line
+		EXPECT_NE(std::string::npos, html.find("<td class=\"ln\"></td><td class=\"dfg\"><code>&nbsp;</code></td>"));
+		EXPECT_NE(std::string::npos, html.find("<td class=\"ln\">3</td><td class=\"df\"><code>added</code></td>"));
+		EXPECT_NE(std::string::npos, html.find("<td class=\"ln\">3</td><td class=\"eq\"><code>same2</code></td>"));
+		EXPECT_NE(std::string::npos, html.find("<td class=\"ln\">4</td><td class=\"eq\"><code>same2</code></td>"));
+		EXPECT_EQ(std::string::npos, html.find("name=\"d2\""));
+	}
+
+	TEST_F(FileCmpHtmlReportTest, PoolCountsFailedReports)
+	{
+		FileCmpHtmlReport report;
+		String sReportFile = m_folder.GetPath(_T("report.html"));
+		PathContext missing(m_files[0], m_folder.GetPath(_T("missing.txt")));
+		FileCmpHtmlReportPool pool(report, 2, nullptr);
+		pool.Add(m_files, m_files, sReportFile);
+		pool.Add(missing, missing, m_folder.GetPath(_T("missing.html")));
+		pool.Finish();
+		EXPECT_EQ(1, pool.GetFailedCount());
+		EXPECT_TRUE(TFile(sReportFile).exists());
+		EXPECT_FALSE(TFile(m_folder.GetPath(_T("missing.html"))).exists());
+	}
+
+}
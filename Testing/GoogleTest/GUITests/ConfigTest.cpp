@@ -214,6 +214,8 @@ namespace
 		{ OPT_CMP_STOP_AFTER_FIRST, varprop::VT_BOOL, {}, {}},
 		{ OPT_CMP_QUICK_LIMIT, varprop::VT_INT, {0, 1, 4, 1024}, {}},
 		{ OPT_CMP_BINARY_LIMIT, varprop::VT_INT, {0, 1, 4, 1024}, {}},
+		{ OPT_CMP_TRANSCODE_IN_MEMORY_LIMIT, varprop::VT_INT, {0, 1, 4, 1024}, {}},
+		{ OPT_CMP_STREAMING_DIFF_MEMORY_LIMIT, varprop::VT_INT, {0, 1, 4, 1024}, {}},
 		{ OPT_CMP_COMPARE_THREADS, varprop::VT_INT, {-1, 1, 2}, {}},
 		{ OPT_CMP_IGNORE_REPARSE_POINTS, varprop::VT_BOOL, {}, {}},
 		{ OPT_CMP_INCLUDE_SUBDIRS, varprop::VT_BOOL, {}, {}},
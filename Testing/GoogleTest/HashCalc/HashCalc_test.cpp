@@ -0,0 +1,102 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include "HashCalc.h"
+#include "TFile.h"
+#include "../UnitTests/TempFolder.h"
+
+namespace
+{
+	const std::vector<HashAlgorithm> AllAlgorithms = {
+		HashAlgorithm::MD5, HashAlgorithm::SHA1, HashAlgorithm::SHA256, HashAlgorithm::XXH64
+	};
+
+	std::string ToHex(const HashDigest& digest)
+	{
+		static const char digits[] = "0123456789abcdef";
+		std::string hex;
+		for (size_t i = 0; i < digest.size(); ++i)
+		{
+			hex += digits[digest.data()[i] >> 4];
+			hex += digits[digest.data()[i] & 15];
+		}
+		return hex;
+	}
+
+	std::vector<HashDigest> Calculate(const std::string& data, size_t chunkSize = std::string::npos)
+	{
+		HashCalculator calculator(AllAlgorithms);
+		for (size_t pos = 0; pos < data.size(); pos += chunkSize)
+			calculator.Update(data.data() + pos, std::min(chunkSize, data.size() - pos));
+		return calculator.Finish();
+	}
+
+	std::string MakeData(size_t size)
+	{
+		std::string data(size, '\0');
+		for (size_t i = 0; i < size; ++i)
+			data[i] = static_cast<char>((i * 31 + i / 7) & 0xff);
+		return data;
+	}
+
+	TEST(HashCalc, Empty)
+	{
+		std::vector<HashDigest> digests = Calculate("");
+		ASSERT_EQ(4, digests.size());
+		EXPECT_EQ("d41d8cd98f00b204e9800998ecf8427e", ToHex(digests[0]));
+		EXPECT_EQ("da39a3ee5e6b4b0d3255bfef95601890afd80709", ToHex(digests[1]));
+		EXPECT_EQ("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", ToHex(digests[2]));
+		EXPECT_EQ("ef46db3751d8e999", ToHex(digests[3]));
+	}
+
+	TEST(HashCalc, Abc)
+	{
+		std::vector<HashDigest> digests = Calculate("abc");
+		ASSERT_EQ(4, digests.size());
+		EXPECT_EQ("900150983cd24fb0d6963f7d28e17f72", ToHex(digests[0]));
+		EXPECT_EQ("a9993e364706816aba3e25717850c26c9cd0d89d", ToHex(digests[1]));
+		EXPECT_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", ToHex(digests[2]));
+		EXPECT_EQ("44bc2cf5ad770999", ToHex(digests[3]));
+	}
+
+	TEST(HashCalc, ChunkedUpdate)
+	{
+		std::string data = MakeData(100003);
+		std::vector<HashDigest> expected = Calculate(data);
+		for (size_t chunkSize : { 1, 3, 31, 32, 33, 4096 })
+			EXPECT_EQ(expected, Calculate(data, chunkSize)) << "chunk size " << chunkSize;
+	}
+
+	TEST(HashCalc, CalculateHashValues)
+	{
+		TempFolder folder(_T("HashCalcTest"));
+		std::string data = MakeData(3 * 1024 * 1024 + 17);
+		String path = folder.WriteFile(_T("data.bin"), data);
+		std::vector<HashDigest> digests;
+		EXPECT_TRUE(CalculateHashValues(path, AllAlgorithms, digests));
+		EXPECT_EQ(Calculate(data), digests);
+
+		// Only the requested algorithms, in the requested order
+		EXPECT_TRUE(CalculateHashValues(path, { HashAlgorithm::XXH64, HashAlgorithm::MD5 }, digests));
+		ASSERT_EQ(2, digests.size());
+		EXPECT_EQ(Calculate(data)[3], digests[0]);
+		EXPECT_EQ(Calculate(data)[0], digests[1]);
+		TFile(path).remove();
+
+		EXPECT_FALSE(CalculateHashValues(path, AllAlgorithms, digests));
+		ASSERT_EQ(4, digests.size());
+		EXPECT_TRUE(digests[0].empty());
+	}
+
+	TEST(HashCalc, DigestAsKey)
+	{
+		std::unordered_map<HashDigest, int, HashDigest::Hasher> counts;
+		for (const char *text : { "a", "b", "a", "abc", "a" })
+			++counts[Calculate(text)[3]];
+		EXPECT_EQ(3, counts.size());
+		EXPECT_EQ(3, counts[Calculate("a")[3]]);
+		EXPECT_NE(Calculate("a")[0], Calculate("a")[1]);
+	}
+}
@@ -0,0 +1,141 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include "MoveDetection.h"
+#include "DiffItemList.h"
+#include "PathContext.h"
+#include "TFile.h"
+#include "paths.h"
+#include "../UnitTests/TempFolder.h"
+
+namespace
+{
+	class MoveDetectionTest : public testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			m_paths = PathContext(m_folder.GetPath(SideNames[0]), m_folder.GetPath(SideNames[1]));
+			TFile(paths::ConcatPath(m_paths[0], _T("sub"))).createDirectories();
+			TFile(paths::ConcatPath(m_paths[1], _T("sub"))).createDirectories();
+			TFile(paths::ConcatPath(m_paths[1], _T("moved"))).createDirectories();
+			m_list.InitDiffItemList();
+		}
+
+		// Writes a file and adds it to the list as a unique item
+		DIFFITEM *AddFile(int side, const String& dir, const String& name, const std::string& text)
+		{
+			m_folder.WriteFile(paths::ConcatPath(paths::ConcatPath(SideNames[side], dir), name), text);
+			DIFFITEM *pdi = m_list.AddNewDiff(nullptr);
+			for (int i = 0; i < 2; i++)
+			{
+				pdi->diffFileInfo[i].path = dir;
+				pdi->diffFileInfo[i].filename = name;
+			}
+			pdi->diffFileInfo[side].size = text.size();
+			pdi->diffcode.setSideFlag(side);
+			pdi->diffcode.diffcode |= DIFFCODE::FILE;
+			return pdi;
+		}
+
+		static std::string Lines(int first, int last, const std::string& prefix = "line")
+		{
+			std::string text;
+			for (int i = first; i <= last; ++i)
+				text += prefix + " " + std::to_string(i) + "\n";
+			return text;
+		}
+
+		static const MovedItem *FindPair(const std::vector<MovedItem>& moved, const DIFFITEM *pLeft)
+		{
+			for (const auto& item : moved)
+			{
+				if (item.pdi[0] == pLeft)
+					return &item;
+			}
+			return nullptr;
+		}
+
+		static constexpr const TCHAR *SideNames[] = { _T("left"), _T("right") };
+
+		TempFolder m_folder { _T("MoveDetectionTest") };
+		PathContext m_paths;
+		DiffItemList m_list;
+	};
+
+	TEST_F(MoveDetectionTest, FindMovedItems)
+	{
+		std::string binary("\x01\x02\x00\x03", 4);
+		for (int i = 0; i < 5000; ++i)
+			binary += static_cast<char>(i * 7);
+		DIFFITEM *pMovedLeft = AddFile(0, _T(""), _T("a.txt"), Lines(1, 2000));
+		DIFFITEM *pMovedRight = AddFile(1, _T("moved"), _T("a.txt"), Lines(1, 2000));
+		DIFFITEM *pRenamedLeft = AddFile(0, _T("sub"), _T("b.bin"), binary);
+		DIFFITEM *pRenamedRight = AddFile(1, _T("sub"), _T("c.bin"), binary);
+		DIFFITEM *pEditedLeft = AddFile(0, _T(""), _T("d.txt"), Lines(1, 100));
+		DIFFITEM *pEditedRight = AddFile(1, _T("moved"), _T("e.txt"), Lines(1, 95) + Lines(1, 5, "changed"));
+		AddFile(0, _T(""), _T("f.txt"), Lines(1, 100, "left"));
+		AddFile(1, _T(""), _T("g.txt"), Lines(1, 100, "right"));
+		AddFile(0, _T(""), _T("empty1"), "");
+		AddFile(1, _T(""), _T("empty2"), "");
+		// Same size and first block as a.txt
+		AddFile(1, _T(""), _T("h.txt"), Lines(1, 1999) + "line 2001\n");
+
+		MoveDetectionOptions options;
+		options.nThreads = 4;
+		std::vector<MovedItem> moved = FindMovedItems(m_list, m_paths, options);
+		ASSERT_EQ(2, moved.size());
+		const MovedItem *pMoved = FindPair(moved, pMovedLeft);
+		ASSERT_NE(nullptr, pMoved);
+		EXPECT_EQ(pMovedRight, pMoved->pdi[1]);
+		EXPECT_TRUE(pMoved->bIdentical);
+		EXPECT_FALSE(pMoved->bBinary);
+		const MovedItem *pRenamed = FindPair(moved, pRenamedLeft);
+		ASSERT_NE(nullptr, pRenamed);
+		EXPECT_EQ(pRenamedRight, pRenamed->pdi[1]);
+		EXPECT_TRUE(pRenamed->bIdentical);
+		EXPECT_TRUE(pRenamed->bBinary);
+
+		options.nSimilarity = 60;
+		moved = FindMovedItems(m_list, m_paths, options);
+		ASSERT_EQ(3, moved.size());
+		EXPECT_EQ(pEditedLeft, moved[2].pdi[0]);
+		EXPECT_EQ(pEditedRight, moved[2].pdi[1]);
+		EXPECT_FALSE(moved[2].bIdentical);
+
+		DIFFITEM *pdi = PairMovedItems(m_list, moved[2]);
+		EXPECT_EQ(pEditedLeft, pdi);
+		EXPECT_TRUE(pdi->diffcode.isMoved());
+		EXPECT_TRUE(pdi->diffcode.isSideBoth());
+		EXPECT_TRUE(pdi->diffcode.isResultNone());
+		EXPECT_EQ(_T("moved"), pdi->diffFileInfo[1].path);
+		EXPECT_EQ(_T("e.txt"), pdi->diffFileInfo[1].filename);
+		EXPECT_EQ(_T("d.txt"), pdi->diffFileInfo[0].filename);
+
+		pdi = PairMovedItems(m_list, *FindPair(moved, pRenamedLeft));
+		EXPECT_TRUE(pdi->diffcode.isResultSame());
+		EXPECT_TRUE(pdi->diffcode.isBin());
+
+		// Paired items are not unique anymore
+		moved = FindMovedItems(m_list, m_paths, options);
+		ASSERT_EQ(1, moved.size());
+		EXPECT_EQ(pMovedLeft, moved[0].pdi[0]);
+	}
+
+	TEST_F(MoveDetectionTest, SameNamePreferred)
+	{
+		DIFFITEM *pLeft1 = AddFile(0, _T(""), _T("x.txt"), "same");
+		DIFFITEM *pLeft2 = AddFile(0, _T(""), _T("y.txt"), "same");
+		DIFFITEM *pRight1 = AddFile(1, _T("moved"), _T("y.txt"), "same");
+		DIFFITEM *pRight2 = AddFile(1, _T("moved"), _T("x.txt"), "same");
+		std::vector<MovedItem> moved = FindMovedItems(m_list, m_paths, MoveDetectionOptions());
+		ASSERT_EQ(2, moved.size());
+		for (const auto& item : moved)
+		{
+			if (item.pdi[0] == pLeft1)
+				EXPECT_EQ(pRight2, item.pdi[1]);
+			else
+				EXPECT_EQ(pRight1, item.pdi[1]);
+		}
+		EXPECT_TRUE(moved[0].pdi[0] == pLeft2 || moved[1].pdi[0] == pLeft2);
+	}
+}
@@ -1,6 +1,8 @@
 #include "pch.h"
 #include <gtest/gtest.h>
 #include <vector>
+#include <algorithm>
+#include <chrono>
 #include "UnicodeString.h"
 #include "RegOptionsMgr.h"
 
@@ -74,4 +76,60 @@ namespace
 		EXPECT_EQ(COption::OPT_OK, mgr.InitOption(_T("BoolOpt2"), true));
 		EXPECT_EQ(true, mgr.GetBool(_T("BoolOpt2")));
 	}
+	// Read options by handle
+	TEST_F(RegOptionsMgrTest, ReadByHandle)
+	{
+		CRegOptionsMgr mgr;
+		mgr.SetRegRootKey(_T("Thingamahoochie\\WinMerge\\UnitTesting"));
+		mgr.SetSerializing(false);
+		OptionHandle hIntOpt = COptionsMgr::GetHandle(_T("IntOpt1"));
+		EXPECT_EQ(hIntOpt, COptionsMgr::GetHandle(_T("IntOpt1")));
+		EXPECT_EQ(varprop::VT_NULL, mgr.Get(hIntOpt).GetType());
+
+		EXPECT_EQ(COption::OPT_OK, mgr.InitOption(_T("IntOpt1"), 5));
+		EXPECT_EQ(COption::OPT_OK, mgr.InitOption(_T("BoolOpt3"), true));
+		OptionHandle hBoolOpt = COptionsMgr::GetHandle(_T("BoolOpt3"));
+		EXPECT_NE(hIntOpt, hBoolOpt);
+		EXPECT_EQ(5, mgr.GetInt(hIntOpt));
+		EXPECT_EQ(true, mgr.GetBool(hBoolOpt));
+
+		unsigned changeCount = mgr.GetChangeCount();
+		EXPECT_EQ(COption::OPT_OK, mgr.Set(_T("IntOpt1"), 7));
+		EXPECT_EQ(7, mgr.GetInt(hIntOpt));
+		EXPECT_NE(changeCount, mgr.GetChangeCount());
+
+		EXPECT_EQ(COption::OPT_OK, mgr.RemoveOption(_T("IntOpt1")));
+		EXPECT_EQ(varprop::VT_NULL, mgr.Get(hIntOpt).GetType());
+		EXPECT_EQ(true, mgr.GetBool(hBoolOpt));
+	}
+
+	// Compare read rates of options by name and by handle,
+	// run with --gtest_also_run_disabled_tests
+	TEST_F(RegOptionsMgrTest, DISABLED_ReadRate)
+	{
+		CRegOptionsMgr mgr;
+		mgr.SetRegRootKey(_T("Thingamahoochie\\WinMerge\\UnitTesting"));
+		mgr.SetSerializing(false);
+		for (int i = 0; i < 500; ++i)
+			mgr.InitOption(strutils::format(_T("Settings/Option%d"), i), i);
+		const String name = _T("Settings/Option250");
+		const OptionHandle handle = COptionsMgr::GetHandle(name);
+		const int count = 10000000;
+
+		auto start = std::chrono::steady_clock::now();
+		int64_t sum = 0;
+		for (int i = 0; i < count; ++i)
+			sum += mgr.GetInt(name);
+		auto byName = std::chrono::steady_clock::now() - start;
+
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < count; ++i)
+			sum += mgr.GetInt(handle);
+		auto byHandle = std::chrono::steady_clock::now() - start;
+
+		EXPECT_EQ(int64_t(250) * count * 2, sum);
+		auto rate = [count](std::chrono::steady_clock::duration d)
+			{ return count / std::max(std::chrono::duration<double>(d).count(), 1e-9); };
+		printf("option reads/s: by name %.0f, by handle %.0f\n", rate(byName), rate(byHandle));
+	}
 }
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include "PatchCreator.h"
+#include "unicoder.h"
+#include "../UnitTests/TempFolder.h"
+
+namespace
+{
+	class PatchCreatorTest : public testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			m_patchFile = m_folder.GetPath(_T("test.patch"));
+			DIFFOPTIONS options = {0};
+			PATCHOPTIONS patchOptions = { OUTPUT_UNIFIED, 3, false };
+			m_creator.SetOptions(options, patchOptions);
+		}
+
+		// Adds a pair of text files that differ in one line
+		void AddTextPair(const String& name)
+		{
+			PATCHFILES files;
+			files.lfile = m_folder.WriteFile(_T("left_") + name, "line1\nline2\nline3\n");
+			files.rfile = m_folder.WriteFile(_T("right_") + name, "line1\nchanged " + ucr::toUTF8(name) + "\nline3\n");
+			files.pathLeft = _T("a/") + name;
+			files.pathRight = _T("b/") + name;
+			m_fileList.push_back(files);
+		}
+
+		std::string ReadPatch() const
+		{
+			return TempFolder::ReadFile(m_patchFile);
+		}
+
+		TempFolder m_folder { _T("PatchCreatorTest") };
+		String m_patchFile;
+		PatchCreator m_creator;
+		std::vector<PATCHFILES> m_fileList;
+	};
+
+	TEST_F(PatchCreatorTest, OutputInInputOrder)
+	{
+		const int count = 40;
+		for (int i = 0; i < count; ++i)
+			AddTextPair(strutils::format(_T("file%02d.txt"), i));
+		m_creator.SetThreadCount(4);
+		EXPECT_EQ(PatchCreator::Result::Ok, m_creator.CreatePatch(m_patchFile, false, m_fileList));
+		EXPECT_EQ(count, m_creator.GetWrittenFileCount());
+		EXPECT_FALSE(m_creator.HasBinaries());
+
+		std::string patch = ReadPatch();
+		size_t prev = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			const std::string name = ucr::toUTF8(strutils::format(_T("file%02d.txt"), i));
+			size_t pos = patch.find("--- a/" + name);
+			ASSERT_NE(std::string::npos, pos) << name;
+			EXPECT_LT(prev, pos) << name;
+			EXPECT_LT(pos, patch.find("+++ b/" + name)) << name;
+			EXPECT_NE(std::string::npos, patch.find("+changed " + name)) << name;
+			prev = pos;
+		}
+	}
+
+	TEST_F(PatchCreatorTest, SkipsBinaries)
+	{
+		AddTextPair(_T("text1.txt"));
+		PATCHFILES files;
+		files.lfile = m_folder.WriteFile(_T("left_data.bin"), std::string("abc\0def\n", 8));
+		files.rfile = m_folder.WriteFile(_T("right_data.bin"), std::string("abc\0xyz\n", 8));
+		files.pathLeft = _T("a/data.bin");
+		files.pathRight = _T("b/data.bin");
+		m_fileList.push_back(files);
+		AddTextPair(_T("text2.txt"));
+		m_creator.SetThreadCount(2);
+		EXPECT_EQ(PatchCreator::Result::Ok, m_creator.CreatePatch(m_patchFile, false, m_fileList));
+		EXPECT_TRUE(m_creator.HasBinaries());
+		EXPECT_EQ(2, m_creator.GetWrittenFileCount());
+
+		std::string patch = ReadPatch();
+		EXPECT_NE(std::string::npos, patch.find("--- a/text1.txt"));
+		EXPECT_NE(std::string::npos, patch.find("--- a/text2.txt"));
+		EXPECT_EQ(std::string::npos, patch.find("data.bin"));
+	}
+
+	TEST_F(PatchCreatorTest, MissingFileStopsPatch)
+	{
+		AddTextPair(_T("file0.txt"));
+		AddTextPair(_T("file1.txt"));
+		PATCHFILES files;
+		files.lfile = m_folder.GetPath(_T("missing.txt"));
+		files.rfile = m_folder.WriteFile(_T("right_missing.txt"), "line1\n");
+		files.pathLeft = _T("a/missing.txt");
+		files.pathRight = _T("b/missing.txt");
+		m_fileList.push_back(files);
+		AddTextPair(_T("file3.txt"));
+		m_creator.SetThreadCount(4);
+		EXPECT_EQ(PatchCreator::Result::FileError, m_creator.CreatePatch(m_patchFile, false, m_fileList));
+		EXPECT_EQ(2u, m_creator.GetFailedIndex());
+		EXPECT_EQ(2, m_creator.GetWrittenFileCount());
+
+		// The patches of the pairs before the failed one are kept
+		std::string patch = ReadPatch();
+		EXPECT_NE(std::string::npos, patch.find("--- a/file0.txt"));
+		EXPECT_NE(std::string::npos, patch.find("--- a/file1.txt"));
+		EXPECT_EQ(std::string::npos, patch.find("file3.txt"));
+	}
+
+}
@@ -0,0 +1,124 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include "PerfTrace.h"
+#include "Environment.h"
+#include "TFile.h"
+#include "paths.h"
+#include "unicoder.h"
+
+namespace
+{
+	class PerfTraceTest : public testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			m_traceFile = paths::ConcatPath(env::GetTemporaryPath(), _T("PerfTraceTest.json"));
+		}
+
+		void TearDown() override
+		{
+			perftrace::Disable();
+			TFile(m_traceFile).remove();
+		}
+
+		std::string DumpTrace()
+		{
+			EXPECT_TRUE(perftrace::Dump(m_traceFile));
+			std::ifstream istr(ucr::toUTF8(m_traceFile).c_str(), std::ios::in | std::ios::binary);
+			std::stringstream sstr;
+			sstr << istr.rdbuf();
+			return sstr.str();
+		}
+
+		static size_t Count(const std::string& str, const std::string& part)
+		{
+			size_t count = 0;
+			for (size_t pos = str.find(part); pos != std::string::npos; pos = str.find(part, pos + 1))
+				++count;
+			return count;
+		}
+
+		String m_traceFile;
+	};
+
+	TEST_F(PerfTraceTest, Disabled)
+	{
+		perftrace::Enable();
+		perftrace::Disable();
+		EXPECT_FALSE(perftrace::IsEnabled());
+		{
+			PERFTRACE_SCOPE("DisabledScope");
+		}
+		std::string trace = DumpTrace();
+		EXPECT_EQ(0u, Count(trace, "DisabledScope"));
+		EXPECT_EQ(0u, trace.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+	}
+
+	TEST_F(PerfTraceTest, Scopes)
+	{
+		perftrace::Enable();
+		String path = _T("sub\\\"a\".txt");
+		{
+			PERFTRACE_SCOPE("Outer", path);
+			PERFTRACE_SCOPE("Inner");
+		}
+		std::thread thread([] {
+			for (int i = 0; i < 3; ++i)
+			{
+				PERFTRACE_SCOPE("Worker");
+			}
+		});
+		thread.join();
+		std::string trace = DumpTrace();
+		EXPECT_EQ(1u, Count(trace, "\"name\":\"Outer\""));
+		EXPECT_EQ(1u, Count(trace, "\"name\":\"Inner\""));
+		EXPECT_EQ(3u, Count(trace, "\"name\":\"Worker\""));
+		EXPECT_EQ(1u, Count(trace, "\"args\":{\"detail\":\"sub\\\\\\\"a\\\".txt\"}"));
+		EXPECT_LE(2u, Count(trace, "\"name\":\"thread_name\""));
+		EXPECT_EQ(std::string::npos, trace.find("DisabledScope"));
+	}
+
+	TEST_F(PerfTraceTest, RingBuffer)
+	{
+		perftrace::Enable(4);
+		for (int i = 0; i < 10; ++i)
+			perftrace::Record("Event", 1000 + i, 1);
+		std::string trace = DumpTrace();
+		EXPECT_EQ(4u, Count(trace, "\"name\":\"Event\""));
+		EXPECT_EQ(std::string::npos, trace.find("\"ts\":1005,"));
+		size_t pos = 0;
+		for (int i = 6; i < 10; ++i)
+		{
+			size_t next = trace.find("\"ts\":" + std::to_string(1000 + i) + ",");
+			ASSERT_NE(std::string::npos, next);
+			EXPECT_LT(pos, next);
+			pos = next;
+		}
+	}
+
+	TEST_F(PerfTraceTest, EndedThreadBufferReused)
+	{
+		perftrace::Enable(4);
+		std::thread first([] {
+			for (int i = 1; i <= 3; ++i)
+				perftrace::Record("Ended", 2000 + i, 1);
+		});
+		first.join();
+		// The second thread records into the buffer of the first one, so
+		// that the oldest event of the first thread is overwritten
+		std::thread second([] {
+			for (int i = 11; i <= 12; ++i)
+				perftrace::Record("Ended", 2000 + i, 1);
+		});
+		second.join();
+		std::string trace = DumpTrace();
+		EXPECT_EQ(4u, Count(trace, "\"name\":\"Ended\""));
+		EXPECT_EQ(std::string::npos, trace.find("\"ts\":2001,"));
+		for (int ts : { 2002, 2003, 2011, 2012 })
+			EXPECT_NE(std::string::npos, trace.find("\"ts\":" + std::to_string(ts) + ","));
+	}
+}
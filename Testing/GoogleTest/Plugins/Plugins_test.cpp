@@ -61,6 +61,30 @@ namespace
 		iu->Unpacking(&subcodes, file, _T(".*\\.xls"), { file });
 	}
 
+	TEST_F(PluginsTest, PluginInfos)
+	{
+		PluginManager pm;
+		IPluginInfos *ppi = &pm;
+		IPluginInfos::PluginInfoTable infos;
+		ppi->GetPluginInfos(infos);
+		EXPECT_TRUE(infos.empty());
+
+		ppi->SetPluginInfos(_T("a.txt|a.txt"), PackingInfo(_T("Unpacker")), PrediffingInfo(_T("Prediffer")));
+		ppi->GetPluginInfos(infos);
+		ASSERT_EQ(1, infos.size());
+		auto it = infos.find(_T("a.txt|a.txt"));
+		ASSERT_TRUE(it != infos.end());
+		EXPECT_EQ(_T("Unpacker"), it->second.first->GetPluginPipeline());
+		EXPECT_EQ(_T("Prediffer"), it->second.second->GetPluginPipeline());
+
+		// The table points to the infos fetched for the same files
+		PackingInfo *iu = nullptr;
+		PrediffingInfo *ip = nullptr;
+		ppi->FetchPluginInfos(_T("a.txt|a.txt"), &iu, &ip);
+		EXPECT_EQ(iu, it->second.first);
+		EXPECT_EQ(ip, it->second.second);
+	}
+
 	TEST_F(PluginsTest, ParsePluginPipeline)
 	{
 		String errorMessage;
@@ -0,0 +1,91 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include <string>
+#include "ReportBuffer.h"
+#include "markdown.h"
+#include "unicoder.h"
+
+namespace
+{
+	// What DirCmpReport wrote before it used ReportBuffer
+	std::string reference_octets(const String& text, bool entities)
+	{
+		String s = entities ? ucr::toTString(CMarkdown::Entities(ucr::toUTF8(text))) : text;
+		std::string octets = ucr::toUTF8(s);
+		std::string result;
+		for (char c : octets)
+		{
+			if (c == '\n')
+				result += '\r';
+			result += c;
+		}
+		return result;
+	}
+
+	std::string contents(const ReportBuffer& buffer)
+	{
+		return std::string(buffer.GetData(), buffer.GetSize());
+	}
+}
+
+TEST(ReportBuffer, same_as_markdown_entities)
+{
+	const String texts[] = {
+		_T(""),
+		_T("plain.txt"),
+		_T("line1\nline2\n"),
+		_T("<a href=\"x\">Tom & Jerry's</a>"),
+		_T("\u00e4\u00f6\u00fc \u65e5\u672c\u8a9e \U0001F600 & <\u00df>"),
+		_T("\n\n&&\"\"''<<>>\n"),
+	};
+	for (const auto& text : texts)
+	{
+		for (bool entities : { false, true })
+		{
+			ReportBuffer buffer(true);
+			if (entities)
+				buffer.AppendEntities(text);
+			else
+				buffer.Append(text);
+			EXPECT_EQ(reference_octets(text, entities), contents(buffer));
+		}
+	}
+}
+
+TEST(ReportBuffer, append_and_clear)
+{
+	ReportBuffer buffer(true);
+	buffer.Append(_T("a,"));
+	buffer.Append(String(_T("b\n")));
+	ReportBuffer chunk(true);
+	chunk.AppendEntities(_T("<c>"));
+	buffer.Append(chunk);
+	EXPECT_EQ("a,b\r\n&lt;c&gt;", contents(buffer));
+	EXPECT_FALSE(buffer.IsFull());
+
+	buffer.Clear();
+	EXPECT_EQ(0u, buffer.GetSize());
+	buffer.Append(_T("x"));
+	EXPECT_EQ("x", contents(buffer));
+}
+
+TEST(ReportBuffer, thread_code_page)
+{
+	ReportBuffer buffer(false);
+	EXPECT_FALSE(buffer.IsUTF8());
+	String text = _T("name,\"size\"\n\u00e4.txt");
+	buffer.Append(text);
+	std::string expected = ucr::toThreadCP(text);
+	expected.insert(expected.find('\n'), 1, '\r');
+	EXPECT_EQ(expected, contents(buffer));
+}
+
+TEST(ReportBuffer, is_full)
+{
+	ReportBuffer buffer(true);
+	String line(1022, _T('x'));
+	line += _T('\n');
+	while (!buffer.IsFull())
+		buffer.Append(line);
+	EXPECT_EQ(ReportBuffer::FlushSize, buffer.GetSize());
+}
@@ -0,0 +1,165 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include "StreamingDiff.h"
+#include <io.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct TempFile
+	{
+		TempFile(const std::string& filename, const std::string& data) : m_filename(filename)
+		{
+			std::ofstream ostr(filename.c_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+			ostr.write(data.data(), data.size());
+		}
+		~TempFile()
+		{
+			remove(m_filename.c_str());
+		}
+		std::string m_filename;
+	};
+
+	struct FilePair
+	{
+		FilePair(const std::string& left, const std::string& right)
+		{
+			_sopen_s(&desc[0], left.c_str(),  O_RDONLY | O_BINARY, _SH_DENYWR, _S_IREAD);
+			_sopen_s(&desc[1], right.c_str(), O_RDONLY | O_BINARY, _SH_DENYWR, _S_IREAD);
+		}
+
+		~FilePair()
+		{
+			_close(desc[0]);
+			_close(desc[1]);
+		}
+
+		int desc[2];
+	};
+
+	class HunkCollector : public StreamingDiff::Listener
+	{
+	public:
+		bool OnCommon(const xrecord_t& line) override { ++m_nCommon; return true; }
+		bool OnChange(const xdiff_hunk& hunk, const xrecord_t *deleted, const xrecord_t *inserted) override
+		{
+			m_hunks.push_back(hunk);
+			return true;
+		}
+		std::vector<xdiff_hunk> m_hunks;
+		long m_nCommon = 0;
+	};
+
+	// Lines are unique, so the windowed result can be checked against xdiff
+	void make_texts(int nLines, std::string& text1, std::string& text2)
+	{
+		for (int i = 0; i < nLines; ++i)
+		{
+			std::string line = "line " + std::to_string(i) + " of the test file\n";
+			text1 += line;
+			if (i % 997 == 0)
+				text2 += "changed " + line;
+			else if (i % 1499 != 0)
+				text2 += line;
+			if (i % 2003 == 0)
+				text2 += "inserted after " + std::to_string(i) + "\n";
+		}
+	}
+
+	std::string read_file(const std::string& filename)
+	{
+		std::ifstream istr(filename.c_str(), std::ios::in|std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(istr), std::istreambuf_iterator<char>());
+	}
+}
+
+TEST(StreamingDiff, Identical)
+{
+	TempFile file1("_tmp_test1.txt", "abc\ndef\n");
+	TempFile file2("_tmp_test2.txt", "abc\ndef\n");
+	FilePair files(file1.m_filename, file2.m_filename);
+	StreamingDiff diff(0, StreamingDiff::MinMemoryLimit);
+	EXPECT_EQ(StreamingDiff::Result::Same, diff.Compare(files.desc[0], files.desc[1]));
+	EXPECT_EQ(0, diff.GetDiffCount());
+	FileTextStats stats;
+	diff.GetTextStats(0, &stats);
+	EXPECT_EQ(2, stats.nlfs);
+}
+
+TEST(StreamingDiff, MissingNewline)
+{
+	TempFile file1("_tmp_test1.txt", "abc\ndef");
+	TempFile file2("_tmp_test2.txt", "abc\ndef\n");
+	FilePair files(file1.m_filename, file2.m_filename);
+	StreamingDiff diff(0, StreamingDiff::MinMemoryLimit);
+	EXPECT_EQ(StreamingDiff::Result::Different, diff.Compare(files.desc[0], files.desc[1]));
+	EXPECT_EQ(1, diff.GetDiffCount());
+	EXPECT_TRUE(diff.IsMissingNewline(0));
+	EXPECT_FALSE(diff.IsMissingNewline(1));
+}
+
+TEST(StreamingDiff, SameAsWholeFileDiff)
+{
+	std::string text1, text2;
+	make_texts(200000, text1, text2);
+	TempFile file1("_tmp_test1.txt", text1);
+	TempFile file2("_tmp_test2.txt", text2);
+
+	xpparam_t xpp = { 0 };
+	std::vector<xrecord_t> recs1, recs2;
+	std::vector<xdiff_hunk> expected;
+	mmfile_t mf1 = { &text1[0], static_cast<long>(text1.size()) };
+	mmfile_t mf2 = { &text2[0], static_cast<long>(text2.size()) };
+	ASSERT_TRUE(xdiff_parallel::diff(mf1, mf2, xpp, 1, recs1, recs2, expected));
+
+	// Both files are several times bigger than the window
+	StreamingDiff diff(0, StreamingDiff::MinMemoryLimit);
+	ASSERT_LT(diff.GetWindowSize() * 4, text1.size());
+	FilePair files(file1.m_filename, file2.m_filename);
+	HunkCollector collector;
+	EXPECT_EQ(StreamingDiff::Result::Different, diff.Compare(files.desc[0], files.desc[1], &collector));
+	ASSERT_EQ(expected.size(), collector.m_hunks.size());
+	long nChanged = 0;
+	for (size_t i = 0; i < expected.size(); ++i)
+	{
+		EXPECT_EQ(expected[i].i1, collector.m_hunks[i].i1);
+		EXPECT_EQ(expected[i].i2, collector.m_hunks[i].i2);
+		EXPECT_EQ(expected[i].chg1, collector.m_hunks[i].chg1);
+		EXPECT_EQ(expected[i].chg2, collector.m_hunks[i].chg2);
+		nChanged += expected[i].chg1;
+	}
+	EXPECT_EQ(static_cast<int>(expected.size()), diff.GetDiffCount());
+	EXPECT_EQ(static_cast<long>(recs1.size()) - nChanged, collector.m_nCommon);
+}
+
+TEST(StreamingDiff, PatchWriter)
+{
+	TempFile file1("_tmp_test1.txt", "1\n2\n3\n4\n5\n6\n7\n8\n9\n10\n");
+	TempFile file2("_tmp_test2.txt", "1\n2x\n3\n4\n5\n6\n7\n8\n9\n10\n11");
+	const std::string patchfile = "_tmp_test.patch";
+
+	struct Case { bool bUnified; int nContext; const char *expected; } cases[] = {
+		{ false, 0, "2c2\n< 2\n---\n> 2x\n10a11\n> 11\n\\ No newline at end of file\n" },
+		{ true, 1, "@@ -1,3 +1,3 @@\n 1\n-2\n+2x\n 3\n@@ -10 +10,2 @@\n 10\n+11\n\\ No newline at end of file\n" },
+		{ true, 4, "@@ -1,10 +1,11 @@\n 1\n-2\n+2x\n 3\n 4\n 5\n 6\n 7\n 8\n 9\n 10\n+11\n\\ No newline at end of file\n" },
+	};
+	for (const auto& c : cases)
+	{
+		{
+			FilePair files(file1.m_filename, file2.m_filename);
+			FILE *outfile = fopen(patchfile.c_str(), "wb");
+			ASSERT_NE(nullptr, outfile);
+			StreamingDiff diff(0, StreamingDiff::MinMemoryLimit);
+			auto pWriter = StreamingDiff::CreatePatchWriter(outfile, c.bUnified, c.nContext, 1024 * 1024);
+			EXPECT_EQ(StreamingDiff::Result::Different, diff.Compare(files.desc[0], files.desc[1], pWriter.get()));
+			fclose(outfile);
+		}
+		EXPECT_EQ(c.expected, read_file(patchfile));
+	}
+	remove(patchfile.c_str());
+}
@@ -0,0 +1,75 @@
+/**
+ * @file  TempFolder.h
+ *
+ * @brief Declaration of TempFolder, a folder for the files of a test.
+ */
+#pragma once
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <Poco/Exception.h>
+#include "Environment.h"
+#include "TFile.h"
+#include "paths.h"
+#include "unicoder.h"
+
+/**
+ * @brief Folder in the temporary folder, removed with its files when the
+ * object is destroyed.
+ */
+class TempFolder
+{
+public:
+	explicit TempFolder(const String& name)
+		: m_path(paths::ConcatPath(env::GetTemporaryPath(), name))
+	{
+		TFile(m_path).createDirectories();
+	}
+
+	~TempFolder()
+	{
+		try
+		{
+			TFile(m_path).remove(true);
+		}
+		catch (Poco::Exception&)
+		{
+		}
+	}
+
+	TempFolder(const TempFolder&) = delete;
+	TempFolder& operator=(const TempFolder&) = delete;
+
+	const String& GetPath() const { return m_path; }
+
+	String GetPath(const String& relpath) const
+	{
+		return paths::ConcatPath(m_path, relpath);
+	}
+
+	/**
+	 * @brief Write a file, creating the folders it is in.
+	 * @param [in] relpath Path of the file, relative to the folder.
+	 * @return Full path of the file.
+	 */
+	String WriteFile(const String& relpath, const std::string& data) const
+	{
+		String path = GetPath(relpath);
+		TFile(paths::GetPathOnly(path)).createDirectories();
+		std::ofstream ostr(ucr::toUTF8(path).c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		ostr << data;
+		return path;
+	}
+
+	static std::string ReadFile(const String& path)
+	{
+		std::ifstream istr(ucr::toUTF8(path).c_str(), std::ios::in | std::ios::binary);
+		std::stringstream sstr;
+		sstr << istr.rdbuf();
+		return sstr.str();
+	}
+
+private:
+	String m_path;
+};
@@ -1,6 +1,13 @@
 #include "pch.h"
 #include <gtest/gtest.h>
 #include "multiformatText.h"
+#include <fstream>
+#include <iterator>
+#include <tuple>
+#include <Poco/UnicodeConverter.h>
+#include "Environment.h"
+#include "TFile.h"
+#include "unicoder.h"
 
 namespace
 {
@@ -80,4 +87,67 @@ namespace
 		}
 	}
 
+	/** @brief Read the bytes of a file as they are on disk. */
+	std::string ReadFileBytes(const String& path)
+	{
+		std::ifstream ifs(ucr::toUTF8(path).c_str(), std::ios::in | std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+	}
+
+	/**
+	 * @brief Convert UTF-16 bytes without their BOM to UTF-8 with Poco, so
+	 * that the expected text does not come from the converters under test.
+	 */
+	std::string UTF16BytesToUTF8(const std::string& bytes, bool bigEndian)
+	{
+		Poco::UTF16String utf16;
+		for (size_t i = 2; i + 1 < bytes.size(); i += 2)
+		{
+			const unsigned lo = static_cast<unsigned char>(bytes[i + (bigEndian ? 1 : 0)]);
+			const unsigned hi = static_cast<unsigned char>(bytes[i + (bigEndian ? 0 : 1)]);
+			utf16 += static_cast<Poco::UTF16Char>(lo | (hi << 8));
+		}
+		std::string utf8;
+		Poco::UnicodeConverter::convert(utf16, utf8);
+		return utf8;
+	}
+
+	TEST_F(storageForPluginsTest, AnyCodepageToUTF8InMemory)
+	{
+		const std::string utf8WithBom = ReadFileBytes(_T("../../Data/Unicode/UTF-8/DiffItem.h"));
+		ASSERT_EQ("\xEF\xBB\xBF", utf8WithBom.substr(0, 3));
+		const std::string ucs2le = ReadFileBytes(_T("../../Data/Unicode/UCS-2LE/DiffItem.h"));
+		ASSERT_EQ("\xFF\xFE", ucs2le.substr(0, 2));
+		const std::string ucs2be = ReadFileBytes(_T("../../Data/Unicode/UCS-2BE/DiffItem.h"));
+		ASSERT_EQ("\xFE\xFF", ucs2be.substr(0, 2));
+
+		const std::tuple<const TCHAR *, int, std::string> files[] = {
+			{ _T("../../Data/Unicode/UCS-2LE/DiffItem.h"), ucr::CP_UCS2LE, UTF16BytesToUTF8(ucs2le, false) },
+			{ _T("../../Data/Unicode/UCS-2BE/DiffItem.h"), ucr::CP_UCS2BE, UTF16BytesToUTF8(ucs2be, true) },
+			{ _T("../../Data/Unicode/UTF-8/DiffItem.h"), ucr::CP_UTF_8, utf8WithBom.substr(3) },
+		};
+		for (const auto& [file, codepage, expected] : files)
+		{
+			std::string text;
+			EXPECT_TRUE(AnyCodepageToUTF8(codepage, file, text, false));
+			EXPECT_EQ(expected, text);
+
+			// Same text as converted to temp file
+			String tempFilepath = env::GetTemporaryFileName(env::GetTemporaryPath(), _T("_T"));
+			int nFileChanged = 0;
+			EXPECT_TRUE(AnyCodepageToUTF8(codepage, file, tempFilepath, nFileChanged, false));
+			EXPECT_EQ(1, nFileChanged);
+			std::string converted = ReadFileBytes(tempFilepath);
+			TFile(tempFilepath).remove();
+			EXPECT_EQ(expected, converted);
+		}
+
+		// The UTF-8 file is unchanged when its BOM is written back
+		std::string text;
+		EXPECT_TRUE(AnyCodepageToUTF8(ucr::CP_UTF_8, _T("../../Data/Unicode/UTF-8/DiffItem.h"), text, true));
+		EXPECT_EQ(utf8WithBom, text);
+
+		EXPECT_FALSE(AnyCodepageToUTF8(ucr::CP_UTF_8, _T("../../Data/Unicode/NotFound.h"), text, false));
+	}
+
 }  // namespace
@@ -0,0 +1,160 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "xdiff_equivs.h"
+
+namespace
+{
+	struct Lines
+	{
+		explicit Lines(const std::string& text) : m_text(text)
+		{
+			const char *top = m_text.c_str() + m_text.size();
+			for (const char *cur = m_text.c_str(); cur < top; )
+			{
+				const char *prev = cur;
+				unsigned long ha = xdl_hash_record(&cur, top, 0);
+				m_recs.push_back({ nullptr, prev, static_cast<long>(cur - prev), ha });
+			}
+			for (auto& rec : m_recs)
+				m_precs.push_back(&rec);
+		}
+		long size() const { return static_cast<long>(m_recs.size()); }
+		std::string m_text;
+		std::vector<xrecord_t> m_recs;
+		std::vector<xrecord_t *> m_precs;
+	};
+
+	// The hash map based numbering EquivClassTable replaced
+	void reference_equivs(xrecord_t * const *recs, long nrec, int *out, std::vector<xrecord_t *>& equivs)
+	{
+		std::unordered_map<unsigned long, std::vector<int>> equivs_map;
+		for (int i = 0; i < static_cast<int>(equivs.size()); ++i)
+			equivs_map[equivs[i]->ha].push_back(i);
+		for (long i = 0; i < nrec; ++i)
+		{
+			std::vector<int>& classes = equivs_map[recs[i]->ha];
+			out[i] = -1;
+			for (int j : classes)
+			{
+				if (xdl_recmatch(equivs[j]->ptr, equivs[j]->size, recs[i]->ptr, recs[i]->size, 0))
+				{
+					out[i] = j;
+					break;
+				}
+			}
+			if (out[i] < 0)
+			{
+				out[i] = static_cast<int>(equivs.size());
+				classes.push_back(out[i]);
+				equivs.push_back(recs[i]);
+			}
+		}
+	}
+
+	// Every line repeats after nDistinct lines
+	std::string make_text(int nLines, int nDistinct, int seed)
+	{
+		std::string text;
+		for (int i = 0; i < nLines; ++i)
+			text += "\tvalue_" + std::to_string((i * 7 + seed) % nDistinct) + " = compute(a, b);\n";
+		return text;
+	}
+}
+
+TEST(xdiff_equivs, same_as_hash_map)
+{
+	for (int nDistinct : { 1, 10, 5000, 100000 })
+	{
+		Lines lines1(make_text(20000, nDistinct, 0));
+		Lines lines2(make_text(30000, nDistinct * 2 + 1, 3));
+		std::vector<int> expected1(lines1.size()), expected2(lines2.size());
+		std::vector<xrecord_t *> equivs;
+		reference_equivs(lines1.m_precs.data(), lines1.size(), expected1.data(), equivs);
+		reference_equivs(lines2.m_precs.data(), lines2.size(), expected2.data(), equivs);
+
+		EquivClassTable table;
+		// Too small on purpose, the table must grow
+		table.Clear(16);
+		std::vector<int> actual1(lines1.size()), actual2(lines2.size());
+		table.Append(lines1.m_precs.data(), lines1.size(), actual1.data(), 0);
+		table.Append(lines2.m_precs.data(), lines2.size(), actual2.data(), 0);
+		EXPECT_EQ(expected1, actual1);
+		EXPECT_EQ(expected2, actual2);
+		EXPECT_EQ(static_cast<int>(equivs.size()), table.GetClassCount());
+	}
+}
+
+TEST(xdiff_equivs, hash_collision)
+{
+	Lines lines("a\nb\nc\nb\na\n");
+	// Lines with the same hash but different text get different classes
+	for (auto& rec : lines.m_recs)
+		rec.ha = 42;
+	EquivClassTable table;
+	table.Clear(lines.size());
+	std::vector<int> equivs(lines.size());
+	table.Append(lines.m_precs.data(), lines.size(), equivs.data(), 0);
+	EXPECT_EQ((std::vector<int>{ 0, 1, 2, 1, 0 }), equivs);
+
+	// Clear() starts the numbering again
+	table.Clear(lines.size());
+	table.Append(lines.m_precs.data() + 2, 3, equivs.data(), 0);
+	EXPECT_EQ(0, equivs[0]);
+	EXPECT_EQ(1, equivs[1]);
+	EXPECT_EQ(2, equivs[2]);
+	EXPECT_EQ(3, table.GetClassCount());
+}
+
+TEST(xdiff_equivs, ignore_flags)
+{
+	std::string text = "a  b\na b\nA B\n";
+	Lines lines(text);
+	const char *top = lines.m_text.c_str() + lines.m_text.size();
+	const char *cur = lines.m_text.c_str();
+	for (auto& rec : lines.m_recs)
+		rec.ha = xdl_hash_record(&cur, top, XDF_IGNORE_WHITESPACE_CHANGE | XDF_IGNORE_CASE);
+	EquivClassTable table;
+	table.Clear(lines.size());
+	std::vector<int> equivs(lines.size());
+	table.Append(lines.m_precs.data(), lines.size(), equivs.data(), XDF_IGNORE_WHITESPACE_CHANGE | XDF_IGNORE_CASE);
+	EXPECT_EQ((std::vector<int>{ 0, 0, 0 }), equivs);
+}
+
+TEST(xdiff_equivs, DISABLED_benchmark)
+{
+	const int nLines = 1000000;
+	struct Case { const char *name; int nDistinct; } cases[] = {
+		{ "high duplication", 1000 },
+		{ "low duplication", nLines },
+	};
+	for (const auto& c : cases)
+	{
+		Lines lines1(make_text(nLines, c.nDistinct, 0));
+		Lines lines2(make_text(nLines, c.nDistinct, 5));
+		std::vector<int> equivs1(lines1.size()), equivs2(lines2.size());
+
+		auto start = std::chrono::steady_clock::now();
+		std::vector<xrecord_t *> equivs;
+		reference_equivs(lines1.m_precs.data(), lines1.size(), equivs1.data(), equivs);
+		reference_equivs(lines2.m_precs.data(), lines2.size(), equivs2.data(), equivs);
+		auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		std::cout << c.name << ", unordered_map: " << ms << " ms, " << equivs.size() << " classes" << std::endl;
+
+		EquivClassTable table;
+		for (int run = 0; run < 2; ++run)
+		{
+			start = std::chrono::steady_clock::now();
+			table.Clear(static_cast<size_t>(lines1.size() + lines2.size()));
+			table.Append(lines1.m_precs.data(), lines1.size(), equivs1.data(), 0);
+			table.Append(lines2.m_precs.data(), lines2.size(), equivs2.data(), 0);
+			ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+			std::cout << c.name << ", EquivClassTable" << (run ? " (reused)" : "") << ": "
+				<< ms << " ms, " << table.GetClassCount() << " classes" << std::endl;
+		}
+	}
+}
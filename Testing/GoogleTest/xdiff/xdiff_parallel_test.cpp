@@ -0,0 +1,106 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "xdiff_parallel.h"
+
+namespace
+{
+	// Lines are unique, so every unchanged line is an unambiguous anchor
+	void make_texts(int nLines, std::string& text1, std::string& text2)
+	{
+		text1.clear();
+		text2.clear();
+		for (int i = 0; i < nLines; ++i)
+		{
+			std::string line = "line " + std::to_string(i) + " of the test file\n";
+			text1 += line;
+			if (i % 997 == 0)
+				text2 += "changed " + line;
+			else if (i % 1499 == 0)
+				continue;
+			else
+				text2 += line;
+			if (i % 2003 == 0)
+				text2 += "inserted after " + std::to_string(i) + "\n";
+		}
+	}
+
+	mmfile_t make_mmfile(std::string& text)
+	{
+		mmfile_t mf;
+		mf.ptr = &text[0];
+		mf.size = static_cast<long>(text.size());
+		return mf;
+	}
+}
+
+static bool operator==(const xdiff_hunk& a, const xdiff_hunk& b)
+{
+	return a.i1 == b.i1 && a.i2 == b.i2 && a.chg1 == b.chg1 && a.chg2 == b.chg2 && a.ignore == b.ignore;
+}
+
+TEST(xdiff_parallel, split_points)
+{
+	std::string text1, text2;
+	make_texts(10000, text1, text2);
+	std::vector<xrecord_t> recs1, recs2;
+	xdiff_parallel::split_records(make_mmfile(text1), 0, recs1);
+	xdiff_parallel::split_records(make_mmfile(text2), 0, recs2);
+	EXPECT_EQ(10000, static_cast<int>(recs1.size()));
+
+	auto splits = xdiff_parallel::find_split_points(recs1, recs2, 0, 8);
+	ASSERT_EQ(9u, splits.size());
+	EXPECT_EQ(std::make_pair(0L, 0L), splits.front());
+	EXPECT_EQ(std::make_pair(static_cast<long>(recs1.size()), static_cast<long>(recs2.size())), splits.back());
+	for (size_t i = 1; i < splits.size(); ++i)
+	{
+		EXPECT_LT(splits[i - 1].first, splits[i].first);
+		EXPECT_LT(splits[i - 1].second, splits[i].second);
+		if (i + 1 < splits.size())
+			EXPECT_EQ(std::string(recs1[splits[i].first].ptr, recs1[splits[i].first].size),
+			          std::string(recs2[splits[i].second].ptr, recs2[splits[i].second].size));
+	}
+
+	// No common lines, no split
+	std::string text3 = "a\nb\nc\n", text4 = "d\ne\nf\n";
+	xdiff_parallel::split_records(make_mmfile(text3), 0, recs1);
+	xdiff_parallel::split_records(make_mmfile(text4), 0, recs2);
+	EXPECT_EQ(2u, xdiff_parallel::find_split_points(recs1, recs2, 0, 8).size());
+}
+
+TEST(xdiff_parallel, same_as_sequential)
+{
+	std::string text1, text2;
+	make_texts(200000, text1, text2);
+	for (unsigned long flags : { 0UL, static_cast<unsigned long>(XDF_HISTOGRAM_DIFF), static_cast<unsigned long>(XDF_PATIENCE_DIFF) })
+	{
+		xpparam_t xpp = { 0 };
+		xpp.flags = flags;
+		std::vector<xrecord_t> recs1, recs2;
+		std::vector<xdiff_hunk> sequential, parallel;
+		ASSERT_TRUE(xdiff_parallel::diff(make_mmfile(text1), make_mmfile(text2), xpp, 1, recs1, recs2, sequential));
+		ASSERT_TRUE(xdiff_parallel::diff(make_mmfile(text1), make_mmfile(text2), xpp, 4, recs1, recs2, parallel));
+		EXPECT_FALSE(sequential.empty());
+		EXPECT_TRUE(sequential == parallel);
+	}
+}
+
+TEST(xdiff_parallel, DISABLED_scaling_benchmark)
+{
+	std::string text1, text2;
+	make_texts(5000000, text1, text2);
+	xpparam_t xpp = { 0 };
+	xpp.flags = XDF_HISTOGRAM_DIFF;
+	for (int nThreads : { 1, 2, 4, 8, 16 })
+	{
+		std::vector<xrecord_t> recs1, recs2;
+		std::vector<xdiff_hunk> hunks;
+		auto start = std::chrono::steady_clock::now();
+		ASSERT_TRUE(xdiff_parallel::diff(make_mmfile(text1), make_mmfile(text2), xpp, nThreads, recs1, recs2, hunks));
+		auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		std::cout << nThreads << " threads: " << ms << " ms, " << hunks.size() << " hunks" << std::endl;
+	}
+}
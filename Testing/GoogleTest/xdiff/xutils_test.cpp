@@ -1,5 +1,8 @@
 #include "pch.h"
 #include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <string>
 extern "C"
 {
 	#include "../../Externals/xdiff/xinclude.h"
@@ -136,3 +139,80 @@ TEST(xutils, xdl_hash_record)
 	EXPECT_FALSE(hash_comp("1234a\r\n", "1234b\r\n", XDF_IGNORE_NUMBERS | XDF_IGNORE_CR_AT_EOL));
 	EXPECT_FALSE(hash_comp("a1234\r\n", "b1234\r\n", XDF_IGNORE_NUMBERS | XDF_IGNORE_CR_AT_EOL));
 }
+
+TEST(xutils, xdl_hash_record_eol)
+{
+	auto next_record = [](const char* data)
+	{
+		const char* ptr = data;
+		xdl_hash_record(&ptr, data + strlen(data), 0);
+		return static_cast<int>(ptr - data);
+	};
+	EXPECT_EQ(0, next_record(""));
+	EXPECT_EQ(2, next_record("ab"));
+	EXPECT_EQ(3, next_record("ab\n"));
+	EXPECT_EQ(3, next_record("ab\ncd"));
+	EXPECT_EQ(4, next_record("ab\r\ncd"));
+	EXPECT_EQ(3, next_record("ab\rcd"));
+	EXPECT_EQ(3, next_record("ab\r"));
+	EXPECT_EQ(3, next_record("ab\r\r\n"));
+	EXPECT_EQ(19, next_record("0123456789abcdefgh\nxyz"));
+	EXPECT_EQ(20, next_record("0123456789abcdefgh\r\nxyz"));
+
+	auto hash = [](const std::string& data)
+	{
+		const char* ptr = data.c_str();
+		return xdl_hash_record(&ptr, ptr + data.length(), 0);
+	};
+	// CR of CRLF is part of the line, a lone CR is not
+	EXPECT_NE(hash("1234a\r\n"), hash("1234a\n"));
+	EXPECT_EQ(hash("1234a\r"), hash("1234a\n"));
+	EXPECT_EQ(hash("1234a"), hash("1234a\n"));
+	for (size_t len = 0; len < 40; ++len)
+	{
+		std::string line(len, 'x');
+		EXPECT_EQ(hash(line + "\n"), hash(line + "\nnext line"));
+		if (len > 0)
+		{
+			std::string line2 = line;
+			line2[len - 1] = 'y';
+			EXPECT_NE(hash(line + "\n"), hash(line2 + "\n"));
+		}
+	}
+}
+
+TEST(xutils, DISABLED_xdl_hash_record_benchmark)
+{
+	std::string text;
+	for (int i = 0; text.size() < 256 * 1024 * 1024; ++i)
+		text += "\tstatic int line_" + std::to_string(i) + " = compute(a, b, c) + " + std::to_string(i * 7) + ";\r\n";
+
+	// Byte at a time hash used before
+	auto reference = [](char const** data, char const* top)
+	{
+		unsigned long ha = 5381;
+		char const* ptr = *data;
+		for (; ptr < top && *ptr != '\n' && (*ptr != '\r' || (ptr + 1 < top && ptr[1] == '\n')); ptr++)
+		{
+			ha += (ha << 5);
+			ha ^= static_cast<unsigned char>(*ptr);
+		}
+		*data = ptr < top ? ptr + 1 : ptr;
+		return ha;
+	};
+
+	char const* top = text.c_str() + text.length();
+	auto measure = [&](const char* name, auto hash_record)
+	{
+		auto start = std::chrono::steady_clock::now();
+		unsigned long sum = 0;
+		long nrec = 0;
+		for (char const* ptr = text.c_str(); ptr < top; ++nrec)
+			sum += hash_record(&ptr, top);
+		auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		std::cout << name << ": " << nrec << " lines, " << ms << " ms, "
+			<< (ms > 0 ? text.length() / 1000 / ms : 0) << " MB/s (" << sum << ")" << std::endl;
+	};
+	measure("byte at a time", reference);
+	measure("xdl_hash_record", [](char const** data, char const* top) { return xdl_hash_record(data, top, 0); });
+}